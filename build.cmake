@@ -4,5 +4,15 @@ list(APPEND OCPP_SRCS
 	${CMAKE_CURRENT_LIST_DIR}/src/ocpp.c
 	${CMAKE_CURRENT_LIST_DIR}/src/core/configuration.c
 	${CMAKE_CURRENT_LIST_DIR}/src/strconv.c
+	${CMAKE_CURRENT_LIST_DIR}/src/overrides.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/schema.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/decimal.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/iso8601.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/json_encoder.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/json_decoder.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/json_scan.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/cbor_encoder.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/cbor_decoder.c
+	${CMAKE_CURRENT_LIST_DIR}/src/codec/codec.c
 )
 list(APPEND OCPP_INCS ${CMAKE_CURRENT_LIST_DIR}/include)
@@ -8,5 +8,15 @@ OCPP_SRCS := \
 	$(ocpp-basedir)src/ocpp.c \
 	$(ocpp-basedir)src/core/configuration.c \
 	$(ocpp-basedir)src/strconv.c \
+	$(ocpp-basedir)src/overrides.c \
+	$(ocpp-basedir)src/codec/schema.c \
+	$(ocpp-basedir)src/codec/decimal.c \
+	$(ocpp-basedir)src/codec/iso8601.c \
+	$(ocpp-basedir)src/codec/json_encoder.c \
+	$(ocpp-basedir)src/codec/json_decoder.c \
+	$(ocpp-basedir)src/codec/json_scan.c \
+	$(ocpp-basedir)src/codec/cbor_encoder.c \
+	$(ocpp-basedir)src/codec/cbor_decoder.c \
+	$(ocpp-basedir)src/codec/codec.c \
 
 OCPP_INCS := $(ocpp-basedir)include
@@ -5,14 +5,15 @@
  */
 
 #include "ocpp/ocpp.h"
-#include <string.h>
-#include <errno.h>
+#include "ocpp/codec/schema.h"
 
 int ocpp_send_bootnotification(const struct ocpp_BootNotification *msg)
 {
-	if (strlen(msg->chargePointModel) <= 0 ||
-			strlen(msg->chargePointVendor) <= 0) {
-		return -EINVAL;
+	const int err = ocpp_validate(OCPP_MSG_BOOTNOTIFICATION, false,
+			msg, sizeof(*msg));
+
+	if (err) {
+		return err;
 	}
 
 	return ocpp_push_request(OCPP_MSG_BOOTNOTIFICATION, msg, sizeof(*msg), false);
@@ -20,8 +21,11 @@ int ocpp_send_bootnotification(const struct ocpp_BootNotification *msg)
 
 int ocpp_send_datatransfer(const struct ocpp_DataTransfer *msg)
 {
-	if (strlen(msg->vendorId) <= 0) {
-		return -EINVAL;
+	const int err = ocpp_validate(OCPP_MSG_DATA_TRANSFER, false,
+			msg, sizeof(*msg));
+
+	if (err) {
+		return err;
 	}
 
 	return ocpp_push_request(OCPP_MSG_DATA_TRANSFER, msg, sizeof(*msg), false);
@@ -0,0 +1,100 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CODEC_CBOR_H
+#define LIBMCU_OCPP_CODEC_CBOR_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/ocpp.h"
+
+/* Bounds the nesting of items skipped by the decoder, e.g. members it does
+ * not know of. The message structs themselves nest less than this. */
+#if !defined(OCPP_CBOR_MAX_DEPTH)
+#define OCPP_CBOR_MAX_DEPTH				8
+#endif
+
+struct ocpp_encoder_cursor;
+
+/**
+ * @brief Encodes a message into a CBOR frame.
+ *
+ * The frame has the shape of an OCPP-J one, in RFC 8949 CBOR: an array of
+ * `[2, "id", type, {...}]` for a CALL, `[3, "id", {...}]` for a CALLRESULT
+ * and `[4, "id", code, "description", {}]` for a CALLERROR. Names are not
+ * sent; the peer is expected to be built from the same message definitions:
+ *
+ * - the action is the ocpp_message_t and the error code the
+ *   ocpp_call_error_t as an unsigned integer
+ * - an object is a map keyed by the index of each field in its schema
+ * - an enum is the index of its name, and a flag the index of its bit
+ * - a decimal is the integer scaled as in the struct
+ * - a time is an epoch-based date/time, tag 1
+ *
+ * Flexible array members are encoded up to the payload size of @p msg, as
+ * for @ref ocpp_encode_json. No memory is allocated.
+ *
+ * @param[in] msg The message to encode.
+ * @param[out] buf Buffer to write the frame to. May be NULL if @p bufsize is
+ *             0, to get the size needed.
+ * @param[in] bufsize The size of @p buf.
+ * @param[out] len Length of the whole frame, set even when it does not fit.
+ *             May be NULL.
+ *
+ * @return 0 on success, -ENOBUFS if the frame does not fit in @p bufsize, or
+ *         -EINVAL if @p msg can not be represented.
+ */
+int ocpp_encode_cbor(const struct ocpp_message *msg,
+		void *buf, size_t bufsize, size_t *len);
+
+/**
+ * @brief Encodes the part of a CBOR frame from @p offset on.
+ *
+ * The CBOR counterpart of @ref ocpp_encode_json_at.
+ */
+int ocpp_encode_cbor_at(const struct ocpp_message *msg, size_t offset,
+		void *buf, size_t bufsize, size_t *len);
+
+/**
+ * @brief Encodes the next piece of a CBOR frame.
+ *
+ * The CBOR counterpart of @ref ocpp_encode_json_next.
+ */
+int ocpp_encode_cbor_next(const struct ocpp_message *msg,
+		struct ocpp_encoder_cursor *cursor, size_t offset,
+		void *buf, size_t bufsize, size_t *len);
+
+/**
+ * @brief Decodes a complete CBOR frame.
+ *
+ * The payload is laid out in @p payload as @ref ocpp_json_decoder_init does,
+ * so the two decoders are interchangeable. Members the schema does not know
+ * of are skipped, and a null value is taken as absent. Indefinite-length
+ * items are not accepted.
+ *
+ * @param[out] msg The message to fill in.
+ * @param[out] payload Buffer for the payload of @p msg.
+ * @param[in] bufsize The size of @p payload.
+ * @param[in] data The frame.
+ * @param[in] len Length of @p data.
+ *
+ * @return 0 on success, -EBADMSG if the frame is malformed or a value does
+ *         not match its member, -ERANGE if a value does not fit its member,
+ *         -ENOBUFS if the payload buffer is too small, -ENOTSUP for an
+ *         unknown action, or -ENOENT for a response to no pending request.
+ *         A decoded payload failing @ref ocpp_validate is reported with its
+ *         -EINVAL or -ERANGE.
+ */
+int ocpp_decode_cbor(struct ocpp_message *msg, void *payload, size_t bufsize,
+		const void *data, size_t len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CODEC_CBOR_H */
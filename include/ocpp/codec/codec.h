@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CODEC_CODEC_H
+#define LIBMCU_OCPP_CODEC_CODEC_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/ocpp.h"
+
+/* WebSocket subprotocols the codecs go by. CBOR is not part of OCPP, so it
+ * is for links between components built from the same message definitions,
+ * e.g. a charge point and its local controller. */
+#if !defined(OCPP_CODEC_JSON_SUBPROTOCOL)
+#define OCPP_CODEC_JSON_SUBPROTOCOL			"ocpp1.6"
+#endif
+#if !defined(OCPP_CODEC_CBOR_SUBPROTOCOL)
+#define OCPP_CODEC_CBOR_SUBPROTOCOL			"ocpp1.6+cbor"
+#endif
+/* Levels of nesting a frame encoded piece by piece is resumed from. Deeper
+ * elements are encoded again from the start of the one on this level. */
+#if !defined(OCPP_ENCODER_MAX_DEPTH)
+#define OCPP_ENCODER_MAX_DEPTH				6
+#endif
+
+/**
+ * @brief A point in a frame between two elements, to resume encoding from.
+ *
+ * An element is a field of an object, an item of a list or a string of a
+ * string list. The point is the start of the element at @p path[depth-1],
+ * inside the one at @p path[depth-2] and so on up to the fields of the
+ * payload. A depth of 0 is the start of the frame.
+ */
+struct ocpp_encoder_cursor {
+	size_t offset;	/* of the point in the frame */
+	uint32_t path[OCPP_ENCODER_MAX_DEPTH];
+	uint8_t depth;
+};
+
+struct ocpp_codec {
+	const char *subprotocol;
+	bool binary;	/* sent in binary frames rather than text frames */
+
+	int (*encode)(const struct ocpp_message *msg,
+			void *buf, size_t bufsize, size_t *len);
+	int (*encode_next)(const struct ocpp_message *msg,
+			struct ocpp_encoder_cursor *cursor, size_t offset,
+			void *buf, size_t bufsize, size_t *len);
+	int (*decode)(struct ocpp_message *msg, void *payload, size_t bufsize,
+			const void *data, size_t len);
+};
+
+/**
+ * @brief Picks the codec for a link from the subprotocols offered.
+ *
+ * The client offers the subprotocols it can speak in its order of preference
+ * in Sec-WebSocket-Protocol, and the server answers with the one chosen. Pass
+ * the header of either side: the first one known is taken. An offer of only
+ * @ref OCPP_CODEC_JSON_SUBPROTOCOL keeps a link to a third-party central
+ * system in OCPP-J.
+ *
+ * @param[in] subprotocols Comma-separated list of subprotocols. NULL or an
+ *            empty one is taken as OCPP-J.
+ *
+ * @return The codec, or NULL if none of @p subprotocols is known.
+ */
+const struct ocpp_codec *ocpp_negotiate_codec(const char *subprotocols);
+
+/**
+ * @brief Gets the codec going by a subprotocol.
+ *
+ * @param[in] subprotocol The subprotocol.
+ * @param[in] len Length of @p subprotocol.
+ *
+ * @return The codec, or NULL if @p subprotocol is not known.
+ */
+const struct ocpp_codec *ocpp_get_codec(const char *subprotocol, size_t len);
+
+/**
+ * @brief State of a frame being encoded piece by piece.
+ *
+ * Only positions in the frame are kept, so it takes no buffer of its own.
+ * Each piece is encoded from the last element started before it, rather
+ * than from the start of the frame.
+ */
+struct ocpp_encoder {
+	const struct ocpp_codec *codec;
+	const struct ocpp_message *msg;
+	size_t offset;	/* bytes given out so far */
+	struct ocpp_encoder_cursor cursor; /* the last point up to offset */
+	struct ocpp_encoder_cursor mark; /* the cursor before the last piece */
+};
+
+/**
+ * @brief Prepares @p enc to encode @p msg with @p codec.
+ *
+ * @p msg and its payload must stay unchanged until the whole frame is out.
+ */
+void ocpp_encoder_init(struct ocpp_encoder *enc,
+		const struct ocpp_codec *codec, const struct ocpp_message *msg);
+
+/**
+ * @brief Encodes the next piece of the frame.
+ *
+ * Fills @p buf with as much of the rest of the frame as fits, so that a frame
+ * of any size goes through a buffer of a fixed size, e.g. to be written to a
+ * non-blocking socket. When less than @p buf gets written out, pass the same
+ * buffer again with @ref ocpp_encoder_rewind for the part left.
+ *
+ * @param[in,out] enc The encoder.
+ * @param[out] buf Buffer for the piece.
+ * @param[in] bufsize The size of @p buf.
+ * @param[out] len Length of the piece.
+ *
+ * @return 0 if it is the last piece, -EAGAIN if more pieces follow, or
+ *         -EINVAL if the message can not be represented or @p bufsize is 0.
+ */
+int ocpp_encoder_next(struct ocpp_encoder *enc,
+		void *buf, size_t bufsize, size_t *len);
+
+/**
+ * @brief Takes back the last @p n bytes given, to have them encoded again.
+ *
+ * Going back no further than the last piece costs nothing more. Any further
+ * and the next piece is encoded from the start of the frame.
+ */
+void ocpp_encoder_rewind(struct ocpp_encoder *enc, size_t n);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CODEC_CODEC_H */
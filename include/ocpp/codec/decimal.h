@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CODEC_DECIMAL_H
+#define LIBMCU_OCPP_CODEC_DECIMAL_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The most digits below the point a fixed-point value can have. */
+#define OCPP_DECIMAL_MAX_SCALE				18
+/* Length of the longest decimal string, "-0.000000000000000001" or
+ * "-9223372036854775808", without a null terminator. */
+#define OCPP_DECIMAL_MAXLEN				21
+
+/**
+ * @brief Formats a fixed-point value as the shortest decimal string.
+ *
+ * @p v holds the value times 10^@p scale, e.g. 325 of scale 1 is "32.5".
+ * Trailing zeros below the point are not written, so 320 of scale 1 is "32".
+ * It does not go through printf() and so does not depend on the locale. The
+ * string fits ocpp_SampledValue.value as it is.
+ *
+ * @param[out] buf Buffer of @ref OCPP_DECIMAL_MAXLEN + 1 bytes at least. It
+ *             is null-terminated.
+ * @param[in] v The scaled value.
+ * @param[in] scale Number of the digits below the point in @p v.
+ *
+ * @return The length of the string, or -EINVAL if @p scale is greater than
+ *         @ref OCPP_DECIMAL_MAX_SCALE.
+ */
+int ocpp_format_decimal(char *buf, int64_t v, unsigned int scale);
+
+/**
+ * @brief Parses a JSON number into a fixed-point value.
+ *
+ * The digits below @p scale are truncated, e.g. "6.55" of scale 1 is 65. An
+ * exponent is accepted as JSON allows.
+ *
+ * @param[in] s The string, not necessarily null-terminated.
+ * @param[in] len The length of @p s.
+ * @param[in] scale Number of the digits below the point to keep.
+ * @param[out] v The value times 10^@p scale.
+ *
+ * @return 0 on success, -EBADMSG if @p s is not a number, or -ERANGE if the
+ *         scaled value does not fit in 64 bits.
+ */
+int ocpp_parse_decimal(const char *s, size_t len, unsigned int scale,
+		int64_t *v);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CODEC_DECIMAL_H */
@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CODEC_ISO8601_H
+#define LIBMCU_OCPP_CODEC_ISO8601_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Length of "YYYY-MM-DDTHH:MM:SSZ", without a null terminator. */
+#define OCPP_ISO8601_LEN				20
+
+/**
+ * @brief The date part of the last time formatted.
+ *
+ * Times in a frame mostly fall on the same day, so the calendar arithmetic is
+ * done once for all of them. It belongs to the caller, e.g. one per frame
+ * being encoded, so no state is shared between threads. Zero it to start.
+ */
+struct ocpp_iso8601_cache {
+	int64_t days;
+	bool valid;
+	char date[11];	/* "YYYY-MM-DDT" */
+};
+
+/**
+ * @brief Formats a time in UTC as "YYYY-MM-DDTHH:MM:SSZ".
+ *
+ * It does not go through gmtime() or strftime(), and it is reentrant.
+ *
+ * @param[out] buf Buffer of @ref OCPP_ISO8601_LEN bytes at least. No null
+ *             terminator is written.
+ * @param[in] t The time. The years 0 to 9999 can be represented.
+ * @param[in,out] cache The date of the last time formatted. May be NULL.
+ *
+ * @return @ref OCPP_ISO8601_LEN.
+ */
+size_t ocpp_format_iso8601(char *buf, time_t t,
+		struct ocpp_iso8601_cache *cache);
+
+/**
+ * @brief Parses "YYYY-MM-DDTHH:MM:SS[.fff][Z|+HH:MM|+HHMM|+HH]".
+ *
+ * The fraction of a second is dropped. A time without a zone designator is
+ * taken as UTC, as every OCPP peer sends it so.
+ *
+ * @param[in] s The string, not necessarily null-terminated.
+ * @param[in] len The length of @p s.
+ * @param[out] t The time.
+ *
+ * @return 0 on success, or -EBADMSG if @p s is not such a time.
+ */
+int ocpp_parse_iso8601(const char *s, size_t len, time_t *t);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CODEC_ISO8601_H */
@@ -0,0 +1,188 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CODEC_JSON_H
+#define LIBMCU_OCPP_CODEC_JSON_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/ocpp.h"
+
+struct ocpp_schema;
+struct ocpp_field;
+struct ocpp_encoder_cursor;
+
+/**
+ * @brief Encodes a message into an OCPP-J frame.
+ *
+ * Writes `[2,"id","Action",{...}]` for a CALL, `[3,"id",{...}]` for a
+ * CALLRESULT and `[4,"id","code","description",{}]` for a CALLERROR. The
+ * payload of a CALLERROR is a struct ocpp_CallError; without one, the error
+ * is sent as NotSupported, which is what the engine replies to unsupported
+ * requests.
+ *
+ * Flexible array members are encoded up to the payload size of @p msg, so the
+ * size pushed along with the payload must cover them. No memory is allocated.
+ *
+ * @param[in] msg The message to encode.
+ * @param[out] buf Buffer to write the frame to. May be NULL if @p bufsize is
+ *             0, to get the size needed.
+ * @param[in] bufsize The size of @p buf.
+ * @param[out] len Length of the whole frame, set even when it does not fit.
+ *             A null terminator is appended when there is room, but it is not
+ *             counted. May be NULL.
+ *
+ * @return 0 on success, -ENOBUFS if the frame does not fit in @p bufsize, or
+ *         -EINVAL if @p msg can not be represented.
+ */
+int ocpp_encode_json(const struct ocpp_message *msg,
+		void *buf, size_t bufsize, size_t *len);
+
+/**
+ * @brief Encodes the part of an OCPP-J frame from @p offset on.
+ *
+ * Same as @ref ocpp_encode_json, except that the frame is written to @p buf
+ * from its byte at @p offset. The message is encoded from its start and to
+ * its end, so sending a large frame in pieces goes through
+ * @ref ocpp_encode_json_next instead.
+ *
+ * @return 0 if the rest of the frame fits in @p bufsize, -ENOBUFS if not,
+ *         or -EINVAL if @p msg can not be represented.
+ */
+int ocpp_encode_json_at(const struct ocpp_message *msg, size_t offset,
+		void *buf, size_t bufsize, size_t *len);
+
+/**
+ * @brief Encodes the next piece of an OCPP-J frame.
+ *
+ * Writes the frame from its byte at @p offset, resuming at @p cursor, and
+ * stops once @p buf is full. No null terminator is appended. See
+ * @ref ocpp_encoder_next, which keeps the cursor and the offset.
+ *
+ * @param[in] msg The message to encode. It must not change in between.
+ * @param[in,out] cursor A point at or before @p offset, all zero for the
+ *                start of the frame. Moved to the last one up to the end of
+ *                the piece.
+ * @param[in] offset Where the piece starts in the frame.
+ * @param[out] buf Buffer for the piece.
+ * @param[in] bufsize The size of @p buf.
+ * @param[out] len Length of the piece.
+ *
+ * @return 0 if it is the last piece, -EAGAIN if more pieces follow, or
+ *         -EINVAL if @p msg can not be represented, @p bufsize is 0 or
+ *         @p cursor is past @p offset.
+ */
+int ocpp_encode_json_next(const struct ocpp_message *msg,
+		struct ocpp_encoder_cursor *cursor, size_t offset,
+		void *buf, size_t bufsize, size_t *len);
+
+#if !defined(OCPP_JSON_MAX_DEPTH)
+#define OCPP_JSON_MAX_DEPTH				8
+#endif
+/* Holds keys, enum names, numbers and times while they are being read. */
+#if !defined(OCPP_JSON_SCRATCH_LEN)
+#define OCPP_JSON_SCRATCH_LEN				48
+#endif
+
+/**
+ * @brief State of a frame being decoded.
+ *
+ * Declared here only to be allocated by the caller. Use it through
+ * @ref ocpp_json_decoder_init and @ref ocpp_json_decoder_feed.
+ */
+struct ocpp_json_decoder {
+	struct ocpp_message *msg;
+	uint8_t *payload;
+	size_t bufsize;
+	size_t used;
+
+	int err;
+	uint8_t state;
+	uint8_t nest;
+	uint8_t depth;
+	uint8_t skip;
+	uint64_t objects;
+	bool first;
+	bool key;
+
+	uint8_t sink;
+	char *str;
+	size_t str_len;
+	size_t str_cap;
+	uint16_t hex;
+	uint16_t surrogate;
+	uint8_t hex_count;
+
+	char scratch[OCPP_JSON_SCRATCH_LEN];
+	uint8_t scratch_len;
+	bool overflow;
+
+	struct ocpp_json_frame {
+		const struct ocpp_schema *schema;
+		const struct ocpp_field *field;
+		size_t base;
+		size_t cursor;
+		uint16_t count;
+		uint8_t kind;
+	} stack[OCPP_JSON_MAX_DEPTH];
+};
+
+/**
+ * @brief Prepares @p dec to decode a frame into @p msg.
+ *
+ * The payload struct of the message is built in @p payload, along with its
+ * flexible array members and the strings its pointer members point to. The
+ * buffer should be aligned for any of the message structs.
+ *
+ * @param[out] dec The decoder.
+ * @param[out] msg The message to fill in.
+ * @param[in] payload Buffer for the payload of @p msg.
+ * @param[in] bufsize The size of @p payload.
+ */
+void ocpp_json_decoder_init(struct ocpp_json_decoder *dec,
+		struct ocpp_message *msg, void *payload, size_t bufsize);
+
+/**
+ * @brief Decodes the next fragment of an OCPP-J frame.
+ *
+ * The input is parsed in a single pass as it arrives, straight into the
+ * payload struct, so a frame can be fed piece by piece as it is received.
+ * Members missing from the frame are left zeroed.
+ *
+ * The id of @p msg is set as soon as it is read, so that an error can still
+ * be answered when the rest of the frame is not usable.
+ *
+ * @param[in,out] dec The decoder.
+ * @param[in] data Next fragment of the frame.
+ * @param[in] len Length of @p data.
+ *
+ * @return 0 once the whole frame is decoded, -EAGAIN if more input is needed,
+ *         -EBADMSG if the frame is malformed or a value does not match its
+ *         member, -ERANGE if a value does not fit its member, -ENOBUFS if the
+ *         payload buffer is too small, -ENOTSUP for an unknown action, or
+ *         -ENOENT for a response to no pending request. A decoded payload
+ *         failing @ref ocpp_validate is reported with its -EINVAL or -ERANGE.
+ *         Errors are sticky until the decoder is initialized again.
+ */
+int ocpp_json_decoder_feed(struct ocpp_json_decoder *dec,
+		const void *data, size_t len);
+
+/**
+ * @brief Decodes a complete OCPP-J frame.
+ *
+ * Same as @ref ocpp_json_decoder_feed with the whole frame at once, except
+ * that a truncated frame is reported as -EBADMSG.
+ */
+int ocpp_decode_json(struct ocpp_message *msg, void *payload, size_t bufsize,
+		const void *data, size_t len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CODEC_JSON_H */
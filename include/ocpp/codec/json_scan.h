@@ -0,0 +1,79 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CODEC_JSON_SCAN_H
+#define LIBMCU_OCPP_CODEC_JSON_SCAN_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Set to 0 to build the scalar classifier only. */
+#if !defined(OCPP_JSON_SIMD)
+#define OCPP_JSON_SIMD					1
+#endif
+
+#define OCPP_JSON_SCAN_BLOCK_SIZE			64
+
+typedef enum {
+	OCPP_JSON_SCAN_SCALAR,
+	OCPP_JSON_SCAN_SSE2,
+	OCPP_JSON_SCAN_AVX2,
+	OCPP_JSON_SCAN_NEON,
+	OCPP_JSON_SCAN_AUTO,	/* the best one the CPU supports */
+} ocpp_json_scan_t;
+
+/* Character classes of a block, bit n for byte n. */
+struct ocpp_json_scan_mask {
+	uint64_t quote;
+	uint64_t backslash;
+	uint64_t control;	/* below 0x20 */
+	uint64_t space;		/* JSON whitespace */
+};
+
+/**
+ * @brief Classifies the bytes of a block.
+ *
+ * This is the first pass of the JSON decoder, which uses the masks to skip
+ * over whitespace and to copy string runs in bulk.
+ *
+ * @param[in] block @ref OCPP_JSON_SCAN_BLOCK_SIZE bytes to classify.
+ * @param[out] mask Character classes of @p block.
+ */
+void ocpp_json_scan(const void *block, struct ocpp_json_scan_mask *mask);
+
+/**
+ * @brief Selects the implementation of @ref ocpp_json_scan.
+ *
+ * The best one supported by the CPU is selected by default.
+ *
+ * @param[in] impl Implementation to use.
+ *
+ * @return 0 on success, or -ENOTSUP if @p impl is not available in this
+ *         build or on this CPU.
+ */
+int ocpp_json_scan_select(ocpp_json_scan_t impl);
+
+/**
+ * @brief Get the implementation in use.
+ *
+ * @return The implementation selected, never @ref OCPP_JSON_SCAN_AUTO.
+ */
+ocpp_json_scan_t ocpp_json_scan_selected(void);
+
+/**
+ * @brief Get the name of an implementation, e.g. "avx2".
+ */
+const char *ocpp_json_scan_stringify(ocpp_json_scan_t impl);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CODEC_JSON_SCAN_H */
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CODEC_SCHEMA_H
+#define LIBMCU_OCPP_CODEC_SCHEMA_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/ocpp.h"
+
+/* Set to 0 to leave out payload validation, e.g. in release builds. */
+#if !defined(OCPP_VALIDATION)
+#define OCPP_VALIDATION				1
+#endif
+
+/*
+ * Field descriptors of the message structs, shared by the wire codecs.
+ *
+ * Optional fields without a presence flag in the struct are taken as absent
+ * when they hold their zero value: an empty string, 0 for numbers and times,
+ * a NULL entry in the enum names and an all-zero object.
+ */
+
+typedef enum {
+	OCPP_FIELD_STRING,	/* char[size], null-terminated */
+	OCPP_FIELD_STRING_PTR,	/* const char *, NULL when absent */
+	OCPP_FIELD_TEXT,	/* char[] flexible array up to the payload end */
+	OCPP_FIELD_STRING_LIST,	/* char[] of null-terminated strings ended by
+				   an empty one or the payload end */
+	OCPP_FIELD_STRING_LIST_PTR, /* same as above, through a pointer */
+	OCPP_FIELD_INT,		/* signed integer of size bytes */
+	OCPP_FIELD_UINT,	/* unsigned integer of size bytes */
+	OCPP_FIELD_DECIMAL,	/* int scaled by 10^aux */
+	OCPP_FIELD_BOOL,
+	OCPP_FIELD_TIME,	/* time_t, ISO 8601 on the wire */
+	OCPP_FIELD_ENUM,	/* index into aux names at ref */
+	OCPP_FIELD_FLAG,	/* single bit flag, bit n named by names[n] */
+	OCPP_FIELD_OBJECT,	/* nested struct described by ref */
+	OCPP_FIELD_OBJECT_LIST_PTR, /* pointer to structs ended by one whose
+				       first field is empty */
+	OCPP_FIELD_ARRAY,	/* flexible array of ref elements, counted by
+				   the size-byte unsigned integer at aux */
+	OCPP_FIELD_RECORD,	/* flexible array holding variable-sized ref
+				   records up to the payload end */
+} ocpp_field_type_t;
+
+enum {
+	OCPP_FIELD_REQUIRED	= 0x01,
+	/* a single element on the wire is an array, e.g. an OBJECT whose
+	 * struct holds only one of them, or every RECORD up to the end */
+	OCPP_FIELD_LIST		= 0x02,
+};
+
+struct ocpp_schema;
+
+struct ocpp_field {
+	const char *name;	/* key on the wire */
+	uint16_t offset;
+	uint16_t size;		/* size of the member, or of the count member
+				   for OCPP_FIELD_ARRAY */
+	uint8_t type;		/* ocpp_field_type_t */
+	uint8_t flags;
+	uint16_t aux;
+	const void *ref;	/* const char * const [] or struct ocpp_schema */
+};
+
+struct ocpp_schema {
+	const char *name;
+	uint16_t size;		/* fixed part of the struct */
+	uint16_t align;
+	uint16_t nr_fields;
+	const struct ocpp_field *fields;
+};
+
+/**
+ * @brief Get the schema of a request or response struct.
+ *
+ * @param[in] type Type of the message.
+ * @param[in] response true for the _conf struct.
+ *
+ * @return The schema, or NULL if @p type is not valid.
+ */
+const struct ocpp_schema *ocpp_get_schema(ocpp_message_t type, bool response);
+
+/**
+ * @brief Size of a variable-sized record following the layout rule of
+ *        @ref OCPP_RECORD_SIZE.
+ *
+ * @param[in] schema Schema of the record.
+ * @param[in] record Start of the record.
+ * @param[in] avail Bytes available from @p record to the payload end.
+ *
+ * @return The size of the record including the padding to its alignment, or
+ *         0 if it does not fit in @p avail.
+ */
+size_t ocpp_get_record_size(const struct ocpp_schema *schema,
+		const void *record, size_t avail);
+
+/**
+ * @brief Checks a request or response payload against its schema.
+ *
+ * Required fields must be present, strings must end within their CiString
+ * bound, enums must be in range and arrays and records must fit in @p size.
+ * It is a single pass over the payload without allocation. The JSON decoder
+ * runs it on every payload it decodes. The typed C++ push wrappers run it
+ * only when built with OCPP_VALIDATE_ON_PUSH set to 1, since
+ * @ref ocpp_push_request does not.
+ *
+ * With @ref OCPP_VALIDATION set to 0, it always returns 0.
+ *
+ * @param[in] type Type of the message.
+ * @param[in] response true for the _conf struct.
+ * @param[in] payload The payload struct. NULL for messages without fields.
+ * @param[in] size The size of @p payload including its flexible array member.
+ *
+ * @return 0 if valid, -EINVAL if a required field is missing or @p payload is
+ *         too small, or -ERANGE if a value is out of its bounds.
+ */
+int ocpp_validate(ocpp_message_t type, bool response,
+		const void *payload, size_t size);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CODEC_SCHEMA_H */
@@ -0,0 +1,233 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CORO_HPP
+#define LIBMCU_OCPP_CORO_HPP
+
+#if !defined(__cpp_impl_coroutine)
+#error "ocpp/coro.hpp requires C++20 coroutines"
+#endif
+
+#include <cerrno>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+
+#include "ocpp/ocpp.hpp"
+
+/**
+ * @brief The number of requests awaited at once, across all coroutines.
+ */
+#if !defined(OCPP_CORO_CALL_SLOTS)
+#define OCPP_CORO_CALL_SLOTS		8
+#endif
+/**
+ * @brief The largest request payload that can be awaited, in bytes.
+ */
+#if !defined(OCPP_CORO_REQUEST_MAXLEN)
+#define OCPP_CORO_REQUEST_MAXLEN	OCPP_MESSAGE_MAX_FIXED_SIZE
+#endif
+
+namespace ocpp {
+
+/**
+ * @brief Outcome of an awaited request.
+ *
+ * @note @ref conf points to the payload of the received CALLRESULT, and
+ *       @ref call_error to that of the received CALLERROR. Either is only
+ *       valid until the coroutine suspends again, since the coroutine is
+ *       resumed from inside @ref ocpp_step.
+ */
+template <typename T>
+struct result {
+	ocpp_completion_t outcome;
+	int error; /**< 0, or the error returned when pushing the request. */
+	const response_t<T> *conf; /**< Set on OCPP_COMPLETION_RESULT only. */
+	/** Set on OCPP_COMPLETION_ERROR only. */
+	const struct ocpp_CallError *call_error;
+
+	explicit operator bool() const noexcept {
+		return error == 0 && outcome == OCPP_COMPLETION_RESULT;
+	}
+};
+
+namespace detail {
+
+/* The engine keeps pointing at a request and at its completion context until
+ * it frees the message, which is after the awaiting coroutine resumed and
+ * maybe ended. So the request is copied into a slot that lives that long, and
+ * the slot is the context, not the awaiter in the coroutine frame. A slot is
+ * taken again once the engine no longer knows its message. */
+struct call_slot {
+	alignas(std::max_align_t) unsigned char data[OCPP_CORO_REQUEST_MAXLEN];
+	void *awaiter; /* nullptr once completed */
+	bool busy;
+	bool completing;
+	char id[OCPP_MESSAGE_ID_MAXLEN]; /* of the response, if any */
+};
+
+inline call_slot call_slots[OCPP_CORO_CALL_SLOTS];
+
+inline bool is_slot_free(const call_slot &slot) noexcept {
+	if (!slot.busy) {
+		return true;
+	}
+	if (slot.awaiter != nullptr || slot.completing) {
+		return false;
+	}
+	/* without a response, the message is freed as the callback returns */
+	return slot.id[0] == '\0' || ocpp_get_message_by_id(slot.id) == NULL;
+}
+
+inline call_slot *alloc_slot() noexcept {
+	for (call_slot &slot : call_slots) {
+		if (is_slot_free(slot)) {
+			slot.busy = true;
+			slot.completing = false;
+			slot.id[0] = '\0';
+			return &slot;
+		}
+	}
+	return nullptr;
+}
+
+} /* namespace detail */
+
+/**
+ * @brief Awaiter which pushes a request and suspends until it completes.
+ *
+ * The awaiter lives in the coroutine frame. The request is copied into one of
+ * @ref OCPP_CORO_CALL_SLOTS static slots, which is handed to the engine as the
+ * completion context, so no allocation is made per await and the events
+ * dispatched after the coroutine resumed never point into its frame. A
+ * request larger than @ref OCPP_CORO_REQUEST_MAXLEN resumes at once with
+ * -ENOBUFS, and one finding no free slot with -ENOMEM.
+ */
+template <typename T>
+class call_awaiter {
+public:
+	call_awaiter(const void *data, size_t size) noexcept
+		: data_(data), size_(size),
+		res_{OCPP_COMPLETION_DROPPED, 0, nullptr, nullptr} {}
+
+	bool await_ready() const noexcept {
+		return false;
+	}
+
+	bool await_suspend(std::coroutine_handle<> handle) noexcept {
+		handle_ = handle;
+		res_.error = validate(message_traits<T>::type, false,
+				data_, size_);
+		if (res_.error == 0) {
+			res_.error = push();
+		}
+		/* resume immediately when the request could not be queued */
+		return res_.error == 0;
+	}
+
+	result<T> await_resume() const noexcept {
+		return res_;
+	}
+
+private:
+	int push() noexcept {
+		if (size_ > OCPP_CORO_REQUEST_MAXLEN) {
+			return -ENOBUFS;
+		}
+
+		detail::call_slot *slot = detail::alloc_slot();
+		if (slot == nullptr) {
+			return -ENOMEM;
+		}
+
+		std::memcpy(slot->data, data_, size_);
+		slot->awaiter = this;
+
+		const int err = ocpp_push_request_cb(message_traits<T>::type,
+				slot->data, size_, on_complete, slot);
+		if (err != 0) {
+			slot->awaiter = nullptr;
+			slot->busy = false;
+		}
+
+		return err;
+	}
+
+	static void on_complete(ocpp_completion_t outcome,
+			const struct ocpp_message *response, void *ctx) {
+		detail::call_slot *slot = static_cast<detail::call_slot *>(ctx);
+		call_awaiter *self = static_cast<call_awaiter *>(slot->awaiter);
+
+		slot->awaiter = nullptr;
+		slot->completing = true;
+		if (response != nullptr) {
+			std::memcpy(slot->id, response->id, sizeof(slot->id));
+		}
+
+		self->res_.outcome = outcome;
+		if (outcome == OCPP_COMPLETION_RESULT) {
+			self->res_.conf = static_cast<const response_t<T> *>(
+					response->payload.fmt.response);
+		} else if (outcome == OCPP_COMPLETION_ERROR) {
+			self->res_.call_error =
+				static_cast<const struct ocpp_CallError *>(
+					response->payload.fmt.response);
+		}
+
+		self->handle_.resume();
+		slot->completing = false;
+	}
+
+	const void *data_;
+	size_t size_;
+	result<T> res_;
+	std::coroutine_handle<> handle_;
+};
+
+/**
+ * @brief Pushes @p req and awaits its completion.
+ *
+ * @code
+ * ocpp::task session(const ocpp::StartTransaction &req) {
+ *	auto res = co_await ocpp::call<ocpp::StartTransaction>(req);
+ *	if (res) {
+ *		transaction_id = res.conf->transactionId;
+ *	}
+ * }
+ * @endcode
+ */
+template <typename T>
+call_awaiter<T> call(const T &req) noexcept {
+	assert_charge_point_request<T>();
+	assert_fixed_size<T>();
+	return call_awaiter<T>(&req, sizeof(req));
+}
+
+template <typename T, size_t N>
+call_awaiter<T> call(const builder<T, N> &req) noexcept {
+	assert_charge_point_request<T>();
+	return call_awaiter<T>(req.data(), req.size());
+}
+
+/**
+ * @brief Eagerly started, detached coroutine.
+ *
+ * The frame is the only allocation and is released as soon as the coroutine
+ * body returns.
+ */
+struct task {
+	struct promise_type {
+		task get_return_object() noexcept { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() noexcept { std::terminate(); }
+	};
+};
+
+} /* namespace ocpp */
+
+#endif /* LIBMCU_OCPP_CORO_HPP */
@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_CSMS_H
+#define LIBMCU_OCPP_CSMS_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/ocpp.h"
+
+/* Raw bytes received from the charge point and not processed yet. */
+#if !defined(OCPP_CSMS_RX_BUFSIZE)
+#define OCPP_CSMS_RX_BUFSIZE				4096
+#endif
+/* Frames queued for the socket. */
+#if !defined(OCPP_CSMS_TX_BUFSIZE)
+#define OCPP_CSMS_TX_BUFSIZE				8192
+#endif
+/* The decoded payload of the last call received. */
+#if !defined(OCPP_CSMS_PAYLOAD_BUFSIZE)
+#define OCPP_CSMS_PAYLOAD_BUFSIZE			4096
+#endif
+/* Answers held back for the latency, and calls of the central system
+ * awaiting their reply, each. */
+#if !defined(OCPP_CSMS_MAX_PENDING)
+#define OCPP_CSMS_MAX_PENDING				16
+#endif
+/* An answer encoded. A larger one is not sent. */
+#if !defined(OCPP_CSMS_ANSWER_MAXLEN)
+#define OCPP_CSMS_ANSWER_MAXLEN				512
+#endif
+
+/*
+ * Central system emulator speaking OCPP-J over WebSocket on localhost.
+ *
+ * It answers BootNotification, Heartbeat, Authorize, StartTransaction,
+ * StopTransaction, MeterValues and StatusNotification after a configurable
+ * latency, and the rest with a NotImplemented CALLERROR. A share of the
+ * calls may be left unanswered, answered with an InternalError CALLERROR or
+ * have the connection dropped on, drawn from a seeded generator so that a
+ * run repeats. Requests of the central system, e.g. Reset, go out with
+ * @ref ocpp_csms_call.
+ *
+ * It serves one charge point at a time, a new connection taking over the
+ * one before, and runs on the thread calling @ref ocpp_csms_poll. Being
+ * driven by hand, it shares the thread with the engine and the transport of
+ * ocpp/ws.h in a test, or runs a process of its own for benchmarks. Frames
+ * are not to be fragmented nor compressed.
+ *
+ * src/csms/csms.c is meant for host builds and tests only and is not part of
+ * OCPP_SRCS. Build it along with the JSON codec and src/ws/ws_simd.c.
+ */
+
+struct ocpp_csms_param {
+	uint16_t port;			/**< 0 for one picked by the kernel. */
+	uint32_t latency_ms;		/**< Before every answer. */
+	uint32_t jitter_ms;		/**< Added to the latency, up to. */
+	uint8_t drop_pct;		/**< Calls left unanswered. */
+	uint8_t callerror_pct;		/**< Calls answered with a CALLERROR. */
+	uint8_t disconnect_pct;		/**< Calls dropping the connection. */
+	uint32_t seed;			/**< Of the draws. 0 is taken as 1. */
+	ocpp_boot_status_t boot_status;
+	uint32_t heartbeat_interval;	/**< Seconds, for BootNotification. */
+};
+
+/**
+ * @brief Called for every message of the charge point.
+ *
+ * @param[in] msg The message. A call comes decoded. A reply comes with
+ *            the type of the call it answers and no payload, and a reply to
+ *            no call of @ref ocpp_csms_call is not told of.
+ * @param[in] text The message as received, not null-terminated.
+ * @param[in] len Length of @p text.
+ * @param[in] ctx The context given to @ref ocpp_csms_start.
+ */
+typedef void (*ocpp_csms_callback_t)(const struct ocpp_message *msg,
+		const char *text, size_t len, void *ctx);
+
+struct ocpp_csms_stats {
+	uint32_t connections;	/**< Handshakes completed. */
+	uint32_t received;	/**< Calls of the charge point. */
+	uint32_t answered;	/**< CALLRESULTs sent. */
+	uint32_t errors;	/**< CALLERRORs sent, injected or not. */
+	uint32_t dropped;	/**< Calls left unanswered on purpose. */
+	uint32_t disconnects;	/**< Connections dropped on purpose. */
+	uint32_t calls;		/**< Calls of the central system sent. */
+	uint32_t replies;	/**< Replies to them received. */
+};
+
+/**
+ * @brief Starts listening on 127.0.0.1.
+ *
+ * @param[in] param The behavior. It is copied.
+ * @param[in] cb Called for every message of the charge point. May be NULL.
+ * @param[in] ctx Context passed to @p cb.
+ *
+ * @return 0 on success, -EALREADY if started already, or a negative errno of
+ *         the socket.
+ */
+int ocpp_csms_start(const struct ocpp_csms_param *param,
+		ocpp_csms_callback_t cb, void *ctx);
+
+/**
+ * @brief Closes the connection and stops listening.
+ */
+void ocpp_csms_stop(void);
+
+/**
+ * @brief Gets the port listening on, e.g. to connect to the one picked by
+ *        the kernel.
+ *
+ * @return The port, or 0 when not started.
+ */
+uint16_t ocpp_csms_get_port(void);
+
+/**
+ * @brief Accepts a connection, takes what came in and sends the answers due.
+ *
+ * @param[in] timeout_ms Milliseconds to wait for something to do at most,
+ *            0 not to block or -1 to wait for as long as it takes. It is
+ *            cut short by the next answer due.
+ *
+ * @return 0 on success, -EINVAL if not started, or a negative errno of
+ *         poll() or accept(). The connection failing is not an error.
+ */
+int ocpp_csms_poll(int timeout_ms);
+
+/**
+ * @brief Tells if a charge point is connected, with the handshake done.
+ */
+bool ocpp_csms_connected(void);
+
+/**
+ * @brief Sends a request of the central system, with no latency.
+ *
+ * The reply is told of to the callback.
+ *
+ * @param[in] type The type of the request.
+ * @param[in] data The payload, e.g. struct ocpp_Reset.
+ * @param[in] datasize The size of @p data.
+ * @param[out] id The id given to the request. May be NULL.
+ *
+ * @return 0 on success, -ENOTCONN if no charge point is connected,
+ *         -ENOBUFS if too many are awaiting their reply or the frame does
+ *         not fit, or a negative errno of the encoder.
+ */
+int ocpp_csms_call(ocpp_message_t type, const void *data, size_t datasize,
+		char id[OCPP_MESSAGE_ID_MAXLEN]);
+
+/**
+ * @brief Drops the connection with no close frame, as if the link was lost.
+ */
+void ocpp_csms_disconnect(void);
+
+void ocpp_csms_get_stats(struct ocpp_csms_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_CSMS_H */
@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_MESSAGES_H
+#define LIBMCU_OCPP_MESSAGES_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/type.h"
+
+#if !defined(OCPP_MESSAGE_DEFINES)
+#define OCPP_MESSAGE_DEFINES		"ocpp_messages.def"
+#endif
+
+#define OCPP_DECL_STRING(m, len)		char m[len];
+#define OCPP_DECL_STRING_PTR(m, x)		char *m;
+#define OCPP_DECL_TEXT(m, x)			char m[];
+#define OCPP_DECL_STRING_LIST(m, x)		char m[];
+#define OCPP_DECL_STRING_LIST_PTR(m, x)		char *m;
+#define OCPP_DECL_INT(m, type)			type m;
+#define OCPP_DECL_UINT(m, type)			type m;
+#define OCPP_DECL_DECIMAL(m, scale)		int m;
+#define OCPP_DECL_BOOL(m, x)			bool m;
+#define OCPP_DECL_TIME(m, x)			time_t m;
+#define OCPP_DECL_ENUM(m, x)			ocpp_##x##_t m;
+#define OCPP_DECL_FLAG(m, x)			ocpp_##x##_t m;
+#define OCPP_DECL_OBJECT(m, x)			struct ocpp_##x m;
+#define OCPP_DECL_OBJECT_LIST_PTR(m, x)		struct ocpp_##x *m;
+#define OCPP_DECL_ARRAY(m, x)			uint8_t m[];
+#define OCPP_DECL_RECORD(m, x)			uint8_t m[];
+
+#define OCPP_STRUCT(name)			struct ocpp_##name {
+#define OCPP_STRUCT_END(name)			};
+#define OCPP_FIELD(name, m, kind, arg, flags)	OCPP_DECL_##kind(m, arg)
+#define OCPP_FIELD_AS(name, m, key, kind, arg, flags)	\
+						OCPP_DECL_##kind(m, arg)
+#define OCPP_MEMBER(name, m, type)		type m;
+#define OCPP_EMPTY(name, m)			struct ocpp_##name { int m; };
+#define OCPP_MESSAGE(type, name)
+#include OCPP_MESSAGE_DEFINES
+#undef OCPP_MESSAGE
+#undef OCPP_EMPTY
+#undef OCPP_MEMBER
+#undef OCPP_FIELD_AS
+#undef OCPP_FIELD
+#undef OCPP_STRUCT_END
+#undef OCPP_STRUCT
+
+/* Not to be instantiated but to get the size of the largest payload. */
+#define OCPP_STRUCT(name)
+#define OCPP_STRUCT_END(name)
+#define OCPP_FIELD(name, m, kind, arg, flags)
+#define OCPP_FIELD_AS(name, m, key, kind, arg, flags)
+#define OCPP_MEMBER(name, m, type)
+#define OCPP_EMPTY(name, m)
+#define OCPP_MESSAGE(type, name)				\
+	uint8_t name[sizeof(struct ocpp_##name)];		\
+	uint8_t name##_conf[sizeof(struct ocpp_##name##_conf)];
+union ocpp_message_sizes {
+#include OCPP_MESSAGE_DEFINES
+};
+#undef OCPP_MESSAGE
+#undef OCPP_EMPTY
+#undef OCPP_MEMBER
+#undef OCPP_FIELD_AS
+#undef OCPP_FIELD
+#undef OCPP_STRUCT_END
+#undef OCPP_STRUCT
+
+#undef OCPP_DECL_RECORD
+#undef OCPP_DECL_ARRAY
+#undef OCPP_DECL_OBJECT_LIST_PTR
+#undef OCPP_DECL_OBJECT
+#undef OCPP_DECL_FLAG
+#undef OCPP_DECL_ENUM
+#undef OCPP_DECL_TIME
+#undef OCPP_DECL_BOOL
+#undef OCPP_DECL_DECIMAL
+#undef OCPP_DECL_UINT
+#undef OCPP_DECL_INT
+#undef OCPP_DECL_STRING_LIST_PTR
+#undef OCPP_DECL_STRING_LIST
+#undef OCPP_DECL_TEXT
+#undef OCPP_DECL_STRING_PTR
+#undef OCPP_DECL_STRING
+
+/* The largest fixed part of the request and response structs, without the
+ * flexible array members, e.g. to size a decoding buffer. */
+#define OCPP_MESSAGE_MAX_FIXED_SIZE	sizeof(union ocpp_message_sizes)
+
+#define OCPP_METER_VALUE_SIZE(nr_sampledValue)				\
+	OCPP_RECORD_SIZE(struct ocpp_MeterValue, sampledValue,		\
+			struct ocpp_SampledValue, nr_sampledValue)
+#define OCPP_CHARGING_SCHEDULE_SIZE(nr_period)				\
+	OCPP_RECORD_SIZE(struct ocpp_ChargingSchedule, chargingSchedulePeriod, \
+			struct ocpp_ChargingSchedulePeriod, nr_period)
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_MESSAGES_H */
@@ -26,6 +26,12 @@ extern "C" {
 #if !defined(OCPP_DEFAULT_TX_TIMEOUT_SEC)
 #define OCPP_DEFAULT_TX_TIMEOUT_SEC		10
 #endif
+/* Seconds between Heartbeats sent only to synchronize the clock, once
+ * WebSocketPingInterval has the transport keep the link alive. OCPP 1.6
+ * advises one a day at least. A longer HeartbeatInterval is taken over. */
+#if !defined(OCPP_CLOCK_SYNC_INTERVAL_SEC)
+#define OCPP_CLOCK_SYNC_INTERVAL_SEC		86400
+#endif
 
 enum ocpp_event {
 	OCPP_EVENT_MESSAGE_INCOMING,
@@ -38,6 +44,25 @@ typedef int ocpp_event_t;
 typedef void (*ocpp_event_callback_t)(ocpp_event_t event_type,
 		const struct ocpp_message *message, void *ctx);
 
+typedef enum {
+	OCPP_COMPLETION_RESULT,		/* CALLRESULT received */
+	OCPP_COMPLETION_ERROR,		/* CALLERROR received, no more retries */
+	OCPP_COMPLETION_TIMEOUT,	/* no response after all attempts */
+	OCPP_COMPLETION_DROPPED,	/* removed from the queue */
+} ocpp_completion_t;
+
+/**
+ * @brief Per-request completion callback.
+ *
+ * @param[in] outcome How the request ended.
+ * @param[in] response The received CALLRESULT or CALLERROR message. NULL for
+ *            @ref OCPP_COMPLETION_TIMEOUT and @ref OCPP_COMPLETION_DROPPED.
+ *            Valid only during the callback.
+ * @param[in] ctx The context given to @ref ocpp_push_request_cb.
+ */
+typedef void (*ocpp_completion_callback_t)(ocpp_completion_t outcome,
+		const struct ocpp_message *response, void *ctx);
+
 struct ocpp_message {
 	char id[OCPP_MESSAGE_ID_MAXLEN];
 	ocpp_message_role_t role;
@@ -99,6 +124,31 @@ int ocpp_step(void);
 int ocpp_push_request(ocpp_message_t type,
 		const void *data, size_t datasize, void *ctx);
 
+/**
+ * @brief Pushes a new OCPP request message with a completion callback.
+ *
+ * Works like @ref ocpp_push_request, but the outcome of the request is also
+ * delivered to @p on_complete exactly once, so the caller does not need to
+ * match the response ID back to its own state. The callback is invoked from
+ * @ref ocpp_step with the OCPP lock released, in addition to the events
+ * dispatched to the global event callback. A request dropped to make room
+ * for @ref ocpp_push_request_force is told of on the next @ref ocpp_step
+ * too, never from within the push.
+ *
+ * @param[in] type The type of the OCPP message.
+ * @param[in] data Pointer to the data to be included in the message.
+ * @param[in] datasize Size of the data in bytes.
+ * @param[in] on_complete The callback to be invoked when the request is done.
+ * @param[in] ctx User-defined context to be associated with the message and
+ *            passed to @p on_complete.
+ *
+ * @return Returns 0 if the request was successfully pushed, non-zero
+ *         otherwise.
+ */
+int ocpp_push_request_cb(ocpp_message_t type, const void *data,
+		size_t datasize, ocpp_completion_callback_t on_complete,
+		void *ctx);
+
 /**
  * @brief Pushes an OCPP request message forcefully.
  *
@@ -180,6 +230,44 @@ ocpp_get_message_by_id(const char id[OCPP_MESSAGE_ID_MAXLEN]);
  */
 size_t ocpp_count_pending_requests(void);
 
+/**
+ * @brief Tells the engine whether the link to the central system is up.
+ *
+ * The transport, or whatever manages it, e.g. ocpp/ws_link.h, reports the
+ * link going down and coming back. The link is taken as up until told
+ * otherwise, as it was before this existed.
+ *
+ * While down, nothing is sent and no attempt is counted, so no message is
+ * dropped for running out of retries, and no Heartbeat is queued. The
+ * requests awaiting their reply go back to the queue, in order, with the
+ * attempt the link took away not counted. Once back up, a BootNotification
+ * not accepted yet is sent first, then the queue is drained one by one.
+ *
+ * @param[in] connected true for the link up, false for down.
+ */
+void ocpp_set_connected(bool connected);
+
+/**
+ * @brief Tells whether the link is up, as last reported by
+ *        @ref ocpp_set_connected.
+ */
+bool ocpp_is_connected(void);
+
+/**
+ * @brief Get the earliest time at which @ref ocpp_step has work to do.
+ *
+ * Covers retries and timeouts of requests in flight, deferred requests,
+ * queued messages and the next Heartbeat. Messages yet to be received are not
+ * known to the engine and thus not taken into account. While the link is
+ * down, only deferred requests are.
+ *
+ * @param[out] deadline Time at which @ref ocpp_step should be called next. It
+ *             may be in the past, meaning that work is already due.
+ *
+ * @return 0 on success, -ENOENT if nothing is scheduled.
+ */
+int ocpp_get_next_deadline(time_t *deadline);
+
 /**
  * @brief Converts an OCPP message type to its string representation.
  *
@@ -199,6 +287,19 @@ const char *ocpp_stringify_type(ocpp_message_t msgtype);
  */
 ocpp_message_t ocpp_get_type_from_string(const char *typestr);
 
+/**
+ * @brief Get message type from a length-delimited message type string
+ *
+ * Unlike @ref ocpp_get_type_from_string, @p typestr does not need to be
+ * NUL-terminated, so it can point straight into a received frame.
+ *
+ * @param[in] typestr The string representation of the OCPP message type.
+ * @param[in] len Length of @p typestr in bytes.
+ *
+ * @return Type of message. `OCPP_MSG_MAX` if no matching found.
+ */
+ocpp_message_t ocpp_get_type_from_strn(const char *typestr, size_t len);
+
 /**
  * @brief Get message type from ID string
  *
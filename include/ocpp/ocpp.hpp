@@ -0,0 +1,386 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_HPP
+#define LIBMCU_OCPP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "ocpp/traits.hpp"
+#include "ocpp/codec/schema.h"
+
+namespace ocpp {
+
+/**
+ * @brief Read-only view of contiguous elements.
+ */
+template <typename T>
+class span {
+public:
+	constexpr span() noexcept : data_(nullptr), size_(0) {}
+	constexpr span(const T *data, size_t size) noexcept
+		: data_(data), size_(size) {}
+	template <size_t N>
+	constexpr span(const T (&arr)[N]) noexcept : data_(arr), size_(N) {}
+	template <typename C,
+		typename = decltype(std::declval<const C &>().data())>
+	constexpr span(const C &c) noexcept
+		: data_(c.data()), size_(c.size()) {}
+
+	constexpr const T *data() const noexcept { return data_; }
+	constexpr size_t size() const noexcept { return size_; }
+
+private:
+	const T *data_;
+	size_t size_;
+};
+
+/* Describes the flexible array member of a struct: its element type and
+ * offset, plus the member holding the element count when there is one. */
+template <typename T> struct flexible_traits {
+	static constexpr bool is_flexible = false;
+};
+
+#define OCPP_DEFINE_FLEXIBLE(type, member, elem)			\
+	template <> struct flexible_traits<type> {			\
+		static constexpr bool is_flexible = true;		\
+		static constexpr bool has_count = false;		\
+		static constexpr size_t offset = offsetof(type, member);\
+		using element = elem;					\
+	};
+#define OCPP_DEFINE_FLEXIBLE_COUNTED(type, member, elem, count)	\
+	template <> struct flexible_traits<type> {			\
+		static constexpr bool is_flexible = true;		\
+		static constexpr bool has_count = true;			\
+		static constexpr size_t offset = offsetof(type, member);\
+		using element = elem;					\
+		static void set_count(type &x, size_t n) {		\
+			x.count = static_cast<decltype(x.count)>(n);	\
+		}							\
+	};
+
+OCPP_DEFINE_FLEXIBLE(::ocpp_DataTransfer, data, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_DataTransfer_conf, data, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_GetConfiguration, keys, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_MeterValues, meterValue, ::ocpp_MeterValue)
+OCPP_DEFINE_FLEXIBLE(::ocpp_RemoteStartTransaction, chargingProfile,
+		::ocpp_ChargingProfile)
+OCPP_DEFINE_FLEXIBLE(::ocpp_StopTransaction, meterValue, ::ocpp_MeterValue)
+OCPP_DEFINE_FLEXIBLE(::ocpp_GetCompositeSchedule_conf, chargingSchedule,
+		::ocpp_ChargingSchedule)
+OCPP_DEFINE_FLEXIBLE(::ocpp_SetChargingProfile, csChargingProfiles,
+		::ocpp_ChargingProfile)
+OCPP_DEFINE_FLEXIBLE(::ocpp_CertificateSigned, certificateChain, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_GetLog, log, ::ocpp_LogParameters)
+OCPP_DEFINE_FLEXIBLE(::ocpp_GetLog_conf, filename, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_InstallCertificate, certificate, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_SecurityEventNotification, techInfo, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_SignCertificate, csr, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_LogParameters, remoteLocation, char)
+OCPP_DEFINE_FLEXIBLE(::ocpp_ChargingProfile, chargingSchedule,
+		::ocpp_ChargingSchedule)
+OCPP_DEFINE_FLEXIBLE_COUNTED(::ocpp_MeterValue, sampledValue,
+		::ocpp_SampledValue, nr_sampledValue)
+OCPP_DEFINE_FLEXIBLE_COUNTED(::ocpp_ChargingSchedule, chargingSchedulePeriod,
+		::ocpp_ChargingSchedulePeriod, nr_chargingSchedulePeriod)
+
+#undef OCPP_DEFINE_FLEXIBLE_COUNTED
+#undef OCPP_DEFINE_FLEXIBLE
+
+template <typename T>
+inline constexpr bool is_flexible_v = flexible_traits<T>::is_flexible;
+
+template <typename T>
+using element_t = typename flexible_traits<T>::element;
+
+/* true when R is the element type of T's flexible array or of any record
+ * nested in it */
+template <typename T, typename R, bool = is_flexible_v<T>>
+struct is_nested_element : std::false_type {};
+template <typename T, typename R>
+struct is_nested_element<T, R, true>
+	: std::bool_constant<std::is_same_v<element_t<T>, R> ||
+		is_nested_element<element_t<T>, R>::value> {};
+
+constexpr size_t align_up(size_t x, size_t align) noexcept {
+	return ((x + align - 1) / align) * align;
+}
+
+/**
+ * @brief Size of @p T with @p n elements in its flexible array.
+ *
+ * Matches @ref OCPP_RECORD_SIZE for records like struct ocpp_MeterValue.
+ */
+template <typename T>
+constexpr size_t payload_size(size_t n) noexcept {
+	static_assert(is_flexible_v<T>, "T has no flexible array member");
+	static_assert(!is_flexible_v<element_t<T>>,
+			"elements are variable-sized; use ocpp::builder");
+	return align_up(flexible_traits<T>::offset + n * sizeof(element_t<T>),
+			alignof(T));
+}
+
+template <typename T>
+constexpr size_t payload_size(span<element_t<T>> elems) noexcept {
+	return payload_size<T>(elems.size());
+}
+
+/**
+ * @brief Builds a request with flexible array payloads in place.
+ *
+ * The payload is laid out exactly as the C API expects, in a buffer of
+ * @p Capacity bytes, and @ref size reports the exact size to be pushed. Element
+ * counts like nr_sampledValue are filled in from the spans given.
+ *
+ * @code
+ * ocpp::builder<ocpp::MeterValues, 256> b({ .connectorId = 1 });
+ * b.append(ocpp_MeterValue{ .timestamp = now }, samples);
+ * ocpp::push_request(b);
+ * @endcode
+ *
+ * @note The engine keeps a pointer to the payload until the message is freed,
+ *       so the builder must outlive the request.
+ */
+template <typename T, size_t Capacity>
+class builder {
+	static_assert(is_flexible_v<T>, "T has no flexible array member");
+	static_assert(Capacity >= flexible_traits<T>::offset,
+			"Capacity is smaller than the fixed part of T");
+public:
+	explicit builder(const T &head) noexcept
+		: size_(flexible_traits<T>::offset) {
+		std::memcpy(buf_, &head, flexible_traits<T>::offset);
+	}
+
+	T &head() noexcept { return *reinterpret_cast<T *>(buf_); }
+	const T &head() const noexcept {
+		return *reinterpret_cast<const T *>(buf_);
+	}
+	const void *data() const noexcept { return buf_; }
+	size_t size() const noexcept { return size_; }
+
+	/**
+	 * @brief Appends fixed-size elements to the last opened array.
+	 *
+	 * @return true on success, false if the capacity is exceeded.
+	 */
+	template <typename E>
+	bool append(span<E> elems) noexcept {
+		static_assert(is_nested_element<T, E>::value &&
+				!is_flexible_v<E>,
+				"E is not an element type of T");
+		return put(elems.data(), elems.size() * sizeof(E), alignof(E));
+	}
+
+	template <typename E, size_t N>
+	bool append(const E (&elems)[N]) noexcept {
+		return append(span<E>(elems));
+	}
+
+	bool append(const char *str, size_t len) noexcept {
+		return append(span<char>(str, len));
+	}
+
+	/**
+	 * @brief Appends a variable-sized record, e.g. a MeterValue, followed
+	 *        by its own elements, e.g. the SampledValues.
+	 *
+	 * @return true on success, false if the capacity is exceeded.
+	 */
+	template <typename R>
+	bool append(const R &record, span<element_t<R>> elems = {}) noexcept {
+		static_assert(is_nested_element<T, R>::value,
+				"R is not a record type of T");
+		R head = record;
+		if constexpr (flexible_traits<R>::has_count) {
+			flexible_traits<R>::set_count(head, elems.size());
+		}
+		size_t start = align_up(size_, alignof(R));
+		size_t end = start + flexible_traits<R>::offset;
+		if (end > Capacity) {
+			return false;
+		}
+		std::memcpy(&buf_[start], &head, flexible_traits<R>::offset);
+		size_ = end;
+		if constexpr (!is_flexible_v<element_t<R>>) {
+			if (!append(elems)) {
+				size_ = start;
+				return false;
+			}
+			size_ = align_up(size_, alignof(R));
+		}
+		return true;
+	}
+
+private:
+	bool put(const void *p, size_t len, size_t align) noexcept {
+		size_t start = align_up(size_, align);
+		if (start + len > Capacity) {
+			return false;
+		}
+		if (len) {
+			std::memcpy(&buf_[start], p, len);
+		}
+		size_ = start + len;
+		return true;
+	}
+
+	alignas(std::max_align_t) unsigned char buf_[Capacity];
+	size_t size_;
+};
+
+/* Checks a payload before it is queued, as ocpp_push_request() does not.
+ * Opt-in, so that the typed wrappers accept what the C API accepts. Nothing
+ * to link unless set along with OCPP_VALIDATION. */
+#if !defined(OCPP_VALIDATE_ON_PUSH)
+#define OCPP_VALIDATE_ON_PUSH			0
+#endif
+
+inline int validate(ocpp_message_t type, bool response,
+		const void *data, size_t size) noexcept {
+#if OCPP_VALIDATION && OCPP_VALIDATE_ON_PUSH
+	return ocpp_validate(type, response, data, size);
+#else
+	(void)type, (void)response, (void)data, (void)size;
+	return 0;
+#endif
+}
+
+template <typename T>
+constexpr void assert_charge_point_request() noexcept {
+	static_assert(is_request_v<T>, "T is not an OCPP request struct");
+	static_assert(message_traits<T>::from_charge_point,
+			"T is initiated by the central system, not pushed");
+}
+
+/* sizeof(T) leaves out the records of a flexible array member. */
+template <typename T>
+constexpr void assert_fixed_size() noexcept {
+	static_assert(!is_flexible_v<T>,
+			"T has a flexible array member; use ocpp::builder<T, N>");
+}
+
+template <typename T>
+inline int push_request(const T &req, void *ctx = nullptr) noexcept {
+	assert_charge_point_request<T>();
+	assert_fixed_size<T>();
+	const int err = validate(message_traits<T>::type, false,
+			&req, sizeof(req));
+	return err? err : ocpp_push_request(message_traits<T>::type,
+			&req, sizeof(req), ctx);
+}
+
+template <typename T, size_t N>
+inline int push_request(const builder<T, N> &req,
+		void *ctx = nullptr) noexcept {
+	assert_charge_point_request<T>();
+	const int err = validate(message_traits<T>::type, false,
+			req.data(), req.size());
+	return err? err : ocpp_push_request(message_traits<T>::type,
+			req.data(), req.size(), ctx);
+}
+
+template <typename T>
+inline int push_request_force(const T &req, void *ctx = nullptr) noexcept {
+	assert_charge_point_request<T>();
+	assert_fixed_size<T>();
+	const int err = validate(message_traits<T>::type, false,
+			&req, sizeof(req));
+	return err? err : ocpp_push_request_force(message_traits<T>::type,
+			&req, sizeof(req), ctx);
+}
+
+template <typename T, size_t N>
+inline int push_request_force(const builder<T, N> &req,
+		void *ctx = nullptr) noexcept {
+	assert_charge_point_request<T>();
+	const int err = validate(message_traits<T>::type, false,
+			req.data(), req.size());
+	return err? err : ocpp_push_request_force(message_traits<T>::type,
+			req.data(), req.size(), ctx);
+}
+
+template <typename T>
+inline int push_request_defer(const T &req, uint32_t timer_sec,
+		void *ctx = nullptr) noexcept {
+	assert_charge_point_request<T>();
+	assert_fixed_size<T>();
+	const int err = validate(message_traits<T>::type, false,
+			&req, sizeof(req));
+	return err? err : ocpp_push_request_defer(message_traits<T>::type,
+			&req, sizeof(req), timer_sec, ctx);
+}
+
+template <typename T, size_t N>
+inline int push_request_defer(const builder<T, N> &req, uint32_t timer_sec,
+		void *ctx = nullptr) noexcept {
+	assert_charge_point_request<T>();
+	const int err = validate(message_traits<T>::type, false,
+			req.data(), req.size());
+	return err? err : ocpp_push_request_defer(message_traits<T>::type,
+			req.data(), req.size(), timer_sec, ctx);
+}
+
+template <typename T>
+inline int push_request_cb(const T &req,
+		ocpp_completion_callback_t on_complete,
+		void *ctx = nullptr) noexcept {
+	assert_charge_point_request<T>();
+	assert_fixed_size<T>();
+	const int rc = validate(message_traits<T>::type, false,
+			&req, sizeof(req));
+	return rc? rc : ocpp_push_request_cb(message_traits<T>::type,
+			&req, sizeof(req), on_complete, ctx);
+}
+
+template <typename T, size_t N>
+inline int push_request_cb(const builder<T, N> &req,
+		ocpp_completion_callback_t on_complete,
+		void *ctx = nullptr) noexcept {
+	assert_charge_point_request<T>();
+	const int rc = validate(message_traits<T>::type, false,
+			req.data(), req.size());
+	return rc? rc : ocpp_push_request_cb(message_traits<T>::type,
+			req.data(), req.size(), on_complete, ctx);
+}
+
+/**
+ * @brief Pushes the response @p conf to a request from the central system.
+ *
+ * The response type is given by @p conf, so only responses to requests that
+ * the central system initiates are accepted.
+ */
+template <typename C>
+inline int push_response(const struct ocpp_message &req, const C &conf,
+		bool err = false, void *ctx = nullptr) noexcept {
+	static_assert(is_response_v<C>, "C is not an OCPP response struct");
+	static_assert(message_traits<C>::from_central_system,
+			"C answers a request initiated by the charge point");
+	assert_fixed_size<C>();
+	const int rc = err? 0 : validate(message_traits<C>::type, true,
+			&conf, sizeof(conf));
+	return rc? rc : ocpp_push_response(&req, &conf, sizeof(conf), err, ctx);
+}
+
+template <typename C, size_t N>
+inline int push_response(const struct ocpp_message &req,
+		const builder<C, N> &conf, bool err = false,
+		void *ctx = nullptr) noexcept {
+	static_assert(is_response_v<C>, "C is not an OCPP response struct");
+	static_assert(message_traits<C>::from_central_system,
+			"C answers a request initiated by the charge point");
+	const int rc = err? 0 : validate(message_traits<C>::type, true,
+			conf.data(), conf.size());
+	return rc? rc : ocpp_push_response(&req, conf.data(), conf.size(),
+			err, ctx);
+}
+
+} /* namespace ocpp */
+
+#endif /* LIBMCU_OCPP_HPP */
@@ -11,7 +11,9 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <time.h>
 
 struct ocpp_message;
 
@@ -24,6 +26,43 @@ struct ocpp_message;
  */
 int ocpp_send(const struct ocpp_message *msg);
 
+/**
+ * @brief Encodes an OCPP message into a frame to be kept for its retries.
+ *
+ * Called once per message when the engine is built with a non-zero
+ * OCPP_FRAME_CACHE_SIZE. The frame is kept in the message slot until the
+ * message is freed, and every attempt to send the message, the retries
+ * included, goes through @ref ocpp_send_frame instead of @ref ocpp_send. The
+ * payload is not read again, so it should not be changed in the meantime.
+ *
+ * The default implementation returns -ENOTSUP, leaving every message to
+ * @ref ocpp_send.
+ *
+ * @param[in] msg The message to encode.
+ * @param[out] buf Buffer to write the frame to.
+ * @param[in] bufsize The size of @p buf, OCPP_FRAME_CACHE_SIZE.
+ * @param[out] len The length of the frame.
+ *
+ * @return 0 on success. On any error, e.g. -ENOBUFS for a frame larger than
+ *         @p bufsize, the message is sent with @ref ocpp_send as usual.
+ */
+int ocpp_encode_frame(const struct ocpp_message *msg,
+		void *buf, size_t bufsize, size_t *len);
+
+/**
+ * @brief Sends a frame encoded by @ref ocpp_encode_frame.
+ *
+ * The default implementation calls @ref ocpp_send with @p msg.
+ *
+ * @param[in] msg The message the frame is of.
+ * @param[in] frame The encoded frame.
+ * @param[in] len The length of @p frame.
+ *
+ * @return 0 on success, or any other value on failure as @ref ocpp_send.
+ */
+int ocpp_send_frame(const struct ocpp_message *msg,
+		const void *frame, size_t len);
+
 /**
  * @brief Receives an OCPP message.
  *
@@ -41,6 +80,20 @@ int ocpp_send(const struct ocpp_message *msg);
  */
 int ocpp_recv(struct ocpp_message *msg);
 
+/**
+ * @brief Tells whether the transport pings the server on its own.
+ *
+ * When it does and WebSocketPingInterval is set, the link is kept alive by
+ * the pings, and Heartbeats are sent only to synchronize the clock, every
+ * OCPP_CLOCK_SYNC_INTERVAL_SEC or HeartbeatInterval if longer.
+ *
+ * The default implementation returns false. The WebSocket transport of
+ * ocpp/ws.h returns true.
+ *
+ * @return true if the transport pings the server on WebSocketPingInterval.
+ */
+bool ocpp_transport_keeps_alive(void);
+
 /**
  * @brief Generates a unique message ID.
  *
@@ -52,6 +105,17 @@ int ocpp_recv(struct ocpp_message *msg);
  */
 void ocpp_generate_message_id(void *buf, size_t bufsize);
 
+/**
+ * @brief Returns the current time in seconds.
+ *
+ * All the timers of the engine are driven by this. The default implementation
+ * returns `time(NULL)`; override it to run the engine on a different clock,
+ * e.g. a monotonic one or the virtual clock of a simulation.
+ *
+ * @return The current time in seconds.
+ */
+time_t ocpp_get_time(void);
+
 /**
  * @brief Acquires a lock for OCPP operations.
  *
@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_REACTOR_H
+#define LIBMCU_OCPP_REACTOR_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Events taken from the kernel per call of @ref ocpp_reactor_run. */
+#if !defined(OCPP_REACTOR_MAX_EVENTS)
+#define OCPP_REACTOR_MAX_EVENTS				64
+#endif
+
+/*
+ * Single-threaded event loop over epoll and a timerfd, for Linux.
+ *
+ * Any number of sources, each a socket, a deadline or both, share one epoll
+ * instance. Deadlines are kept in a binary heap with the earliest one armed
+ * on the timerfd, so an idle source costs neither a syscall nor a wakeup.
+ * A callback runs only when its socket gets ready or its deadline passes.
+ *
+ * No memory is allocated: the sources and the room of the heap belong to
+ * the caller. src/reactor/reactor.c is not part of OCPP_SRCS, nor is
+ * src/reactor/reactor_ws.c for the transport of ocpp/ws.h.
+ *
+ * It does not run many charge points in one thread. The engine, in
+ * src/ocpp.c, and the transport, in src/ws/, keep their state in statics,
+ * so a process holds one charge point connection and
+ * @ref ocpp_reactor_attach_ws drives that one without a thread blocking on
+ * it. Hosting many charge points takes a process each, with a reactor of
+ * its own. One loop for all of them would need an engine and a transport
+ * instance passed to ocpp_step(), ocpp_send() and ocpp_recv(), which the
+ * API does not have. The other sources are left to the application, e.g.
+ * its own sockets and timers.
+ */
+
+typedef enum {
+	OCPP_REACTOR_READABLE		= 0x01,
+	OCPP_REACTOR_WRITABLE		= 0x02,
+	OCPP_REACTOR_HANGUP		= 0x04, /**< Error or hang-up. */
+	OCPP_REACTOR_TIMEOUT		= 0x08, /**< The deadline passed. */
+} ocpp_reactor_event_t;
+
+struct ocpp_reactor_source;
+
+/**
+ * @brief Called when a source has something to do.
+ *
+ * The source may be removed or given a new deadline or new events from
+ * here, and so may any other.
+ *
+ * @param[in] src The source.
+ * @param[in] events Bitwise OR of @ref ocpp_reactor_event_t.
+ * @param[in] ctx The context of the source.
+ */
+typedef void (*ocpp_reactor_callback_t)(struct ocpp_reactor_source *src,
+		unsigned int events, void *ctx);
+
+struct ocpp_reactor_source {
+	int fd;				/**< -1 for a deadline only. */
+	ocpp_reactor_callback_t callback;
+	void *ctx;
+
+	/* kept by the reactor */
+	unsigned int events;
+	bool polled;
+	uint64_t expiry;		/**< Monotonic, in ms. 0 for none. */
+	size_t timer_index;
+};
+
+struct ocpp_reactor {
+	int epfd;
+	int timerfd;
+	uint64_t armed;			/**< Expiry on the timerfd, or 0. */
+
+	struct ocpp_reactor_source **timers;
+	size_t nr_timers;
+	size_t max_timers;
+
+	/* the events being dispatched, for a source removed in between */
+	void *batch;
+	int batch_len;
+	bool dispatching;		/**< The timerfd is armed after. */
+};
+
+/**
+ * @brief Creates the epoll instance and the timerfd.
+ *
+ * @param[out] reactor The reactor.
+ * @param[in] timers Room for the heap of deadlines.
+ * @param[in] max_timers Number of sources that may have a deadline at once.
+ *
+ * @return 0 on success, or a negative errno.
+ */
+int ocpp_reactor_init(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source **timers, size_t max_timers);
+
+/**
+ * @brief Closes the epoll instance and the timerfd.
+ *
+ * The file descriptors of the sources are left open.
+ */
+void ocpp_reactor_deinit(struct ocpp_reactor *reactor);
+
+/**
+ * @brief Adds a source.
+ *
+ * @param[in] reactor The reactor.
+ * @param[in] src The source, with its fd, callback and context set. It must
+ *            stay valid until removed.
+ * @param[in] events @ref OCPP_REACTOR_READABLE and
+ *            @ref OCPP_REACTOR_WRITABLE to wait for. Ignored for no fd.
+ *
+ * @return 0 on success, or a negative errno of epoll_ctl().
+ */
+int ocpp_reactor_add(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src, unsigned int events);
+
+/**
+ * @brief Changes the events a source waits for.
+ *
+ * The fd is polled again even if the events are the same, which covers an fd
+ * closed and its number given to a new socket in between.
+ *
+ * @return 0 on success, or a negative errno of epoll_ctl().
+ */
+int ocpp_reactor_set_events(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src, unsigned int events);
+
+/**
+ * @brief Sets the deadline of a source, replacing the one before.
+ *
+ * It fires once, with @ref OCPP_REACTOR_TIMEOUT.
+ *
+ * @param[in] reactor The reactor.
+ * @param[in] src The source.
+ * @param[in] timeout_ms Milliseconds from now, or negative to cancel.
+ *
+ * @return 0 on success, -ENOBUFS if the heap is full, or a negative errno
+ *         of timerfd_settime().
+ */
+int ocpp_reactor_set_timeout(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src, int64_t timeout_ms);
+
+/**
+ * @brief Removes a source, with its deadline and its events not dispatched
+ *        yet.
+ */
+void ocpp_reactor_remove(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src);
+
+/**
+ * @brief Waits for events and dispatches them.
+ *
+ * @param[in] reactor The reactor.
+ * @param[in] timeout_ms Milliseconds to wait at most, 0 not to block or -1
+ *            to wait for as long as it takes.
+ *
+ * @return The number of callbacks run, or a negative errno of epoll_wait().
+ */
+int ocpp_reactor_run(struct ocpp_reactor *reactor, int timeout_ms);
+
+/**
+ * @brief Gets the epoll fd, to nest the reactor in another event loop.
+ */
+int ocpp_reactor_get_fd(const struct ocpp_reactor *reactor);
+
+/**
+ * @brief Drives the engine and the built-in WebSocket transport.
+ *
+ * There is one of each per process, so a single source is to be attached,
+ * to a single reactor.
+ *
+ * ocpp_step() is called when the socket of ocpp/ws.h gets ready or when
+ * the next deadline of the engine or of the pings of the transport passes,
+ * and for every message buffered in the transport. Call
+ * @ref ocpp_reactor_sync_ws after ocpp_ws_open() and after pushing requests
+ * from outside the reactor.
+ *
+ * @param[in] reactor The reactor.
+ * @param[out] src The source to use. Its fd, callback and context are set.
+ *
+ * @return 0 on success, or a negative errno.
+ */
+int ocpp_reactor_attach_ws(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src);
+
+/**
+ * @brief Brings the socket, the events and the deadline of @p src up to
+ *        date with the transport and the engine.
+ *
+ * @return 0 on success, or a negative errno.
+ */
+int ocpp_reactor_sync_ws(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_REACTOR_H */
@@ -0,0 +1,112 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_SIM_H
+#define LIBMCU_OCPP_SIM_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/ocpp.h"
+
+#if !defined(OCPP_SIM_INBOX_LEN)
+#define OCPP_SIM_INBOX_LEN				8
+#endif
+
+/*
+ * Deterministic simulation harness for the engine.
+ *
+ * It runs the engine on a virtual clock over an in-memory loopback transport,
+ * answering requests with a scripted central system. Time only moves forward
+ * when asked to, jumping straight to the next deadline, so days of traffic run
+ * in milliseconds and every run is reproducible.
+ *
+ * src/sim/sim.c provides ocpp_send(), ocpp_recv(), ocpp_get_time() and
+ * ocpp_generate_message_id(). It is meant for host builds and tests only and
+ * is not part of OCPP_SRCS. The locks are left to the application.
+ */
+
+/**
+ * @brief Scripted behavior of the central system.
+ *
+ * Called for every message the engine sends while the link is up.
+ *
+ * @param[in] msg The message sent by the engine.
+ * @param[out] resp The response to deliver back. Its id and type are preset to
+ *             match @p msg and its role to CALLRESULT. The payload must stay
+ *             valid until it is delivered.
+ * @param[out] delay_sec Seconds until @p resp is delivered. 0 by default.
+ * @param[in] ctx The context given to @ref ocpp_sim_init.
+ *
+ * @return true to deliver @p resp, false to leave @p msg unanswered.
+ */
+typedef bool (*ocpp_sim_csms_t)(const struct ocpp_message *msg,
+		struct ocpp_message *resp, uint32_t *delay_sec, void *ctx);
+
+struct ocpp_sim_stats {
+	uint32_t sent;          /**< Messages accepted by the transport. */
+	uint32_t received;      /**< Messages delivered to the engine. */
+	uint32_t send_failures; /**< Sends rejected while the link was down. */
+	uint32_t steps;         /**< Calls to ocpp_step(). */
+};
+
+/**
+ * @brief Resets the virtual clock, transport and statistics.
+ *
+ * Call it before @ref ocpp_init so that the engine starts on the virtual
+ * clock.
+ *
+ * @param[in] start Initial time of the virtual clock.
+ * @param[in] csms Scripted central system. NULL leaves every message
+ *             unanswered.
+ * @param[in] ctx Context passed to @p csms.
+ */
+void ocpp_sim_init(time_t start, ocpp_sim_csms_t csms, void *ctx);
+
+/**
+ * @brief Brings the link up or down.
+ *
+ * While down, sends fail with -ENOTCONN and nothing is received. Responses
+ * already in flight are delivered once the link is up again.
+ */
+void ocpp_sim_set_link(bool up);
+
+/**
+ * @brief Queues a message from the central system, e.g. a Reset request.
+ *
+ * @param[in] msg The message to deliver. Its payload must stay valid until it
+ *            is delivered.
+ * @param[in] delay_sec Seconds from now until @p msg is delivered.
+ *
+ * @return 0 on success, -ENOBUFS if the inbox is full.
+ */
+int ocpp_sim_inject(const struct ocpp_message *msg, uint32_t delay_sec);
+
+/**
+ * @brief Runs the engine until the virtual clock reaches @p until.
+ *
+ * The clock jumps from one deadline to the next, whichever comes first of
+ * the engine's own, see @ref ocpp_get_next_deadline, and the delivery of a
+ * queued message.
+ *
+ * @param[in] until Time to run up to, inclusive.
+ */
+void ocpp_sim_run_until(time_t until);
+
+/**
+ * @brief Runs the engine for @p sec seconds of virtual time.
+ */
+void ocpp_sim_run(uint32_t sec);
+
+time_t ocpp_sim_now(void);
+const struct ocpp_sim_stats *ocpp_sim_get_stats(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_SIM_H */
@@ -48,6 +48,25 @@ const char *ocpp_stringify_context(ocpp_reading_context_t ctx);
 const char *ocpp_stringify_unit(ocpp_measure_unit_t unit);
 const char *ocpp_stringify_measurand(ocpp_measurand_t measurand);
 
+/**
+ * @brief Converts a CALLERROR code to its string on the wire.
+ *
+ * @note OccurrenceConstraintViolation is spelled as in the OCPP-J 1.6
+ *       specification, "OccurenceConstraintViolation".
+ */
+const char *ocpp_stringify_call_error(ocpp_call_error_t code);
+
+/**
+ * @brief Converts a CALLERROR code string to ocpp_call_error_t.
+ *
+ * @param[in] str The error code string, not necessarily null-terminated.
+ * @param[in] len The length of @p str.
+ *
+ * @return The error code, or OCPP_CALL_ERROR_GENERIC if unknown.
+ */
+ocpp_call_error_t ocpp_get_call_error_from_string(const char *str,
+		const size_t len);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_TRAITS_HPP
+#define LIBMCU_OCPP_TRAITS_HPP
+
+#include "ocpp/ocpp.h"
+
+namespace ocpp {
+
+/* Only specialized for OCPP request and response structs, so that any other
+ * type is rejected at compile time instead of being pushed with a wrong type.
+ * from_charge_point and from_central_system tell which side initiates the
+ * request. */
+template <typename T> struct message_traits {
+	static constexpr bool is_request = false;
+	static constexpr bool is_response = false;
+};
+
+#define OCPP_FROM_CP		true, false
+#define OCPP_FROM_CS		false, true
+#define OCPP_FROM_BOTH		true, true
+
+#define OCPP_DEFINE_MESSAGE_TRAITS_(name, msgtype, cp, cs)		\
+	using name = ::ocpp_##name;					\
+	using name##_conf = ::ocpp_##name##_conf;			\
+	template <> struct message_traits<::ocpp_##name> {		\
+		static constexpr bool is_request = true;		\
+		static constexpr bool is_response = false;		\
+		static constexpr bool from_charge_point = cp;		\
+		static constexpr bool from_central_system = cs;		\
+		static constexpr ocpp_message_t type = msgtype;		\
+		using request = ::ocpp_##name;				\
+		using response = ::ocpp_##name##_conf;			\
+	};								\
+	template <> struct message_traits<::ocpp_##name##_conf> {	\
+		static constexpr bool is_request = false;		\
+		static constexpr bool is_response = true;		\
+		static constexpr bool from_charge_point = cp;		\
+		static constexpr bool from_central_system = cs;		\
+		static constexpr ocpp_message_t type = msgtype;		\
+		using request = ::ocpp_##name;				\
+		using response = ::ocpp_##name##_conf;			\
+	};
+#define OCPP_DEFINE_MESSAGE_TRAITS(name, msgtype, dir)			\
+	OCPP_DEFINE_MESSAGE_TRAITS_(name, msgtype, dir)
+
+/* Core */
+OCPP_DEFINE_MESSAGE_TRAITS(Authorize, OCPP_MSG_AUTHORIZE, OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(BootNotification, OCPP_MSG_BOOTNOTIFICATION,
+		OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(ChangeAvailability, OCPP_MSG_CHANGE_AVAILABILITY,
+		OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(ChangeConfiguration, OCPP_MSG_CHANGE_CONFIGURATION,
+		OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(ClearCache, OCPP_MSG_CLEAR_CACHE, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(DataTransfer, OCPP_MSG_DATA_TRANSFER,
+		OCPP_FROM_BOTH)
+OCPP_DEFINE_MESSAGE_TRAITS(GetConfiguration, OCPP_MSG_GET_CONFIGURATION,
+		OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(Heartbeat, OCPP_MSG_HEARTBEAT, OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(MeterValues, OCPP_MSG_METER_VALUES, OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(RemoteStartTransaction,
+		OCPP_MSG_REMOTE_START_TRANSACTION, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(RemoteStopTransaction,
+		OCPP_MSG_REMOTE_STOP_TRANSACTION, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(Reset, OCPP_MSG_RESET, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(StartTransaction, OCPP_MSG_START_TRANSACTION,
+		OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(StatusNotification, OCPP_MSG_STATUS_NOTIFICATION,
+		OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(StopTransaction, OCPP_MSG_STOP_TRANSACTION,
+		OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(UnlockConnector, OCPP_MSG_UNLOCK_CONNECTOR,
+		OCPP_FROM_CS)
+/* Firmware Management */
+OCPP_DEFINE_MESSAGE_TRAITS(DiagnosticsStatusNotification,
+		OCPP_MSG_DIAGNOSTICS_NOTIFICATION, OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(FirmwareStatusNotification,
+		OCPP_MSG_FIRMWARE_NOTIFICATION, OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(GetDiagnostics, OCPP_MSG_GET_DIAGNOSTICS,
+		OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(UpdateFirmware, OCPP_MSG_UPDATE_FIRMWARE,
+		OCPP_FROM_CS)
+/* Local Auth List Management */
+OCPP_DEFINE_MESSAGE_TRAITS(GetLocalListVersion,
+		OCPP_MSG_GET_LOCAL_LIST_VERSION, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(SendLocalList, OCPP_MSG_SEND_LOCAL_LIST,
+		OCPP_FROM_CS)
+/* Reservation */
+OCPP_DEFINE_MESSAGE_TRAITS(CancelReservation, OCPP_MSG_CANCEL_RESERVATION,
+		OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(ReserveNow, OCPP_MSG_RESERVE_NOW, OCPP_FROM_CS)
+/* Smart Charging */
+OCPP_DEFINE_MESSAGE_TRAITS(ClearChargingProfile,
+		OCPP_MSG_CLEAR_CHARGING_PROFILE, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(GetCompositeSchedule,
+		OCPP_MSG_GET_COMPOSITE_SCHEDULE, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(SetChargingProfile, OCPP_MSG_SET_CHARGING_PROFILE,
+		OCPP_FROM_CS)
+/* Remote Trigger */
+OCPP_DEFINE_MESSAGE_TRAITS(TriggerMessage, OCPP_MSG_TRIGGER_MESSAGE,
+		OCPP_FROM_CS)
+/* Security */
+OCPP_DEFINE_MESSAGE_TRAITS(CertificateSigned, OCPP_MSG_CERTIFICATE_SIGNED,
+		OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(DeleteCertificate, OCPP_MSG_DELETE_CERTIFICATE,
+		OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(ExtendedTriggerMessage,
+		OCPP_MSG_EXTENDED_TRIGGER_MESSAGE, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(GetInstalledCertificateIds,
+		OCPP_MSG_GET_INSTALLED_CERTIFICATE_IDS, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(GetLog, OCPP_MSG_GET_LOG, OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(InstallCertificate, OCPP_MSG_INSTALL_CERTIFICATE,
+		OCPP_FROM_CS)
+OCPP_DEFINE_MESSAGE_TRAITS(LogStatusNotification,
+		OCPP_MSG_LOG_STATUS_NOTIFICATION, OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(SecurityEventNotification,
+		OCPP_MSG_SECURITY_EVENT_NOTIFICATION, OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(SignCertificate, OCPP_MSG_SIGN_CERTIFICATE,
+		OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(SignedFirmwareStatusNotification,
+		OCPP_MSG_SIGNED_FIRMWARE_STATUS_NOTIFICATION, OCPP_FROM_CP)
+OCPP_DEFINE_MESSAGE_TRAITS(SignedUpdateFirmware,
+		OCPP_MSG_SIGNED_UPDATE_FIRMWARE, OCPP_FROM_CS)
+
+#undef OCPP_DEFINE_MESSAGE_TRAITS
+#undef OCPP_DEFINE_MESSAGE_TRAITS_
+#undef OCPP_FROM_BOTH
+#undef OCPP_FROM_CS
+#undef OCPP_FROM_CP
+
+template <typename T>
+inline constexpr bool is_request_v = message_traits<T>::is_request;
+template <typename T>
+inline constexpr bool is_response_v = message_traits<T>::is_response;
+
+template <typename T>
+using response_t = typename message_traits<T>::response;
+
+} /* namespace ocpp */
+
+#endif /* LIBMCU_OCPP_TRAITS_HPP */
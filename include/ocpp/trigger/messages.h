@@ -7,24 +7,6 @@
 #ifndef LIBMCU_OCPP_TRIGGER_MESSAGES_H
 #define LIBMCU_OCPP_TRIGGER_MESSAGES_H
 
-#if defined(__cplusplus)
-extern "C" {
-#endif
-
-#include <time.h>
-#include "ocpp/type.h"
-
-struct ocpp_TriggerMessage {
-	ocpp_trigger_message_t requestedMessage;
-	int connectorId;
-};
-
-struct ocpp_TriggerMessage_conf {
-	ocpp_trigger_status_t status;
-};
-
-#if defined(__cplusplus)
-}
-#endif
+#include "ocpp/messages.h"
 
 #endif /* LIBMCU_OCPP_TRIGGER_MESSAGES_H */
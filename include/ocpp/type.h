@@ -11,6 +11,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
@@ -382,65 +383,93 @@ typedef enum {
 	OCPP_LOG_SECURITY,
 } ocpp_log_t;
 
-struct ocpp_KeyValue {
-	char key[OCPP_CiString50];
-	bool readonly;
-	char value[OCPP_CiString500];
-};
-
-struct ocpp_idTagInfo {
-	time_t expiryDate;
-	char parentIdTag[OCPP_CiString20];
-	ocpp_auth_status_t status;
-};
-
-struct ocpp_AuthorizationData {
-	char idTag[OCPP_CiString20];
-	struct ocpp_idTagInfo idTagInfo;
-};
-
-struct ocpp_ChargingSchedulePeriod {
-	int startPeriod;
-	int limit_tenth;
-	int numberPhases;
-};
-
-struct ocpp_ChargingSchedule {
-	int duration;
-	time_t startSchedule;
-	ocpp_charging_unit_t chargingRateUnit;
-	int minChargingRate_tenth;
-	int nr_chargingSchedulePeriod;
-	uint8_t chargingSchedulePeriod[]; /* struct ocpp_ChargingSchedulePeriod */
-};
-
-struct ocpp_ChargingProfile {
-	int chargingProfileId;
-	int transactionId;
-	int stackLevel;
-	ocpp_charging_profile_purpose_t chargingProfilePurpose;
-	ocpp_charging_profile_kind_t chargingProfileKind;
-	ocpp_charging_profile_recurrency_t recurrencyKind;
-	time_t validFrom;
-	time_t validTo;
-	uint8_t chargingSchedule[]; /* struct ocpp_ChargingSchedule */
-};
-
-struct ocpp_SampledValue {
-	char value[32+1];
-	ocpp_reading_context_t context;
-	ocpp_value_format_t format;
-	ocpp_measurand_t measurand;
-	ocpp_phase_t phase;
-	ocpp_location_t location;
-	ocpp_measure_unit_t unit;
+typedef enum {
+	OCPP_SECURITY_STATUS_ACCEPTED,
+	OCPP_SECURITY_STATUS_REJECTED,
+	OCPP_SECURITY_STATUS_FAILED,
+	OCPP_SECURITY_STATUS_NOT_FOUND,
+	OCPP_SECURITY_STATUS_ACCEPTED_CANCELED,
+	OCPP_SECURITY_STATUS_NOT_IMPLEMENTED,
+	OCPP_SECURITY_STATUS_INVALID_CERTIFICATE,
+	OCPP_SECURITY_STATUS_REVOKED_CERTIFICATE,
+	OCPP_SECURITY_STATUS_BAD_MESSAGE,
+	OCPP_SECURITY_STATUS_IDLE,
+	OCPP_SECURITY_STATUS_NOT_SUPPORTED,
+	OCPP_SECURITY_STATUS_PERMISSION_DENIED,
+	OCPP_SECURITY_STATUS_UPLOADED,
+	OCPP_SECURITY_STATUS_UPLOAD_FAILED,
+	OCPP_SECURITY_STATUS_UPLOADING,
+
+	OCPP_SECURITY_STATUS_DOWNLOADED,
+	OCPP_SECURITY_STATUS_DOWNLOAD_FAILED,
+	OCPP_SECURITY_STATUS_DOWNLOADING,
+	OCPP_SECURITY_STATUS_DOWNLOAD_SCHEDULED,
+	OCPP_SECURITY_STATUS_DOWNLOAD_PAUSED,
+	OCPP_SECURITY_STATUS_INSTALLATION_FAILED,
+	OCPP_SECURITY_STATUS_INSTALLING,
+	OCPP_SECURITY_STATUS_INSTALLED,
+	OCPP_SECURITY_STATUS_INSTALL_REBOOTING,
+	OCPP_SECURITY_STATUS_INSTALL_SCHEDULED,
+	OCPP_SECURITY_STATUS_INSTALL_VERIFICATION_FAILED,
+	OCPP_SECURITY_STATUS_INVALID_SIGNATURE,
+	OCPP_SECURITY_STATUS_SIGNATURE_VERIFIED,
+} ocpp_security_status_t;
+
+typedef enum {
+	OCPP_SECURITY_EVENT_FIRMWARE_UPDATED,
+	OCPP_SECURITY_EVENT_FAILED_AUTHENTICATE_AT_CSMS,
+	OCPP_SECURITY_EVENT_CENTRAL_SYSTEM_FAILED_TO_AUTHENTICATE,
+	OCPP_SECURITY_EVENT_SETTING_SYSTEM_TIME,
+	OCPP_SECURITY_EVENT_STARTUP_DEVICE,
+	OCPP_SECURITY_EVENT_REBOOT,
+	OCPP_SECURITY_EVENT_LOG_CLEARED,
+	OCPP_SECURITY_EVENT_PARAMETERS_UPDATED,
+	OCPP_SECURITY_EVENT_MEMORY_EXHAUSTION,
+	OCPP_SECURITY_EVENT_INVALID_MESSAGE,
+	OCPP_SECURITY_EVENT_ATTEMPTED_REPLAY_ATTACK,
+	OCPP_SECURITY_EVENT_TAMPER_DETECTED,
+	OCPP_SECURITY_EVENT_INVALID_FIRMWARE_SIGNATURE,
+	OCPP_SECURITY_EVENT_INVALID_FIRMWARE_SIGNING,
+	OCPP_SECURITY_EVENT_INVALID_CSMS_CERTIFICATE,
+	OCPP_SECURITY_EVENT_INVALID_CHARGE_POINT_CERTIFICATE,
+	OCPP_SECURITY_EVENT_INVALID_TLS_VERSION,
+	OCPP_SECURITY_EVENT_INVALID_TLS_CIPHER_SUITE,
+} ocpp_security_event_t;
+
+typedef enum {
+	OCPP_SECURITY_CERT_TYPE_ROOT_CSMS,
+	OCPP_SECURITY_CERT_TYPE_ROOT_MANUFACTURER,
+} ocpp_security_cert_t;
+
+typedef enum {
+	OCPP_CALL_ERROR_NOT_IMPLEMENTED,
+	OCPP_CALL_ERROR_NOT_SUPPORTED,
+	OCPP_CALL_ERROR_INTERNAL,
+	OCPP_CALL_ERROR_PROTOCOL,
+	OCPP_CALL_ERROR_SECURITY,
+	OCPP_CALL_ERROR_FORMATION_VIOLATION,
+	OCPP_CALL_ERROR_PROPERTY_CONSTRAINT_VIOLATION,
+	OCPP_CALL_ERROR_OCCURRENCE_CONSTRAINT_VIOLATION,
+	OCPP_CALL_ERROR_TYPE_CONSTRAINT_VIOLATION,
+	OCPP_CALL_ERROR_GENERIC,
+} ocpp_call_error_t;
+
+/* Payload of a CALLERROR. The error details are always sent empty. */
+struct ocpp_CallError {
+	ocpp_call_error_t code;
+	char description[OCPP_CiString255];
 };
 
-struct ocpp_MeterValue {
-	time_t timestamp;
-	size_t nr_sampledValue;
-	uint8_t sampledValue[]; /* struct ocpp_SampledValue */
-};
+/* Variable-sized records in a flexible array member, like meterValue[] of
+ * struct ocpp_MeterValue, start at the first offset aligned for the record
+ * and are packed back to back, each padded to the record alignment. */
+#define OCPP_ALIGN_UP(x, align)		\
+	((((x) + (align) - 1) / (align)) * (align))
+#define OCPP_RECORD_OFFSET(type, member, record_type)	\
+	OCPP_ALIGN_UP(offsetof(type, member), __alignof__(record_type))
+#define OCPP_RECORD_SIZE(type, member, elem_type, n)	\
+	OCPP_ALIGN_UP(offsetof(type, member) + (size_t)(n) * sizeof(elem_type), \
+			__alignof__(type))
 
 #if defined(__cplusplus)
 }
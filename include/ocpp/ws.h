@@ -0,0 +1,209 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_WS_H
+#define LIBMCU_OCPP_WS_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/ocpp.h"
+#include "ocpp/codec/codec.h"
+#include "ocpp/ws_deflate.h"
+#include "ocpp/ws_uring.h"
+#include "ocpp/ws_tls.h"
+
+/* Raw bytes received and not yet taken by the engine: the handshake response
+ * and then the frames of one message at least. A message larger than this
+ * fails the connection with 1009. */
+#if !defined(OCPP_WS_RX_BUFSIZE)
+#define OCPP_WS_RX_BUFSIZE				4096
+#endif
+/* Frames queued for the socket. A message larger than this goes out in
+ * fragments of this size, but for a compressed one, which is not sent. */
+#if !defined(OCPP_WS_TX_BUFSIZE)
+#define OCPP_WS_TX_BUFSIZE				4096
+#endif
+/* How long ocpp_send() waits on the socket for the fragments of a message
+ * larger than OCPP_WS_TX_BUFSIZE to go out, each. The connection fails on
+ * the timeout, with the message sent in part. */
+#if !defined(OCPP_WS_TX_TIMEOUT_MS)
+#define OCPP_WS_TX_TIMEOUT_MS				5000
+#endif
+/* Frames queued for the socket at most, the messages among them each taking
+ * one. No more than IOV_MAX. */
+#if !defined(OCPP_WS_TX_SEGMENTS)
+#define OCPP_WS_TX_SEGMENTS				16
+#endif
+/* The decoded payload of the last message received. */
+#if !defined(OCPP_WS_PAYLOAD_BUFSIZE)
+#define OCPP_WS_PAYLOAD_BUFSIZE				4096
+#endif
+
+/*
+ * WebSocket transport over a non-blocking TCP socket, RFC 6455.
+ *
+ * src/ws/ws.c provides ocpp_send() and ocpp_recv() on top of POSIX sockets,
+ * so neither of them blocks ocpp_step(), but ocpp_send() on a message larger
+ * than @ref OCPP_WS_TX_BUFSIZE with the socket full. Every bit of I/O is
+ * done from those two and @ref ocpp_ws_poll, on the thread running
+ * ocpp_step(). The frames are encoded and decoded with the codec of the
+ * subprotocol agreed in the handshake, see ocpp/codec/codec.h. It provides
+ * ocpp_encode_frame() and ocpp_send_frame() as well, for the engine built
+ * with OCPP_FRAME_CACHE_SIZE to keep the payload encoded for the retries.
+ *
+ * No memory is allocated: the buffers are sized at compile time, but for
+ * TLS, which OpenSSL allocates for. It is not part of OCPP_SRCS; build it,
+ * along with src/ws/ws_simd.c, src/ws/ws_deflate.c, src/ws/ws_uring.c and
+ * src/ws/ws_tls.c, in place of your own ocpp_send() and ocpp_recv().
+ */
+
+typedef enum {
+	OCPP_WS_CLOSED,
+	OCPP_WS_CONNECTING,	/**< TCP connection in progress. */
+	OCPP_WS_HANDSHAKING,	/**< Upgrade request sent, awaiting 101. */
+	OCPP_WS_OPEN,
+	OCPP_WS_CLOSING,	/**< Close frame sent, awaiting the peer's. */
+} ocpp_ws_state_t;
+
+struct ocpp_ws_param {
+	const char *host;	/**< Name or address of the central system. */
+	uint16_t port;
+	const char *path;	/**< e.g. "/ocpp/CP001". "/" if NULL. */
+	/** Subprotocols offered, in order of preference, e.g.
+	 * "ocpp1.6+cbor, ocpp1.6". @ref OCPP_CODEC_JSON_SUBPROTOCOL if NULL. */
+	const char *subprotocols;
+	/** permessage-deflate to offer, or NULL not to. Ignored unless built
+	 * with @ref OCPP_WS_DEFLATE. */
+	const struct ocpp_ws_deflate_param *deflate;
+	/** TLS to connect to wss://, or NULL for ws://. Needs
+	 * @ref OCPP_WS_TLS, see ocpp/ws_tls.h. The server is verified
+	 * against the host. */
+	const struct ocpp_ws_tls_param *tls;
+};
+
+/**
+ * @brief Starts connecting to a central system.
+ *
+ * The TCP connection, the TLS handshake if any and the HTTP upgrade go on
+ * in @ref ocpp_ws_poll. The name of the host is resolved here, which may
+ * block; pass an address not to. A connection already open is dropped
+ * first.
+ *
+ * @param[in] param Where to connect to. The strings are not kept, but
+ *            @p param->tls is, see ocpp_ws_tls_start().
+ *
+ * @return 0 on success, -EINVAL if @p param is incomplete, -ENOBUFS if the
+ *         upgrade request does not fit in @ref OCPP_WS_TX_BUFSIZE, -ENOMEM
+ *         if the compression does not fit in @ref OCPP_WS_DEFLATE_HEAPSIZE,
+ *         -ENOTSUP for TLS when built without it, -ENOENT for a certificate
+ *         that can not be loaded, or a negative errno of the socket.
+ */
+int ocpp_ws_open(const struct ocpp_ws_param *param);
+
+/**
+ * @brief Moves the connection forward without blocking.
+ *
+ * Completes the TCP connection and the handshake, writes out the frames
+ * queued, reads what has arrived and answers pings and close frames. With
+ * WebSocketPingInterval set in the configuration, it pings the server once
+ * nothing has come for that many seconds, see @ref ocpp_ws_get_next_deadline.
+ * ocpp_recv() calls it on every ocpp_step(), so it only needs calling on its
+ * own to go faster than that, e.g. when the socket of @ref ocpp_ws_get_fd
+ * gets ready.
+ *
+ * @return 0 while the connection is alive, or the negative errno that
+ *         brought it down: -ECONNREFUSED for an upgrade refused, -EPROTO for
+ *         a handshake, TLS or HTTP, or a frame violating the protocol, e.g.
+ *         a server not verified or a subprotocol not offered, -EILSEQ for a
+ *         text message or a close reason not in UTF-8, -EBADMSG for a
+ *         compressed message corrupt, -EMSGSIZE for a message larger than
+ *         @ref OCPP_WS_RX_BUFSIZE or @ref OCPP_WS_DEFLATE_BUFSIZE once
+ *         decompressed, -ECONNRESET for a connection lost, -ETIMEDOUT for
+ *         a ping left unanswered for WebSocketPingInterval, or -ENOTCONN
+ *         once closed.
+ */
+int ocpp_ws_poll(void);
+
+/**
+ * @brief Starts the closing handshake.
+ *
+ * The connection stays in @ref OCPP_WS_CLOSING until the peer answers with
+ * its close frame. Calling it again in the meantime drops the connection at
+ * once.
+ *
+ * @param[in] code Status code to send, e.g. 1000 for a normal closure.
+ */
+void ocpp_ws_close(uint16_t code);
+
+ocpp_ws_state_t ocpp_ws_get_state(void);
+
+/**
+ * @brief Gets the fd to wait on, e.g. with poll() or select().
+ *
+ * It is the socket, or the ring once handed over to io_uring, see
+ * ocpp/ws_uring.h. Either gets readable when there is something to take.
+ *
+ * @return The file descriptor, or -1 when closed.
+ */
+int ocpp_ws_get_fd(void);
+
+/**
+ * @brief Checks if the socket needs waiting for to be writable, to finish
+ *        connecting or to write out the frames queued.
+ */
+bool ocpp_ws_wants_write(void);
+
+/**
+ * @brief Checks if a message is buffered in full, for ocpp_recv() to take
+ *        with no need for the socket to get readable.
+ */
+bool ocpp_ws_has_message(void);
+
+/**
+ * @brief Gets when @ref ocpp_ws_poll is next due to ping the server or to
+ *        give up on a ping.
+ *
+ * Wait for the earlier of this and ocpp_get_next_deadline() not to miss
+ * either. Any frame received, a pong or not, puts it off.
+ *
+ * @param[out] deadline The time, on the clock of ocpp_get_time().
+ *
+ * @return 0 on success, or -ENOENT when not open or WebSocketPingInterval is
+ *         0.
+ */
+int ocpp_ws_get_next_deadline(time_t *deadline);
+
+/**
+ * @brief Gets the status code of the last close frame received.
+ *
+ * @return The code, 1005 if the frame had none, or 1006 if the connection
+ *         went down without one.
+ */
+uint16_t ocpp_ws_get_close_code(void);
+
+/**
+ * @brief Gets the codec of the subprotocol agreed in the handshake.
+ *
+ * @return The codec, or NULL before the connection is open.
+ */
+const struct ocpp_codec *ocpp_ws_get_codec(void);
+
+/**
+ * @brief Fills @p buf with random bytes for the handshake key and the masks.
+ *
+ * The default implementation is a xorshift generator seeded from the clock,
+ * which is enough for masking against caching proxies. Override it with the
+ * random number generator of the platform where one is available.
+ */
+void ocpp_ws_random(void *buf, size_t len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_WS_H */
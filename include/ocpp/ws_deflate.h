@@ -0,0 +1,135 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_WS_DEFLATE_H
+#define LIBMCU_OCPP_WS_DEFLATE_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * permessage-deflate for the WebSocket transport, RFC 7692.
+ *
+ * Set OCPP_WS_DEFLATE to 1 to offer it in the handshake, which needs zlib or
+ * a library with its API, e.g. miniz. The transport falls back to messages
+ * uncompressed when the server does not agree.
+ */
+#if !defined(OCPP_WS_DEFLATE)
+#define OCPP_WS_DEFLATE					0
+#endif
+/* zlib compression level, 1 to 9 or -1 for its default. */
+#if !defined(OCPP_WS_DEFLATE_LEVEL)
+#define OCPP_WS_DEFLATE_LEVEL				-1
+#endif
+/* Memory for the compression state, 1 to 9. Each step down halves the hash
+ * table and the pending buffer at the cost of the ratio. */
+#if !defined(OCPP_WS_DEFLATE_MEM_LEVEL)
+#define OCPP_WS_DEFLATE_MEM_LEVEL			8
+#endif
+/* Caps the memory of both streams, taken from a static heap of this size
+ * instead of malloc(). The windows offered are narrowed to fit in it:
+ * about 16 KiB + 2^(client bits + 2) + 2^(mem level + 9) + 2^(server bits).
+ * 0 to allocate with the zlib defaults. */
+#if !defined(OCPP_WS_DEFLATE_HEAPSIZE)
+#define OCPP_WS_DEFLATE_HEAPSIZE			0
+#endif
+/* A message before compression and after decompression. */
+#if !defined(OCPP_WS_DEFLATE_BUFSIZE)
+#define OCPP_WS_DEFLATE_BUFSIZE				4096
+#endif
+
+struct ocpp_ws_deflate_param {
+	/** Window of the messages sent, 9 to 15, or 0 for 15. */
+	uint8_t client_max_window_bits;
+	/** Window the server is asked to keep to, 8 to 15, or 0 for 15.
+	 * It is what the decompression needs in memory. */
+	uint8_t server_max_window_bits;
+	/** Compress every message on its own, to keep no window between
+	 * messages. */
+	bool client_no_context_takeover;
+	/** Ask the server to compress every message on its own. */
+	bool server_no_context_takeover;
+};
+
+/**
+ * @brief Writes the offer for the Sec-WebSocket-Extensions header.
+ *
+ * Any agreement from before is ended.
+ *
+ * @param[out] buf Where to write the offer, NUL-terminated.
+ * @param[in] bufsize Size of @p buf.
+ * @param[in] param What to offer.
+ *
+ * @return 0 on success, -ENOBUFS if @p buf is too small, or -ENOMEM if even
+ *         the narrowest windows do not fit in @ref OCPP_WS_DEFLATE_HEAPSIZE.
+ */
+int ocpp_ws_deflate_offer(char *buf, size_t bufsize,
+		const struct ocpp_ws_deflate_param *param);
+
+/**
+ * @brief Takes the server's answer to the offer and sets up the streams.
+ *
+ * @param[in] value The Sec-WebSocket-Extensions header of the response.
+ * @param[in] len Length of @p value.
+ *
+ * @return 0 on success, -EPROTO if the response does not match the offer,
+ *         or -ENOMEM if the streams could not be allocated.
+ */
+int ocpp_ws_deflate_accept(const char *value, size_t len);
+
+/**
+ * @brief Ends the agreement and frees the streams.
+ */
+void ocpp_ws_deflate_end(void);
+
+/**
+ * @brief Checks if the server has agreed to compress messages.
+ */
+bool ocpp_ws_deflate_enabled(void);
+
+/**
+ * @brief Compresses a message, without the trailing 0x00 0x00 0xff 0xff.
+ *
+ * On failure the stream is reset, which the peer does not need to know of.
+ *
+ * @param[out] buf Where to write the compressed message.
+ * @param[in] bufsize Size of @p buf.
+ * @param[in] data The message.
+ * @param[in] len Length of @p data.
+ * @param[out] out_len Length of the compressed message.
+ *
+ * @return 0 on success, -ENOBUFS if @p buf is too small, or -ENOTCONN if not
+ *         agreed.
+ */
+int ocpp_ws_deflate_compress(void *buf, size_t bufsize,
+		const void *data, size_t len, size_t *out_len);
+
+/**
+ * @brief Decompresses a message received.
+ *
+ * @param[out] buf Where to write the message.
+ * @param[in] bufsize Size of @p buf.
+ * @param[in] data The payload of the message, as received.
+ * @param[in] len Length of @p data.
+ * @param[out] out_len Length of the message.
+ *
+ * @return 0 on success, -EMSGSIZE if the message does not fit in @p buf,
+ *         -EBADMSG if @p data is corrupt, or -ENOTCONN if not agreed. The
+ *         stream can not be used any more after an error.
+ */
+int ocpp_ws_deflate_decompress(void *buf, size_t bufsize,
+		const void *data, size_t len, size_t *out_len);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_WS_DEFLATE_H */
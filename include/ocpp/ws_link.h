@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_WS_LINK_H
+#define LIBMCU_OCPP_WS_LINK_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include "ocpp/ws.h"
+
+/* Seconds to wait before the first attempt after the link went down. */
+#if !defined(OCPP_WS_LINK_BACKOFF_MIN_SEC)
+#define OCPP_WS_LINK_BACKOFF_MIN_SEC			1
+#endif
+/* The wait doubles on every attempt failed in a row, up to this. */
+#if !defined(OCPP_WS_LINK_BACKOFF_MAX_SEC)
+#define OCPP_WS_LINK_BACKOFF_MAX_SEC			300
+#endif
+/* Seconds for the TCP connection and the handshake to complete in. */
+#if !defined(OCPP_WS_LINK_CONNECT_TIMEOUT_SEC)
+#define OCPP_WS_LINK_CONNECT_TIMEOUT_SEC		30
+#endif
+
+/*
+ * Keeps the WebSocket transport of ocpp/ws.h connected.
+ *
+ * The link is reported to the engine with ocpp_set_connected(), so that the
+ * queue is held rather than spent on retries while down. A connection lost
+ * or failed is tried again after a wait doubling from the minimum up to the
+ * maximum, with up to half of it again added at random so that a fleet of
+ * charge points does not come back all at once. The wait starts over from
+ * the minimum once the handshake completes.
+ *
+ * It runs on the thread calling @ref ocpp_ws_link_poll, which is the one
+ * running ocpp_step(). It is not part of OCPP_SRCS; build src/ws/ws_link.c
+ * along with the transport.
+ */
+
+struct ocpp_ws_link_param {
+	/** Where to connect to. The strings must stay valid until stopped. */
+	struct ocpp_ws_param ws;
+	uint32_t backoff_min_sec;	/**< 0 for the default. */
+	uint32_t backoff_max_sec;	/**< 0 for the default. */
+};
+
+struct ocpp_ws_link_stats {
+	uint32_t attempts;	/**< Connections started. */
+	uint32_t connects;	/**< Handshakes completed. */
+	uint32_t drops;		/**< Links lost once up. */
+};
+
+/**
+ * @brief Reports the link down to the engine and starts connecting.
+ *
+ * @param[in] param The central system and the waits. It is copied.
+ *
+ * @return 0 on success, -EINVAL for no host or port, or -EALREADY if
+ *         started already. The connection failing is not an error, but
+ *         tried again.
+ */
+int ocpp_ws_link_start(const struct ocpp_ws_link_param *param);
+
+/**
+ * @brief Closes the connection and stops connecting.
+ *
+ * The link is left down for the engine, which holds the queue.
+ */
+void ocpp_ws_link_stop(void);
+
+/**
+ * @brief Moves the connection forward, tells the engine of the link going
+ *        up or down and connects again once the wait is over.
+ *
+ * Call it on every ocpp_step(), before it.
+ *
+ * @return 0 on success, or -EINVAL if not started.
+ */
+int ocpp_ws_link_poll(void);
+
+/**
+ * @brief Tells whether the link is up, with the handshake done.
+ */
+bool ocpp_ws_link_is_up(void);
+
+/**
+ * @brief Gets when @ref ocpp_ws_link_poll is next due to connect again, to
+ *        give up on a connection taking too long or to ping the server.
+ *
+ * Wait for the earlier of this and ocpp_get_next_deadline() not to miss
+ * either.
+ *
+ * @param[out] deadline The time, on the clock of ocpp_get_time().
+ *
+ * @return 0 on success, or -ENOENT when nothing is due.
+ */
+int ocpp_ws_link_get_next_deadline(time_t *deadline);
+
+void ocpp_ws_link_get_stats(struct ocpp_ws_link_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_WS_LINK_H */
@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_WS_SIMD_H
+#define LIBMCU_OCPP_WS_SIMD_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Set to 0 to build the scalar kernels only. */
+#if !defined(OCPP_WS_SIMD)
+#define OCPP_WS_SIMD					1
+#endif
+
+typedef enum {
+	OCPP_WS_SIMD_SCALAR,
+	OCPP_WS_SIMD_SSE2,
+	OCPP_WS_SIMD_AVX2,
+	OCPP_WS_SIMD_NEON,
+	OCPP_WS_SIMD_AUTO,	/* the best one the CPU supports */
+} ocpp_ws_simd_t;
+
+/**
+ * @brief XORs @p data with the masking key, RFC 6455 5.3.
+ *
+ * Masking and unmasking are the same operation.
+ *
+ * @param[in,out] data The payload, starting at its first byte.
+ * @param[in] len Length of @p data.
+ * @param[in] key The 4-byte masking key of the frame.
+ */
+void ocpp_ws_mask(void *data, size_t len, const uint8_t key[4]);
+
+/**
+ * @brief Checks if @p data is well-formed UTF-8.
+ *
+ * Overlong forms, surrogates, code points above U+10FFFF and a sequence cut
+ * off at the end are all rejected, as RFC 3629 requires.
+ *
+ * @param[in] data The bytes to check.
+ * @param[in] len Length of @p data.
+ *
+ * @return true if @p data is valid UTF-8.
+ */
+bool ocpp_ws_utf8_valid(const void *data, size_t len);
+
+/**
+ * @brief Selects the implementation of @ref ocpp_ws_mask and
+ *        @ref ocpp_ws_utf8_valid.
+ *
+ * The best one supported by the CPU is selected by default. SSE2 has no byte
+ * shuffle, so its UTF-8 check only skips ASCII runs in bulk and leaves the
+ * rest to the scalar code.
+ *
+ * @param[in] impl Implementation to use.
+ *
+ * @return 0 on success, or -ENOTSUP if @p impl is not available in this
+ *         build or on this CPU.
+ */
+int ocpp_ws_simd_select(ocpp_ws_simd_t impl);
+
+/**
+ * @brief Get the implementation in use.
+ *
+ * @return The implementation selected, never @ref OCPP_WS_SIMD_AUTO.
+ */
+ocpp_ws_simd_t ocpp_ws_simd_selected(void);
+
+/**
+ * @brief Get the name of an implementation, e.g. "avx2".
+ */
+const char *ocpp_ws_simd_stringify(ocpp_ws_simd_t impl);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_WS_SIMD_H */
@@ -0,0 +1,130 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_WS_TLS_H
+#define LIBMCU_OCPP_WS_TLS_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * TLS of the WebSocket transport over OpenSSL, for Security Profile 2 and 3.
+ *
+ * Set OCPP_WS_TLS to 1 and link libssl and libcrypto to connect to wss://.
+ * The server is verified against the CAs given, or the store of the system,
+ * and its name or address. A client certificate is presented for Security
+ * Profile 3.
+ *
+ * The session of the last connection is kept, with its ticket or its ID,
+ * and offered on the next one to the same host and port. A resumed
+ * handshake skips the certificate chain and its signature on both ends,
+ * which is most of the work of a full one when a fleet reconnects at once,
+ * e.g. after the central system restarted. The session is kept over a
+ * connection lost, but not over one failed on a TLS error.
+ *
+ * The transport stays on the socket, not on io_uring, while on TLS.
+ */
+#if !defined(OCPP_WS_TLS)
+#define OCPP_WS_TLS					0
+#endif
+/* "host:port" the session is kept for. */
+#if !defined(OCPP_WS_TLS_PEER_MAXLEN)
+#define OCPP_WS_TLS_PEER_MAXLEN				128
+#endif
+
+struct ocpp_ws_tls_param {
+	/** PEM of the CAs to trust, or NULL for the store of the system. */
+	const char *ca_file;
+	/** PEM of the client certificate for Security Profile 3, or NULL. */
+	const char *cert_file;
+	const char *key_file;	/**< PEM of its private key. */
+};
+
+struct ocpp_ws_tls_stats {
+	uint32_t handshakes;	/**< Completed, full or resumed. */
+	uint32_t resumed;	/**< Of them, resuming the session kept. */
+};
+
+/**
+ * @brief Sets up TLS on a socket connecting, for the handshake to go on as
+ *        the first bytes are sent.
+ *
+ * The context is built on the first call and kept for the next ones with
+ * the same @p param, and so is the session.
+ *
+ * @param[in] fd The socket, non-blocking.
+ * @param[in] host Name or address of the server, to verify it against and
+ *            for SNI. It is not kept.
+ * @param[in] port Port of the server, for the session to be resumed on the
+ *            same one only.
+ * @param[in] param The certificates. It must stay valid until
+ *            @ref ocpp_ws_tls_forget.
+ *
+ * @return 0 on success, -ENOTSUP when built without it, -ENOENT for a file
+ *         that can not be loaded, or -ENOMEM.
+ */
+int ocpp_ws_tls_start(int fd, const char *host, uint16_t port,
+		const struct ocpp_ws_tls_param *param);
+
+/**
+ * @brief Sends close_notify if it can, and tears down the connection.
+ *
+ * The socket is left open. The session is kept unless the connection failed
+ * on a TLS error.
+ */
+void ocpp_ws_tls_stop(void);
+
+/**
+ * @brief Frees the context and the session kept, e.g. once the
+ *        certificates changed.
+ */
+void ocpp_ws_tls_forget(void);
+
+bool ocpp_ws_tls_active(void);
+
+/**
+ * @brief Encrypts and sends bytes, doing the handshake first.
+ *
+ * @return The number of bytes taken, -EAGAIN if the socket would block,
+ *         -EPROTO for a handshake or a record that failed, e.g. a server not
+ *         verified, or the negative errno of the socket.
+ */
+ssize_t ocpp_ws_tls_send(const void *data, size_t len);
+
+/**
+ * @brief Receives and decrypts bytes, doing the handshake first.
+ *
+ * @return The number of bytes, -EAGAIN if none, 0 at the end of the stream,
+ *         -EPROTO for a handshake or a record that failed, or the negative
+ *         errno of the socket.
+ */
+ssize_t ocpp_ws_tls_recv(void *buf, size_t bufsize);
+
+/**
+ * @brief Tells if TLS waits for the socket to get writable, e.g. in the
+ *        middle of the handshake.
+ */
+bool ocpp_ws_tls_wants_write(void);
+
+/**
+ * @brief Tells if bytes decrypted are left to take, which the socket getting
+ *        readable would not tell of.
+ */
+bool ocpp_ws_tls_has_pending(void);
+
+void ocpp_ws_tls_get_stats(struct ocpp_ws_tls_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_WS_TLS_H */
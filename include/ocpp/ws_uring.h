@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef LIBMCU_OCPP_WS_URING_H
+#define LIBMCU_OCPP_WS_URING_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/*
+ * io_uring backend of the WebSocket transport, for Linux 6.0 or later.
+ *
+ * Set OCPP_WS_URING to 1 to hand the socket over to a ring once connected.
+ * Frames go out of the buffer they are encoded in, registered with the
+ * kernel, as a chain of writes submitted in one go, and a multishot receive
+ * fills buffers provided to the kernel with no syscall per read. Where the
+ * ring can not be set up, e.g. an older kernel or a seccomp filter, the
+ * transport stays on the socket as without it. No liburing is needed.
+ *
+ * There is one ring, for the one connection of the process, see
+ * ocpp/reactor.h. What it saves, counted in @ref ocpp_ws_uring_stats, is
+ * per charge point: a gateway of many takes a process, and a ring, each.
+ */
+#if !defined(OCPP_WS_URING)
+#define OCPP_WS_URING					0
+#endif
+/* Writes in a chain at most, one for each segment of the buffer given. */
+#if !defined(OCPP_WS_URING_TX_SEGMENTS)
+#define OCPP_WS_URING_TX_SEGMENTS			16
+#endif
+/* Buffers provided for the multishot receive, a power of 2. The receive is
+ * armed again once they run out and some are taken. */
+#if !defined(OCPP_WS_URING_RX_BUFS)
+#define OCPP_WS_URING_RX_BUFS				8
+#endif
+#if !defined(OCPP_WS_URING_RX_BUFSIZE)
+#define OCPP_WS_URING_RX_BUFSIZE			2048
+#endif
+
+struct ocpp_ws_uring_stats {
+	uint32_t enters;	/**< io_uring_enter(), the only syscall made. */
+	uint32_t writes;	/**< Writes submitted, of one segment each. */
+	uint32_t reads;		/**< Buffers filled by the receive. */
+	uint32_t arms;		/**< Times the receive was armed. */
+};
+
+/**
+ * @brief Sets up the ring for a socket connected.
+ *
+ * The socket is made blocking, as the ring waits for it on its own, until
+ * @ref ocpp_ws_uring_stop.
+ *
+ * @param[in] fd The socket.
+ * @param[in] txbuf The buffer the frames to send are encoded in, registered
+ *            with the kernel to be written from with nothing copied. It
+ *            must stay valid until @ref ocpp_ws_uring_stop.
+ * @param[in] txbufsize The size of @p txbuf.
+ *
+ * @return 0 on success, or the negative errno of what is missing for the
+ *         transport to stay on the socket, e.g. -ENOSYS or -EPERM.
+ */
+int ocpp_ws_uring_start(int fd, void *txbuf, size_t txbufsize);
+
+/**
+ * @brief Submits what is queued and tears down the ring.
+ *
+ * The socket is left open, non-blocking again if it was before.
+ */
+void ocpp_ws_uring_stop(void);
+
+bool ocpp_ws_uring_active(void);
+
+/**
+ * @brief Gets the fd of the ring, readable when something has completed.
+ *
+ * @return The file descriptor, or -1 when not active.
+ */
+int ocpp_ws_uring_get_fd(void);
+
+/**
+ * @brief Writes segments of the registered buffer, in order.
+ *
+ * They go out on the next submission, each a write linked to the one
+ * before. The bytes are written from where they lie, so they must be left
+ * in place until reported written. Give the bytes not reported yet again,
+ * along with any queued since: those of a chain in flight are not written
+ * twice, and the rest waits for the chain to complete.
+ *
+ * @param[in] iov The segments, from the first byte not reported written.
+ * @param[in] iovcnt The number of segments.
+ *
+ * @return The number of bytes written since the last call, -EAGAIN if none,
+ *         or the negative errno of a write that failed.
+ */
+ssize_t ocpp_ws_uring_send(const struct iovec *iov, unsigned int iovcnt);
+
+/**
+ * @brief Takes what the receive has brought in.
+ *
+ * @return The number of bytes, -EAGAIN if none, 0 at the end of the stream,
+ *         or the negative errno of the receive.
+ */
+ssize_t ocpp_ws_uring_recv(void *buf, size_t bufsize);
+
+/**
+ * @brief Submits the bytes queued and a receive to arm, in one syscall.
+ *
+ * ocpp_ws_poll() calls it, and so does the reactor after stepping the
+ * engine. Call it after ocpp_step() otherwise, for the messages sent from
+ * there not to wait for the next step.
+ *
+ * @return 0 on success or with nothing to submit, or a negative errno.
+ */
+int ocpp_ws_uring_submit(void);
+
+void ocpp_ws_uring_get_stats(struct ocpp_ws_uring_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* LIBMCU_OCPP_WS_URING_H */
@@ -0,0 +1,695 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/cbor.h"
+#include "ocpp/codec/schema.h"
+
+#include <errno.h>
+#include <string.h>
+
+enum {
+	MAJOR_UINT,
+	MAJOR_NINT,
+	MAJOR_BYTES,
+	MAJOR_TEXT,
+	MAJOR_ARRAY,
+	MAJOR_MAP,
+	MAJOR_TAG,
+	MAJOR_SIMPLE,
+};
+
+#define SIMPLE_FALSE				20
+#define SIMPLE_TRUE				21
+#define SIMPLE_NULL				22
+#define TAG_EPOCH_TIME				1
+
+struct decoder {
+	const uint8_t *in;
+	size_t len;
+	size_t pos;
+
+	uint8_t *payload;
+	size_t bufsize;
+	size_t used;
+
+	uint8_t depth;
+};
+
+struct head {
+	uint8_t major;
+	uint64_t v;
+};
+
+static size_t align_up(size_t x, size_t align)
+{
+	return (x + align - 1) / align * align;
+}
+
+static int set_int(void *p, size_t size, int64_t v, bool is_signed)
+{
+	if (!is_signed && v < 0) {
+		return -ERANGE;
+	}
+
+	switch (size) {
+	case sizeof(int8_t):
+		if (is_signed? (v < INT8_MIN || v > INT8_MAX) : v > UINT8_MAX) {
+			return -ERANGE;
+		}
+		*(uint8_t *)p = (uint8_t)v;
+		break;
+	case sizeof(int16_t):
+		if (is_signed? (v < INT16_MIN || v > INT16_MAX) :
+				v > UINT16_MAX) {
+			return -ERANGE;
+		}
+		*(uint16_t *)p = (uint16_t)v;
+		break;
+	case sizeof(int32_t):
+		if (is_signed? (v < INT32_MIN || v > INT32_MAX) :
+				v > UINT32_MAX) {
+			return -ERANGE;
+		}
+		*(uint32_t *)p = (uint32_t)v;
+		break;
+	case sizeof(int64_t):
+		*(uint64_t *)p = (uint64_t)v;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void set_ptr(void *p, const void *ptr)
+{
+	memcpy(p, &ptr, sizeof(ptr));
+}
+
+static int get_head(struct decoder *dec, struct head *head)
+{
+	if (dec->pos >= dec->len) {
+		return -EBADMSG;
+	}
+
+	const uint8_t c = dec->in[dec->pos++];
+	const uint8_t info = c & 0x1f;
+	size_t n;
+
+	head->major = c >> 5;
+
+	if (info < 24) {
+		head->v = info;
+		return 0;
+	} else if (info > 27) { /* indefinite length or reserved */
+		return -EBADMSG;
+	}
+
+	n = (size_t)1 << (info - 24);
+
+	if (n > dec->len - dec->pos) {
+		return -EBADMSG;
+	}
+
+	head->v = 0;
+	for (size_t i = 0; i < n; i++) {
+		head->v = head->v << 8 | dec->in[dec->pos++];
+	}
+
+	return 0;
+}
+
+static int expect(struct decoder *dec, uint8_t major, uint64_t *v)
+{
+	struct head head;
+	int err;
+
+	if ((err = get_head(dec, &head)) != 0) {
+		return err;
+	}
+	if (head.major != major) {
+		return -EBADMSG;
+	}
+
+	*v = head.v;
+
+	return 0;
+}
+
+static bool is_next(const struct decoder *dec, uint8_t initial)
+{
+	return dec->pos < dec->len && dec->in[dec->pos] == initial;
+}
+
+static int get_int(struct decoder *dec, int64_t *v)
+{
+	struct head head;
+	int err;
+
+	if ((err = get_head(dec, &head)) != 0) {
+		return err;
+	}
+	if (head.major != MAJOR_UINT && head.major != MAJOR_NINT) {
+		return -EBADMSG;
+	}
+	if (head.v > INT64_MAX) {
+		return -ERANGE;
+	}
+
+	*v = head.major == MAJOR_UINT? (int64_t)head.v : -1 - (int64_t)head.v;
+
+	return 0;
+}
+
+static int get_text(struct decoder *dec, const uint8_t **s, size_t *n)
+{
+	uint64_t len;
+	int err;
+
+	if ((err = expect(dec, MAJOR_TEXT, &len)) != 0) {
+		return err;
+	}
+	if (len > dec->len - dec->pos) {
+		return -EBADMSG;
+	}
+
+	*s = &dec->in[dec->pos];
+	*n = (size_t)len;
+	dec->pos += (size_t)len;
+
+	return 0;
+}
+
+static int skip(struct decoder *dec)
+{
+	struct head head;
+	int err;
+
+	if ((err = get_head(dec, &head)) != 0) {
+		return err;
+	}
+	if (dec->depth >= OCPP_CBOR_MAX_DEPTH) {
+		return -EBADMSG;
+	}
+
+	dec->depth++;
+
+	switch (head.major) {
+	case MAJOR_BYTES: /* fall through */
+	case MAJOR_TEXT:
+		if (head.v > dec->len - dec->pos) {
+			err = -EBADMSG;
+		} else {
+			dec->pos += (size_t)head.v;
+		}
+		break;
+	case MAJOR_MAP:
+		if (head.v > UINT64_MAX / 2) {
+			err = -EBADMSG;
+			break;
+		}
+		head.v *= 2;
+		/* fall through */
+	case MAJOR_ARRAY:
+		/* every item takes a byte at least */
+		if (head.v > dec->len - dec->pos) {
+			err = -EBADMSG;
+			break;
+		}
+		for (uint64_t i = 0; i < head.v && err == 0; i++) {
+			err = skip(dec);
+		}
+		break;
+	case MAJOR_TAG:
+		err = skip(dec);
+		break;
+	default:
+		break;
+	}
+
+	dec->depth--;
+
+	return err;
+}
+
+/* Claims size zeroed bytes at pos of the payload. */
+static int claim(struct decoder *dec, size_t pos, size_t size)
+{
+	if (pos > dec->bufsize || size > dec->bufsize - pos) {
+		return -ENOBUFS;
+	}
+
+	memset(&dec->payload[pos], 0, size);
+
+	if (pos + size > dec->used) {
+		dec->used = pos + size;
+	}
+
+	return 0;
+}
+
+/* Copies a text string to pos of the payload, null-terminated, and returns
+ * the position past it in end. */
+static int put_text(struct decoder *dec, size_t pos, size_t *end)
+{
+	const uint8_t *s;
+	size_t n;
+	int err;
+
+	if ((err = get_text(dec, &s, &n)) != 0) {
+		return err;
+	}
+	if ((err = claim(dec, pos, n + 1)) != 0) {
+		return err;
+	}
+
+	memcpy(&dec->payload[pos], s, n);
+
+	if (end) {
+		*end = pos + n + 1;
+	}
+
+	return 0;
+}
+
+static int decode_string(struct decoder *dec, const struct ocpp_field *field,
+		void *p)
+{
+	const uint8_t *s;
+	size_t n;
+	int err;
+
+	if ((err = get_text(dec, &s, &n)) != 0) {
+		return err;
+	}
+	if (n >= field->size) {
+		return -ERANGE;
+	}
+
+	memcpy(p, s, n);
+	((char *)p)[n] = '\0';
+
+	return 0;
+}
+
+/* The list ends with an empty string, or at the end of the payload when it
+ * is a flexible array member. */
+static int decode_string_list(struct decoder *dec, size_t pos, bool flexible)
+{
+	uint64_t n;
+	int err;
+
+	if ((err = expect(dec, MAJOR_ARRAY, &n)) != 0) {
+		return err;
+	}
+
+	for (uint64_t i = 0; i < n; i++) {
+		if ((err = put_text(dec, pos, &pos)) != 0) {
+			return err;
+		}
+	}
+
+	if (flexible && pos >= dec->bufsize) {
+		return 0;
+	}
+
+	return claim(dec, pos, 1);
+}
+
+static int decode_time(struct decoder *dec, time_t *t)
+{
+	int64_t v;
+	uint64_t tag;
+	int err;
+
+	if (is_next(dec, MAJOR_TAG << 5 | TAG_EPOCH_TIME)) {
+		if ((err = expect(dec, MAJOR_TAG, &tag)) != 0) {
+			return err;
+		}
+	}
+	if ((err = get_int(dec, &v)) != 0) {
+		return err;
+	}
+
+	*t = (time_t)v;
+
+	if ((int64_t)*t != v) {
+		return -ERANGE;
+	}
+
+	return 0;
+}
+
+static int decode_enum(struct decoder *dec, const struct ocpp_field *field,
+		void *p)
+{
+	const char * const *names = (const char * const *)field->ref;
+	uint64_t i;
+	int err;
+
+	if ((err = expect(dec, MAJOR_UINT, &i)) != 0) {
+		return err;
+	}
+	if (i >= field->aux || names[i] == NULL) {
+		return -EBADMSG;
+	}
+
+	return set_int(p, field->size, field->type == OCPP_FIELD_FLAG?
+			(int64_t)((uint64_t)1 << i) : (int64_t)i, true);
+}
+
+static int decode_object(struct decoder *dec,
+		const struct ocpp_schema *schema, size_t base);
+
+static int decode_object_list(struct decoder *dec,
+		const struct ocpp_field *field, size_t pos)
+{
+	const struct ocpp_schema *elem = (const struct ocpp_schema *)field->ref;
+	const size_t start = align_up(dec->used, elem->align);
+	uint64_t n;
+	int err;
+
+	if ((err = expect(dec, MAJOR_ARRAY, &n)) != 0) {
+		return err;
+	}
+	/* the elements and the empty one ending them, placed before anything
+	 * they point to */
+	if (n >= dec->bufsize / elem->size ||
+			(err = claim(dec, start, (size_t)(n + 1) * elem->size))
+			!= 0) {
+		return err? err : -ENOBUFS;
+	}
+
+	set_ptr(&dec->payload[pos], &dec->payload[start]);
+
+	for (size_t i = 0; i < (size_t)n && err == 0; i++) {
+		err = decode_object(dec, elem, start + i * elem->size);
+	}
+
+	return err;
+}
+
+static int decode_array(struct decoder *dec, const struct ocpp_field *field,
+		size_t base)
+{
+	const struct ocpp_schema *elem = (const struct ocpp_schema *)field->ref;
+	const size_t pos = base + field->offset;
+	uint64_t n;
+	int err;
+
+	if ((err = expect(dec, MAJOR_ARRAY, &n)) != 0) {
+		return err;
+	}
+	if (n > dec->bufsize / elem->size ||
+			(err = claim(dec, pos, (size_t)n * elem->size)) != 0) {
+		return err? err : -ENOBUFS;
+	}
+	if ((err = set_int(&dec->payload[base + field->aux], field->size,
+			(int64_t)n, false)) != 0) {
+		return err;
+	}
+
+	for (size_t i = 0; i < (size_t)n && err == 0; i++) {
+		err = decode_object(dec, elem, pos + i * elem->size);
+	}
+
+	return err;
+}
+
+static int decode_records(struct decoder *dec, const struct ocpp_field *field,
+		size_t base)
+{
+	const struct ocpp_schema *sub = (const struct ocpp_schema *)field->ref;
+	size_t pos = base + align_up(field->offset, sub->align);
+	uint64_t n = 1;
+	int err;
+
+	if ((field->flags & OCPP_FIELD_LIST) &&
+			(err = expect(dec, MAJOR_ARRAY, &n)) != 0) {
+		return err;
+	}
+
+	for (uint64_t i = 0; i < n; i++) {
+		if ((err = claim(dec, pos, sub->size)) != 0 ||
+				(err = decode_object(dec, sub, pos)) != 0) {
+			return err;
+		}
+
+		/* the next record starts past the padding of this one */
+		pos = align_up(dec->used, sub->align);
+		if (pos <= dec->bufsize) {
+			dec->used = pos;
+		}
+	}
+
+	return 0;
+}
+
+static int decode_value(struct decoder *dec, const struct ocpp_field *field,
+		size_t base)
+{
+	const size_t pos = base + field->offset;
+	void *p = &dec->payload[pos];
+	struct head head;
+	int64_t v;
+	int err;
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING:
+		return decode_string(dec, field, p);
+	case OCPP_FIELD_TEXT:
+		return put_text(dec, pos, NULL);
+	case OCPP_FIELD_STRING_PTR:
+		set_ptr(p, &dec->payload[dec->used]);
+		return put_text(dec, dec->used, NULL);
+	case OCPP_FIELD_STRING_LIST:
+		return decode_string_list(dec, pos, true);
+	case OCPP_FIELD_STRING_LIST_PTR:
+		set_ptr(p, &dec->payload[dec->used]);
+		return decode_string_list(dec, dec->used, false);
+	case OCPP_FIELD_INT: /* fall through */
+	case OCPP_FIELD_DECIMAL: /* fall through */
+	case OCPP_FIELD_UINT:
+		if ((err = get_int(dec, &v)) != 0) {
+			return err;
+		}
+		return set_int(p, field->size, v,
+				field->type != OCPP_FIELD_UINT);
+	case OCPP_FIELD_BOOL:
+		if ((err = get_head(dec, &head)) != 0) {
+			return err;
+		}
+		if (head.major != MAJOR_SIMPLE || (head.v != SIMPLE_TRUE &&
+					head.v != SIMPLE_FALSE)) {
+			return -EBADMSG;
+		}
+		return set_int(p, field->size, head.v == SIMPLE_TRUE, true);
+	case OCPP_FIELD_TIME:
+		return decode_time(dec, (time_t *)p);
+	case OCPP_FIELD_ENUM: /* fall through */
+	case OCPP_FIELD_FLAG:
+		return decode_enum(dec, field, p);
+	case OCPP_FIELD_OBJECT:
+		if (field->flags & OCPP_FIELD_LIST) {
+			uint64_t n;
+			if ((err = expect(dec, MAJOR_ARRAY, &n)) != 0) {
+				return err;
+			} else if (n == 0) {
+				return 0;
+			} else if (n > 1) {
+				return -ENOBUFS; /* the struct holds only one */
+			}
+		}
+		return decode_object(dec,
+				(const struct ocpp_schema *)field->ref, pos);
+	case OCPP_FIELD_OBJECT_LIST_PTR:
+		return decode_object_list(dec, field, pos);
+	case OCPP_FIELD_ARRAY:
+		return decode_array(dec, field, base);
+	case OCPP_FIELD_RECORD:
+		return decode_records(dec, field, base);
+	default:
+		return -EBADMSG;
+	}
+}
+
+static int decode_object(struct decoder *dec,
+		const struct ocpp_schema *schema, size_t base)
+{
+	uint64_t n;
+	int err;
+
+	if (dec->depth >= OCPP_CBOR_MAX_DEPTH) {
+		return -EBADMSG;
+	}
+	if ((err = expect(dec, MAJOR_MAP, &n)) != 0) {
+		return err;
+	}
+
+	dec->depth++;
+
+	for (uint64_t i = 0; i < n && err == 0; i++) {
+		uint64_t key;
+
+		if (dec->pos < dec->len &&
+				dec->in[dec->pos] >> 5 == MAJOR_TEXT) {
+			/* keyed by name, not by one of ours */
+			if ((err = skip(dec)) == 0) {
+				err = skip(dec);
+			}
+		} else if ((err = expect(dec, MAJOR_UINT, &key)) != 0) {
+			break;
+		} else if (key >= schema->nr_fields ||
+				is_next(dec, MAJOR_SIMPLE << 5 | SIMPLE_NULL)) {
+			err = skip(dec);
+		} else {
+			err = decode_value(dec, &schema->fields[key], base);
+		}
+	}
+
+	dec->depth--;
+
+	return err;
+}
+
+static int start_payload(struct decoder *dec, struct ocpp_message *msg)
+{
+	size_t size;
+
+	if (msg->role == OCPP_MSG_ROLE_CALLERROR) {
+		size = sizeof(struct ocpp_CallError);
+	} else {
+		const struct ocpp_schema *schema = ocpp_get_schema(msg->type,
+				msg->role == OCPP_MSG_ROLE_CALLRESULT);
+		if (schema == NULL) {
+			return -ENOTSUP;
+		}
+		size = schema->size;
+	}
+
+	msg->payload.fmt.data = dec->payload;
+
+	return claim(dec, 0, size);
+}
+
+static int decode_error(struct decoder *dec)
+{
+	struct ocpp_CallError *err = (struct ocpp_CallError *)dec->payload;
+	const uint8_t *s;
+	uint64_t code;
+	size_t n;
+	int rc;
+
+	if ((rc = expect(dec, MAJOR_UINT, &code)) != 0 ||
+			(rc = get_text(dec, &s, &n)) != 0) {
+		return rc;
+	}
+
+	err->code = code < OCPP_CALL_ERROR_GENERIC?
+		(ocpp_call_error_t)code : OCPP_CALL_ERROR_GENERIC;
+	/* the description is cut to fit as it is only informative */
+	n = n < sizeof(err->description)? n : sizeof(err->description) - 1;
+	memcpy(err->description, s, n);
+	err->description[n] = '\0';
+
+	return skip(dec); /* error details */
+}
+
+static int decode_frame(struct decoder *dec, struct ocpp_message *msg)
+{
+	const uint8_t *s;
+	uint64_t n, v;
+	size_t len;
+	int err;
+
+	if ((err = expect(dec, MAJOR_ARRAY, &n)) != 0 ||
+			(err = expect(dec, MAJOR_UINT, &v)) != 0) {
+		return err;
+	}
+
+	/* the roles are numbered as on the wire */
+	if ((v == OCPP_MSG_ROLE_CALL && n != 4) ||
+			(v == OCPP_MSG_ROLE_CALLRESULT && n != 3) ||
+			(v == OCPP_MSG_ROLE_CALLERROR && n != 5) ||
+			v < OCPP_MSG_ROLE_CALL || v > OCPP_MSG_ROLE_CALLERROR) {
+		return -EBADMSG;
+	}
+
+	msg->role = (ocpp_message_role_t)v;
+
+	if ((err = get_text(dec, &s, &len)) != 0) {
+		return err;
+	}
+	if (len >= sizeof(msg->id)) {
+		return -ERANGE;
+	}
+
+	memcpy(msg->id, s, len);
+	msg->id[len] = '\0';
+
+	switch (msg->role) {
+	case OCPP_MSG_ROLE_CALL:
+		if ((err = expect(dec, MAJOR_UINT, &v)) != 0) {
+			return err;
+		}
+		msg->type = v < OCPP_MSG_MAX? (ocpp_message_t)v : OCPP_MSG_MAX;
+		if (msg->type == OCPP_MSG_MAX) {
+			return -ENOTSUP;
+		}
+		break;
+	case OCPP_MSG_ROLE_CALLRESULT:
+		if ((msg->type = ocpp_get_type_from_idstr(msg->id))
+				== OCPP_MSG_MAX) {
+			return -ENOENT;
+		}
+		break;
+	default:
+		break;
+	}
+
+	if ((err = start_payload(dec, msg)) != 0) {
+		return err;
+	}
+
+	if (msg->role == OCPP_MSG_ROLE_CALLERROR) {
+		err = decode_error(dec);
+	} else {
+		err = decode_object(dec, ocpp_get_schema(msg->type,
+				msg->role == OCPP_MSG_ROLE_CALLRESULT), 0);
+	}
+
+	if (err) {
+		return err;
+	}
+	if (dec->pos != dec->len) {
+		return -EBADMSG;
+	}
+
+	msg->payload.size = dec->used;
+
+	if (msg->role == OCPP_MSG_ROLE_CALLERROR) {
+		return 0;
+	}
+
+	return ocpp_validate(msg->type, msg->role == OCPP_MSG_ROLE_CALLRESULT,
+			dec->payload, dec->used);
+}
+
+int ocpp_decode_cbor(struct ocpp_message *msg, void *payload, size_t bufsize,
+		const void *data, size_t len)
+{
+	struct decoder dec = {
+		.in = (const uint8_t *)data,
+		.len = data? len : 0,
+		.payload = (uint8_t *)payload,
+		.bufsize = payload? bufsize : 0,
+	};
+
+	memset(msg, 0, sizeof(*msg));
+
+	return decode_frame(&dec, msg);
+}
@@ -0,0 +1,714 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/cbor.h"
+#include "ocpp/codec/codec.h"
+#include "ocpp/codec/schema.h"
+
+#include <errno.h>
+#include <string.h>
+
+enum {
+	MAJOR_UINT,
+	MAJOR_NINT,
+	MAJOR_BYTES,
+	MAJOR_TEXT,
+	MAJOR_ARRAY,
+	MAJOR_MAP,
+	MAJOR_TAG,
+	MAJOR_SIMPLE,
+};
+
+#define SIMPLE_FALSE				0xf4
+#define SIMPLE_TRUE				0xf5
+#define TAG_EPOCH_TIME				1
+
+/* Writes the cap bytes of the frame from skip and keeps counting past them,
+ * so that the size of the whole frame is known even when it does not fit.
+ * With a cursor, it resumes at the point given and stops past the cap bytes
+ * instead, leaving the cursor at the last point within them. */
+struct writer {
+	uint8_t *buf;
+	size_t cap;
+	size_t skip;
+	size_t len;
+
+	struct ocpp_encoder_cursor *cursor;
+	struct ocpp_encoder_cursor from;
+	bool resuming;
+	uint8_t depth;
+	uint32_t path[OCPP_ENCODER_MAX_DEPTH];
+};
+
+static void put(struct writer *w, const void *data, size_t n)
+{
+	const size_t end = w->skip + w->cap;
+
+	if (w->len < end && w->len + n > w->skip) {
+		const size_t from = w->len < w->skip? w->skip - w->len : 0;
+		const size_t to = w->len + n < end? n : end - w->len;
+
+		memcpy(&w->buf[w->len + from - w->skip],
+				(const uint8_t *)data + from, to - from);
+	}
+
+	w->len += n;
+}
+
+/* Goes down a level, into the elements of a map or an array. */
+static void enter(struct writer *w)
+{
+	w->depth++;
+}
+
+static void leave(struct writer *w)
+{
+	w->depth--;
+}
+
+/* Comes to the element at index on the current level. Returns 1 to skip it
+ * as it is before the point resumed from, 0 to encode it, or -ENOBUFS to
+ * stop as the piece is full. */
+static int begin(struct writer *w, uint32_t index)
+{
+	if (w->cursor == NULL || w->depth > OCPP_ENCODER_MAX_DEPTH) {
+		return 0;
+	}
+
+	const uint8_t level = (uint8_t)(w->depth - 1);
+
+	w->path[level] = index;
+
+	if (w->resuming) {
+		if (index < w->from.path[level]) {
+			return 1;
+		}
+		if (level + 1 < w->from.depth) {
+			return 0; /* on the way down to the point */
+		}
+		/* what was put on the way is left behind the piece */
+		w->resuming = false;
+		w->len = w->from.offset;
+	}
+
+	if (w->len > w->skip + w->cap) {
+		return -ENOBUFS;
+	}
+
+	memcpy(w->cursor->path, w->path, (level + 1u) * sizeof(*w->path));
+	w->cursor->depth = (uint8_t)(level + 1);
+	w->cursor->offset = w->len;
+
+	return 0;
+}
+
+static void put_byte(struct writer *w, uint8_t c)
+{
+	put(w, &c, 1);
+}
+
+/* The shortest form of the head as the deterministic encoding requires. */
+static void put_head(struct writer *w, uint8_t major, uint64_t v)
+{
+	uint8_t tmp[9];
+	size_t n;
+
+	if (v < 24) {
+		tmp[0] = (uint8_t)(major << 5 | v);
+		n = 1;
+	} else if (v <= UINT8_MAX) {
+		tmp[0] = (uint8_t)(major << 5 | 24);
+		n = 2;
+	} else if (v <= UINT16_MAX) {
+		tmp[0] = (uint8_t)(major << 5 | 25);
+		n = 3;
+	} else if (v <= UINT32_MAX) {
+		tmp[0] = (uint8_t)(major << 5 | 26);
+		n = 5;
+	} else {
+		tmp[0] = (uint8_t)(major << 5 | 27);
+		n = 9;
+	}
+
+	for (size_t i = n - 1; i > 0; i--) {
+		tmp[i] = (uint8_t)v;
+		v >>= 8;
+	}
+
+	put(w, tmp, n);
+}
+
+static void put_int(struct writer *w, int64_t v)
+{
+	if (v < 0) {
+		put_head(w, MAJOR_NINT, (uint64_t)(-1 - v));
+	} else {
+		put_head(w, MAJOR_UINT, (uint64_t)v);
+	}
+}
+
+/* Up to maxlen bytes of str, stopping early at a null. */
+static void put_text(struct writer *w, const char *str, size_t maxlen)
+{
+	size_t n = 0;
+
+	while (n < maxlen && str[n]) {
+		n++;
+	}
+
+	put_head(w, MAJOR_TEXT, n);
+	put(w, str, n);
+}
+
+/* Null-terminated strings up to an empty one or maxlen bytes. */
+static int put_text_list(struct writer *w, const char *list, size_t maxlen)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < maxlen && list[i]; count++) {
+		while (i < maxlen && list[i]) {
+			i++;
+		}
+		i++;
+	}
+
+	put_head(w, MAJOR_ARRAY, count);
+	enter(w);
+
+	for (size_t i = 0, k = 0; k < count; k++) {
+		size_t n = 0;
+		int rc;
+
+		while (i + n < maxlen && list[i + n]) {
+			n++;
+		}
+
+		if ((rc = begin(w, (uint32_t)k)) < 0) {
+			return rc;
+		} else if (rc == 0) {
+			put_text(w, &list[i], n);
+		}
+
+		i += n + 1;
+	}
+
+	leave(w);
+
+	return 0;
+}
+
+static int64_t get_int(const void *p, size_t size)
+{
+	switch (size) {
+	case sizeof(int8_t):
+		return *(const int8_t *)p;
+	case sizeof(int16_t):
+		return *(const int16_t *)p;
+	case sizeof(int32_t):
+		return *(const int32_t *)p;
+	case sizeof(int64_t):
+		return *(const int64_t *)p;
+	default:
+		return 0;
+	}
+}
+
+static uint64_t get_uint(const void *p, size_t size)
+{
+	switch (size) {
+	case sizeof(uint8_t):
+		return *(const uint8_t *)p;
+	case sizeof(uint16_t):
+		return *(const uint16_t *)p;
+	case sizeof(uint32_t):
+		return *(const uint32_t *)p;
+	case sizeof(uint64_t):
+		return *(const uint64_t *)p;
+	default:
+		return 0;
+	}
+}
+
+static const char *get_ptr(const void *p)
+{
+	const char *ptr;
+	memcpy(&ptr, p, sizeof(ptr));
+	return ptr;
+}
+
+static bool is_zero(const uint8_t *p, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (p[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static size_t align_up(size_t x, size_t align)
+{
+	return (x + align - 1) / align * align;
+}
+
+/* Index of the name of the value, or -1 if it has none. */
+static int get_enum_index(const struct ocpp_field *field, const uint8_t *p)
+{
+	const char * const *names = (const char * const *)field->ref;
+	const int64_t v = get_int(p, field->size);
+
+	if (field->type == OCPP_FIELD_FLAG) {
+		const uint64_t u = (uint64_t)v;
+
+		if (u == 0 || (u & (u - 1)) != 0) {
+			return -1;
+		}
+
+		int bit = 0;
+		while (!(u & ((uint64_t)1 << bit))) {
+			bit++;
+		}
+
+		return bit < field->aux && names[bit]? bit : -1;
+	}
+
+	if (v < 0 || v >= field->aux || names[v] == NULL) {
+		return -1;
+	}
+
+	return (int)v;
+}
+
+static bool is_present(const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const uint8_t *p = &base[field->offset];
+
+	if (field->flags & OCPP_FIELD_REQUIRED) {
+		return true;
+	}
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING:
+		return p[0] != '\0';
+	case OCPP_FIELD_STRING_PTR: /* fall through */
+	case OCPP_FIELD_STRING_LIST_PTR: {
+		const char *str = get_ptr(p);
+		return str && str[0];
+	}
+	case OCPP_FIELD_TEXT: /* fall through */
+	case OCPP_FIELD_STRING_LIST:
+		return field->offset < avail && p[0] != '\0';
+	case OCPP_FIELD_INT: /* fall through */
+	case OCPP_FIELD_DECIMAL: /* fall through */
+	case OCPP_FIELD_BOOL:
+		return get_int(p, field->size) != 0;
+	case OCPP_FIELD_UINT:
+		return get_uint(p, field->size) != 0;
+	case OCPP_FIELD_TIME:
+		return *(const time_t *)p != 0;
+	case OCPP_FIELD_ENUM: /* fall through */
+	case OCPP_FIELD_FLAG:
+		return get_enum_index(field, p) >= 0;
+	case OCPP_FIELD_OBJECT:
+		return !is_zero(p, field->size);
+	case OCPP_FIELD_OBJECT_LIST_PTR:
+		return get_ptr(p) != NULL;
+	case OCPP_FIELD_ARRAY:
+		return get_uint(&base[field->aux], field->size) != 0;
+	case OCPP_FIELD_RECORD: {
+		const struct ocpp_schema *sub =
+			(const struct ocpp_schema *)field->ref;
+		return align_up(field->offset, sub->align) < avail;
+	}
+	default:
+		return false;
+	}
+}
+
+static bool is_flexible(const struct ocpp_field *field)
+{
+	return field->type == OCPP_FIELD_TEXT ||
+		field->type == OCPP_FIELD_STRING_LIST ||
+		field->type == OCPP_FIELD_ARRAY ||
+		field->type == OCPP_FIELD_RECORD;
+}
+
+static int encode_object(struct writer *w, const struct ocpp_schema *schema,
+		const uint8_t *base, size_t avail);
+
+static int encode_records(struct writer *w, const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const struct ocpp_schema *sub = (const struct ocpp_schema *)field->ref;
+	const bool list = (field->flags & OCPP_FIELD_LIST) != 0;
+	const size_t start = align_up(field->offset, sub->align);
+	size_t count = 0;
+	int err = 0;
+
+	/* the array head goes first, so count them beforehand */
+	for (size_t pos = start; pos < avail && (list || count == 0); ) {
+		const size_t size =
+			ocpp_get_record_size(sub, &base[pos], avail - pos);
+
+		if (size == 0) {
+			return -EINVAL;
+		}
+
+		pos += size;
+		count++;
+	}
+
+	if (list) {
+		put_head(w, MAJOR_ARRAY, count);
+		enter(w);
+	} else if (count == 0) {
+		return -EINVAL; /* required but missing */
+	}
+
+	for (size_t pos = start, k = 0; k < count && err == 0; k++) {
+		const size_t size =
+			ocpp_get_record_size(sub, &base[pos], avail - pos);
+		int rc = 0;
+
+		if (list && (rc = begin(w, (uint32_t)k)) < 0) {
+			return rc;
+		} else if (rc == 0) {
+			err = encode_object(w, sub, &base[pos], size);
+		}
+
+		pos += size;
+	}
+
+	if (list) {
+		leave(w);
+	}
+
+	return err;
+}
+
+static int encode_array(struct writer *w, const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const struct ocpp_schema *elem = (const struct ocpp_schema *)field->ref;
+	const uint64_t n = get_uint(&base[field->aux], field->size);
+	int err = 0;
+
+	if (n > (avail - field->offset) / elem->size) {
+		return -EINVAL;
+	}
+
+	put_head(w, MAJOR_ARRAY, n);
+	enter(w);
+
+	for (size_t i = 0; i < (size_t)n && err == 0; i++) {
+		const int rc = begin(w, (uint32_t)i);
+
+		if (rc < 0) {
+			return rc;
+		} else if (rc == 0) {
+			err = encode_object(w, elem,
+					&base[field->offset + i * elem->size],
+					elem->size);
+		}
+	}
+
+	leave(w);
+
+	return err;
+}
+
+static int encode_object_list(struct writer *w,
+		const struct ocpp_field *field, const uint8_t *p)
+{
+	const struct ocpp_schema *elem = (const struct ocpp_schema *)field->ref;
+	const uint8_t *list = (const uint8_t *)get_ptr(p);
+	size_t n = 0;
+	int err = 0;
+
+	/* ended by an element whose first field is empty */
+	while (list && list[n * elem->size + elem->fields[0].offset]) {
+		n++;
+	}
+
+	put_head(w, MAJOR_ARRAY, n);
+	enter(w);
+
+	for (size_t i = 0; i < n && err == 0; i++) {
+		const int rc = begin(w, (uint32_t)i);
+
+		if (rc < 0) {
+			return rc;
+		} else if (rc == 0) {
+			err = encode_object(w, elem, &list[i * elem->size],
+					elem->size);
+		}
+	}
+
+	leave(w);
+
+	return err;
+}
+
+static int encode_value(struct writer *w, const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const uint8_t *p = &base[field->offset];
+	const char *str;
+	int index;
+	int err = 0;
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING:
+		put_text(w, (const char *)p, field->size);
+		break;
+	case OCPP_FIELD_STRING_PTR:
+		str = get_ptr(p);
+		put_text(w, str? str : "", SIZE_MAX);
+		break;
+	case OCPP_FIELD_TEXT:
+		put_text(w, (const char *)p,
+				field->offset < avail? avail - field->offset : 0);
+		break;
+	case OCPP_FIELD_STRING_LIST:
+		err = put_text_list(w, (const char *)p,
+				field->offset < avail? avail - field->offset : 0);
+		break;
+	case OCPP_FIELD_STRING_LIST_PTR:
+		str = get_ptr(p);
+		err = put_text_list(w, str? str : "", SIZE_MAX);
+		break;
+	case OCPP_FIELD_INT: /* fall through */
+	case OCPP_FIELD_DECIMAL:
+		put_int(w, get_int(p, field->size));
+		break;
+	case OCPP_FIELD_UINT:
+		put_head(w, MAJOR_UINT, get_uint(p, field->size));
+		break;
+	case OCPP_FIELD_BOOL:
+		put_byte(w, get_int(p, field->size)?
+				SIMPLE_TRUE : SIMPLE_FALSE);
+		break;
+	case OCPP_FIELD_TIME:
+		put_head(w, MAJOR_TAG, TAG_EPOCH_TIME);
+		put_int(w, (int64_t)*(const time_t *)p);
+		break;
+	case OCPP_FIELD_ENUM: /* fall through */
+	case OCPP_FIELD_FLAG:
+		if ((index = get_enum_index(field, p)) < 0) {
+			return -EINVAL;
+		}
+		put_head(w, MAJOR_UINT, (uint64_t)index);
+		break;
+	case OCPP_FIELD_OBJECT:
+		if (field->flags & OCPP_FIELD_LIST) {
+			put_head(w, MAJOR_ARRAY, 1);
+		}
+		err = encode_object(w, (const struct ocpp_schema *)field->ref,
+				p, field->size);
+		break;
+	case OCPP_FIELD_OBJECT_LIST_PTR:
+		err = encode_object_list(w, field, p);
+		break;
+	case OCPP_FIELD_ARRAY:
+		err = encode_array(w, field, base, avail);
+		break;
+	case OCPP_FIELD_RECORD:
+		err = encode_records(w, field, base, avail);
+		break;
+	default:
+		err = -EINVAL;
+		break;
+	}
+
+	return err;
+}
+
+static int encode_object(struct writer *w, const struct ocpp_schema *schema,
+		const uint8_t *base, size_t avail)
+{
+	size_t count = 0;
+
+	for (uint16_t i = 0; i < schema->nr_fields; i++) {
+		const struct ocpp_field *field = &schema->fields[i];
+
+		if (!is_flexible(field) &&
+				(size_t)field->offset + field->size > avail) {
+			return -EINVAL;
+		}
+		if (is_present(field, base, avail)) {
+			count++;
+		}
+	}
+
+	put_head(w, MAJOR_MAP, count);
+	enter(w);
+
+	for (uint16_t i = 0; i < schema->nr_fields; i++) {
+		const struct ocpp_field *field = &schema->fields[i];
+		int rc;
+
+		if (!is_present(field, base, avail)) {
+			continue;
+		}
+		if ((rc = begin(w, i)) < 0) {
+			return rc;
+		} else if (rc > 0) {
+			continue;
+		}
+
+		put_head(w, MAJOR_UINT, i);
+
+		int err = encode_value(w, field, base, avail);
+		if (err) {
+			return err;
+		}
+	}
+
+	leave(w);
+
+	return 0;
+}
+
+static int encode_payload(struct writer *w, const struct ocpp_message *msg)
+{
+	const struct ocpp_schema *schema = ocpp_get_schema(msg->type,
+			msg->role == OCPP_MSG_ROLE_CALLRESULT);
+	const uint8_t *payload = (const uint8_t *)msg->payload.fmt.request;
+
+	if (schema == NULL) {
+		return -EINVAL;
+	}
+	if (payload == NULL) {
+		if (schema->nr_fields > 0) {
+			return -EINVAL;
+		}
+		put_head(w, MAJOR_MAP, 0);
+		return 0;
+	}
+
+	return encode_object(w, schema, payload, msg->payload.size);
+}
+
+/* A CALLERROR without a payload answers an action not known, as the engine
+ * does for a CALL the decoder gives up on with -ENOTSUP. */
+static ocpp_call_error_t get_default_error(const struct ocpp_message *msg)
+{
+	if ((unsigned int)msg->type >= OCPP_MSG_MAX) {
+		return OCPP_CALL_ERROR_NOT_IMPLEMENTED;
+	}
+	return OCPP_CALL_ERROR_NOT_SUPPORTED;
+}
+
+static int encode_error(struct writer *w, const struct ocpp_message *msg)
+{
+	const struct ocpp_CallError *err =
+		(const struct ocpp_CallError *)msg->payload.fmt.response;
+
+	if (err && msg->payload.size < sizeof(*err)) {
+		return -EINVAL;
+	}
+
+	put_head(w, MAJOR_UINT, err? (uint64_t)err->code :
+			get_default_error(msg));
+	put_text(w, err? err->description : "", sizeof(err->description));
+	put_head(w, MAJOR_MAP, 0);
+
+	return 0;
+}
+
+static int encode_frame(struct writer *w, const struct ocpp_message *msg)
+{
+	/* only a CALLERROR goes without a known action */
+	if (msg == NULL || (msg->role != OCPP_MSG_ROLE_CALLERROR &&
+			(unsigned int)msg->type >= OCPP_MSG_MAX)) {
+		return -EINVAL;
+	}
+
+	/* the roles are numbered as on the wire */
+	switch (msg->role) {
+	case OCPP_MSG_ROLE_CALL:
+		put_head(w, MAJOR_ARRAY, 4);
+		put_head(w, MAJOR_UINT, msg->role);
+		put_text(w, msg->id, sizeof(msg->id));
+		put_head(w, MAJOR_UINT, msg->type);
+		return encode_payload(w, msg);
+	case OCPP_MSG_ROLE_CALLRESULT:
+		put_head(w, MAJOR_ARRAY, 3);
+		put_head(w, MAJOR_UINT, msg->role);
+		put_text(w, msg->id, sizeof(msg->id));
+		return encode_payload(w, msg);
+	case OCPP_MSG_ROLE_CALLERROR:
+		put_head(w, MAJOR_ARRAY, 5);
+		put_head(w, MAJOR_UINT, msg->role);
+		put_text(w, msg->id, sizeof(msg->id));
+		return encode_error(w, msg);
+	default:
+		return -EINVAL;
+	}
+}
+
+int ocpp_encode_cbor_next(const struct ocpp_message *msg,
+		struct ocpp_encoder_cursor *cursor, size_t offset,
+		void *buf, size_t bufsize, size_t *len)
+{
+	struct writer w = {
+		.buf = (uint8_t *)buf,
+		.cap = bufsize,
+		.skip = offset,
+		.cursor = cursor,
+		.from = *cursor,
+		.resuming = cursor->depth > 0,
+	};
+	int err;
+
+	if (buf == NULL || bufsize == 0 || cursor->offset > offset ||
+			cursor->depth > OCPP_ENCODER_MAX_DEPTH) {
+		return -EINVAL;
+	}
+
+	/* -ENOBUFS is for a stop once past the piece */
+	if ((err = encode_frame(&w, msg)) != 0 && err != -ENOBUFS) {
+		return err;
+	}
+
+	if (w.len > w.skip + w.cap) {
+		*len = w.cap;
+		return -EAGAIN;
+	}
+
+	*len = w.len > w.skip? w.len - w.skip : 0;
+
+	return 0;
+}
+
+int ocpp_encode_cbor_at(const struct ocpp_message *msg, size_t offset,
+		void *buf, size_t bufsize, size_t *len)
+{
+	struct writer w = {
+		.buf = (uint8_t *)buf,
+		.cap = buf? bufsize : 0,
+		.skip = offset,
+	};
+	int err;
+
+	if ((err = encode_frame(&w, msg)) != 0) {
+		return err;
+	}
+
+	if (len) {
+		*len = w.len;
+	}
+
+	return w.len > w.skip && w.len - w.skip > w.cap? -ENOBUFS : 0;
+}
+
+int ocpp_encode_cbor(const struct ocpp_message *msg,
+		void *buf, size_t bufsize, size_t *len)
+{
+	return ocpp_encode_cbor_at(msg, 0, buf, bufsize, len);
+}
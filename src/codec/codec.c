@@ -0,0 +1,123 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/codec.h"
+#include "ocpp/codec/cbor.h"
+#include "ocpp/codec/json.h"
+
+#include <errno.h>
+#include <string.h>
+
+static const struct ocpp_codec codecs[] = {
+	{
+		.subprotocol = OCPP_CODEC_JSON_SUBPROTOCOL,
+		.binary = false,
+		.encode = ocpp_encode_json,
+		.encode_next = ocpp_encode_json_next,
+		.decode = ocpp_decode_json,
+	},
+	{
+		.subprotocol = OCPP_CODEC_CBOR_SUBPROTOCOL,
+		.binary = true,
+		.encode = ocpp_encode_cbor,
+		.encode_next = ocpp_encode_cbor_next,
+		.decode = ocpp_decode_cbor,
+	},
+};
+
+static bool is_ows(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+const struct ocpp_codec *ocpp_get_codec(const char *subprotocol, size_t len)
+{
+	for (size_t i = 0; i < sizeof(codecs) / sizeof(*codecs); i++) {
+		const char *name = codecs[i].subprotocol;
+
+		if (strlen(name) == len &&
+				memcmp(name, subprotocol, len) == 0) {
+			return &codecs[i];
+		}
+	}
+
+	return NULL;
+}
+
+const struct ocpp_codec *ocpp_negotiate_codec(const char *subprotocols)
+{
+	const char *p = subprotocols;
+
+	if (p == NULL || *p == '\0') {
+		return &codecs[0];
+	}
+
+	while (*p) {
+		while (is_ows(*p)) {
+			p++;
+		}
+
+		const char *end = p;
+		while (*end && *end != ',') {
+			end++;
+		}
+
+		size_t len = (size_t)(end - p);
+		while (len && is_ows(p[len - 1])) {
+			len--;
+		}
+
+		const struct ocpp_codec *codec = ocpp_get_codec(p, len);
+		if (codec) {
+			return codec;
+		}
+
+		p = *end? end + 1 : end;
+	}
+
+	return NULL;
+}
+
+void ocpp_encoder_init(struct ocpp_encoder *enc,
+		const struct ocpp_codec *codec, const struct ocpp_message *msg)
+{
+	*enc = (struct ocpp_encoder) {
+		.codec = codec,
+		.msg = msg,
+	};
+}
+
+int ocpp_encoder_next(struct ocpp_encoder *enc,
+		void *buf, size_t bufsize, size_t *len)
+{
+	const struct ocpp_encoder_cursor mark = enc->cursor;
+	size_t n = 0;
+	const int err = enc->codec->encode_next(enc->msg, &enc->cursor,
+			enc->offset, buf, bufsize, &n);
+
+	if (err && err != -EAGAIN) {
+		enc->cursor = mark;
+		return err;
+	}
+
+	enc->mark = mark;
+	enc->offset += n;
+	*len = n;
+
+	return err;
+}
+
+void ocpp_encoder_rewind(struct ocpp_encoder *enc, size_t n)
+{
+	enc->offset = n < enc->offset? enc->offset - n : 0;
+
+	if (enc->cursor.offset > enc->offset) {
+		enc->cursor = enc->mark;
+	}
+	if (enc->cursor.offset > enc->offset) {
+		enc->cursor = (struct ocpp_encoder_cursor) { .offset = 0 };
+	}
+}
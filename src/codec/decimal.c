@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/decimal.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+static bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+int ocpp_format_decimal(char *buf, int64_t v, unsigned int scale)
+{
+	char tmp[OCPP_DECIMAL_MAXLEN];
+	size_t i = sizeof(tmp);
+	uint64_t u = v < 0? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+
+	if (scale > OCPP_DECIMAL_MAX_SCALE) {
+		return -EINVAL;
+	}
+
+	for (; scale && u % 10 == 0; scale--) {
+		u /= 10;
+	}
+
+	if (scale) {
+		for (unsigned int n = 0; n < scale; n++) {
+			tmp[--i] = (char)('0' + u % 10);
+			u /= 10;
+		}
+		tmp[--i] = '.';
+	}
+
+	do {
+		tmp[--i] = (char)('0' + u % 10);
+		u /= 10;
+	} while (u);
+
+	if (v < 0) {
+		tmp[--i] = '-';
+	}
+
+	const size_t len = sizeof(tmp) - i;
+	memcpy(buf, &tmp[i], len);
+	buf[len] = '\0';
+
+	return (int)len;
+}
+
+int ocpp_parse_decimal(const char *s, size_t len, unsigned int scale,
+		int64_t *v)
+{
+	uint64_t m = 0;
+	int exp10 = 0;
+	int exp = 0;
+	bool neg = false;
+	bool exp_neg = false;
+	size_t i = 0;
+	size_t n;
+
+	if (i < len && s[i] == '-') {
+		neg = true;
+		i++;
+	}
+
+	for (n = i; i < len && is_digit(s[i]); i++) {
+		if (m > (UINT64_MAX - 9) / 10) {
+			return -ERANGE;
+		}
+		m = m * 10 + (uint64_t)(s[i] - '0');
+	}
+	if (i == n || (s[n] == '0' && i - n > 1)) {
+		return -EBADMSG;
+	}
+
+	if (i < len && s[i] == '.') {
+		for (n = ++i; i < len && is_digit(s[i]); i++) {
+			if (m > (UINT64_MAX - 9) / 10) {
+				continue; /* beyond the precision kept */
+			}
+			m = m * 10 + (uint64_t)(s[i] - '0');
+			exp10--;
+		}
+		if (i == n) {
+			return -EBADMSG;
+		}
+	}
+
+	if (i < len && (s[i] == 'e' || s[i] == 'E')) {
+		if (++i < len && (s[i] == '+' || s[i] == '-')) {
+			exp_neg = s[i++] == '-';
+		}
+		for (n = i; i < len && is_digit(s[i]); i++) {
+			if (exp < 1000) {
+				exp = exp * 10 + (s[i] - '0');
+			}
+		}
+		if (i == n) {
+			return -EBADMSG;
+		}
+	}
+
+	if (i != len) {
+		return -EBADMSG;
+	}
+
+	for (exp10 += (exp_neg? -exp : exp) + (int)scale;
+			exp10 > 0 && m; exp10--) {
+		if (m > UINT64_MAX / 10) {
+			return -ERANGE;
+		}
+		m *= 10;
+	}
+	for (; exp10 < 0 && m; exp10++) {
+		m /= 10;
+	}
+
+	if (m > (uint64_t)INT64_MAX + neg) {
+		return -ERANGE;
+	}
+
+	*v = neg? (int64_t)(0 - m) : (int64_t)m;
+
+	return 0;
+}
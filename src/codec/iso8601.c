@@ -0,0 +1,207 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/iso8601.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define SECONDS_PER_DAY				86400
+
+static const char digits2[] =
+	"00010203040506070809" "10111213141516171819"
+	"20212223242526272829" "30313233343536373839"
+	"40414243444546474849" "50515253545556575859"
+	"60616263646566676869" "70717273747576777879"
+	"80818283848586878889" "90919293949596979899";
+
+static void put2(char *p, unsigned int v)
+{
+	memcpy(p, &digits2[v * 2], 2);
+}
+
+static bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool get_digits(const char *s, size_t n, int *v)
+{
+	*v = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		if (!is_digit(s[i])) {
+			return false;
+		}
+		*v = *v * 10 + (s[i] - '0');
+	}
+
+	return true;
+}
+
+static bool is_leap_year(int year)
+{
+	return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int get_days_in_month(int year, int month)
+{
+	static const uint8_t days[] = {
+		31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31,
+	};
+
+	return month == 2 && is_leap_year(year)? 29 : days[month - 1];
+}
+
+/* Days since 1970-01-01 to the proleptic Gregorian calendar date. */
+static void get_date_from_days(int64_t days,
+		int64_t *year, unsigned int *month, unsigned int *day)
+{
+	days += 719468;
+	const int64_t era = (days >= 0? days : days - 146096) / 146097;
+	const unsigned int doe = (unsigned int)(days - era * 146097);
+	const unsigned int yoe =
+		(doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const unsigned int mp = (5 * doy + 2) / 153;
+
+	*day = doy - (153 * mp + 2) / 5 + 1;
+	*month = mp < 10? mp + 3 : mp - 9;
+	*year = (int64_t)yoe + era * 400 + (*month <= 2);
+}
+
+/* Proleptic Gregorian calendar date to days since 1970-01-01. */
+static int64_t get_days_from_date(int year, int month, int day)
+{
+	const int y = year - (month <= 2);
+	const int era = (y >= 0? y : y - 399) / 400;
+	const unsigned int yoe = (unsigned int)(y - era * 400);
+	const unsigned int mp =
+		(unsigned int)(month > 2? month - 3 : month + 9);
+	const unsigned int doy = (153 * mp + 2) / 5 + (unsigned int)day - 1;
+	const unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return (int64_t)era * 146097 + (int64_t)doe - 719468;
+}
+
+static void format_date(char date[11], int64_t days)
+{
+	int64_t year;
+	unsigned int month, day;
+
+	get_date_from_days(days, &year, &month, &day);
+
+	put2(&date[0], (unsigned int)(year / 100 % 100));
+	put2(&date[2], (unsigned int)(year % 100));
+	date[4] = '-';
+	put2(&date[5], month);
+	date[7] = '-';
+	put2(&date[8], day);
+	date[10] = 'T';
+}
+
+size_t ocpp_format_iso8601(char *buf, time_t t,
+		struct ocpp_iso8601_cache *cache)
+{
+	const int64_t sec = (int64_t)t;
+	int64_t days = sec / SECONDS_PER_DAY;
+	int64_t rem = sec % SECONDS_PER_DAY;
+
+	if (rem < 0) {
+		rem += SECONDS_PER_DAY;
+		days--;
+	}
+
+	if (cache == NULL) {
+		format_date(buf, days);
+	} else {
+		if (!cache->valid || cache->days != days) {
+			format_date(cache->date, days);
+			cache->days = days;
+			cache->valid = true;
+		}
+		memcpy(buf, cache->date, sizeof(cache->date));
+	}
+
+	const unsigned int s = (unsigned int)rem;
+
+	put2(&buf[11], s / 3600);
+	buf[13] = ':';
+	put2(&buf[14], s / 60 % 60);
+	buf[16] = ':';
+	put2(&buf[17], s % 60);
+	buf[19] = 'Z';
+
+	return OCPP_ISO8601_LEN;
+}
+
+static int parse_zone(const char *s, size_t len, int *offset_min)
+{
+	int hour, min = 0;
+
+	if (len == 1 && (s[0] == 'Z' || s[0] == 'z')) {
+		*offset_min = 0;
+		return 0;
+	}
+
+	if ((s[0] != '+' && s[0] != '-') ||
+			(len != 3 && len != 5 && len != 6) ||
+			!get_digits(&s[1], 2, &hour) ||
+			(len == 5 && !get_digits(&s[3], 2, &min)) ||
+			(len == 6 && (s[3] != ':' ||
+				!get_digits(&s[4], 2, &min))) ||
+			hour > 23 || min > 59) {
+		return -EBADMSG;
+	}
+
+	*offset_min = (s[0] == '-'? -1 : 1) * (hour * 60 + min);
+
+	return 0;
+}
+
+int ocpp_parse_iso8601(const char *s, size_t len, time_t *t)
+{
+	int year, month, day, hour, min, sec;
+	int offset_min = 0;
+	size_t i = 19;
+
+	if (len < 19 || s[4] != '-' || s[7] != '-' ||
+			(s[10] != 'T' && s[10] != 't') ||
+			s[13] != ':' || s[16] != ':' ||
+			!get_digits(&s[0], 4, &year) ||
+			!get_digits(&s[5], 2, &month) ||
+			!get_digits(&s[8], 2, &day) ||
+			!get_digits(&s[11], 2, &hour) ||
+			!get_digits(&s[14], 2, &min) ||
+			!get_digits(&s[17], 2, &sec)) {
+		return -EBADMSG;
+	}
+
+	if (month < 1 || month > 12 || day < 1 ||
+			day > get_days_in_month(year, month) ||
+			hour > 23 || min > 59 || sec > 60) {
+		return -EBADMSG;
+	}
+
+	if (i < len && s[i] == '.') {
+		const size_t start = ++i;
+		while (i < len && is_digit(s[i])) {
+			i++;
+		}
+		if (i == start) {
+			return -EBADMSG;
+		}
+	}
+
+	if (i < len && parse_zone(&s[i], len - i, &offset_min) != 0) {
+		return -EBADMSG;
+	}
+
+	*t = (time_t)(get_days_from_date(year, month, day) * SECONDS_PER_DAY +
+			hour * 3600 + (min - offset_min) * 60 + sec);
+
+	return 0;
+}
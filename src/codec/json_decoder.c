@@ -0,0 +1,1162 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/json.h"
+#include "ocpp/codec/decimal.h"
+#include "ocpp/codec/iso8601.h"
+#include "ocpp/codec/json_scan.h"
+#include "ocpp/codec/schema.h"
+#include "ocpp/strconv.h"
+
+#include <errno.h>
+#include <string.h>
+
+/* returned by a state to have the same character processed again */
+#define REPROCESS				1
+
+enum {
+	S_VALUE,
+	S_MEMBER,
+	S_COLON,
+	S_AFTER,
+	S_STRING,
+	S_ESCAPE,
+	S_UNICODE,
+	S_NUMBER,
+	S_LITERAL,
+	S_DONE,
+};
+
+enum {
+	FRAME_ROOT,
+	FRAME_OBJECT,
+	FRAME_ARRAY,
+};
+
+enum {
+	SINK_NONE,
+	SINK_SCRATCH,
+	SINK_FIXED,	/* char[] member */
+	SINK_GROWING,	/* flexible array member or a string pointed to */
+};
+
+enum {
+	ROOT_TYPE,
+	ROOT_ID,
+	ROOT_ACTION,
+	ROOT_CALL_PAYLOAD,
+	ROOT_RESULT_PAYLOAD = ROOT_ACTION,
+	ROOT_ERROR_CODE = ROOT_ACTION,
+	ROOT_ERROR_DESCRIPTION,
+	ROOT_ERROR_DETAILS,
+};
+
+#define MAX_NEST				64
+
+static size_t align_up(size_t x, size_t align)
+{
+	return (x + align - 1) / align * align;
+}
+
+static bool is_ws(uint8_t c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool is_digit(uint8_t c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static struct ocpp_json_frame *top(struct ocpp_json_decoder *dec)
+{
+	return &dec->stack[dec->depth - 1];
+}
+
+static int get_nr_root_values(ocpp_message_role_t role)
+{
+	switch (role) {
+	case OCPP_MSG_ROLE_CALL:
+		return 4;
+	case OCPP_MSG_ROLE_CALLRESULT:
+		return 3;
+	case OCPP_MSG_ROLE_CALLERROR:
+		return 5;
+	default:
+		return 0;
+	}
+}
+
+static int set_int(void *p, size_t size, int64_t v, bool is_signed)
+{
+	if (!is_signed && v < 0) {
+		return -ERANGE;
+	}
+
+	switch (size) {
+	case sizeof(int8_t):
+		if (is_signed? (v < INT8_MIN || v > INT8_MAX) : v > UINT8_MAX) {
+			return -ERANGE;
+		}
+		*(uint8_t *)p = (uint8_t)v;
+		break;
+	case sizeof(int16_t):
+		if (is_signed? (v < INT16_MIN || v > INT16_MAX) :
+				v > UINT16_MAX) {
+			return -ERANGE;
+		}
+		*(uint16_t *)p = (uint16_t)v;
+		break;
+	case sizeof(int32_t):
+		if (is_signed? (v < INT32_MIN || v > INT32_MAX) :
+				v > UINT32_MAX) {
+			return -ERANGE;
+		}
+		*(uint32_t *)p = (uint32_t)v;
+		break;
+	case sizeof(int64_t):
+		*(uint64_t *)p = (uint64_t)v;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void set_ptr(void *p, const void *ptr)
+{
+	memcpy(p, &ptr, sizeof(ptr));
+}
+
+static int set_enum(const struct ocpp_field *field, void *p,
+		const char *s, size_t len)
+{
+	const char * const *names = (const char * const *)field->ref;
+
+	for (uint16_t i = 0; i < field->aux; i++) {
+		if (names[i] && strlen(names[i]) == len &&
+				memcmp(names[i], s, len) == 0) {
+			const int64_t v = field->type == OCPP_FIELD_FLAG?
+				(int64_t)((uint64_t)1 << i) : (int64_t)i;
+			return set_int(p, field->size, v, true);
+		}
+	}
+
+	return -EBADMSG;
+}
+
+static const struct ocpp_field *find_field(const struct ocpp_schema *schema,
+		const char *key, size_t len)
+{
+	for (uint16_t i = 0; i < schema->nr_fields; i++) {
+		const char *name = schema->fields[i].name;
+
+		if (strlen(name) == len && memcmp(name, key, len) == 0) {
+			return &schema->fields[i];
+		}
+	}
+
+	return NULL;
+}
+
+static int push(struct ocpp_json_decoder *dec, uint8_t kind,
+		const struct ocpp_schema *schema,
+		const struct ocpp_field *field, size_t base, size_t cursor)
+{
+	if (dec->depth >= OCPP_JSON_MAX_DEPTH) {
+		return -EBADMSG;
+	}
+
+	dec->stack[dec->depth++] = (struct ocpp_json_frame) {
+		.schema = schema,
+		.field = field,
+		.base = base,
+		.cursor = cursor,
+		.kind = kind,
+	};
+
+	return 0;
+}
+
+/* Claims size zeroed bytes at pos of the payload. */
+static int claim(struct ocpp_json_decoder *dec, size_t pos, size_t size)
+{
+	if (pos > dec->bufsize || size > dec->bufsize - pos) {
+		return -ENOBUFS;
+	}
+
+	memset(&dec->payload[pos], 0, size);
+
+	if (pos + size > dec->used) {
+		dec->used = pos + size;
+	}
+
+	return 0;
+}
+
+static int start_payload(struct ocpp_json_decoder *dec)
+{
+	struct ocpp_message *msg = dec->msg;
+	size_t size;
+
+	if (msg->role == OCPP_MSG_ROLE_CALLERROR) {
+		size = sizeof(struct ocpp_CallError);
+	} else {
+		const struct ocpp_schema *schema = ocpp_get_schema(msg->type,
+				msg->role == OCPP_MSG_ROLE_CALLRESULT);
+		if (schema == NULL) {
+			return -ENOTSUP;
+		}
+		top(dec)->schema = schema;
+		size = schema->size;
+	}
+
+	msg->payload.fmt.data = dec->payload;
+
+	return claim(dec, 0, size);
+}
+
+static void set_sink(struct ocpp_json_decoder *dec, uint8_t sink,
+		void *str, size_t cap)
+{
+	dec->sink = sink;
+	dec->str = (char *)str;
+	dec->str_cap = cap;
+	dec->str_len = 0;
+	dec->scratch_len = 0;
+	dec->overflow = false;
+	dec->surrogate = 0;
+}
+
+/* The string is written straight into the payload from pos, null-terminated,
+ * growing as far as the buffer allows. */
+static int set_sink_growing(struct ocpp_json_decoder *dec, size_t pos)
+{
+	if (pos >= dec->bufsize) {
+		return -ENOBUFS;
+	}
+
+	set_sink(dec, SINK_GROWING, &dec->payload[pos], dec->bufsize - pos - 1);
+
+	return 0;
+}
+
+static int put_byte(struct ocpp_json_decoder *dec, uint8_t c)
+{
+	switch (dec->sink) {
+	case SINK_SCRATCH:
+		if (dec->scratch_len >= sizeof(dec->scratch)) {
+			dec->overflow = true;
+		} else {
+			dec->scratch[dec->scratch_len++] = (char)c;
+		}
+		break;
+	case SINK_FIXED: /* fall through */
+	case SINK_GROWING:
+		if (dec->str_len >= dec->str_cap) {
+			return dec->sink == SINK_FIXED? -ERANGE : -ENOBUFS;
+		}
+		dec->str[dec->str_len++] = (char)c;
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static int put_codepoint(struct ocpp_json_decoder *dec, uint32_t cp)
+{
+	uint8_t utf8[4];
+	size_t n;
+	int err = 0;
+
+	if (cp < 0x80) {
+		utf8[0] = (uint8_t)cp;
+		n = 1;
+	} else if (cp < 0x800) {
+		utf8[0] = (uint8_t)(0xc0 | (cp >> 6));
+		utf8[1] = (uint8_t)(0x80 | (cp & 0x3f));
+		n = 2;
+	} else if (cp < 0x10000) {
+		utf8[0] = (uint8_t)(0xe0 | (cp >> 12));
+		utf8[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+		utf8[2] = (uint8_t)(0x80 | (cp & 0x3f));
+		n = 3;
+	} else {
+		utf8[0] = (uint8_t)(0xf0 | (cp >> 18));
+		utf8[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3f));
+		utf8[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3f));
+		utf8[3] = (uint8_t)(0x80 | (cp & 0x3f));
+		n = 4;
+	}
+
+	for (size_t i = 0; i < n && err == 0; i++) {
+		err = put_byte(dec, utf8[i]);
+	}
+
+	return err;
+}
+
+/* A high surrogate not followed by a low one is replaced with U+FFFD. */
+static int flush_surrogate(struct ocpp_json_decoder *dec)
+{
+	if (dec->surrogate == 0) {
+		return 0;
+	}
+
+	dec->surrogate = 0;
+	return put_codepoint(dec, 0xfffd);
+}
+
+static int put_utf16(struct ocpp_json_decoder *dec, uint16_t u)
+{
+	int err;
+
+	if (u >= 0xdc00 && u <= 0xdfff) {
+		if (dec->surrogate == 0) {
+			return put_codepoint(dec, 0xfffd);
+		}
+
+		const uint32_t cp = 0x10000 +
+			((uint32_t)(dec->surrogate - 0xd800) << 10) +
+			(uint32_t)(u - 0xdc00);
+		dec->surrogate = 0;
+		return put_codepoint(dec, cp);
+	}
+
+	if ((err = flush_surrogate(dec)) != 0) {
+		return err;
+	}
+
+	if (u >= 0xd800 && u <= 0xdbff) {
+		dec->surrogate = u;
+		return 0;
+	} else if (u == 0) {
+		return -EBADMSG;
+	}
+
+	return put_codepoint(dec, u);
+}
+
+static int put_run(struct ocpp_json_decoder *dec, const uint8_t *s, size_t n)
+{
+	int err;
+
+	if ((err = flush_surrogate(dec)) != 0) {
+		return err;
+	}
+
+	switch (dec->sink) {
+	case SINK_SCRATCH: {
+		const size_t room = sizeof(dec->scratch) - dec->scratch_len;
+		if (n > room) {
+			dec->overflow = true;
+			n = room;
+		}
+		memcpy(&dec->scratch[dec->scratch_len], s, n);
+		dec->scratch_len = (uint8_t)(dec->scratch_len + n);
+		break;
+	}
+	case SINK_FIXED: /* fall through */
+	case SINK_GROWING:
+		if (n > dec->str_cap - dec->str_len) {
+			return dec->sink == SINK_FIXED? -ERANGE : -ENOBUFS;
+		}
+		memcpy(&dec->str[dec->str_len], s, n);
+		dec->str_len += n;
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+/* Decides where the string value about to be read goes. */
+static int begin_string(struct ocpp_json_decoder *dec)
+{
+	struct ocpp_json_frame *frame = top(dec);
+	const struct ocpp_field *field = frame->field;
+	struct ocpp_message *msg = dec->msg;
+
+	if (dec->skip) {
+		set_sink(dec, SINK_NONE, NULL, 0);
+		return 0;
+	}
+
+	if (frame->kind == FRAME_ROOT) {
+		if (frame->count == ROOT_ID) {
+			set_sink(dec, SINK_FIXED, msg->id, sizeof(msg->id) - 1);
+		} else if (frame->count == ROOT_ACTION &&
+				msg->role != OCPP_MSG_ROLE_CALLRESULT) {
+			set_sink(dec, SINK_SCRATCH, NULL, 0);
+		} else if (frame->count == ROOT_ERROR_DESCRIPTION &&
+				msg->role == OCPP_MSG_ROLE_CALLERROR) {
+			struct ocpp_CallError *err =
+				(struct ocpp_CallError *)dec->payload;
+			set_sink(dec, SINK_FIXED, err->description,
+					sizeof(err->description) - 1);
+		} else {
+			return -EBADMSG;
+		}
+		return 0;
+	}
+
+	if (field == NULL) {
+		set_sink(dec, SINK_NONE, NULL, 0);
+		return 0;
+	}
+
+	const size_t pos = frame->base + field->offset;
+
+	if (frame->kind == FRAME_ARRAY) {
+		if (field->type != OCPP_FIELD_STRING_LIST &&
+				field->type != OCPP_FIELD_STRING_LIST_PTR) {
+			return -EBADMSG;
+		}
+		return set_sink_growing(dec, frame->cursor);
+	}
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING:
+		set_sink(dec, SINK_FIXED, &dec->payload[pos],
+				(size_t)field->size - 1);
+		break;
+	case OCPP_FIELD_TEXT:
+		return set_sink_growing(dec, pos);
+	case OCPP_FIELD_STRING_PTR:
+		set_ptr(&dec->payload[pos], &dec->payload[dec->used]);
+		return set_sink_growing(dec, dec->used);
+	case OCPP_FIELD_ENUM: /* fall through */
+	case OCPP_FIELD_FLAG: /* fall through */
+	case OCPP_FIELD_TIME:
+		set_sink(dec, SINK_SCRATCH, NULL, 0);
+		break;
+	default:
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+static int end_root_string(struct ocpp_json_decoder *dec)
+{
+	struct ocpp_json_frame *frame = top(dec);
+	struct ocpp_message *msg = dec->msg;
+
+	if (frame->count == ROOT_ID) {
+		if (msg->role == OCPP_MSG_ROLE_CALL) {
+			return 0;
+		}
+		if ((msg->type = ocpp_get_type_from_idstr(msg->id))
+				== OCPP_MSG_MAX) {
+			return -ENOENT;
+		}
+		return start_payload(dec);
+	} else if (frame->count == ROOT_ACTION &&
+			msg->role == OCPP_MSG_ROLE_CALL) {
+		msg->type = dec->overflow? OCPP_MSG_MAX :
+			ocpp_get_type_from_strn(dec->scratch, dec->scratch_len);
+		if (msg->type == OCPP_MSG_MAX) {
+			return -ENOTSUP;
+		}
+		return start_payload(dec);
+	} else if (frame->count == ROOT_ERROR_CODE) {
+		struct ocpp_CallError *err =
+			(struct ocpp_CallError *)dec->payload;
+		err->code = dec->overflow? OCPP_CALL_ERROR_GENERIC :
+			ocpp_get_call_error_from_string(dec->scratch,
+					dec->scratch_len);
+	}
+
+	return 0;
+}
+
+static int end_string(struct ocpp_json_decoder *dec)
+{
+	struct ocpp_json_frame *frame = top(dec);
+	const struct ocpp_field *field = frame->field;
+	int err;
+
+	if ((err = flush_surrogate(dec)) != 0) {
+		return err;
+	}
+
+	if (dec->key) {
+		dec->key = false;
+		if (!dec->skip) {
+			frame->field = dec->overflow? NULL : find_field(
+					frame->schema, dec->scratch,
+					dec->scratch_len);
+		}
+		dec->state = S_COLON;
+		return 0;
+	}
+
+	dec->state = S_AFTER;
+
+	if (dec->sink == SINK_FIXED || dec->sink == SINK_GROWING) {
+		dec->str[dec->str_len] = '\0';
+	}
+	if (dec->sink == SINK_GROWING) {
+		const size_t end = (size_t)((uint8_t *)&dec->str[dec->str_len]
+				- dec->payload) + 1;
+		if (end > dec->used) {
+			dec->used = end;
+		}
+		if (frame->kind == FRAME_ARRAY) {
+			frame->cursor = end;
+		}
+	}
+
+	if (frame->kind == FRAME_ROOT) {
+		return dec->skip? 0 : end_root_string(dec);
+	} else if (dec->skip || field == NULL) {
+		return 0;
+	}
+
+	if (dec->sink != SINK_SCRATCH) {
+		return 0;
+	}
+
+	void *p = &dec->payload[frame->base + field->offset];
+
+	if (field->type == OCPP_FIELD_TIME) {
+		return dec->overflow? -EBADMSG :
+			ocpp_parse_iso8601(dec->scratch, dec->scratch_len,
+					(time_t *)p);
+	}
+
+	return dec->overflow? -EBADMSG :
+		set_enum(field, p, dec->scratch, dec->scratch_len);
+}
+
+static int end_number(struct ocpp_json_decoder *dec)
+{
+	struct ocpp_json_frame *frame = top(dec);
+	const struct ocpp_field *field = frame->field;
+	int64_t v;
+	int err;
+
+	dec->state = S_AFTER;
+
+	if (dec->overflow) {
+		return -ERANGE;
+	}
+	if ((err = ocpp_parse_decimal(dec->scratch, dec->scratch_len,
+			field && field->type == OCPP_FIELD_DECIMAL?
+			field->aux : 0, &v)) != 0) {
+		return err;
+	}
+
+	if (dec->skip) {
+		return 0;
+	}
+
+	if (frame->kind == FRAME_ROOT) {
+		if (frame->count != ROOT_TYPE || v < 2 || v > 4) {
+			return -EBADMSG;
+		}
+		/* the roles are numbered as on the wire */
+		dec->msg->role = (ocpp_message_role_t)v;
+		return 0;
+	}
+
+	if (field == NULL) {
+		return 0;
+	}
+
+	void *p = &dec->payload[frame->base + field->offset];
+
+	switch (frame->kind == FRAME_OBJECT? field->type : OCPP_FIELD_ARRAY) {
+	case OCPP_FIELD_INT: /* fall through */
+	case OCPP_FIELD_DECIMAL:
+		return set_int(p, field->size, v, true);
+	case OCPP_FIELD_UINT:
+		return set_int(p, field->size, v, false);
+	default:
+		return -EBADMSG;
+	}
+}
+
+static int end_literal(struct ocpp_json_decoder *dec)
+{
+	struct ocpp_json_frame *frame = top(dec);
+	const struct ocpp_field *field = frame->field;
+	const char *s = dec->scratch;
+	const size_t len = dec->scratch_len;
+	int v;
+
+	dec->state = S_AFTER;
+
+	if (len == 4 && memcmp(s, "true", 4) == 0) {
+		v = 1;
+	} else if (len == 5 && memcmp(s, "false", 5) == 0) {
+		v = 0;
+	} else if (len == 4 && memcmp(s, "null", 4) == 0) {
+		v = -1;
+	} else {
+		return -EBADMSG;
+	}
+
+	if (dec->skip || (frame->kind != FRAME_ROOT && field == NULL)) {
+		return 0;
+	}
+	if (v < 0 && frame->kind == FRAME_OBJECT) {
+		return 0; /* absent */
+	}
+	if (v < 0 || frame->kind != FRAME_OBJECT ||
+			field->type != OCPP_FIELD_BOOL) {
+		return -EBADMSG;
+	}
+
+	return set_int(&dec->payload[frame->base + field->offset],
+			field->size, v, true);
+}
+
+static int open_list(struct ocpp_json_decoder *dec,
+		const struct ocpp_field *field, size_t base)
+{
+	const struct ocpp_schema *sub = (const struct ocpp_schema *)field->ref;
+	const size_t pos = base + field->offset;
+	size_t cursor = pos;
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING_LIST:
+		break;
+	case OCPP_FIELD_STRING_LIST_PTR:
+		cursor = dec->used;
+		set_ptr(&dec->payload[pos], &dec->payload[cursor]);
+		break;
+	case OCPP_FIELD_OBJECT_LIST_PTR:
+		cursor = align_up(dec->used, sub->align);
+		if (cursor > dec->bufsize) {
+			return -ENOBUFS;
+		}
+		set_ptr(&dec->payload[pos], &dec->payload[cursor]);
+		break;
+	case OCPP_FIELD_ARRAY:
+		break;
+	case OCPP_FIELD_RECORD:
+		if (!(field->flags & OCPP_FIELD_LIST)) {
+			return -EBADMSG;
+		}
+		cursor = base + align_up(field->offset, sub->align);
+		break;
+	case OCPP_FIELD_OBJECT:
+		if (!(field->flags & OCPP_FIELD_LIST)) {
+			return -EBADMSG;
+		}
+		break;
+	default:
+		return -EBADMSG;
+	}
+
+	return push(dec, FRAME_ARRAY, NULL, field, base, cursor);
+}
+
+static int close_list(struct ocpp_json_decoder *dec,
+		const struct ocpp_json_frame *frame)
+{
+	const struct ocpp_field *field = frame->field;
+	const struct ocpp_schema *sub = (const struct ocpp_schema *)field->ref;
+	int err = 0;
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING_LIST:
+		/* the payload end ends the list as well */
+		if (frame->cursor < dec->bufsize) {
+			err = claim(dec, frame->cursor, 1);
+		}
+		break;
+	case OCPP_FIELD_STRING_LIST_PTR:
+		err = claim(dec, frame->cursor, 1);
+		break;
+	case OCPP_FIELD_OBJECT_LIST_PTR:
+		err = claim(dec, frame->cursor, sub->size);
+		break;
+	default:
+		break;
+	}
+
+	return err;
+}
+
+/* Places the next element of the list being read. */
+static int open_element(struct ocpp_json_decoder *dec,
+		struct ocpp_json_frame *frame)
+{
+	const struct ocpp_field *field = frame->field;
+	const struct ocpp_schema *sub = (const struct ocpp_schema *)field->ref;
+	const size_t pos = frame->cursor;
+	int err;
+
+	switch (field->type) {
+	case OCPP_FIELD_OBJECT:
+		if (frame->count) {
+			return -ENOBUFS; /* the struct holds only one */
+		}
+		break;
+	case OCPP_FIELD_OBJECT_LIST_PTR: /* fall through */
+	case OCPP_FIELD_RECORD:
+		if ((err = claim(dec, pos, sub->size)) != 0) {
+			return err;
+		}
+		frame->cursor += sub->size;
+		break;
+	case OCPP_FIELD_ARRAY:
+		if ((err = claim(dec, pos, sub->size)) != 0) {
+			return err;
+		}
+		if ((err = set_int(&dec->payload[frame->base + field->aux],
+				field->size, frame->count + 1, false)) != 0) {
+			return err;
+		}
+		frame->cursor += sub->size;
+		break;
+	default:
+		return -EBADMSG;
+	}
+
+	frame->count++;
+
+	return push(dec, FRAME_OBJECT, sub, NULL, pos, 0);
+}
+
+static int open_root(struct ocpp_json_decoder *dec, bool object)
+{
+	struct ocpp_json_frame *frame = top(dec);
+	const ocpp_message_role_t role = dec->msg->role;
+
+	if (object && ((role == OCPP_MSG_ROLE_CALL &&
+				frame->count == ROOT_CALL_PAYLOAD) ||
+			(role == OCPP_MSG_ROLE_CALLRESULT &&
+				frame->count == ROOT_RESULT_PAYLOAD))) {
+		return push(dec, FRAME_OBJECT, frame->schema, NULL, 0, 0);
+	}
+
+	if (role == OCPP_MSG_ROLE_CALLERROR &&
+			frame->count == ROOT_ERROR_DETAILS) {
+		dec->skip = 1;
+		return 0;
+	}
+
+	return -EBADMSG;
+}
+
+static int open_container(struct ocpp_json_decoder *dec, bool object)
+{
+	if (dec->nest >= MAX_NEST) {
+		return -EBADMSG;
+	}
+
+	if (object) {
+		dec->objects |= (uint64_t)1 << dec->nest;
+	} else {
+		dec->objects &= ~((uint64_t)1 << dec->nest);
+	}
+
+	dec->nest++;
+	dec->first = true;
+	dec->state = object? S_MEMBER : S_VALUE;
+
+	if (dec->depth == 0) {
+		return object? -EBADMSG :
+			push(dec, FRAME_ROOT, NULL, NULL, 0, 0);
+	}
+
+	if (dec->skip) {
+		dec->skip++;
+		return 0;
+	}
+
+	struct ocpp_json_frame *frame = top(dec);
+	const struct ocpp_field *field = frame->field;
+
+	if (frame->kind == FRAME_ROOT) {
+		return open_root(dec, object);
+	} else if (field == NULL) {
+		dec->skip = 1;
+		return 0;
+	} else if (frame->kind == FRAME_ARRAY) {
+		return object? open_element(dec, frame) : -EBADMSG;
+	} else if (!object) {
+		return open_list(dec, field, frame->base);
+	}
+
+	const struct ocpp_schema *sub = (const struct ocpp_schema *)field->ref;
+	size_t pos = frame->base + field->offset;
+	int err;
+
+	switch (field->type) {
+	case OCPP_FIELD_OBJECT:
+		if (field->flags & OCPP_FIELD_LIST) {
+			return -EBADMSG;
+		}
+		break;
+	case OCPP_FIELD_RECORD:
+		if (field->flags & OCPP_FIELD_LIST) {
+			return -EBADMSG;
+		}
+		pos = frame->base + align_up(field->offset, sub->align);
+		if ((err = claim(dec, pos, sub->size)) != 0) {
+			return err;
+		}
+		break;
+	default:
+		return -EBADMSG;
+	}
+
+	return push(dec, FRAME_OBJECT, sub, NULL, pos, 0);
+}
+
+static int close_container(struct ocpp_json_decoder *dec, bool object)
+{
+	const bool is_object = (dec->objects >> (dec->nest - 1)) & 1;
+	int err = 0;
+
+	if (is_object != object) {
+		return -EBADMSG;
+	}
+
+	dec->nest--;
+	dec->state = S_AFTER;
+
+	if (dec->skip) {
+		dec->skip--;
+		goto out;
+	}
+
+	const struct ocpp_json_frame frame = dec->stack[--dec->depth];
+
+	if (frame.kind == FRAME_ROOT) {
+		if (frame.count != get_nr_root_values(dec->msg->role)) {
+			return -EBADMSG;
+		}
+		dec->msg->payload.size = dec->used;
+		dec->state = S_DONE;
+		if (dec->msg->role == OCPP_MSG_ROLE_CALLERROR) {
+			return 0;
+		}
+		return ocpp_validate(dec->msg->type,
+				dec->msg->role == OCPP_MSG_ROLE_CALLRESULT,
+				dec->payload, dec->used);
+	} else if (frame.kind == FRAME_ARRAY) {
+		err = close_list(dec, &frame);
+	} else if (top(dec)->kind == FRAME_ARRAY &&
+			top(dec)->field->type == OCPP_FIELD_RECORD) {
+		/* the next record starts past the padding of this one */
+		struct ocpp_json_frame *list = top(dec);
+		list->cursor = align_up(dec->used, frame.schema->align);
+		if (list->cursor <= dec->bufsize) {
+			dec->used = list->cursor;
+		}
+	}
+
+out:
+	if (dec->depth && top(dec)->kind == FRAME_ROOT && !dec->skip) {
+		top(dec)->count++;
+	}
+
+	return err;
+}
+
+static int begin_value(struct ocpp_json_decoder *dec, uint8_t c)
+{
+	struct ocpp_json_frame *frame = top(dec);
+
+	if (!dec->skip && frame->kind == FRAME_ROOT &&
+			frame->count >= get_nr_root_values(dec->msg->role) &&
+			frame->count != ROOT_TYPE) {
+		return -EBADMSG;
+	}
+
+	if (c == '"') {
+		dec->state = S_STRING;
+		return begin_string(dec);
+	}
+
+	set_sink(dec, SINK_SCRATCH, NULL, 0);
+	dec->state = (c == '-' || is_digit(c))? S_NUMBER : S_LITERAL;
+
+	return put_byte(dec, c);
+}
+
+static int end_value(struct ocpp_json_decoder *dec, int err)
+{
+	if (err == 0 && !dec->skip && top(dec)->kind == FRAME_ROOT) {
+		top(dec)->count++;
+	}
+
+	return err;
+}
+
+static int step_value(struct ocpp_json_decoder *dec, uint8_t c)
+{
+	if (dec->nest == 0) {
+		return c == '['? open_container(dec, false) : -EBADMSG;
+	}
+
+	switch (c) {
+	case '{':
+		return open_container(dec, true);
+	case '[':
+		return open_container(dec, false);
+	case ']':
+		return dec->first? close_container(dec, false) : -EBADMSG;
+	default:
+		break;
+	}
+
+	if (c == '"' || c == '-' || is_digit(c) || (c >= 'a' && c <= 'z')) {
+		dec->first = false;
+
+		if (dec->depth && top(dec)->kind == FRAME_ARRAY &&
+				!dec->skip && c != '"') {
+			return -EBADMSG;
+		}
+
+		return begin_value(dec, c);
+	}
+
+	return -EBADMSG;
+}
+
+static int step(struct ocpp_json_decoder *dec, uint8_t c)
+{
+	const bool ws = is_ws(c);
+	int err = 0;
+
+	switch (dec->state) {
+	case S_VALUE:
+		return ws? 0 : step_value(dec, c);
+	case S_MEMBER:
+		if (ws) {
+			return 0;
+		} else if (c == '}' && dec->first) {
+			return close_container(dec, true);
+		} else if (c != '"') {
+			return -EBADMSG;
+		}
+		dec->first = false;
+		dec->key = true;
+		dec->state = S_STRING;
+		set_sink(dec, SINK_SCRATCH, NULL, 0);
+		return 0;
+	case S_COLON:
+		if (ws) {
+			return 0;
+		} else if (c != ':') {
+			return -EBADMSG;
+		}
+		dec->state = S_VALUE;
+		dec->first = false;
+		return 0;
+	case S_AFTER:
+		if (ws) {
+			return 0;
+		} else if (c == ',') {
+			dec->first = false;
+			dec->state = ((dec->objects >> (dec->nest - 1)) & 1)?
+				S_MEMBER : S_VALUE;
+			return 0;
+		} else if (c == '}' || c == ']') {
+			return close_container(dec, c == '}');
+		}
+		return -EBADMSG;
+	case S_STRING:
+		if (c == '"') {
+			const bool key = dec->key;
+			err = end_string(dec);
+			return key? err : end_value(dec, err);
+		} else if (c == '\\') {
+			dec->state = S_ESCAPE;
+			return 0;
+		} else if (c < 0x20) {
+			return -EBADMSG;
+		}
+		if ((err = flush_surrogate(dec)) != 0) {
+			return err;
+		}
+		return put_byte(dec, c);
+	case S_ESCAPE:
+		dec->state = S_STRING;
+		if (c == 'u') {
+			dec->state = S_UNICODE;
+			dec->hex = 0;
+			dec->hex_count = 0;
+			return 0;
+		}
+		if ((err = flush_surrogate(dec)) != 0) {
+			return err;
+		}
+		switch (c) {
+		case '"': /* fall through */
+		case '\\': /* fall through */
+		case '/': return put_byte(dec, c);
+		case 'b': return put_byte(dec, '\b');
+		case 'f': return put_byte(dec, '\f');
+		case 'n': return put_byte(dec, '\n');
+		case 'r': return put_byte(dec, '\r');
+		case 't': return put_byte(dec, '\t');
+		default: return -EBADMSG;
+		}
+	case S_UNICODE: {
+		uint16_t nibble;
+		if (is_digit(c)) {
+			nibble = (uint16_t)(c - '0');
+		} else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+			nibble = (uint16_t)((c | 0x20) - 'a' + 10);
+		} else {
+			return -EBADMSG;
+		}
+		dec->hex = (uint16_t)((dec->hex << 4) | nibble);
+		if (++dec->hex_count == 4) {
+			dec->state = S_STRING;
+			return put_utf16(dec, dec->hex);
+		}
+		return 0;
+	}
+	case S_NUMBER:
+		if (is_digit(c) || c == '.' || c == '-' || c == '+' ||
+				c == 'e' || c == 'E') {
+			return put_byte(dec, c);
+		}
+		err = end_value(dec, end_number(dec));
+		return err? err : REPROCESS;
+	case S_LITERAL:
+		if (c >= 'a' && c <= 'z') {
+			return put_byte(dec, c);
+		}
+		err = end_value(dec, end_literal(dec));
+		return err? err : REPROCESS;
+	case S_DONE:
+		return ws? 0 : -EBADMSG;
+	default:
+		return -EBADMSG;
+	}
+}
+
+static unsigned int count_trailing_zeros(uint64_t x)
+{
+#if defined(__GNUC__)
+	return (unsigned int)__builtin_ctzll(x);
+#else
+	unsigned int n = 0;
+	while (!(x & 1)) {
+		x >>= 1;
+		n++;
+	}
+	return n;
+#endif
+}
+
+/* Length of the run from pos up to the first byte set in stop. */
+static size_t get_run(uint64_t stop, size_t pos, size_t n)
+{
+	stop >>= pos;
+
+	const size_t run = stop? count_trailing_zeros(stop) :
+		OCPP_JSON_SCAN_BLOCK_SIZE - pos;
+
+	return run < n - pos? run : n - pos;
+}
+
+static bool is_between_tokens(uint8_t state)
+{
+	return state == S_VALUE || state == S_MEMBER || state == S_COLON ||
+		state == S_AFTER || state == S_DONE;
+}
+
+/* String bodies and whitespace are passed over in runs found by the scan of
+ * the block, leaving only the rest to the state machine. */
+static void feed_block(struct ocpp_json_decoder *dec,
+		const uint8_t *block, size_t n)
+{
+	struct ocpp_json_scan_mask mask;
+	size_t pos = 0;
+
+	if (n == OCPP_JSON_SCAN_BLOCK_SIZE) {
+		ocpp_json_scan(block, &mask);
+	} else {
+		uint8_t tmp[OCPP_JSON_SCAN_BLOCK_SIZE] = { 0, };
+		memcpy(tmp, block, n);
+		ocpp_json_scan(tmp, &mask);
+	}
+
+	while (pos < n && dec->err == 0) {
+		size_t run = 0;
+		int rc;
+
+		if (dec->state == S_STRING) {
+			run = get_run(mask.quote | mask.backslash |
+					mask.control, pos, n);
+			if (run) {
+				dec->err = put_run(dec, &block[pos], run);
+			}
+		} else if (is_between_tokens(dec->state)) {
+			run = get_run(~mask.space, pos, n);
+		}
+
+		if (run) {
+			pos += run;
+			continue;
+		}
+
+		while ((rc = step(dec, block[pos])) == REPROCESS) {
+			/* the value ended at block[pos], which belongs to
+			 * the next */
+		}
+
+		dec->err = rc;
+		pos++;
+	}
+}
+
+int ocpp_json_decoder_feed(struct ocpp_json_decoder *dec,
+		const void *data, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)data;
+
+	for (size_t i = 0; i < len && dec->err == 0;
+			i += OCPP_JSON_SCAN_BLOCK_SIZE) {
+		const size_t n = len - i < OCPP_JSON_SCAN_BLOCK_SIZE?
+			len - i : OCPP_JSON_SCAN_BLOCK_SIZE;
+		feed_block(dec, &p[i], n);
+	}
+
+	if (dec->err) {
+		return dec->err;
+	}
+
+	return dec->state == S_DONE? 0 : -EAGAIN;
+}
+
+void ocpp_json_decoder_init(struct ocpp_json_decoder *dec,
+		struct ocpp_message *msg, void *payload, size_t bufsize)
+{
+	memset(dec, 0, sizeof(*dec));
+	memset(msg, 0, sizeof(*msg));
+
+	dec->msg = msg;
+	dec->payload = (uint8_t *)payload;
+	dec->bufsize = bufsize;
+	dec->state = S_VALUE;
+}
+
+int ocpp_decode_json(struct ocpp_message *msg, void *payload, size_t bufsize,
+		const void *data, size_t len)
+{
+	struct ocpp_json_decoder dec;
+
+	ocpp_json_decoder_init(&dec, msg, payload, bufsize);
+
+	const int err = ocpp_json_decoder_feed(&dec, data, len);
+
+	return err == -EAGAIN? -EBADMSG : err;
+}
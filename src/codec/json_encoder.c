@@ -0,0 +1,775 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/json.h"
+#include "ocpp/codec/codec.h"
+#include "ocpp/codec/decimal.h"
+#include "ocpp/codec/iso8601.h"
+#include "ocpp/codec/schema.h"
+#include "ocpp/strconv.h"
+
+#include <errno.h>
+#include <string.h>
+
+/* Writes the cap bytes of the frame from skip and keeps counting past them,
+ * so that the size of the whole frame is known even when it does not fit.
+ * With a cursor, it resumes at the point given and stops past the cap bytes
+ * instead, leaving the cursor at the last point within them. */
+struct writer {
+	char *buf;
+	size_t cap;
+	size_t skip;
+	size_t len;
+	struct ocpp_iso8601_cache date;
+
+	struct ocpp_encoder_cursor *cursor;
+	struct ocpp_encoder_cursor from;
+	bool resuming;
+	uint8_t depth;
+	uint32_t path[OCPP_ENCODER_MAX_DEPTH];
+};
+
+static void put(struct writer *w, const void *data, size_t n)
+{
+	const size_t end = w->skip + w->cap;
+
+	if (w->len < end && w->len + n > w->skip) {
+		const size_t from = w->len < w->skip? w->skip - w->len : 0;
+		const size_t to = w->len + n < end? n : end - w->len;
+
+		memcpy(&w->buf[w->len + from - w->skip],
+				(const uint8_t *)data + from, to - from);
+	}
+
+	w->len += n;
+}
+
+/* Goes down a level, into the elements of an object or a list. */
+static void enter(struct writer *w)
+{
+	w->depth++;
+}
+
+static void leave(struct writer *w)
+{
+	w->depth--;
+}
+
+/* Comes to the element at index on the current level. Returns 1 to skip it
+ * as it is before the point resumed from, 0 to encode it, or -ENOBUFS to
+ * stop as the piece is full. */
+static int begin(struct writer *w, uint32_t index)
+{
+	if (w->cursor == NULL || w->depth > OCPP_ENCODER_MAX_DEPTH) {
+		return 0;
+	}
+
+	const uint8_t level = (uint8_t)(w->depth - 1);
+
+	w->path[level] = index;
+
+	if (w->resuming) {
+		if (index < w->from.path[level]) {
+			return 1;
+		}
+		if (level + 1 < w->from.depth) {
+			return 0; /* on the way down to the point */
+		}
+		/* what was put on the way is left behind the piece */
+		w->resuming = false;
+		w->len = w->from.offset;
+	}
+
+	if (w->len > w->skip + w->cap) {
+		return -ENOBUFS;
+	}
+
+	memcpy(w->cursor->path, w->path, (level + 1u) * sizeof(*w->path));
+	w->cursor->depth = (uint8_t)(level + 1);
+	w->cursor->offset = w->len;
+
+	return 0;
+}
+
+static void put_char(struct writer *w, char c)
+{
+	put(w, &c, 1);
+}
+
+static void put_literal(struct writer *w, const char *str)
+{
+	put(w, str, strlen(str));
+}
+
+static void put_uint(struct writer *w, uint64_t v)
+{
+	char tmp[20];
+	size_t i = sizeof(tmp);
+
+	do {
+		tmp[--i] = (char)('0' + v % 10);
+		v /= 10;
+	} while (v);
+
+	put(w, &tmp[i], sizeof(tmp) - i);
+}
+
+static void put_int(struct writer *w, int64_t v)
+{
+	if (v < 0) {
+		put_char(w, '-');
+		put_uint(w, (uint64_t)0 - (uint64_t)v);
+	} else {
+		put_uint(w, (uint64_t)v);
+	}
+}
+
+static int put_decimal(struct writer *w, int64_t v, unsigned int scale)
+{
+	char tmp[OCPP_DECIMAL_MAXLEN + 1];
+	const int len = ocpp_format_decimal(tmp, v, scale);
+
+	if (len < 0) {
+		return len;
+	}
+
+	put(w, tmp, (size_t)len);
+
+	return 0;
+}
+
+static void put_time(struct writer *w, time_t t)
+{
+	char tmp[OCPP_ISO8601_LEN];
+
+	put_char(w, '"');
+	put(w, tmp, ocpp_format_iso8601(tmp, t, &w->date));
+	put_char(w, '"');
+}
+
+/* Escapes up to maxlen bytes of str, stopping early at a null. */
+static void put_string(struct writer *w, const char *str, size_t maxlen)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t start = 0;
+	size_t i;
+
+	put_char(w, '"');
+
+	for (i = 0; i < maxlen && str[i]; i++) {
+		const unsigned char c = (unsigned char)str[i];
+
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		put(w, &str[start], i - start);
+		start = i + 1;
+
+		switch (c) {
+		case '"':  put_literal(w, "\\\""); break;
+		case '\\': put_literal(w, "\\\\"); break;
+		case '\b': put_literal(w, "\\b"); break;
+		case '\f': put_literal(w, "\\f"); break;
+		case '\n': put_literal(w, "\\n"); break;
+		case '\r': put_literal(w, "\\r"); break;
+		case '\t': put_literal(w, "\\t"); break;
+		default:
+			put_literal(w, "\\u00");
+			put_char(w, hex[c >> 4]);
+			put_char(w, hex[c & 0xf]);
+			break;
+		}
+	}
+
+	put(w, &str[start], i - start);
+	put_char(w, '"');
+}
+
+/* Encodes null-terminated strings up to an empty one or maxlen bytes. */
+static int put_string_list(struct writer *w, const char *list, size_t maxlen)
+{
+	size_t i = 0;
+
+	put_char(w, '[');
+	enter(w);
+
+	for (uint32_t k = 0; i < maxlen && list[i]; k++) {
+		size_t n = 0;
+		int rc;
+
+		while (i + n < maxlen && list[i + n]) {
+			n++;
+		}
+
+		if ((rc = begin(w, k)) < 0) {
+			return rc;
+		} else if (rc == 0) {
+			if (i) {
+				put_char(w, ',');
+			}
+			put_string(w, &list[i], n);
+		}
+
+		i += n + 1;
+	}
+
+	leave(w);
+	put_char(w, ']');
+
+	return 0;
+}
+
+static int64_t get_int(const void *p, size_t size)
+{
+	switch (size) {
+	case sizeof(int8_t):
+		return *(const int8_t *)p;
+	case sizeof(int16_t):
+		return *(const int16_t *)p;
+	case sizeof(int32_t):
+		return *(const int32_t *)p;
+	case sizeof(int64_t):
+		return *(const int64_t *)p;
+	default:
+		return 0;
+	}
+}
+
+static uint64_t get_uint(const void *p, size_t size)
+{
+	switch (size) {
+	case sizeof(uint8_t):
+		return *(const uint8_t *)p;
+	case sizeof(uint16_t):
+		return *(const uint16_t *)p;
+	case sizeof(uint32_t):
+		return *(const uint32_t *)p;
+	case sizeof(uint64_t):
+		return *(const uint64_t *)p;
+	default:
+		return 0;
+	}
+}
+
+static const char *get_ptr(const void *p)
+{
+	const char *ptr;
+	memcpy(&ptr, p, sizeof(ptr));
+	return ptr;
+}
+
+static bool is_zero(const uint8_t *p, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (p[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static size_t align_up(size_t x, size_t align)
+{
+	return (x + align - 1) / align * align;
+}
+
+static const char *get_enum_name(const struct ocpp_field *field,
+		const uint8_t *p)
+{
+	const char * const *names = (const char * const *)field->ref;
+	const int64_t v = get_int(p, field->size);
+
+	if (field->type == OCPP_FIELD_FLAG) {
+		const uint64_t u = (uint64_t)v;
+
+		if (u == 0 || (u & (u - 1)) != 0) {
+			return NULL;
+		}
+
+		unsigned int bit = 0;
+		while (!(u & ((uint64_t)1 << bit))) {
+			bit++;
+		}
+
+		return bit < field->aux? names[bit] : NULL;
+	}
+
+	if (v < 0 || v >= field->aux) {
+		return NULL;
+	}
+
+	return names[v];
+}
+
+static bool is_present(const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const uint8_t *p = &base[field->offset];
+
+	if (field->flags & OCPP_FIELD_REQUIRED) {
+		return true;
+	}
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING:
+		return p[0] != '\0';
+	case OCPP_FIELD_STRING_PTR: /* fall through */
+	case OCPP_FIELD_STRING_LIST_PTR: {
+		const char *str = get_ptr(p);
+		return str && str[0];
+	}
+	case OCPP_FIELD_TEXT: /* fall through */
+	case OCPP_FIELD_STRING_LIST:
+		return field->offset < avail && p[0] != '\0';
+	case OCPP_FIELD_INT: /* fall through */
+	case OCPP_FIELD_DECIMAL: /* fall through */
+	case OCPP_FIELD_BOOL:
+		return get_int(p, field->size) != 0;
+	case OCPP_FIELD_UINT:
+		return get_uint(p, field->size) != 0;
+	case OCPP_FIELD_TIME:
+		return *(const time_t *)p != 0;
+	case OCPP_FIELD_ENUM: /* fall through */
+	case OCPP_FIELD_FLAG:
+		return get_enum_name(field, p) != NULL;
+	case OCPP_FIELD_OBJECT:
+		return !is_zero(p, field->size);
+	case OCPP_FIELD_OBJECT_LIST_PTR:
+		return get_ptr(p) != NULL;
+	case OCPP_FIELD_ARRAY:
+		return get_uint(&base[field->aux], field->size) != 0;
+	case OCPP_FIELD_RECORD: {
+		const struct ocpp_schema *sub =
+			(const struct ocpp_schema *)field->ref;
+		return align_up(field->offset, sub->align) < avail;
+	}
+	default:
+		return false;
+	}
+}
+
+static int encode_object(struct writer *w, const struct ocpp_schema *schema,
+		const uint8_t *base, size_t avail);
+
+static int encode_records(struct writer *w, const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const struct ocpp_schema *sub = (const struct ocpp_schema *)field->ref;
+	const bool list = (field->flags & OCPP_FIELD_LIST) != 0;
+	size_t pos = align_up(field->offset, sub->align);
+	int err = 0;
+
+	if (list) {
+		put_char(w, '[');
+		enter(w);
+	}
+
+	for (uint32_t k = 0; pos < avail && err == 0; k++) {
+		const size_t size =
+			ocpp_get_record_size(sub, &base[pos], avail - pos);
+		int rc = 0;
+
+		if (size == 0) {
+			return -EINVAL;
+		}
+
+		if (list && (rc = begin(w, k)) < 0) {
+			return rc;
+		} else if (rc == 0) {
+			if (k) {
+				put_char(w, ',');
+			}
+			err = encode_object(w, sub, &base[pos], size);
+		}
+
+		pos += size;
+
+		if (!list) {
+			break;
+		}
+	}
+
+	if (list) {
+		leave(w);
+		put_char(w, ']');
+	} else if (pos == align_up(field->offset, sub->align)) {
+		return -EINVAL; /* required but missing */
+	}
+
+	return err;
+}
+
+static int encode_array(struct writer *w, const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const struct ocpp_schema *elem = (const struct ocpp_schema *)field->ref;
+	const uint64_t n = get_uint(&base[field->aux], field->size);
+	int err = 0;
+
+	if (n > (avail - field->offset) / elem->size) {
+		return -EINVAL;
+	}
+
+	put_char(w, '[');
+	enter(w);
+
+	for (size_t i = 0; i < (size_t)n && err == 0; i++) {
+		const int rc = begin(w, (uint32_t)i);
+
+		if (rc < 0) {
+			return rc;
+		} else if (rc > 0) {
+			continue;
+		}
+
+		if (i) {
+			put_char(w, ',');
+		}
+		err = encode_object(w, elem,
+				&base[field->offset + i * elem->size],
+				elem->size);
+	}
+
+	leave(w);
+	put_char(w, ']');
+
+	return err;
+}
+
+static int encode_object_list(struct writer *w,
+		const struct ocpp_field *field, const uint8_t *p)
+{
+	const struct ocpp_schema *elem = (const struct ocpp_schema *)field->ref;
+	const uint8_t *list = (const uint8_t *)get_ptr(p);
+	int err = 0;
+
+	put_char(w, '[');
+	enter(w);
+
+	/* ended by an element whose first field is empty */
+	for (size_t i = 0; list && err == 0; i++) {
+		const uint8_t *e = &list[i * elem->size];
+		int rc;
+
+		if (e[elem->fields[0].offset] == 0) {
+			break;
+		}
+		if ((rc = begin(w, (uint32_t)i)) < 0) {
+			return rc;
+		} else if (rc > 0) {
+			continue;
+		}
+		if (i) {
+			put_char(w, ',');
+		}
+
+		err = encode_object(w, elem, e, elem->size);
+	}
+
+	leave(w);
+	put_char(w, ']');
+
+	return err;
+}
+
+static int encode_value(struct writer *w, const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const uint8_t *p = &base[field->offset];
+	const char *str;
+	int err = 0;
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING:
+		put_string(w, (const char *)p, field->size);
+		break;
+	case OCPP_FIELD_STRING_PTR:
+		str = get_ptr(p);
+		put_string(w, str? str : "", SIZE_MAX);
+		break;
+	case OCPP_FIELD_TEXT:
+		put_string(w, (const char *)p,
+				field->offset < avail? avail - field->offset : 0);
+		break;
+	case OCPP_FIELD_STRING_LIST:
+		err = put_string_list(w, (const char *)p,
+				field->offset < avail? avail - field->offset : 0);
+		break;
+	case OCPP_FIELD_STRING_LIST_PTR:
+		str = get_ptr(p);
+		err = put_string_list(w, str? str : "", SIZE_MAX);
+		break;
+	case OCPP_FIELD_INT:
+		put_int(w, get_int(p, field->size));
+		break;
+	case OCPP_FIELD_UINT:
+		put_uint(w, get_uint(p, field->size));
+		break;
+	case OCPP_FIELD_DECIMAL:
+		err = put_decimal(w, get_int(p, field->size), field->aux);
+		break;
+	case OCPP_FIELD_BOOL:
+		put_literal(w, get_int(p, field->size)? "true" : "false");
+		break;
+	case OCPP_FIELD_TIME:
+		put_time(w, *(const time_t *)p);
+		break;
+	case OCPP_FIELD_ENUM: /* fall through */
+	case OCPP_FIELD_FLAG:
+		if ((str = get_enum_name(field, p)) == NULL) {
+			return -EINVAL;
+		}
+		put_string(w, str, SIZE_MAX);
+		break;
+	case OCPP_FIELD_OBJECT:
+		if (field->flags & OCPP_FIELD_LIST) {
+			put_char(w, '[');
+		}
+		err = encode_object(w, (const struct ocpp_schema *)field->ref,
+				p, field->size);
+		if (field->flags & OCPP_FIELD_LIST) {
+			put_char(w, ']');
+		}
+		break;
+	case OCPP_FIELD_OBJECT_LIST_PTR:
+		err = encode_object_list(w, field, p);
+		break;
+	case OCPP_FIELD_ARRAY:
+		err = encode_array(w, field, base, avail);
+		break;
+	case OCPP_FIELD_RECORD:
+		err = encode_records(w, field, base, avail);
+		break;
+	default:
+		err = -EINVAL;
+		break;
+	}
+
+	return err;
+}
+
+static bool is_flexible(const struct ocpp_field *field)
+{
+	return field->type == OCPP_FIELD_TEXT ||
+		field->type == OCPP_FIELD_STRING_LIST ||
+		field->type == OCPP_FIELD_ARRAY ||
+		field->type == OCPP_FIELD_RECORD;
+}
+
+static int encode_object(struct writer *w, const struct ocpp_schema *schema,
+		const uint8_t *base, size_t avail)
+{
+	bool first = true;
+
+	put_char(w, '{');
+	enter(w);
+
+	for (uint16_t i = 0; i < schema->nr_fields; i++) {
+		const struct ocpp_field *field = &schema->fields[i];
+		int rc;
+
+		if (!is_flexible(field) &&
+				(size_t)field->offset + field->size > avail) {
+			return -EINVAL;
+		}
+		if (!is_present(field, base, avail)) {
+			continue;
+		}
+		if ((rc = begin(w, i)) < 0) {
+			return rc;
+		} else if (rc > 0) {
+			first = false;
+			continue;
+		}
+
+		if (!first) {
+			put_char(w, ',');
+		}
+		first = false;
+
+		put_char(w, '"');
+		put_literal(w, field->name);
+		put_literal(w, "\":");
+
+		int err = encode_value(w, field, base, avail);
+		if (err) {
+			return err;
+		}
+	}
+
+	leave(w);
+	put_char(w, '}');
+
+	return 0;
+}
+
+static int encode_payload(struct writer *w, const struct ocpp_message *msg)
+{
+	const struct ocpp_schema *schema = ocpp_get_schema(msg->type,
+			msg->role == OCPP_MSG_ROLE_CALLRESULT);
+	const uint8_t *payload = (const uint8_t *)msg->payload.fmt.request;
+
+	if (schema == NULL) {
+		return -EINVAL;
+	}
+	if (payload == NULL) {
+		if (schema->nr_fields > 0) {
+			return -EINVAL;
+		}
+		put_literal(w, "{}");
+		return 0;
+	}
+
+	return encode_object(w, schema, payload, msg->payload.size);
+}
+
+/* A CALLERROR without a payload answers an action not known, as the engine
+ * does for a CALL the decoder gives up on with -ENOTSUP. */
+static ocpp_call_error_t get_default_error(const struct ocpp_message *msg)
+{
+	if ((unsigned int)msg->type >= OCPP_MSG_MAX) {
+		return OCPP_CALL_ERROR_NOT_IMPLEMENTED;
+	}
+	return OCPP_CALL_ERROR_NOT_SUPPORTED;
+}
+
+static int encode_error(struct writer *w, const struct ocpp_message *msg)
+{
+	const struct ocpp_CallError *err =
+		(const struct ocpp_CallError *)msg->payload.fmt.response;
+
+	if (err && msg->payload.size < sizeof(*err)) {
+		return -EINVAL;
+	}
+
+	put_string(w, ocpp_stringify_call_error(err? err->code :
+				get_default_error(msg)), SIZE_MAX);
+	put_char(w, ',');
+	put_string(w, err? err->description : "", sizeof(err->description));
+	put_literal(w, ",{}");
+
+	return 0;
+}
+
+static int encode_frame(struct writer *w, const struct ocpp_message *msg)
+{
+	int err = 0;
+
+	/* only a CALLERROR goes without a known action */
+	if (msg == NULL || (msg->role != OCPP_MSG_ROLE_CALLERROR &&
+			(unsigned int)msg->type >= OCPP_MSG_MAX)) {
+		return -EINVAL;
+	}
+
+	put_char(w, '[');
+
+	switch (msg->role) {
+	case OCPP_MSG_ROLE_CALL:
+		put_literal(w, "2,");
+		put_string(w, msg->id, sizeof(msg->id));
+		put_char(w, ',');
+		put_string(w, ocpp_stringify_type(msg->type), SIZE_MAX);
+		put_char(w, ',');
+		err = encode_payload(w, msg);
+		break;
+	case OCPP_MSG_ROLE_CALLRESULT:
+		put_literal(w, "3,");
+		put_string(w, msg->id, sizeof(msg->id));
+		put_char(w, ',');
+		err = encode_payload(w, msg);
+		break;
+	case OCPP_MSG_ROLE_CALLERROR:
+		put_literal(w, "4,");
+		put_string(w, msg->id, sizeof(msg->id));
+		put_char(w, ',');
+		err = encode_error(w, msg);
+		break;
+	default:
+		err = -EINVAL;
+		break;
+	}
+
+	if (err) {
+		return err;
+	}
+
+	put_char(w, ']');
+
+	return 0;
+}
+
+int ocpp_encode_json_next(const struct ocpp_message *msg,
+		struct ocpp_encoder_cursor *cursor, size_t offset,
+		void *buf, size_t bufsize, size_t *len)
+{
+	struct writer w = {
+		.buf = (char *)buf,
+		.cap = bufsize,
+		.skip = offset,
+		.cursor = cursor,
+		.from = *cursor,
+		.resuming = cursor->depth > 0,
+	};
+	int err;
+
+	if (buf == NULL || bufsize == 0 || cursor->offset > offset ||
+			cursor->depth > OCPP_ENCODER_MAX_DEPTH) {
+		return -EINVAL;
+	}
+
+	/* -ENOBUFS is for a stop once past the piece */
+	if ((err = encode_frame(&w, msg)) != 0 && err != -ENOBUFS) {
+		return err;
+	}
+
+	if (w.len > w.skip + w.cap) {
+		*len = w.cap;
+		return -EAGAIN;
+	}
+
+	*len = w.len > w.skip? w.len - w.skip : 0;
+
+	return 0;
+}
+
+int ocpp_encode_json_at(const struct ocpp_message *msg, size_t offset,
+		void *buf, size_t bufsize, size_t *len)
+{
+	struct writer w = {
+		.buf = (char *)buf,
+		.cap = buf? bufsize : 0,
+		.skip = offset,
+	};
+	size_t rest;
+	int err;
+
+	if ((err = encode_frame(&w, msg)) != 0) {
+		return err;
+	}
+
+	if (len) {
+		*len = w.len;
+	}
+
+	rest = w.len > w.skip? w.len - w.skip : 0;
+
+	if (rest > w.cap) {
+		return -ENOBUFS;
+	}
+	if (rest < w.cap) {
+		w.buf[rest] = '\0';
+	}
+
+	return 0;
+}
+
+int ocpp_encode_json(const struct ocpp_message *msg,
+		void *buf, size_t bufsize, size_t *len)
+{
+	return ocpp_encode_json_at(msg, 0, buf, bufsize, len);
+}
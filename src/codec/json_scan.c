@@ -0,0 +1,247 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/json_scan.h"
+
+#include <errno.h>
+#include <stdbool.h>
+
+#if OCPP_JSON_SIMD && (defined(__x86_64__) || \
+		(defined(__i386__) && defined(__SSE2__))) && defined(__GNUC__)
+#define HAVE_X86
+#include <immintrin.h>
+#endif
+
+#if OCPP_JSON_SIMD && defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*scan_func_t)(const uint8_t *block,
+		struct ocpp_json_scan_mask *mask);
+
+static void scan_scalar(const uint8_t *block,
+		struct ocpp_json_scan_mask *mask)
+{
+	*mask = (struct ocpp_json_scan_mask) { 0, };
+
+	for (unsigned int i = 0; i < OCPP_JSON_SCAN_BLOCK_SIZE; i++) {
+		const uint8_t c = block[i];
+		const uint64_t bit = (uint64_t)1 << i;
+
+		if (c == '"') {
+			mask->quote |= bit;
+		} else if (c == '\\') {
+			mask->backslash |= bit;
+		} else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+			mask->space |= bit;
+		}
+
+		if (c < 0x20) {
+			mask->control |= bit;
+		}
+	}
+}
+
+#if defined(HAVE_X86)
+static void sse2_classify(const uint8_t *p, struct ocpp_json_scan_mask *m,
+		unsigned int shift)
+{
+	const __m128i v = _mm_loadu_si128((const __m128i *)(const void *)p);
+	const __m128i ctrl = _mm_set1_epi8(0x1f);
+	const __m128i space = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+				_mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+				_mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+
+#define MOVEMASK(x)	((uint64_t)(uint16_t)_mm_movemask_epi8(x) << shift)
+	m->quote |= MOVEMASK(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+	m->backslash |= MOVEMASK(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+	m->control |= MOVEMASK(_mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl));
+	m->space |= MOVEMASK(space);
+#undef MOVEMASK
+}
+
+static void scan_sse2(const uint8_t *block, struct ocpp_json_scan_mask *mask)
+{
+	*mask = (struct ocpp_json_scan_mask) { 0, };
+
+	for (unsigned int i = 0; i < OCPP_JSON_SCAN_BLOCK_SIZE; i += 16) {
+		sse2_classify(&block[i], mask, i);
+	}
+}
+
+__attribute__((target("avx2")))
+static void avx2_classify(const uint8_t *p, struct ocpp_json_scan_mask *m,
+		unsigned int shift)
+{
+	const __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)p);
+	const __m256i ctrl = _mm256_set1_epi8(0x1f);
+	const __m256i space = _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+			_mm256_or_si256(
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+				_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+
+#define MOVEMASK(x)	((uint64_t)(uint32_t)_mm256_movemask_epi8(x) << shift)
+	m->quote |= MOVEMASK(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+	m->backslash |= MOVEMASK(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+	m->control |= MOVEMASK(_mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl),
+				ctrl));
+	m->space |= MOVEMASK(space);
+#undef MOVEMASK
+}
+
+__attribute__((target("avx2")))
+static void scan_avx2(const uint8_t *block, struct ocpp_json_scan_mask *mask)
+{
+	*mask = (struct ocpp_json_scan_mask) { 0, };
+
+	avx2_classify(&block[0], mask, 0);
+	avx2_classify(&block[32], mask, 32);
+}
+#endif /* HAVE_X86 */
+
+#if defined(HAVE_NEON)
+/* Gathers the top bit of each byte of four vectors, like pmovmskb. */
+static uint64_t neon_movemask(uint8x16_t a, uint8x16_t b,
+		uint8x16_t c, uint8x16_t d)
+{
+	static const uint8_t weights[16] = {
+		1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128,
+	};
+	const uint8x16_t w = vld1q_u8(weights);
+	uint8x16_t sum0 = vpaddq_u8(vandq_u8(a, w), vandq_u8(b, w));
+	const uint8x16_t sum1 = vpaddq_u8(vandq_u8(c, w), vandq_u8(d, w));
+
+	sum0 = vpaddq_u8(sum0, sum1);
+	sum0 = vpaddq_u8(sum0, sum0);
+
+	return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+}
+
+static void scan_neon(const uint8_t *block, struct ocpp_json_scan_mask *mask)
+{
+	uint8x16_t quote[4], backslash[4], control[4], space[4];
+
+	for (unsigned int i = 0; i < 4; i++) {
+		const uint8x16_t v = vld1q_u8(&block[i * 16]);
+
+		quote[i] = vceqq_u8(v, vdupq_n_u8('"'));
+		backslash[i] = vceqq_u8(v, vdupq_n_u8('\\'));
+		control[i] = vcltq_u8(v, vdupq_n_u8(0x20));
+		space[i] = vorrq_u8(
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8(' ')),
+					vceqq_u8(v, vdupq_n_u8('\t'))),
+				vorrq_u8(vceqq_u8(v, vdupq_n_u8('\n')),
+					vceqq_u8(v, vdupq_n_u8('\r'))));
+	}
+
+	mask->quote = neon_movemask(quote[0], quote[1], quote[2], quote[3]);
+	mask->backslash = neon_movemask(backslash[0], backslash[1],
+			backslash[2], backslash[3]);
+	mask->control = neon_movemask(control[0], control[1],
+			control[2], control[3]);
+	mask->space = neon_movemask(space[0], space[1], space[2], space[3]);
+}
+#endif /* HAVE_NEON */
+
+static scan_func_t get_func(ocpp_json_scan_t impl)
+{
+	switch (impl) {
+	case OCPP_JSON_SCAN_SCALAR:
+		return scan_scalar;
+#if defined(HAVE_X86)
+	case OCPP_JSON_SCAN_SSE2:
+		return scan_sse2;
+	case OCPP_JSON_SCAN_AVX2:
+		return __builtin_cpu_supports("avx2")? scan_avx2 : NULL;
+#endif
+#if defined(HAVE_NEON)
+	case OCPP_JSON_SCAN_NEON:
+		return scan_neon;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static ocpp_json_scan_t get_best(void)
+{
+	static const ocpp_json_scan_t preferred[] = {
+		OCPP_JSON_SCAN_AVX2,
+		OCPP_JSON_SCAN_NEON,
+		OCPP_JSON_SCAN_SSE2,
+	};
+
+	for (size_t i = 0; i < sizeof(preferred) / sizeof(*preferred); i++) {
+		if (get_func(preferred[i])) {
+			return preferred[i];
+		}
+	}
+
+	return OCPP_JSON_SCAN_SCALAR;
+}
+
+static struct {
+	scan_func_t func;
+	ocpp_json_scan_t impl;
+} selected;
+
+int ocpp_json_scan_select(ocpp_json_scan_t impl)
+{
+	if (impl == OCPP_JSON_SCAN_AUTO) {
+		impl = get_best();
+	}
+
+	scan_func_t func = get_func(impl);
+
+	if (func == NULL) {
+		return -ENOTSUP;
+	}
+
+	selected.impl = impl;
+	selected.func = func;
+
+	return 0;
+}
+
+ocpp_json_scan_t ocpp_json_scan_selected(void)
+{
+	if (selected.func == NULL) {
+		(void)ocpp_json_scan_select(OCPP_JSON_SCAN_AUTO);
+	}
+
+	return selected.impl;
+}
+
+const char *ocpp_json_scan_stringify(ocpp_json_scan_t impl)
+{
+	switch (impl) {
+	case OCPP_JSON_SCAN_SCALAR:
+		return "scalar";
+	case OCPP_JSON_SCAN_SSE2:
+		return "sse2";
+	case OCPP_JSON_SCAN_AVX2:
+		return "avx2";
+	case OCPP_JSON_SCAN_NEON:
+		return "neon";
+	default:
+		return "auto";
+	}
+}
+
+void ocpp_json_scan(const void *block, struct ocpp_json_scan_mask *mask)
+{
+	if (selected.func == NULL) {
+		(void)ocpp_json_scan_select(OCPP_JSON_SCAN_AUTO);
+	}
+
+	(*selected.func)((const uint8_t *)block, mask);
+}
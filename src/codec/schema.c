@@ -0,0 +1,788 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/codec/schema.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if !defined(ARRAY_COUNT)
+#define ARRAY_COUNT(x)		(sizeof(x) / sizeof((x)[0]))
+#endif
+
+#define MEMBER_SIZE(st, member)		sizeof(((struct st *)0)->member)
+
+#define FIELD(st, member, key, t, fl, ax, r)				\
+	{								\
+		.name = key,						\
+		.offset = offsetof(struct st, member),			\
+		.size = MEMBER_SIZE(st, member),			\
+		.type = t,						\
+		.flags = fl,						\
+		.aux = ax,						\
+		.ref = r,						\
+	}
+#define FLEX(st, member, key, t, fl, r)					\
+	{								\
+		.name = key,						\
+		.offset = offsetof(struct st, member),			\
+		.type = t,						\
+		.flags = fl,						\
+		.ref = r,						\
+	}
+
+#define ARRAY(st, member, key, fl, elem)				\
+	{								\
+		.name = key,						\
+		.offset = offsetof(struct st, member),			\
+		.size = MEMBER_SIZE(st, nr_##member),			\
+		.type = OCPP_FIELD_ARRAY,				\
+		.flags = fl,						\
+		.aux = offsetof(struct st, nr_##member),		\
+		.ref = &ocpp_##elem##_schema,				\
+	}
+
+#define FIELD_STRING(st, m, key, len, fl)				\
+	FIELD(st, m, key, OCPP_FIELD_STRING, fl, 0, 0)
+#define FIELD_STRING_PTR(st, m, key, x, fl)				\
+	FIELD(st, m, key, OCPP_FIELD_STRING_PTR, fl, 0, 0)
+#define FIELD_TEXT(st, m, key, x, fl)					\
+	FLEX(st, m, key, OCPP_FIELD_TEXT, fl, 0)
+#define FIELD_STRING_LIST(st, m, key, x, fl)				\
+	FLEX(st, m, key, OCPP_FIELD_STRING_LIST, fl, 0)
+#define FIELD_STRING_LIST_PTR(st, m, key, x, fl)			\
+	FIELD(st, m, key, OCPP_FIELD_STRING_LIST_PTR, fl, 0, 0)
+#define FIELD_INT(st, m, key, type, fl)					\
+	FIELD(st, m, key, OCPP_FIELD_INT, fl, 0, 0)
+#define FIELD_UINT(st, m, key, type, fl)				\
+	FIELD(st, m, key, OCPP_FIELD_UINT, fl, 0, 0)
+#define FIELD_DECIMAL(st, m, key, scale, fl)				\
+	FIELD(st, m, key, OCPP_FIELD_DECIMAL, fl, scale, 0)
+#define FIELD_BOOL(st, m, key, x, fl)					\
+	FIELD(st, m, key, OCPP_FIELD_BOOL, fl, 0, 0)
+#define FIELD_TIME(st, m, key, x, fl)					\
+	FIELD(st, m, key, OCPP_FIELD_TIME, fl, 0, 0)
+#define FIELD_ENUM(st, m, key, x, fl)					\
+	FIELD(st, m, key, OCPP_FIELD_ENUM, fl,				\
+			ARRAY_COUNT(x##_names), x##_names)
+#define FIELD_FLAG(st, m, key, x, fl)					\
+	FIELD(st, m, key, OCPP_FIELD_FLAG, fl,				\
+			ARRAY_COUNT(x##_names), x##_names)
+#define FIELD_OBJECT(st, m, key, x, fl)					\
+	FIELD(st, m, key, OCPP_FIELD_OBJECT, fl, 0, &ocpp_##x##_schema)
+#define FIELD_OBJECT_LIST_PTR(st, m, key, x, fl)			\
+	FIELD(st, m, key, OCPP_FIELD_OBJECT_LIST_PTR, fl, 0,		\
+			&ocpp_##x##_schema)
+#define FIELD_ARRAY(st, m, key, x, fl)					\
+	ARRAY(st, m, key, fl, x)
+#define FIELD_RECORD(st, m, key, x, fl)					\
+	FLEX(st, m, key, OCPP_FIELD_RECORD, fl, &ocpp_##x##_schema)
+
+#define REQ			OCPP_FIELD_REQUIRED
+#define OPT			0
+#define LIST			OCPP_FIELD_LIST
+
+static const char * const auth_status_names[] = {
+	[OCPP_AUTH_STATUS_UNKNOWN] = NULL,
+	[OCPP_AUTH_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_AUTH_STATUS_BLOCKED] = "Blocked",
+	[OCPP_AUTH_STATUS_EXPIRED] = "Expired",
+	[OCPP_AUTH_STATUS_INVALID] = "Invalid",
+	[OCPP_AUTH_STATUS_CONCURRENT_TX] = "ConcurrentTx",
+};
+
+static const char * const boot_status_names[] = {
+	[OCPP_BOOT_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_BOOT_STATUS_PENDING] = "Pending",
+	[OCPP_BOOT_STATUS_REJECTED] = "Rejected",
+	[OCPP_BOOT_STATUS_UNKNOWN] = NULL,
+};
+
+static const char * const availability_names[] = {
+	[OCPP_INOPERATIVE] = "Inoperative",
+	[OCPP_OPERATIVE] = "Operative",
+};
+
+static const char * const availability_status_names[] = {
+	[OCPP_AVAILABILITY_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_AVAILABILITY_STATUS_REJECTED] = "Rejected",
+	[OCPP_AVAILABILITY_STATUS_SCHEDULED] = "Scheduled",
+};
+
+static const char * const config_status_names[] = {
+	[OCPP_CONFIG_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_CONFIG_STATUS_REJECTED] = "Rejected",
+	[OCPP_CONFIG_STATUS_REBOOT_REQUIRED] = "RebootRequired",
+	[OCPP_CONFIG_STATUS_NOT_SUPPORTED] = "NotSupported",
+};
+
+static const char * const remote_status_names[] = {
+	[OCPP_REMOTE_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_REMOTE_STATUS_REJECTED] = "Rejected",
+};
+
+static const char * const data_status_names[] = {
+	[OCPP_DATA_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_DATA_STATUS_REJECTED] = "Rejected",
+	[OCPP_DATA_STATUS_UNKNOWN_MESSAGE_ID] = "UnknownMessageId",
+	[OCPP_DATA_STATUS_UNKNOWN_VENDOR_ID] = "UnknownVendorId",
+};
+
+static const char * const reset_names[] = {
+	[OCPP_RESET_HARD] = "Hard",
+	[OCPP_RESET_SOFT] = "Soft",
+};
+
+static const char * const error_names[] = {
+	[OCPP_ERROR_NONE] = "NoError",
+	[OCPP_ERROR_CONNECTOR_LOCK_FAILURE] = "ConnectorLockFailure",
+	[OCPP_ERROR_EV_COMMUNICATION] = "EVCommunicationError",
+	[OCPP_ERROR_GROUND] = "GroundFailure",
+	[OCPP_ERROR_HIGH_TEMPERATURE] = "HighTemperature",
+	[OCPP_ERROR_INTERNAL] = "InternalError",
+	[OCPP_ERROR_LOCAL_LIST_CONFLICT] = "LocalListConflict",
+	[OCPP_ERROR_OTHER] = "OtherError",
+	[OCPP_ERROR_OVER_CURRENT] = "OverCurrentFailure",
+	[OCPP_ERROR_OVER_VOLTAGE] = "OverVoltage",
+	[OCPP_ERROR_POWER_METER] = "PowerMeterFailure",
+	[OCPP_ERROR_POWER_SWITCH] = "PowerSwitchFailure",
+	[OCPP_ERROR_READER] = "ReaderFailure",
+	[OCPP_ERROR_RESET] = "ResetFailure",
+	[OCPP_ERROR_UNDER_VOLTAGE] = "UnderVoltage",
+	[OCPP_ERROR_WEAK_SIGNAL] = "WeakSignal",
+};
+
+static const char * const status_names[] = {
+	[OCPP_STATUS_AVAILABLE] = "Available",
+	[OCPP_STATUS_PREPARING] = "Preparing",
+	[OCPP_STATUS_CHARGING] = "Charging",
+	[OCPP_STATUS_SUSPENDED_EVSE] = "SuspendedEVSE",
+	[OCPP_STATUS_SUSPENDED_EV] = "SuspendedEV",
+	[OCPP_STATUS_FINISHING] = "Finishing",
+	[OCPP_STATUS_RESERVED] = "Reserved",
+	[OCPP_STATUS_UNAVAILABLE] = "Unavailable",
+	[OCPP_STATUS_FAULTED] = "Faulted",
+};
+
+static const char * const stop_reason_names[] = {
+	[OCPP_STOP_REASON_LOCAL] = "Local",
+	[OCPP_STOP_REASON_DEAUTHORIZED] = "DeAuthorized",
+	[OCPP_STOP_REASON_EMERGENCY_STOP] = "EmergencyStop",
+	[OCPP_STOP_REASON_EV_DISCONNECTED] = "EVDisconnected",
+	[OCPP_STOP_REASON_HARD_RESET] = "HardReset",
+	[OCPP_STOP_REASON_OTHER] = "Other",
+	[OCPP_STOP_REASON_POWER_LOSS] = "PowerLoss",
+	[OCPP_STOP_REASON_REBOOT] = "Reboot",
+	[OCPP_STOP_REASON_REMOTE] = "Remote",
+	[OCPP_STOP_REASON_SOFT_RESET] = "SoftReset",
+	[OCPP_STOP_REASON_UNLOCK_COMMAND] = "UnlockCommand",
+};
+
+static const char * const unlock_status_names[] = {
+	[OCPP_UNLOCK_UNLOCKED] = "Unlocked",
+	[OCPP_UNLOCK_FAILED] = "UnlockFailed",
+	[OCPP_UNLOCK_NOT_SUPPORTED] = "NotSupported",
+};
+
+static const char * const comm_status_names[] = {
+	[OCPP_COMM_IDLE] = "Idle",
+	[OCPP_COMM_UPLOADED] = "Uploaded",
+	[OCPP_COMM_UPLOAD_FAILED] = "UploadFailed",
+	[OCPP_COMM_UPLOADING] = "Uploading",
+	[OCPP_COMM_DOWNLOADED] = "Downloaded",
+	[OCPP_COMM_DOWNLOAD_FAILED] = "DownloadFailed",
+	[OCPP_COMM_DOWNLOADING] = "Downloading",
+	[OCPP_COMM_INSTALLATION_FAILED] = "InstallationFailed",
+	[OCPP_COMM_INSTALLING] = "Installing",
+	[OCPP_COMM_INSTALLED] = "Installed",
+};
+
+static const char * const update_names[] = {
+	[OCPP_UPDATE_DIFFERENTIAL] = "Differential",
+	[OCPP_UPDATE_FULL] = "Full",
+};
+
+static const char * const update_status_names[] = {
+	[OCPP_UPDATE_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_UPDATE_STATUS_FAILED] = "Failed",
+	[OCPP_UPDATE_STATUS_NOT_SUPPORTED] = "NotSupported",
+	[OCPP_UPDATE_STATUS_VERSION_MISMATCH] = "VersionMismatch",
+};
+
+static const char * const reservation_status_names[] = {
+	[OCPP_RESERVE_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_RESERVE_STATUS_FAULTED] = "Faulted",
+	[OCPP_RESERVE_STATUS_OCCUPIED] = "Occupied",
+	[OCPP_RESERVE_STATUS_REJECTED] = "Rejected",
+	[OCPP_RESERVE_STATUS_UNAVAILABLE] = "Unavailable",
+};
+
+static const char * const profile_status_names[] = {
+	[OCPP_PROFILE_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_PROFILE_STATUS_REJECTED] = "Rejected",
+	[OCPP_PROFILE_STATUS_NOT_SUPPORTED] = "NotSupported",
+	[OCPP_PROFILE_STATUS_UNKNOWN] = "Unknown",
+};
+
+static const char * const charging_unit_names[] = {
+	[OCPP_CHARGING_UNIT_NONE] = NULL,
+	[OCPP_CHARGING_UNIT_WATT] = "W",
+	[OCPP_CHARGING_UNIT_AMPERE] = "A",
+};
+
+static const char * const charging_profile_purpose_names[] = {
+	[OCPP_CHARGING_PROFILE_MAX] = "ChargePointMaxProfile",
+	[OCPP_CHARGING_PROFILE_TX_DEFAULT] = "TxDefaultProfile",
+	[OCPP_CHARGING_PROFILE_TX] = "TxProfile",
+};
+
+static const char * const charging_profile_kind_names[] = {
+	[OCPP_CHARGING_PROFILE_KIND_ABSOLUTE] = "Absolute",
+	[OCPP_CHARGING_PROFILE_KIND_RECURRING] = "Recurring",
+	[OCPP_CHARGING_PROFILE_KIND_RELATIVE] = "Relative",
+};
+
+static const char * const charging_profile_recurrency_names[] = {
+	[OCPP_CHARGING_PROFILE_RECURRENCY_DAILY] = "Daily",
+	[OCPP_CHARGING_PROFILE_RECURRENCY_WEEKLY] = "Weekly",
+};
+
+static const char * const trigger_message_names[] = {
+	[OCPP_TRIGGER_BOOT_NOTIFICATION] = "BootNotification",
+	[OCPP_TRIGGER_LOG_STATUS_NOTIFICATION] = "LogStatusNotification",
+	[OCPP_TRIGGER_DIAGNOSTICS_STATUS] = "DiagnosticsStatusNotification",
+	[OCPP_TRIGGER_FIRMWARE_STATUS] = "FirmwareStatusNotification",
+	[OCPP_TRIGGER_HEARTBEAT] = "Heartbeat",
+	[OCPP_TRIGGER_METER_VALUE] = "MeterValues",
+	[OCPP_TRIGGER_SIGN_CP_CERTIFICATE] = "SignChargePointCertificate",
+	[OCPP_TRIGGER_STATUS_NOTIFICATION] = "StatusNotification",
+};
+
+static const char * const trigger_status_names[] = {
+	[OCPP_TRIGGER_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_TRIGGER_STATUS_REJECTED] = "Rejected",
+	[OCPP_TRIGGER_STATUS_NOT_IMPLEMENTED] = "NotImplemented",
+};
+
+static const char * const reading_context_names[] = {
+	[OCPP_READ_CTX_UNKNOWN] = NULL,
+	[OCPP_READ_CTX_INT_BEGIN] = "Interruption.Begin",
+	[OCPP_READ_CTX_INT_END] = "Interruption.End",
+	[OCPP_READ_CTX_OTHER] = "Other",
+	[OCPP_READ_CTX_SAMPLE_CLOCK] = "Sample.Clock",
+	[OCPP_READ_CTX_SAMPLE_PERIODIC] = "Sample.Periodic",
+	[OCPP_READ_CTX_TRANSACTION_BEGIN] = "Transaction.Begin",
+	[OCPP_READ_CTX_TRANSACTION_END] = "Transaction.End",
+	[OCPP_READ_CTX_TRIGGER] = "Trigger",
+};
+
+static const char * const value_format_names[] = {
+	[OCPP_VALUE_FORMAT_UNKNOWN] = NULL,
+	[OCPP_VALUE_FORMAT_RAW] = "Raw",
+	[OCPP_VALUE_FORMAT_SIGNED] = "SignedData",
+};
+
+/* indexed by the bit position of ocpp_measurand_t */
+static const char * const measurand_names[] = {
+	"Current.Export",
+	"Current.Import",
+	"Current.Offered",
+	"Energy.Active.Export.Register",
+	"Energy.Active.Import.Register",
+	"Energy.Reactive.Export.Register",
+	"Energy.Reactive.Import.Register",
+	"Energy.Active.Export.Interval",
+	"Energy.Active.Import.Interval",
+	"Energy.Reactive.Export.Interval",
+	"Energy.Reactive.Import.Interval",
+	"Frequency",
+	"Power.Active.Export",
+	"Power.Active.Import",
+	"Power.Factor",
+	"Power.Offered",
+	"Power.Reactive.Export",
+	"Power.Reactive.Import",
+	"RPM",
+	"SoC",
+	"Temperature",
+	"Voltage",
+};
+
+static const char * const phase_names[] = {
+	[OCPP_PHASE_UNKNOWN] = NULL,
+	[OCPP_PHASE_L1] = "L1",
+	[OCPP_PHASE_L2] = "L2",
+	[OCPP_PHASE_L3] = "L3",
+	[OCPP_PHASE_N] = "N",
+	[OCPP_PHASE_L1_N] = "L1-N",
+	[OCPP_PHASE_L2_N] = "L2-N",
+	[OCPP_PHASE_L3_N] = "L3-N",
+	[OCPP_PHASE_L1_L2] = "L1-L2",
+	[OCPP_PHASE_L2_L3] = "L2-L3",
+	[OCPP_PHASE_L3_L1] = "L3-L1",
+};
+
+static const char * const location_names[] = {
+	[OCPP_LOCATION_UNKNOWN] = NULL,
+	[OCPP_LOCATION_BODY] = "Body",
+	[OCPP_LOCATION_CABLE] = "Cable",
+	[OCPP_LOCATION_EV] = "EV",
+	[OCPP_LOCATION_INLET] = "Inlet",
+	[OCPP_LOCATION_OUTLET] = "Outlet",
+};
+
+static const char * const measure_unit_names[] = {
+	[OCPP_UNIT_UNKNOWN] = NULL,
+	[OCPP_UNIT_WH] = "Wh",
+	[OCPP_UNIT_KWH] = "kWh",
+	[OCPP_UNIT_VARH] = "varh",
+	[OCPP_UNIT_KVARH] = "kvarh",
+	[OCPP_UNIT_W] = "W",
+	[OCPP_UNIT_KW] = "kW",
+	[OCPP_UNIT_VA] = "VA",
+	[OCPP_UNIT_KVA] = "kVA",
+	[OCPP_UNIT_VAR] = "var",
+	[OCPP_UNIT_KVAR] = "kvar",
+	[OCPP_UNIT_A] = "A",
+	[OCPP_UNIT_V] = "V",
+	[OCPP_UNIT_CELSIUS] = "Celsius",
+	[OCPP_UNIT_FAHRENHEIT] = "Fahrenheit",
+	[OCPP_UNIT_K] = "K",
+	[OCPP_UNIT_PERCENT] = "Percent",
+};
+
+static const char * const security_status_names[] = {
+	[OCPP_SECURITY_STATUS_ACCEPTED] = "Accepted",
+	[OCPP_SECURITY_STATUS_REJECTED] = "Rejected",
+	[OCPP_SECURITY_STATUS_FAILED] = "Failed",
+	[OCPP_SECURITY_STATUS_NOT_FOUND] = "NotFound",
+	[OCPP_SECURITY_STATUS_ACCEPTED_CANCELED] = "AcceptedCanceled",
+	[OCPP_SECURITY_STATUS_NOT_IMPLEMENTED] = "NotImplemented",
+	[OCPP_SECURITY_STATUS_INVALID_CERTIFICATE] = "InvalidCertificate",
+	[OCPP_SECURITY_STATUS_REVOKED_CERTIFICATE] = "RevokedCertificate",
+	[OCPP_SECURITY_STATUS_BAD_MESSAGE] = "BadMessage",
+	[OCPP_SECURITY_STATUS_IDLE] = "Idle",
+	[OCPP_SECURITY_STATUS_NOT_SUPPORTED] = "NotSupportedOperation",
+	[OCPP_SECURITY_STATUS_PERMISSION_DENIED] = "PermissionDenied",
+	[OCPP_SECURITY_STATUS_UPLOADED] = "Uploaded",
+	[OCPP_SECURITY_STATUS_UPLOAD_FAILED] = "UploadFailure",
+	[OCPP_SECURITY_STATUS_UPLOADING] = "Uploading",
+	[OCPP_SECURITY_STATUS_DOWNLOADED] = "Downloaded",
+	[OCPP_SECURITY_STATUS_DOWNLOAD_FAILED] = "DownloadFailed",
+	[OCPP_SECURITY_STATUS_DOWNLOADING] = "Downloading",
+	[OCPP_SECURITY_STATUS_DOWNLOAD_SCHEDULED] = "DownloadScheduled",
+	[OCPP_SECURITY_STATUS_DOWNLOAD_PAUSED] = "DownloadPaused",
+	[OCPP_SECURITY_STATUS_INSTALLATION_FAILED] = "InstallationFailed",
+	[OCPP_SECURITY_STATUS_INSTALLING] = "Installing",
+	[OCPP_SECURITY_STATUS_INSTALLED] = "Installed",
+	[OCPP_SECURITY_STATUS_INSTALL_REBOOTING] = "InstallRebooting",
+	[OCPP_SECURITY_STATUS_INSTALL_SCHEDULED] = "InstallScheduled",
+	[OCPP_SECURITY_STATUS_INSTALL_VERIFICATION_FAILED] =
+		"InstallVerificationFailed",
+	[OCPP_SECURITY_STATUS_INVALID_SIGNATURE] = "InvalidSignature",
+	[OCPP_SECURITY_STATUS_SIGNATURE_VERIFIED] = "SignatureVerified",
+};
+
+static const char * const security_event_names[] = {
+	[OCPP_SECURITY_EVENT_FIRMWARE_UPDATED] = "FirmwareUpdated",
+	[OCPP_SECURITY_EVENT_FAILED_AUTHENTICATE_AT_CSMS] =
+		"FailedToAuthenticateAtCentralSystem",
+	[OCPP_SECURITY_EVENT_CENTRAL_SYSTEM_FAILED_TO_AUTHENTICATE] =
+		"CentralSystemFailedToAuthenticate",
+	[OCPP_SECURITY_EVENT_SETTING_SYSTEM_TIME] = "SettingSystemTime",
+	[OCPP_SECURITY_EVENT_STARTUP_DEVICE] = "StartupOfTheDevice",
+	[OCPP_SECURITY_EVENT_REBOOT] = "ResetOrReboot",
+	[OCPP_SECURITY_EVENT_LOG_CLEARED] = "SecurityLogWasCleared",
+	[OCPP_SECURITY_EVENT_PARAMETERS_UPDATED] =
+		"ReconfigurationOfSecurityParameters",
+	[OCPP_SECURITY_EVENT_MEMORY_EXHAUSTION] = "MemoryExhaustion",
+	[OCPP_SECURITY_EVENT_INVALID_MESSAGE] = "InvalidMessages",
+	[OCPP_SECURITY_EVENT_ATTEMPTED_REPLAY_ATTACK] =
+		"AttemptedReplayAttacks",
+	[OCPP_SECURITY_EVENT_TAMPER_DETECTED] = "TamperDetectionActivated",
+	[OCPP_SECURITY_EVENT_INVALID_FIRMWARE_SIGNATURE] =
+		"InvalidFirmwareSignature",
+	[OCPP_SECURITY_EVENT_INVALID_FIRMWARE_SIGNING] =
+		"InvalidFirmwareSigningCertificate",
+	[OCPP_SECURITY_EVENT_INVALID_CSMS_CERTIFICATE] =
+		"InvalidCentralSystemCertificate",
+	[OCPP_SECURITY_EVENT_INVALID_CHARGE_POINT_CERTIFICATE] =
+		"InvalidChargePointCertificate",
+	[OCPP_SECURITY_EVENT_INVALID_TLS_VERSION] = "InvalidTLSVersion",
+	[OCPP_SECURITY_EVENT_INVALID_TLS_CIPHER_SUITE] =
+		"InvalidTLSCipherSuite",
+};
+
+static const char * const security_cert_names[] = {
+	[OCPP_SECURITY_CERT_TYPE_ROOT_CSMS] = "CentralSystemRootCertificate",
+	[OCPP_SECURITY_CERT_TYPE_ROOT_MANUFACTURER] =
+		"ManufacturerRootCertificate",
+};
+
+static const char * const hash_names[] = {
+	[OCPP_HASH_SHA256] = "SHA256",
+	[OCPP_HASH_SHA384] = "SHA384",
+	[OCPP_HASH_SHA512] = "SHA512",
+};
+
+static const char * const log_names[] = {
+	[OCPP_LOG_DIAGNOSTICS] = "DiagnosticsLog",
+	[OCPP_LOG_SECURITY] = "SecurityLog",
+};
+
+/* Descriptors of the structs in OCPP_MESSAGE_DEFINES, in the same order */
+#define OCPP_STRUCT(st)							\
+	static const struct ocpp_field ocpp_##st##_fields[] = {
+#define OCPP_STRUCT_END(st)						\
+	};								\
+	static const struct ocpp_schema ocpp_##st##_schema = {		\
+		.name = "ocpp_" #st,					\
+		.size = sizeof(struct ocpp_##st),			\
+		.align = __alignof__(struct ocpp_##st),			\
+		.nr_fields = ARRAY_COUNT(ocpp_##st##_fields),		\
+		.fields = ocpp_##st##_fields,				\
+	};
+#define OCPP_FIELD(st, m, kind, arg, fl)				\
+	FIELD_##kind(ocpp_##st, m, #m, arg, fl),
+#define OCPP_FIELD_AS(st, m, key, kind, arg, fl)			\
+	FIELD_##kind(ocpp_##st, m, key, arg, fl),
+#define OCPP_MEMBER(st, m, type)
+#define OCPP_EMPTY(st, m)						\
+	static const struct ocpp_schema ocpp_##st##_schema = {		\
+		.name = "ocpp_" #st,					\
+		.size = sizeof(struct ocpp_##st),			\
+		.align = __alignof__(struct ocpp_##st),			\
+	};
+#define OCPP_MESSAGE(type, st)
+#include OCPP_MESSAGE_DEFINES
+#undef OCPP_MESSAGE
+#undef OCPP_EMPTY
+#undef OCPP_FIELD_AS
+#undef OCPP_FIELD
+#undef OCPP_STRUCT_END
+#undef OCPP_STRUCT
+
+#define OCPP_STRUCT(st)
+#define OCPP_STRUCT_END(st)
+#define OCPP_FIELD(st, m, kind, arg, fl)
+#define OCPP_FIELD_AS(st, m, key, kind, arg, fl)
+#define OCPP_EMPTY(st, m)
+#define OCPP_MESSAGE(type, st)						\
+	[type] = { &ocpp_##st##_schema, &ocpp_##st##_conf_schema },
+static const struct ocpp_schema * const schemas[OCPP_MSG_MAX][2] = {
+#include OCPP_MESSAGE_DEFINES
+};
+#undef OCPP_MESSAGE
+#undef OCPP_EMPTY
+#undef OCPP_MEMBER
+#undef OCPP_FIELD_AS
+#undef OCPP_FIELD
+#undef OCPP_STRUCT_END
+#undef OCPP_STRUCT
+
+const struct ocpp_schema *ocpp_get_schema(ocpp_message_t type, bool response)
+{
+	if ((unsigned int)type >= OCPP_MSG_MAX) {
+		return NULL;
+	}
+
+	return schemas[type][response];
+}
+
+static size_t align_up(size_t x, size_t align)
+{
+	return (x + align - 1) / align * align;
+}
+
+static size_t get_uint(const void *p, size_t size)
+{
+	switch (size) {
+	case sizeof(uint8_t):
+		return *(const uint8_t *)p;
+	case sizeof(uint16_t):
+		return *(const uint16_t *)p;
+	case sizeof(uint32_t):
+		return *(const uint32_t *)p;
+	case sizeof(uint64_t):
+		return (size_t)*(const uint64_t *)p;
+	default:
+		return 0;
+	}
+}
+
+size_t ocpp_get_record_size(const struct ocpp_schema *schema,
+		const void *record, size_t avail)
+{
+	const struct ocpp_field *last = schema->nr_fields == 0? NULL :
+		&schema->fields[schema->nr_fields - 1];
+	const uint8_t *base = (const uint8_t *)record;
+	size_t end = schema->size;
+
+	if (last && last->type == OCPP_FIELD_ARRAY) {
+		const struct ocpp_schema *elem =
+			(const struct ocpp_schema *)last->ref;
+		const size_t n = get_uint(&base[last->aux], last->size);
+		end = last->offset + n * elem->size;
+	} else if (last && last->type == OCPP_FIELD_RECORD) {
+		const struct ocpp_schema *sub =
+			(const struct ocpp_schema *)last->ref;
+		const size_t start = align_up(last->offset, sub->align);
+		if (start >= avail) {
+			return 0;
+		}
+		const size_t n = ocpp_get_record_size(sub,
+				&base[start], avail - start);
+		end = n == 0? avail + 1 : start + n;
+	} else if (last && last->type == OCPP_FIELD_TEXT) {
+		end = avail;
+	}
+
+	if (end > avail) {
+		return 0;
+	}
+
+	/* the padding of the last record may be left out of the payload */
+	end = align_up(end, schema->align);
+	return end > avail? avail : end;
+}
+
+#if OCPP_VALIDATION
+static int64_t get_int(const void *p, size_t size)
+{
+	switch (size) {
+	case sizeof(int8_t):
+		return *(const int8_t *)p;
+	case sizeof(int16_t):
+		return *(const int16_t *)p;
+	case sizeof(int32_t):
+		return *(const int32_t *)p;
+	case sizeof(int64_t):
+		return *(const int64_t *)p;
+	default:
+		return 0;
+	}
+}
+
+static const char *get_ptr(const void *p)
+{
+	const char *ptr;
+	memcpy(&ptr, p, sizeof(ptr));
+	return ptr;
+}
+
+static bool is_zero(const uint8_t *p, size_t size)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (p[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool is_flexible(const struct ocpp_field *field)
+{
+	return field->type == OCPP_FIELD_TEXT ||
+		field->type == OCPP_FIELD_STRING_LIST ||
+		field->type == OCPP_FIELD_ARRAY ||
+		field->type == OCPP_FIELD_RECORD;
+}
+
+static int check_missing(const struct ocpp_field *field, bool present)
+{
+	return !present && (field->flags & OCPP_FIELD_REQUIRED)? -EINVAL : 0;
+}
+
+/* Zero, or a value without a name like OCPP_AUTH_STATUS_UNKNOWN, is taken
+ * as absent as the encoder does. */
+static int validate_enum(const struct ocpp_field *field, const uint8_t *p)
+{
+	const char * const *names = (const char * const *)field->ref;
+	const int64_t v = get_int(p, field->size);
+
+	if (field->type == OCPP_FIELD_FLAG) {
+		const uint64_t u = (uint64_t)v;
+
+		if (u == 0) {
+			return check_missing(field, false);
+		} else if ((u & (u - 1)) != 0 || u >> field->aux) {
+			return -ERANGE;
+		}
+
+		return 0;
+	}
+
+	if (v < 0 || v >= field->aux) {
+		return -ERANGE;
+	}
+
+	return check_missing(field, names[v] != NULL);
+}
+
+static int validate_object(const struct ocpp_schema *schema,
+		const uint8_t *base, size_t avail);
+
+static int validate_object_list(const struct ocpp_field *field,
+		const uint8_t *p)
+{
+	const struct ocpp_schema *elem = (const struct ocpp_schema *)field->ref;
+	const uint8_t *list = (const uint8_t *)get_ptr(p);
+	size_t i = 0;
+	int err = 0;
+
+	/* ended by an element whose first field is empty */
+	for (; list && err == 0; i++) {
+		const uint8_t *e = &list[i * elem->size];
+
+		if (e[elem->fields[0].offset] == 0) {
+			break;
+		}
+
+		err = validate_object(elem, e, elem->size);
+	}
+
+	return err? err : check_missing(field, i > 0);
+}
+
+static int validate_array(const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const struct ocpp_schema *elem = (const struct ocpp_schema *)field->ref;
+	const size_t n = get_uint(&base[field->aux], field->size);
+	const size_t room = avail > field->offset? avail - field->offset : 0;
+	int err = 0;
+
+	if (n > room / elem->size) {
+		return -ERANGE;
+	}
+
+	for (size_t i = 0; i < n && err == 0; i++) {
+		err = validate_object(elem,
+				&base[field->offset + i * elem->size],
+				elem->size);
+	}
+
+	return err? err : check_missing(field, n > 0);
+}
+
+static int validate_records(const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const struct ocpp_schema *sub = (const struct ocpp_schema *)field->ref;
+	size_t pos = align_up(field->offset, sub->align);
+	size_t n = 0;
+
+	while (pos < avail) {
+		const size_t size =
+			ocpp_get_record_size(sub, &base[pos], avail - pos);
+
+		if (size == 0) {
+			return -ERANGE;
+		}
+
+		int err = validate_object(sub, &base[pos], size);
+		if (err) {
+			return err;
+		}
+
+		pos += size;
+		n++;
+
+		if (!(field->flags & OCPP_FIELD_LIST)) {
+			break;
+		}
+	}
+
+	return check_missing(field, n > 0);
+}
+
+static int validate_field(const struct ocpp_field *field,
+		const uint8_t *base, size_t avail)
+{
+	const uint8_t *p = &base[field->offset];
+	const char *str;
+	time_t t;
+
+	switch (field->type) {
+	case OCPP_FIELD_STRING:
+		if (memchr(p, '\0', field->size) == NULL) {
+			return -ERANGE;
+		}
+		return check_missing(field, p[0] != '\0');
+	case OCPP_FIELD_STRING_PTR: /* fall through */
+	case OCPP_FIELD_STRING_LIST_PTR:
+		str = get_ptr(p);
+		return check_missing(field, str && str[0]);
+	case OCPP_FIELD_TEXT: /* fall through */
+	case OCPP_FIELD_STRING_LIST:
+		return check_missing(field, field->offset < avail && p[0]);
+	case OCPP_FIELD_TIME:
+		memcpy(&t, p, sizeof(t));
+		return check_missing(field, t != 0);
+	case OCPP_FIELD_ENUM: /* fall through */
+	case OCPP_FIELD_FLAG:
+		return validate_enum(field, p);
+	case OCPP_FIELD_OBJECT:
+		if (is_zero(p, field->size)) {
+			return check_missing(field, false);
+		}
+		return validate_object((const struct ocpp_schema *)field->ref,
+				p, field->size);
+	case OCPP_FIELD_OBJECT_LIST_PTR:
+		return validate_object_list(field, p);
+	case OCPP_FIELD_ARRAY:
+		return validate_array(field, base, avail);
+	case OCPP_FIELD_RECORD:
+		return validate_records(field, base, avail);
+	default: /* numbers and booleans are always present */
+		return 0;
+	}
+}
+
+static int validate_object(const struct ocpp_schema *schema,
+		const uint8_t *base, size_t avail)
+{
+	for (uint16_t i = 0; i < schema->nr_fields; i++) {
+		const struct ocpp_field *field = &schema->fields[i];
+
+		if (!is_flexible(field) &&
+				(size_t)field->offset + field->size > avail) {
+			return -EINVAL;
+		}
+
+		int err = validate_field(field, base, avail);
+		if (err) {
+			return err;
+		}
+	}
+
+	return 0;
+}
+#endif /* OCPP_VALIDATION */
+
+int ocpp_validate(ocpp_message_t type, bool response,
+		const void *payload, size_t size)
+{
+#if OCPP_VALIDATION
+	const struct ocpp_schema *schema = ocpp_get_schema(type, response);
+
+	if (schema == NULL) {
+		return -EINVAL;
+	}
+	if (payload == NULL) {
+		return schema->nr_fields > 0? -EINVAL : 0;
+	}
+
+	return validate_object(schema, (const uint8_t *)payload, size);
+#else
+	(void)type;
+	(void)response;
+	(void)payload;
+	(void)size;
+	return 0;
+#endif
+}
@@ -0,0 +1,1112 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE				200112L
+#endif
+
+#include "ocpp/csms.h"
+#include "ocpp/codec/codec.h"
+#include "ocpp/ws_simd.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL				0
+#endif
+
+#define WS_GUID				"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_LEN				24 /* base64 of 16 bytes */
+#define WS_ACCEPT_LEN				28 /* base64 of 20 bytes */
+/* 2 bytes and 8 of extended payload length, as servers do not mask */
+#define WS_MAX_HEADER_LEN			10
+
+#define CLOSE_PROTOCOL_ERROR			1002
+#define CLOSE_UNSUPPORTED_DATA			1003
+#define CLOSE_TOO_BIG				1009
+
+enum opcode {
+	OP_CONTINUATION				= 0x0,
+	OP_TEXT					= 0x1,
+	OP_BINARY				= 0x2,
+	OP_CLOSE				= 0x8,
+	OP_PING					= 0x9,
+	OP_PONG					= 0xA,
+};
+
+struct answer {
+	bool used;
+	uint64_t due; /**< Monotonic, in ms. */
+	size_t len;
+	char text[OCPP_CSMS_ANSWER_MAXLEN];
+};
+
+struct call {
+	bool used;
+	char id[OCPP_MESSAGE_ID_MAXLEN];
+	ocpp_message_t type;
+};
+
+static struct {
+	int listener;
+	int fd;
+	bool open; /**< The handshake is done. */
+	uint16_t port;
+
+	struct ocpp_csms_param param;
+	ocpp_csms_callback_t cb;
+	void *cb_ctx;
+	const struct ocpp_codec *codec;
+
+	uint32_t random;
+	uint32_t seq;
+	int transaction_id;
+
+	struct {
+		uint8_t buf[OCPP_CSMS_RX_BUFSIZE];
+		size_t len;
+	} rx;
+
+	struct {
+		uint8_t buf[OCPP_CSMS_TX_BUFSIZE];
+		size_t len;
+		size_t sent;
+	} tx;
+
+	struct answer answers[OCPP_CSMS_MAX_PENDING];
+	struct call calls[OCPP_CSMS_MAX_PENDING];
+
+	uint64_t payload[OCPP_CSMS_PAYLOAD_BUFSIZE / sizeof(uint64_t)];
+	struct ocpp_csms_stats stats;
+} csms = {
+	.listener = -1,
+	.fd = -1,
+};
+
+static uint64_t now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* xorshift32, for the draws to repeat from the same seed */
+static uint32_t next_random(void)
+{
+	uint32_t x = csms.random;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return csms.random = x;
+}
+
+static bool draw(uint8_t pct)
+{
+	return pct && next_random() % 100 < pct;
+}
+
+static uint32_t rol32(uint32_t x, unsigned int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(uint32_t h[5], const uint8_t *p)
+{
+	uint32_t w[80];
+	uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+	for (int i = 0; i < 16; i++) {
+		w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 |
+			(uint32_t)p[i * 4 + 2] << 8 | (uint32_t)p[i * 4 + 3];
+	}
+	for (int i = 16; i < 80; i++) {
+		w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	for (int i = 0; i < 80; i++) {
+		uint32_t f, k;
+
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+
+		const uint32_t t = rol32(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = rol32(b, 30);
+		b = a;
+		a = t;
+	}
+
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+}
+
+static void sha1(const void *data, size_t len, uint8_t digest[20])
+{
+	uint32_t h[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+	};
+	const uint8_t *p = (const uint8_t *)data;
+	uint8_t block[64];
+	size_t i = 0;
+
+	for (; len - i >= sizeof(block); i += sizeof(block)) {
+		sha1_block(h, &p[i]);
+	}
+
+	const size_t rest = len - i;
+	memset(block, 0, sizeof(block));
+	memcpy(block, &p[i], rest);
+	block[rest] = 0x80;
+
+	if (rest >= sizeof(block) - 8) {
+		sha1_block(h, block);
+		memset(block, 0, sizeof(block));
+	}
+
+	const uint64_t bits = (uint64_t)len * 8;
+	for (int j = 0; j < 8; j++) {
+		block[63 - j] = (uint8_t)(bits >> (j * 8));
+	}
+	sha1_block(h, block);
+
+	for (int j = 0; j < 20; j++) {
+		digest[j] = (uint8_t)(h[j / 4] >> (24 - (j % 4) * 8));
+	}
+}
+
+static void base64(char *out, const uint8_t *data, size_t len)
+{
+	static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	for (size_t i = 0; i < len; i += 3) {
+		const uint32_t v = (uint32_t)data[i] << 16 |
+			(i + 1 < len? (uint32_t)data[i + 1] << 8 : 0) |
+			(i + 2 < len? (uint32_t)data[i + 2] : 0);
+
+		*out++ = table[v >> 18 & 0x3f];
+		*out++ = table[v >> 12 & 0x3f];
+		*out++ = i + 1 < len? table[v >> 6 & 0x3f] : '=';
+		*out++ = i + 2 < len? table[v & 0x3f] : '=';
+	}
+
+	*out = '\0';
+}
+
+static char to_lower(char c)
+{
+	return c >= 'A' && c <= 'Z'? (char)(c - 'A' + 'a') : c;
+}
+
+/* Compares s of len bytes with the null-terminated lowercase str. */
+static bool equals_nocase(const char *s, size_t len, const char *str)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (str[i] == '\0' || to_lower(s[i]) != str[i]) {
+			return false;
+		}
+	}
+
+	return str[len] == '\0';
+}
+
+/* Tells if the comma-separated list s has the element str. */
+static bool has_element(const char *s, size_t len, const char *str)
+{
+	const size_t n = strlen(str);
+
+	for (size_t i = 0; i < len; ) {
+		size_t end = i;
+
+		while (i < len && (s[i] == ' ' || s[i] == '\t')) {
+			end = ++i;
+		}
+		while (end < len && s[end] != ',') {
+			end++;
+		}
+
+		size_t m = end - i;
+		while (m && (s[i + m - 1] == ' ' || s[i + m - 1] == '\t')) {
+			m--;
+		}
+
+		if (m == n && memcmp(&s[i], str, n) == 0) {
+			return true;
+		}
+
+		i = end + 1;
+	}
+
+	return false;
+}
+
+/* Finds the end of the line at s, returning its length without CRLF. */
+static size_t get_line_len(const char *s, size_t len)
+{
+	for (size_t i = 0; i + 1 < len; i++) {
+		if (s[i] == '\r' && s[i + 1] == '\n') {
+			return i;
+		}
+	}
+
+	return len;
+}
+
+static void consume(size_t n)
+{
+	memmove(csms.rx.buf, &csms.rx.buf[n], csms.rx.len - n);
+	csms.rx.len -= n;
+}
+
+static void compact_tx(void)
+{
+	if (csms.tx.sent == 0) {
+		return;
+	}
+
+	memmove(csms.tx.buf, &csms.tx.buf[csms.tx.sent],
+			csms.tx.len - csms.tx.sent);
+	csms.tx.len -= csms.tx.sent;
+	csms.tx.sent = 0;
+}
+
+static int queue(const void *data, size_t len)
+{
+	compact_tx();
+
+	if (len > sizeof(csms.tx.buf) - csms.tx.len) {
+		return -ENOBUFS;
+	}
+
+	memcpy(&csms.tx.buf[csms.tx.len], data, len);
+	csms.tx.len += len;
+
+	return 0;
+}
+
+/* Server frames are never masked, RFC 6455 5.1. */
+static int queue_frame(uint8_t opcode, const void *data, size_t len)
+{
+	uint8_t *p;
+	size_t hlen = 2;
+
+	compact_tx();
+
+	if (WS_MAX_HEADER_LEN + len > sizeof(csms.tx.buf) - csms.tx.len) {
+		return -ENOBUFS;
+	}
+
+	p = &csms.tx.buf[csms.tx.len];
+	p[0] = (uint8_t)(0x80 | opcode);
+
+	if (len <= 125) {
+		p[1] = (uint8_t)len;
+	} else if (len <= 0xffff) {
+		p[1] = 126;
+		p[hlen++] = (uint8_t)(len >> 8);
+		p[hlen++] = (uint8_t)len;
+	} else {
+		p[1] = 127;
+		for (int j = 7; j >= 0; j--) {
+			p[hlen++] = (uint8_t)((uint64_t)len >> (j * 8));
+		}
+	}
+
+	if (len) {
+		memcpy(&p[hlen], data, len);
+	}
+	csms.tx.len += hlen + len;
+
+	return 0;
+}
+
+static void drop(void)
+{
+	if (csms.fd >= 0) {
+		close(csms.fd);
+	}
+
+	csms.fd = -1;
+	csms.open = false;
+	csms.rx.len = 0;
+	csms.tx.len = csms.tx.sent = 0;
+
+	memset(csms.answers, 0, sizeof(csms.answers));
+	memset(csms.calls, 0, sizeof(csms.calls));
+}
+
+static int flush(void)
+{
+	while (csms.tx.sent < csms.tx.len) {
+		const ssize_t n = send(csms.fd, &csms.tx.buf[csms.tx.sent],
+				csms.tx.len - csms.tx.sent, MSG_NOSIGNAL);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			return -errno;
+		}
+
+		csms.tx.sent += (size_t)n;
+	}
+
+	if (csms.tx.sent == csms.tx.len) {
+		csms.tx.sent = csms.tx.len = 0;
+	}
+
+	return 0;
+}
+
+/* Reads what has arrived, returning -ECONNRESET at the end of the stream. */
+static int fill_rx(void)
+{
+	while (csms.rx.len < sizeof(csms.rx.buf)) {
+		const ssize_t n = recv(csms.fd, &csms.rx.buf[csms.rx.len],
+				sizeof(csms.rx.buf) - csms.rx.len, 0);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			return -errno;
+		} else if (n == 0) {
+			return -ECONNRESET;
+		}
+
+		csms.rx.len += (size_t)n;
+	}
+
+	return 0;
+}
+
+static int fail(uint16_t code)
+{
+	const uint8_t status[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+
+	if (queue_frame(OP_CLOSE, status, sizeof(status)) == 0) {
+		(void)flush();
+	}
+
+	drop();
+
+	return -EPROTO;
+}
+
+static int reject(const char *status)
+{
+	char buf[64];
+	const int len = snprintf(buf, sizeof(buf),
+			"HTTP/1.1 %s\r\nContent-Length: 0\r\n\r\n", status);
+
+	if (queue(buf, (size_t)len) == 0) {
+		(void)flush();
+	}
+
+	drop();
+
+	return -EPROTO;
+}
+
+static int process_handshake(void)
+{
+	const char *s = (const char *)csms.rx.buf;
+	size_t end = 0;
+	bool upgrade = false, ocpp = false;
+	char key[WS_KEY_LEN + sizeof(WS_GUID)] = "";
+
+	for (size_t i = 0; i + 3 < csms.rx.len; i++) {
+		if (memcmp(&s[i], "\r\n\r\n", 4) == 0) {
+			end = i + 4;
+			break;
+		}
+	}
+
+	if (end == 0) {
+		return csms.rx.len == sizeof(csms.rx.buf)?
+			reject("431 Request Header Fields Too Large") : 0;
+	}
+
+	if (memcmp(s, "GET ", 4) != 0) {
+		return reject("405 Method Not Allowed");
+	}
+
+	for (size_t i = get_line_len(s, end) + 2; i < end - 2; ) {
+		const size_t n = get_line_len(&s[i], end - i);
+		const char *line = &s[i];
+		const char *colon = memchr(line, ':', n);
+
+		i += n + 2;
+
+		if (colon == NULL) {
+			return reject("400 Bad Request");
+		}
+
+		const size_t name_len = (size_t)(colon - line);
+		const char *value = colon + 1;
+		size_t value_len = n - name_len - 1;
+
+		while (value_len && (*value == ' ' || *value == '\t')) {
+			value++;
+			value_len--;
+		}
+		while (value_len && (value[value_len - 1] == ' ' ||
+					value[value_len - 1] == '\t')) {
+			value_len--;
+		}
+
+		if (equals_nocase(line, name_len, "upgrade")) {
+			upgrade = equals_nocase(value, value_len, "websocket");
+		} else if (equals_nocase(line, name_len,
+					"sec-websocket-key")) {
+			if (value_len == WS_KEY_LEN) {
+				memcpy(key, value, WS_KEY_LEN);
+			}
+		} else if (equals_nocase(line, name_len,
+					"sec-websocket-protocol")) {
+			ocpp = has_element(value, value_len,
+					OCPP_CODEC_JSON_SUBPROTOCOL);
+		}
+	}
+
+	if (!upgrade || key[0] == '\0') {
+		return reject("400 Bad Request");
+	}
+	if (!ocpp) {
+		return reject("406 Not Acceptable");
+	}
+
+	uint8_t digest[20];
+	char accept[WS_ACCEPT_LEN + 1];
+	char buf[256];
+
+	memcpy(&key[WS_KEY_LEN], WS_GUID, sizeof(WS_GUID));
+	sha1(key, WS_KEY_LEN + sizeof(WS_GUID) - 1, digest);
+	base64(accept, digest, sizeof(digest));
+
+	const int len = snprintf(buf, sizeof(buf),
+			"HTTP/1.1 101 Switching Protocols\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Accept: %s\r\n"
+			"Sec-WebSocket-Protocol: %s\r\n"
+			"\r\n",
+			accept, OCPP_CODEC_JSON_SUBPROTOCOL);
+
+	if (queue(buf, (size_t)len) != 0) {
+		drop();
+		return -ENOBUFS;
+	}
+
+	consume(end);
+	csms.open = true;
+	csms.stats.connections++;
+
+	return 0;
+}
+
+static struct answer *alloc_answer(void)
+{
+	for (size_t i = 0; i < OCPP_CSMS_MAX_PENDING; i++) {
+		if (!csms.answers[i].used) {
+			return &csms.answers[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void schedule(const struct ocpp_message *msg)
+{
+	struct answer *answer = alloc_answer();
+	uint64_t delay = csms.param.latency_ms;
+
+	if (answer == NULL || (*csms.codec->encode)(msg, answer->text,
+			sizeof(answer->text), &answer->len) != 0) {
+		return;
+	}
+
+	if (csms.param.jitter_ms) {
+		delay += next_random() % (csms.param.jitter_ms + 1);
+	}
+
+	answer->due = now_ms() + delay;
+	answer->used = true;
+
+	if (msg->role == OCPP_MSG_ROLE_CALLERROR) {
+		csms.stats.errors++;
+	} else {
+		csms.stats.answered++;
+	}
+}
+
+static void schedule_error(const struct ocpp_message *req,
+		ocpp_call_error_t code)
+{
+	struct ocpp_CallError err = { .code = code, };
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALLERROR,
+		.type = req->type,
+		.payload.fmt.response = &err,
+		.payload.size = sizeof(err),
+	};
+
+	memcpy(msg.id, req->id, sizeof(msg.id));
+	schedule(&msg);
+}
+
+static void answer(const struct ocpp_message *req)
+{
+	union {
+		struct ocpp_BootNotification_conf boot;
+		struct ocpp_Heartbeat_conf heartbeat;
+		struct ocpp_Authorize_conf authorize;
+		struct ocpp_StartTransaction_conf start;
+		struct ocpp_StopTransaction_conf stop;
+		struct ocpp_MeterValues_conf meter;
+		struct ocpp_StatusNotification_conf status;
+	} conf;
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALLRESULT,
+		.type = req->type,
+		.payload.fmt.response = &conf,
+		.payload.size = sizeof(conf),
+	};
+
+	if (draw(csms.param.drop_pct)) {
+		csms.stats.dropped++;
+		return;
+	} else if (draw(csms.param.disconnect_pct)) {
+		csms.stats.disconnects++;
+		drop();
+		return;
+	} else if (draw(csms.param.callerror_pct)) {
+		schedule_error(req, OCPP_CALL_ERROR_INTERNAL);
+		return;
+	}
+
+	memset(&conf, 0, sizeof(conf));
+	memcpy(msg.id, req->id, sizeof(msg.id));
+
+	switch (req->type) {
+	case OCPP_MSG_BOOTNOTIFICATION:
+		conf.boot.currentTime = time(NULL);
+		conf.boot.interval = (int)csms.param.heartbeat_interval;
+		conf.boot.status = csms.param.boot_status;
+		break;
+	case OCPP_MSG_HEARTBEAT:
+		conf.heartbeat.currentTime = time(NULL);
+		break;
+	case OCPP_MSG_AUTHORIZE:
+		conf.authorize.idTagInfo.status = OCPP_AUTH_STATUS_ACCEPTED;
+		break;
+	case OCPP_MSG_START_TRANSACTION:
+		conf.start.idTagInfo.status = OCPP_AUTH_STATUS_ACCEPTED;
+		conf.start.transactionId = ++csms.transaction_id;
+		break;
+	case OCPP_MSG_STOP_TRANSACTION:
+		conf.stop.idTagInfo.status = OCPP_AUTH_STATUS_ACCEPTED;
+		break;
+	case OCPP_MSG_METER_VALUES: /* fall through */
+	case OCPP_MSG_STATUS_NOTIFICATION:
+		break;
+	default:
+		schedule_error(req, OCPP_CALL_ERROR_NOT_IMPLEMENTED);
+		return;
+	}
+
+	schedule(&msg);
+}
+
+static struct call *find_call(const char *id, size_t len)
+{
+	for (size_t i = 0; i < OCPP_CSMS_MAX_PENDING; i++) {
+		struct call *call = &csms.calls[i];
+
+		if (call->used && strlen(call->id) == len &&
+				memcmp(call->id, id, len) == 0) {
+			return call;
+		}
+	}
+
+	return NULL;
+}
+
+static const char *skip_space(const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' ||
+				*p == '\r' || *p == '\n')) {
+		p++;
+	}
+
+	return p;
+}
+
+/* Takes a reply to a call of the central system by its id, as the codec
+ * looks the type up in the queue of the engine. */
+static void process_reply(ocpp_message_role_t role,
+		const char *text, size_t len)
+{
+	const char *end = &text[len];
+	const char *comma = memchr(text, ',', len);
+	const char *p = comma? skip_space(comma + 1, end) : end;
+	const char *id = p + 1;
+	const char *quote;
+
+	if (p >= end || *p != '"' ||
+			(quote = memchr(id, '"', (size_t)(end - id))) == NULL) {
+		return;
+	}
+
+	struct call *call = find_call(id, (size_t)(quote - id));
+
+	if (call == NULL) {
+		return;
+	}
+
+	struct ocpp_message msg = {
+		.role = role,
+		.type = call->type,
+	};
+
+	memcpy(msg.id, call->id, sizeof(msg.id));
+	call->used = false;
+	csms.stats.replies++;
+
+	if (csms.cb) {
+		(*csms.cb)(&msg, text, len, csms.cb_ctx);
+	}
+}
+
+static void process_text(const char *text, size_t len)
+{
+	const char *p = skip_space(text, &text[len]);
+	struct ocpp_message msg = { 0, };
+
+	if (p + 1 >= &text[len] || *p != '[') {
+		return;
+	}
+
+	p = skip_space(p + 1, &text[len]);
+
+	if (p < &text[len] && (*p == '3' || *p == '4')) {
+		process_reply(*p == '3'? OCPP_MSG_ROLE_CALLRESULT :
+				OCPP_MSG_ROLE_CALLERROR, text, len);
+		return;
+	}
+
+	const int err = (*csms.codec->decode)(&msg, csms.payload,
+			sizeof(csms.payload), text, len);
+
+	if (msg.role != OCPP_MSG_ROLE_CALL || msg.id[0] == '\0') {
+		return;
+	}
+
+	csms.stats.received++;
+
+	if (err == -ENOTSUP) {
+		schedule_error(&msg, OCPP_CALL_ERROR_NOT_IMPLEMENTED);
+	} else if (err) {
+		schedule_error(&msg, OCPP_CALL_ERROR_FORMATION_VIOLATION);
+	} else {
+		if (csms.cb) {
+			(*csms.cb)(&msg, text, len, csms.cb_ctx);
+		}
+		answer(&msg);
+	}
+}
+
+static int handle_control(uint8_t opcode, const uint8_t *data, size_t len)
+{
+	switch (opcode) {
+	case OP_PING:
+		(void)queue_frame(OP_PONG, data, len);
+		return 0;
+	case OP_PONG:
+		return 0;
+	case OP_CLOSE:
+		if (queue_frame(OP_CLOSE, data, len >= 2? 2 : 0) == 0) {
+			(void)flush();
+		}
+		drop();
+		return 0;
+	default:
+		return fail(CLOSE_PROTOCOL_ERROR);
+	}
+}
+
+/* Client frames must be masked, RFC 6455 5.1. Fragments are not taken. */
+static int process_frames(void)
+{
+	while (csms.fd >= 0) {
+		uint8_t *p = csms.rx.buf;
+		size_t hlen = 2;
+		uint64_t len;
+
+		if (csms.rx.len < hlen) {
+			break;
+		}
+
+		const uint8_t opcode = p[0] & 0x0f;
+
+		if ((p[0] & 0xf0) != 0x80 || !(p[1] & 0x80)) {
+			return fail(CLOSE_PROTOCOL_ERROR);
+		}
+
+		len = p[1] & 0x7f;
+		if (len == 126) {
+			if (csms.rx.len < (hlen = 4)) {
+				break;
+			}
+			len = (uint64_t)p[2] << 8 | p[3];
+		} else if (len == 127) {
+			if (csms.rx.len < (hlen = 10)) {
+				break;
+			}
+			len = 0;
+			for (int i = 2; i < 10; i++) {
+				len = len << 8 | p[i];
+			}
+		}
+		hlen += 4;
+
+		if (len > sizeof(csms.rx.buf) - hlen) {
+			return fail(CLOSE_TOO_BIG);
+		}
+		if (csms.rx.len < hlen + len) {
+			break;
+		}
+
+		ocpp_ws_mask(&p[hlen], (size_t)len, &p[hlen - 4]);
+
+		if (opcode & 0x8) {
+			int err = handle_control(opcode, &p[hlen], (size_t)len);
+			if (err || csms.fd < 0) {
+				return err;
+			}
+		} else if (opcode == OP_TEXT) {
+			process_text((const char *)&p[hlen], (size_t)len);
+			if (csms.fd < 0) { /* dropped on purpose */
+				return 0;
+			}
+		} else {
+			return fail(CLOSE_UNSUPPORTED_DATA);
+		}
+
+		consume(hlen + (size_t)len);
+	}
+
+	return 0;
+}
+
+static struct answer *next_answer(void)
+{
+	struct answer *next = NULL;
+
+	for (size_t i = 0; i < OCPP_CSMS_MAX_PENDING; i++) {
+		struct answer *answer = &csms.answers[i];
+
+		if (answer->used && (next == NULL || answer->due < next->due)) {
+			next = answer;
+		}
+	}
+
+	return next;
+}
+
+static void send_due(void)
+{
+	const uint64_t now = now_ms();
+	struct answer *answer;
+
+	while ((answer = next_answer()) != NULL && answer->due <= now &&
+			queue_frame(OP_TEXT, answer->text, answer->len) == 0) {
+		answer->used = false;
+	}
+}
+
+static int get_timeout(int timeout_ms)
+{
+	const struct answer *answer = next_answer();
+
+	if (answer == NULL || !csms.open) {
+		return timeout_ms;
+	}
+
+	const uint64_t now = now_ms();
+	const int due = answer->due > now? (int)(answer->due - now) : 0;
+
+	return timeout_ms < 0 || due < timeout_ms? due : timeout_ms;
+}
+
+static int accept_connection(void)
+{
+	const int fd = accept(csms.listener, NULL, NULL);
+	const int one = 1;
+
+	if (fd < 0) {
+		return errno == EAGAIN || errno == EWOULDBLOCK ||
+			errno == EINTR? 0 : -errno;
+	}
+
+	const int flags = fcntl(fd, F_GETFL, 0);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		const int err = -errno;
+		close(fd);
+		return err;
+	}
+
+	/* answers are small and latency is what gets measured */
+	(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	drop();
+	csms.fd = fd;
+
+	return 0;
+}
+
+static void service(short revents)
+{
+	int err = 0;
+
+	if (revents & POLLOUT) {
+		err = flush();
+	}
+
+	if (!err && (revents & (POLLIN | POLLHUP | POLLERR))) {
+		/* what came before the end of the stream is processed first */
+		const int rx = fill_rx();
+
+		if (!csms.open) {
+			err = process_handshake();
+		}
+		if (!err && csms.open) {
+			err = process_frames();
+		}
+		if (!err && csms.fd >= 0) {
+			err = rx;
+		}
+	}
+
+	if (err && csms.fd >= 0) {
+		drop();
+	}
+}
+
+int ocpp_csms_poll(int timeout_ms)
+{
+	struct pollfd fds[2] = {
+		{ .fd = csms.listener, .events = POLLIN, },
+		{ .fd = csms.fd, .events = POLLIN, },
+	};
+
+	if (csms.listener < 0) {
+		return -EINVAL;
+	}
+
+	if (csms.tx.sent < csms.tx.len) {
+		fds[1].events |= POLLOUT;
+	}
+
+	if (poll(fds, csms.fd >= 0? 2 : 1, get_timeout(timeout_ms)) < 0) {
+		return errno == EINTR? 0 : -errno;
+	}
+
+	if (csms.fd >= 0 && fds[1].revents) {
+		service(fds[1].revents);
+	}
+
+	if (fds[0].revents & POLLIN) {
+		const int err = accept_connection();
+		if (err) {
+			return err;
+		}
+	}
+
+	if (csms.open) {
+		send_due();
+	}
+	if (csms.fd >= 0 && flush() != 0) {
+		drop();
+	}
+
+	return 0;
+}
+
+int ocpp_csms_call(ocpp_message_t type, const void *data, size_t datasize,
+		char id[OCPP_MESSAGE_ID_MAXLEN])
+{
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = type,
+		.payload.fmt.request = data,
+		.payload.size = datasize,
+	};
+	struct call *call = NULL;
+	char text[OCPP_CSMS_ANSWER_MAXLEN];
+	size_t len;
+	int err;
+
+	if (!csms.open) {
+		return -ENOTCONN;
+	}
+
+	for (size_t i = 0; i < OCPP_CSMS_MAX_PENDING && call == NULL; i++) {
+		if (!csms.calls[i].used) {
+			call = &csms.calls[i];
+		}
+	}
+
+	if (call == NULL) {
+		return -ENOBUFS;
+	}
+
+	snprintf(msg.id, sizeof(msg.id), "csms-%u", (unsigned int)++csms.seq);
+
+	if ((err = (*csms.codec->encode)(&msg, text, sizeof(text), &len))
+			!= 0) {
+		return err;
+	}
+	if ((err = queue_frame(OP_TEXT, text, len)) != 0) {
+		return err;
+	}
+
+	memcpy(call->id, msg.id, sizeof(call->id));
+	call->type = type;
+	call->used = true;
+	csms.stats.calls++;
+
+	if (id) {
+		memcpy(id, msg.id, sizeof(msg.id));
+	}
+
+	if ((err = flush()) != 0) {
+		drop();
+	}
+
+	return err;
+}
+
+bool ocpp_csms_connected(void)
+{
+	return csms.open;
+}
+
+void ocpp_csms_disconnect(void)
+{
+	if (csms.fd >= 0) {
+		csms.stats.disconnects++;
+	}
+
+	drop();
+}
+
+uint16_t ocpp_csms_get_port(void)
+{
+	return csms.port;
+}
+
+void ocpp_csms_get_stats(struct ocpp_csms_stats *stats)
+{
+	*stats = csms.stats;
+}
+
+int ocpp_csms_start(const struct ocpp_csms_param *param,
+		ocpp_csms_callback_t cb, void *ctx)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = htons(param->port),
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t addrlen = sizeof(addr);
+	const int one = 1;
+	int err = 0;
+
+	if (csms.listener >= 0) {
+		return -EALREADY;
+	}
+
+	const int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		return -errno;
+	}
+
+	const int flags = fcntl(fd, F_GETFL, 0);
+
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+				&one, sizeof(one)) < 0 ||
+			bind(fd, (struct sockaddr *)&addr, addrlen) < 0 ||
+			listen(fd, 1) < 0 ||
+			getsockname(fd, (struct sockaddr *)&addr,
+				&addrlen) < 0) {
+		err = -errno;
+		close(fd);
+		return err;
+	}
+
+	memset(&csms.stats, 0, sizeof(csms.stats));
+	csms.param = *param;
+	csms.cb = cb;
+	csms.cb_ctx = ctx;
+	csms.codec = ocpp_get_codec(OCPP_CODEC_JSON_SUBPROTOCOL,
+			strlen(OCPP_CODEC_JSON_SUBPROTOCOL));
+	csms.random = param->seed? param->seed : 1;
+	csms.seq = 0;
+	csms.transaction_id = 0;
+	csms.listener = fd;
+	csms.port = ntohs(addr.sin_port);
+
+	return 0;
+}
+
+void ocpp_csms_stop(void)
+{
+	drop();
+
+	if (csms.listener >= 0) {
+		close(csms.listener);
+	}
+
+	csms.listener = -1;
+	csms.port = 0;
+}
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <assert.h>
 
 #if !defined(OCPP_DEBUG)
 #define OCPP_DEBUG(...)
@@ -27,6 +28,11 @@
 #if !defined(OCPP_DEFAULT_TX_RETRIES)
 #define OCPP_DEFAULT_TX_RETRIES			3
 #endif
+/* Bytes kept in each message slot for its encoded frame, so that a retry is
+ * sent without encoding the message again. 0 disables the cache. */
+#if !defined(OCPP_FRAME_CACHE_SIZE)
+#define OCPP_FRAME_CACHE_SIZE			0
+#endif
 
 #define container_of(ptr, type, member)		\
 	((type *)(void *)((char *)(ptr) - offsetof(type, member)))
@@ -36,6 +42,12 @@ struct message {
 	struct ocpp_message body;
 	time_t expiry;
 	uint32_t attempts; /**< The number of message sending attempts. */
+	bool in_flight; /**< Sent and waiting for its response. */
+	ocpp_completion_callback_t on_complete;
+#if OCPP_FRAME_CACHE_SIZE > 0
+	size_t frame_len; /**< The length of the cached frame, 0 if none. */
+	uint8_t frame[OCPP_FRAME_CACHE_SIZE];
+#endif
 };
 
 typedef void (*list_add_func_t)(struct message *);
@@ -51,6 +63,18 @@ static struct {
 		struct list timer;
 		struct list dead;
 
+		/* Completions of the requests dropped on a push, delivered on
+		 * the next ocpp_step(). Each was a message with a callback in
+		 * the pool, whose slot is taken by a forced push, which never
+		 * has one. Slots are only freed within ocpp_step(), so the
+		 * messages with a callback and the entries here together never
+		 * outnumber the slots of the pool. */
+		struct {
+			ocpp_completion_callback_t cb;
+			void *ctx;
+		} dropped[OCPP_TX_POOL_LEN];
+		unsigned int nr_dropped;
+
 		time_t timestamp;
 	} tx;
 
@@ -59,6 +83,8 @@ static struct {
 	} rx;
 
 	bool boot_accepted;
+	bool offline; /**< The transport told the link is down. */
+	time_t clock_synced; /**< When the last currentTime came in. */
 } m;
 
 static void add_last_to_list(struct message *msg, struct list *head)
@@ -121,6 +147,7 @@ static void del_msg_ready(struct message *msg)
 static void del_msg_wait(struct message *msg)
 {
 	del_from_list(msg, &m.tx.wait);
+	msg->in_flight = false;
 	OCPP_DEBUG("%s removed from wait list",
 			ocpp_stringify_type(msg->body.type));
 }
@@ -179,6 +206,53 @@ static void dispatch_event(ocpp_event_t event_type,
 	}
 }
 
+static void complete_message(struct message *msg, ocpp_completion_t outcome,
+		const struct ocpp_message *response)
+{
+	ocpp_completion_callback_t cb = msg->on_complete;
+
+	if (cb == NULL) {
+		return;
+	}
+
+	msg->on_complete = NULL;
+
+	ocpp_unlock();
+	(*cb)(outcome, response, msg->body.ctx);
+	ocpp_lock();
+}
+
+/* Keeps the completion for ocpp_step(), not to call back into the caller
+ * of a push from within it. */
+static void defer_completion(struct message *msg)
+{
+	if (msg->on_complete == NULL) {
+		return;
+	}
+
+	assert(m.tx.nr_dropped < OCPP_TX_POOL_LEN);
+
+	m.tx.dropped[m.tx.nr_dropped].cb = msg->on_complete;
+	m.tx.dropped[m.tx.nr_dropped].ctx = msg->body.ctx;
+	m.tx.nr_dropped++;
+
+	msg->on_complete = NULL;
+}
+
+static void complete_dropped_messages(void)
+{
+	for (unsigned int i = 0; i < m.tx.nr_dropped; i++) {
+		ocpp_completion_callback_t cb = m.tx.dropped[i].cb;
+		void *ctx = m.tx.dropped[i].ctx;
+
+		ocpp_unlock();
+		(*cb)(OCPP_COMPLETION_DROPPED, NULL, ctx);
+		ocpp_lock();
+	}
+
+	m.tx.nr_dropped = 0;
+}
+
 static struct message *alloc_message(void)
 {
 	for (int i = 0; i < OCPP_TX_POOL_LEN; i++) {
@@ -222,6 +296,7 @@ static struct message *new_message(const char *id,
 
 	msg->body.type = type;
 	msg->attempts = 0;
+	msg->in_flight = false;
 
 	if (id) {
 		msg->body.role = err?
@@ -252,7 +327,8 @@ static struct message *find_msg_by_idstr(struct list *list_head,
 
 static int push_message(const char *id, ocpp_message_t type,
 		const void *data, size_t datasize,
-		time_t timer, list_add_func_t f, bool err, void *ctx)
+		time_t timer, list_add_func_t f, bool err,
+		ocpp_completion_callback_t on_complete, void *ctx)
 {
 	struct message *msg = new_message(id, type, err);
 
@@ -264,6 +340,7 @@ static int push_message(const char *id, ocpp_message_t type,
 	msg->body.payload.size = datasize;
 	msg->body.ctx = ctx;
 	msg->expiry = timer;
+	msg->on_complete = on_complete;
 	(*f)(msg);
 
 	return 0;
@@ -303,16 +380,39 @@ static bool should_drop(struct message *msg)
 	return true;
 }
 
-static bool should_send_heartbeat(const time_t *now)
+/* Gets when the Heartbeat period started and how long it is, 0 if disabled.
+ * Any message sent starts it again, unless the transport pings the server on
+ * WebSocketPingInterval, leaving Heartbeats to synchronize the clock only. */
+static uint32_t get_heartbeat_period(time_t *start)
 {
-	uint32_t interval;
+	uint32_t interval = 0;
+	uint32_t ping = 0;
+
 	ocpp_get_configuration("HeartbeatInterval",
 			&interval, sizeof(interval), 0);
+	ocpp_get_configuration("WebSocketPingInterval",
+			&ping, sizeof(ping), 0);
+
+	if (interval == 0 || ping == 0 || !ocpp_transport_keeps_alive()) {
+		*start = m.tx.timestamp;
+		return interval;
+	}
+
+	*start = m.clock_synced;
+
+	return interval > OCPP_CLOCK_SYNC_INTERVAL_SEC?
+		interval : OCPP_CLOCK_SYNC_INTERVAL_SEC;
+}
+
+static bool should_send_heartbeat(const time_t *now)
+{
+	time_t start;
+	const uint32_t interval = get_heartbeat_period(&start);
 	const bool disabled = interval == 0;
-	const uint32_t elapsed = (uint32_t)(*now - m.tx.timestamp);
+	const uint32_t elapsed = (uint32_t)(*now - start);
 
 	if (disabled || elapsed < interval || !is_boot_accepted() ||
-			count_messages_ready() > 0 ||
+			m.offline || count_messages_ready() > 0 ||
 			count_messages_waiting() > 0) {
 		return false;
 	}
@@ -352,6 +452,24 @@ static void update_message_expiry(struct message *msg, const time_t *now)
 	msg->expiry = get_next_period(msg, now);
 }
 
+static int transmit(struct message *msg)
+{
+#if OCPP_FRAME_CACHE_SIZE > 0
+	size_t len;
+
+	if (msg->frame_len == 0 && ocpp_encode_frame(&msg->body,
+			msg->frame, sizeof(msg->frame), &len) == 0) {
+		msg->frame_len = len;
+	}
+
+	/* a frame not fitting in the cache goes through ocpp_send() */
+	if (msg->frame_len > 0) {
+		return ocpp_send_frame(&msg->body, msg->frame, msg->frame_len);
+	}
+#endif
+	return ocpp_send(&msg->body);
+}
+
 static void send_message(struct message *msg, const time_t *now)
 {
 	msg->attempts++;
@@ -364,8 +482,9 @@ static void send_message(struct message *msg, const time_t *now)
 			msg->attempts, OCPP_DEFAULT_TX_RETRIES,
 			(unsigned long)(msg->expiry - *now));
 
-	if (ocpp_send(&msg->body) == 0) {
+	if (transmit(msg) == 0) {
 		if (msg->body.role == OCPP_MSG_ROLE_CALL) {
+			msg->in_flight = true;
 			put_msg_wait(msg);
 			return;
 		}
@@ -376,6 +495,8 @@ static void send_message(struct message *msg, const time_t *now)
 			put_msg_wait(msg);
 			return;
 		}
+
+		complete_message(msg, OCPP_COMPLETION_DROPPED, NULL);
 	}
 
 	free_message(msg);
@@ -397,6 +518,7 @@ static void process_tx_timeout(const time_t *now)
 		if (should_drop(msg)) {
 			OCPP_INFO("Dropping message %s",
 					ocpp_stringify_type(msg->body.type));
+			complete_message(msg, OCPP_COMPLETION_TIMEOUT, NULL);
 			free_message(msg);
 		} else {
 			OCPP_INFO("Retrying message %s",
@@ -408,6 +530,11 @@ static void process_tx_timeout(const time_t *now)
 
 static int process_queued_messages(const time_t *now)
 {
+	/* nothing is sent nor counted as an attempt until the link is back */
+	if (m.offline) {
+		return -ENOTCONN;
+	}
+
 	process_tx_timeout(now);
 
 	/* do not send a message if there is a message waiting for a response.
@@ -506,7 +633,6 @@ static bool process_central_response_result(const struct ocpp_message *received,
 		struct message *req, const time_t *now)
 {
 	(void)req;
-	(void)now;
 
 	if (received->type == OCPP_MSG_BOOTNOTIFICATION) {
 		const struct ocpp_BootNotification_conf *p =
@@ -515,7 +641,10 @@ static bool process_central_response_result(const struct ocpp_message *received,
 
 		if (p->status == OCPP_BOOT_STATUS_ACCEPTED) {
 			set_boot_accepted(true);
+			m.clock_synced = *now;
 		}
+	} else if (received->type == OCPP_MSG_HEARTBEAT) {
+		m.clock_synced = *now;
 	}
 
 	return true;
@@ -538,8 +667,14 @@ static int process_central_response(const struct ocpp_message *received,
 
 	if (received->role == OCPP_MSG_ROLE_CALLRESULT) {
 		done = process_central_response_result(received, req, now);
+		if (done) {
+			complete_message(req, OCPP_COMPLETION_RESULT, received);
+		}
 	} else if (received->role == OCPP_MSG_ROLE_CALLERROR) {
 		done = process_central_response_error(received, req, now);
+		if (done) {
+			complete_message(req, OCPP_COMPLETION_ERROR, received);
+		}
 	} else {
 		OCPP_ERROR("Invalid message role: %d", received->role);
 	}
@@ -586,7 +721,7 @@ static int process_incoming_messages(const time_t *now)
 	if (err == -ENOTSUP && received.role == OCPP_MSG_ROLE_CALL) {
 		/* Send CallError if the message is not supported. */
 		push_message(received.id, received.type, NULL, 0, 0,
-				put_msg_ready, true, NULL);
+				put_msg_ready, true, NULL, NULL);
 	} else {
 		dispatch_event(err, &received);
 	}
@@ -609,6 +744,7 @@ static int remove_oldest(void)
 			OCPP_ERROR("Removing the oldest message: %s",
 					ocpp_stringify_type(msg->body.type));
 			del_msg_ready(msg);
+			defer_completion(msg);
 			free_message(msg);
 			return 0;
 		}
@@ -674,17 +810,100 @@ const char *ocpp_stringify_type(ocpp_message_t msgtype)
 	return msgtype >= OCPP_MSG_MAX? "UnknownMessage" : msgstr[msgtype];
 }
 
-ocpp_message_t ocpp_get_type_from_string(const char *typestr)
+/* Minimal perfect hash over the message type names: FNV-1a started from a
+ * seed found by tools/typestr_hash.c so that every name lands in its own
+ * slot. The round trip test over all the types fails if a new name
+ * collides; `make typestr_hash` then prints the seed and the slot table to
+ * replace these with. */
+#define TYPESTR_HASH_BITS		6
+#define TYPESTR_HASH_SEED		0x95ea4u
+
+static uint32_t hash_typestr(const char *str, size_t len)
 {
-	const char **msgstr = get_typestr_array();
+	uint32_t h = TYPESTR_HASH_SEED;
 
-	for (uint32_t i = 0; i < OCPP_MSG_MAX; i++) {
-		if (strcmp(typestr, msgstr[i]) == 0) {
-			return (ocpp_message_t)i;
-		}
+	for (size_t i = 0; i < len; i++) {
+		h ^= (uint8_t)str[i];
+		h *= 16777619u;
 	}
 
-	return OCPP_MSG_MAX;
+	return h >> (32 - TYPESTR_HASH_BITS);
+}
+
+ocpp_message_t ocpp_get_type_from_strn(const char *typestr, size_t len)
+{
+	/* type is stored plus one so that zero marks an empty slot */
+	static const struct {
+		uint8_t type;
+		uint8_t len;
+	} slots[1u << TYPESTR_HASH_BITS] = {
+		[0] = { OCPP_MSG_DATA_TRANSFER + 1, 12 },
+		[1] = { OCPP_MSG_GET_DIAGNOSTICS + 1, 14 },
+		[3] = { OCPP_MSG_LOG_STATUS_NOTIFICATION + 1, 21 },
+		[4] = { OCPP_MSG_FIRMWARE_NOTIFICATION + 1, 26 },
+		[5] = { OCPP_MSG_EXTENDED_TRIGGER_MESSAGE + 1, 22 },
+		[6] = { OCPP_MSG_SET_CHARGING_PROFILE + 1, 18 },
+		[7] = { OCPP_MSG_TRIGGER_MESSAGE + 1, 14 },
+		[8] = { OCPP_MSG_RESERVE_NOW + 1, 10 },
+		[9] = { OCPP_MSG_HEARTBEAT + 1, 9 },
+		[10] = { OCPP_MSG_CANCEL_RESERVATION + 1, 17 },
+		[12] = { OCPP_MSG_UPDATE_FIRMWARE + 1, 14 },
+		[13] = { OCPP_MSG_GET_LOCAL_LIST_VERSION + 1, 19 },
+		[18] = { OCPP_MSG_SIGNED_FIRMWARE_STATUS_NOTIFICATION + 1, 32 },
+		[20] = { OCPP_MSG_STOP_TRANSACTION + 1, 15 },
+		[21] = { OCPP_MSG_DELETE_CERTIFICATE + 1, 17 },
+		[22] = { OCPP_MSG_CLEAR_CHARGING_PROFILE + 1, 20 },
+		[23] = { OCPP_MSG_CERTIFICATE_SIGNED + 1, 17 },
+		[24] = { OCPP_MSG_RESET + 1, 5 },
+		[25] = { OCPP_MSG_CHANGE_AVAILABILITY + 1, 18 },
+		[26] = { OCPP_MSG_START_TRANSACTION + 1, 16 },
+		[27] = { OCPP_MSG_CLEAR_CACHE + 1, 10 },
+		[29] = { OCPP_MSG_GET_INSTALLED_CERTIFICATE_IDS + 1, 26 },
+		[31] = { OCPP_MSG_REMOTE_STOP_TRANSACTION + 1, 21 },
+		[33] = { OCPP_MSG_STATUS_NOTIFICATION + 1, 18 },
+		[35] = { OCPP_MSG_GET_LOG + 1, 6 },
+		[37] = { OCPP_MSG_CHANGE_CONFIGURATION + 1, 19 },
+		[38] = { OCPP_MSG_DIAGNOSTICS_NOTIFICATION + 1, 29 },
+		[39] = { OCPP_MSG_METER_VALUES + 1, 11 },
+		[40] = { OCPP_MSG_SECURITY_EVENT_NOTIFICATION + 1, 25 },
+		[41] = { OCPP_MSG_GET_COMPOSITE_SCHEDULE + 1, 20 },
+		[44] = { OCPP_MSG_UNLOCK_CONNECTOR + 1, 15 },
+		[46] = { OCPP_MSG_SIGN_CERTIFICATE + 1, 15 },
+		[48] = { OCPP_MSG_REMOTE_START_TRANSACTION + 1, 22 },
+		[51] = { OCPP_MSG_INSTALL_CERTIFICATE + 1, 18 },
+		[52] = { OCPP_MSG_AUTHORIZE + 1, 9 },
+		[54] = { OCPP_MSG_BOOTNOTIFICATION + 1, 16 },
+		[55] = { OCPP_MSG_GET_CONFIGURATION + 1, 16 },
+		[58] = { OCPP_MSG_SIGNED_UPDATE_FIRMWARE + 1, 20 },
+		[60] = { OCPP_MSG_SEND_LOCAL_LIST + 1, 13 },
+	};
+
+	if (typestr == NULL) {
+		return OCPP_MSG_MAX;
+	}
+
+	const uint32_t slot = hash_typestr(typestr, len);
+
+	if (slots[slot].type == 0 || slots[slot].len != len) {
+		return OCPP_MSG_MAX;
+	}
+
+	const ocpp_message_t type = (ocpp_message_t)(slots[slot].type - 1);
+
+	if (memcmp(typestr, get_typestr_array()[type], len) != 0) {
+		return OCPP_MSG_MAX;
+	}
+
+	return type;
+}
+
+ocpp_message_t ocpp_get_type_from_string(const char *typestr)
+{
+	if (typestr == NULL) {
+		return OCPP_MSG_MAX;
+	}
+
+	return ocpp_get_type_from_strn(typestr, strlen(typestr));
 }
 
 ocpp_message_t ocpp_get_type_from_idstr(const char *idstr)
@@ -704,6 +923,147 @@ ocpp_message_t ocpp_get_type_from_idstr(const char *idstr)
 	return req->body.type;
 }
 
+static void update_earliest(time_t *earliest, bool *found, time_t t)
+{
+	if (!*found || t < *earliest) {
+		*earliest = t;
+		*found = true;
+	}
+}
+
+static void update_earliest_in_list(time_t *earliest, bool *found,
+		struct list *list_head)
+{
+	struct list *p;
+
+	list_for_each(p, list_head) {
+		const struct message *msg =
+			container_of(p, struct message, link);
+		update_earliest(earliest, found, msg->expiry);
+	}
+}
+
+int ocpp_get_next_deadline(time_t *deadline)
+{
+	time_t earliest = 0;
+	bool found = false;
+
+	ocpp_lock();
+	{
+		update_earliest_in_list(&earliest, &found, &m.tx.wait);
+		update_earliest_in_list(&earliest, &found, &m.tx.timer);
+
+		if (m.offline) {
+			/* the queue is held until the link is back */
+		} else if (count_messages_waiting() == 0) {
+			if (count_messages_ready() > 0) {
+				update_earliest(&earliest, &found,
+						ocpp_get_time());
+			} else if (is_boot_accepted()) {
+				time_t start;
+				const uint32_t interval =
+					get_heartbeat_period(&start);
+				if (interval > 0) {
+					update_earliest(&earliest, &found,
+							start +
+							(time_t)interval);
+				}
+			}
+		}
+	}
+	ocpp_unlock();
+
+	if (!found) {
+		return -ENOENT;
+	}
+
+	if (deadline) {
+		*deadline = earliest;
+	}
+
+	return 0;
+}
+
+/* The replies to the messages in flight are lost with the link. They go
+ * back to the front of the ready list in the order sent, and the attempt
+ * the link took away is not counted. The rest of the wait list, like a
+ * transaction message held back after a CALLERROR, keeps its expiry. */
+static void requeue_messages_in_flight(void)
+{
+	struct list *pos = &m.tx.ready;
+	struct list *p;
+	struct list *t;
+
+	list_for_each_safe(p, t, &m.tx.wait) {
+		struct message *msg = container_of(p, struct message, link);
+
+		if (!msg->in_flight) {
+			continue;
+		}
+
+		del_msg_wait(msg);
+		if (msg->attempts > 0) {
+			msg->attempts--;
+		}
+
+		list_add(&msg->link, pos);
+		pos = &msg->link;
+		OCPP_DEBUG("%s requeued to ready list",
+				ocpp_stringify_type(msg->body.type));
+	}
+}
+
+/* BootNotification not accepted yet goes first on a new link. */
+static void put_bootnoti_infront(void)
+{
+	struct list *p;
+	struct list *t;
+
+	if (is_boot_accepted()) {
+		return;
+	}
+
+	list_for_each_safe(p, t, &m.tx.ready) {
+		struct message *msg = container_of(p, struct message, link);
+		if (msg->body.type == OCPP_MSG_BOOTNOTIFICATION &&
+				msg->body.role == OCPP_MSG_ROLE_CALL) {
+			del_msg_ready(msg);
+			put_msg_ready_infront(msg);
+			return;
+		}
+	}
+}
+
+void ocpp_set_connected(bool connected)
+{
+	ocpp_lock();
+	{
+		if (m.offline == connected) {
+			OCPP_INFO("Link %s", connected? "up" : "down");
+
+			m.offline = !connected;
+
+			if (connected) {
+				put_bootnoti_infront();
+			} else {
+				requeue_messages_in_flight();
+			}
+		}
+	}
+	ocpp_unlock();
+}
+
+bool ocpp_is_connected(void)
+{
+	bool connected;
+
+	ocpp_lock();
+	connected = !m.offline;
+	ocpp_unlock();
+
+	return connected;
+}
+
 size_t ocpp_count_pending_requests(void)
 {
 	size_t count = 0;
@@ -727,7 +1087,23 @@ int ocpp_push_request(ocpp_message_t type,
 	ocpp_lock();
 	{
 		rc = push_message(NULL, type, data, datasize, 0,
-				put_msg_ready, 0, ctx);
+				put_msg_ready, 0, NULL, ctx);
+	}
+	ocpp_unlock();
+
+	return rc;
+}
+
+int ocpp_push_request_cb(ocpp_message_t type, const void *data,
+		size_t datasize, ocpp_completion_callback_t on_complete,
+		void *ctx)
+{
+	int rc = 0;
+
+	ocpp_lock();
+	{
+		rc = push_message(NULL, type, data, datasize, 0,
+				put_msg_ready, 0, on_complete, ctx);
 	}
 	ocpp_unlock();
 
@@ -742,10 +1118,10 @@ int ocpp_push_request_force(ocpp_message_t type,
 	ocpp_lock();
 	{
 		if ((rc = push_message(NULL, type, data, datasize, 0,
-				put_msg_ready, 0, ctx)) != 0) {
+				put_msg_ready, 0, NULL, ctx)) != 0) {
 			remove_oldest();
 			rc = push_message(NULL, type, data, datasize, 0,
-					put_msg_ready, 0, ctx);
+					put_msg_ready, 0, NULL, ctx);
 		}
 	}
 	ocpp_unlock();
@@ -766,7 +1142,7 @@ int ocpp_push_request_defer(ocpp_message_t type, const void *data,
 	ocpp_lock();
 	{
 		rc = push_message(NULL, type, data, datasize,
-				time(NULL) + (time_t)timer_sec, f, 0, ctx);
+				ocpp_get_time() + (time_t)timer_sec, f, 0, NULL, ctx);
 	}
 	ocpp_unlock();
 
@@ -781,7 +1157,7 @@ int ocpp_push_response(const struct ocpp_message *req,
 	ocpp_lock();
 	{
 		rc = push_message(req->id, req->type, data, datasize,
-				0, put_msg_ready, err, ctx);
+				0, put_msg_ready, err, NULL, ctx);
 	}
 	ocpp_unlock();
 
@@ -811,10 +1187,11 @@ ocpp_get_message_by_id(const char id[OCPP_MESSAGE_ID_MAXLEN])
 
 int ocpp_step(void)
 {
-	const time_t now = time(NULL);
+	const time_t now = ocpp_get_time();
 
 	ocpp_lock();
 	{
+		complete_dropped_messages();
 		process_queued_messages(&now);
 		process_incoming_messages(&now);
 		process_periodic_messages(&now);
@@ -827,7 +1204,7 @@ int ocpp_step(void)
 
 int ocpp_init(ocpp_event_callback_t cb, void *cb_ctx)
 {
-	const time_t now = time(NULL);
+	const time_t now = ocpp_get_time();
 
 	memset(&m, 0, sizeof(m));
 
@@ -5,10 +5,39 @@
  */
 
 #include "ocpp/overrides.h"
+#include <errno.h>
 #include <time.h>
 #include <stdio.h>
 
+int __attribute__((weak)) ocpp_encode_frame(const struct ocpp_message *msg,
+		void *buf, size_t bufsize, size_t *len)
+{
+	(void)msg;
+	(void)buf;
+	(void)bufsize;
+	(void)len;
+	return -ENOTSUP;
+}
+
+int __attribute__((weak)) ocpp_send_frame(const struct ocpp_message *msg,
+		const void *frame, size_t len)
+{
+	(void)frame;
+	(void)len;
+	return ocpp_send(msg);
+}
+
 void __attribute__((weak)) ocpp_generate_message_id(void *buf, size_t bufsize)
 {
 	snprintf(buf, bufsize, "%lu", time(NULL));
 }
+
+bool __attribute__((weak)) ocpp_transport_keeps_alive(void)
+{
+	return false;
+}
+
+time_t __attribute__((weak)) ocpp_get_time(void)
+{
+	return time(NULL);
+}
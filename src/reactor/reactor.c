@@ -0,0 +1,361 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE				200112L
+#endif
+
+#include "ocpp/reactor.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t get_now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static uint32_t to_epoll(unsigned int events)
+{
+	uint32_t mask = 0;
+
+	if (events & OCPP_REACTOR_READABLE) {
+		mask |= EPOLLIN;
+	}
+	if (events & OCPP_REACTOR_WRITABLE) {
+		mask |= EPOLLOUT;
+	}
+
+	return mask;
+}
+
+static unsigned int from_epoll(uint32_t mask)
+{
+	unsigned int events = 0;
+
+	if (mask & EPOLLIN) {
+		events |= OCPP_REACTOR_READABLE;
+	}
+	if (mask & EPOLLOUT) {
+		events |= OCPP_REACTOR_WRITABLE;
+	}
+	if (mask & (EPOLLERR | EPOLLHUP)) {
+		events |= OCPP_REACTOR_HANGUP;
+	}
+
+	return events;
+}
+
+static void swap_timers(struct ocpp_reactor *reactor, size_t i, size_t j)
+{
+	struct ocpp_reactor_source *tmp = reactor->timers[i];
+
+	reactor->timers[i] = reactor->timers[j];
+	reactor->timers[j] = tmp;
+	reactor->timers[i]->timer_index = i;
+	reactor->timers[j]->timer_index = j;
+}
+
+static void sift_up(struct ocpp_reactor *reactor, size_t i)
+{
+	while (i > 0) {
+		const size_t parent = (i - 1) / 2;
+
+		if (reactor->timers[parent]->expiry <=
+				reactor->timers[i]->expiry) {
+			break;
+		}
+
+		swap_timers(reactor, i, parent);
+		i = parent;
+	}
+}
+
+static void sift_down(struct ocpp_reactor *reactor, size_t i)
+{
+	for (;;) {
+		const size_t left = i * 2 + 1;
+		const size_t right = left + 1;
+		size_t smallest = i;
+
+		if (left < reactor->nr_timers &&
+				reactor->timers[left]->expiry <
+				reactor->timers[smallest]->expiry) {
+			smallest = left;
+		}
+		if (right < reactor->nr_timers &&
+				reactor->timers[right]->expiry <
+				reactor->timers[smallest]->expiry) {
+			smallest = right;
+		}
+		if (smallest == i) {
+			break;
+		}
+
+		swap_timers(reactor, i, smallest);
+		i = smallest;
+	}
+}
+
+static void delete_timer(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src)
+{
+	const size_t i = src->timer_index;
+	const size_t last = --reactor->nr_timers;
+
+	src->expiry = 0;
+
+	if (i == last) {
+		return;
+	}
+
+	swap_timers(reactor, i, last);
+	sift_down(reactor, i);
+	sift_up(reactor, i);
+}
+
+/* Arms the timerfd for the earliest deadline, if not armed for it yet. */
+static int arm(struct ocpp_reactor *reactor)
+{
+	const uint64_t expiry = reactor->nr_timers?
+		reactor->timers[0]->expiry : 0;
+	struct itimerspec its = { 0, };
+
+	if (reactor->dispatching || expiry == reactor->armed) {
+		return 0;
+	}
+
+	/* all zero disarms it */
+	its.it_value.tv_sec = (time_t)(expiry / 1000);
+	its.it_value.tv_nsec = (long)(expiry % 1000) * 1000000;
+
+	if (timerfd_settime(reactor->timerfd, TFD_TIMER_ABSTIME, &its, NULL)) {
+		return -errno;
+	}
+
+	reactor->armed = expiry;
+
+	return 0;
+}
+
+static int expire_timers(struct ocpp_reactor *reactor)
+{
+	const uint64_t now = get_now_ms();
+	/* not the ones set again from the callbacks with no timeout */
+	size_t limit = reactor->nr_timers;
+	int n = 0;
+
+	while (limit-- > 0 && reactor->nr_timers > 0 &&
+			reactor->timers[0]->expiry <= now) {
+		struct ocpp_reactor_source *src = reactor->timers[0];
+
+		delete_timer(reactor, src);
+		(*src->callback)(src, OCPP_REACTOR_TIMEOUT, src->ctx);
+		n++;
+	}
+
+	return n;
+}
+
+static int dispatch(struct ocpp_reactor *reactor,
+		struct epoll_event *events, int nr_events)
+{
+	int n = 0;
+
+	reactor->batch = events;
+	reactor->batch_len = nr_events;
+
+	for (int i = 0; i < nr_events; i++) {
+		struct ocpp_reactor_source *src =
+			(struct ocpp_reactor_source *)events[i].data.ptr;
+
+		if (src == NULL) { /* removed in between */
+			continue;
+		}
+
+		if ((void *)src == (void *)reactor) {
+			uint64_t ticks;
+			/* to be armed again even for the same expiry */
+			reactor->armed = 0;
+			(void)read(reactor->timerfd, &ticks, sizeof(ticks));
+			continue;
+		}
+
+		(*src->callback)(src, from_epoll(events[i].events), src->ctx);
+		n++;
+	}
+
+	reactor->batch = NULL;
+	reactor->batch_len = 0;
+
+	return n;
+}
+
+int ocpp_reactor_run(struct ocpp_reactor *reactor, int timeout_ms)
+{
+	struct epoll_event events[OCPP_REACTOR_MAX_EVENTS];
+	const int nr_events = epoll_wait(reactor->epfd, events,
+			OCPP_REACTOR_MAX_EVENTS, timeout_ms);
+	int n;
+
+	if (nr_events < 0) {
+		return errno == EINTR? 0 : -errno;
+	}
+
+	reactor->dispatching = true;
+	n = dispatch(reactor, events, nr_events);
+	n += expire_timers(reactor);
+	reactor->dispatching = false;
+
+	int err = arm(reactor);
+
+	return err? err : n;
+}
+
+int ocpp_reactor_set_timeout(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src, int64_t timeout_ms)
+{
+	if (timeout_ms < 0) {
+		if (src->expiry) {
+			delete_timer(reactor, src);
+		}
+		return arm(reactor);
+	}
+
+	const uint64_t expiry = get_now_ms() + (uint64_t)timeout_ms;
+
+	if (src->expiry) {
+		src->expiry = expiry;
+		sift_down(reactor, src->timer_index);
+		sift_up(reactor, src->timer_index);
+	} else {
+		if (reactor->nr_timers >= reactor->max_timers) {
+			return -ENOBUFS;
+		}
+
+		src->expiry = expiry;
+		src->timer_index = reactor->nr_timers++;
+		reactor->timers[src->timer_index] = src;
+		sift_up(reactor, src->timer_index);
+	}
+
+	return arm(reactor);
+}
+
+int ocpp_reactor_set_events(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src, unsigned int events)
+{
+	struct epoll_event ev = {
+		.events = to_epoll(events),
+		.data.ptr = src,
+	};
+
+	src->events = events;
+
+	if (src->fd < 0) {
+		return 0;
+	}
+
+	if (src->polled) {
+		if (!epoll_ctl(reactor->epfd, EPOLL_CTL_MOD, src->fd, &ev)) {
+			return 0;
+		}
+		/* closed and the number given to another socket since */
+		if (errno != ENOENT) {
+			return -errno;
+		}
+	}
+
+	if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, src->fd, &ev) != 0) {
+		src->polled = false;
+		return -errno;
+	}
+
+	src->polled = true;
+
+	return 0;
+}
+
+int ocpp_reactor_add(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src, unsigned int events)
+{
+	src->polled = false;
+	src->expiry = 0;
+	src->timer_index = 0;
+
+	return ocpp_reactor_set_events(reactor, src, events);
+}
+
+void ocpp_reactor_remove(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src)
+{
+	struct epoll_event *events = (struct epoll_event *)reactor->batch;
+
+	if (src->polled) {
+		/* fails harmlessly if the fd is closed already */
+		(void)epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+		src->polled = false;
+	}
+
+	if (src->expiry) {
+		delete_timer(reactor, src);
+		(void)arm(reactor);
+	}
+
+	for (int i = 0; i < reactor->batch_len; i++) {
+		if (events[i].data.ptr == src) {
+			events[i].data.ptr = NULL;
+		}
+	}
+}
+
+int ocpp_reactor_get_fd(const struct ocpp_reactor *reactor)
+{
+	return reactor->epfd;
+}
+
+int ocpp_reactor_init(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source **timers, size_t max_timers)
+{
+	struct epoll_event ev = { .events = EPOLLIN, .data.ptr = reactor };
+	int err;
+
+	*reactor = (struct ocpp_reactor) {
+		.epfd = epoll_create1(EPOLL_CLOEXEC),
+		.timerfd = timerfd_create(CLOCK_MONOTONIC,
+				TFD_NONBLOCK | TFD_CLOEXEC),
+		.timers = timers,
+		.max_timers = max_timers,
+	};
+
+	if (reactor->epfd < 0 || reactor->timerfd < 0 ||
+			epoll_ctl(reactor->epfd, EPOLL_CTL_ADD,
+				reactor->timerfd, &ev) != 0) {
+		err = -errno;
+		ocpp_reactor_deinit(reactor);
+		return err;
+	}
+
+	return 0;
+}
+
+void ocpp_reactor_deinit(struct ocpp_reactor *reactor)
+{
+	if (reactor->timerfd >= 0) {
+		close(reactor->timerfd);
+	}
+	if (reactor->epfd >= 0) {
+		close(reactor->epfd);
+	}
+
+	reactor->epfd = reactor->timerfd = -1;
+	reactor->nr_timers = 0;
+}
@@ -0,0 +1,93 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/reactor.h"
+#include "ocpp/ocpp.h"
+#include "ocpp/ws.h"
+#include "ocpp/overrides.h"
+
+/* Binds the one engine and the one WebSocket connection of the process to
+ * a source. Both keep their state in statics, so there is no instance to
+ * tell apart here. */
+
+static void on_ready(struct ocpp_reactor_source *src, unsigned int events,
+		void *ctx)
+{
+	(void)events;
+
+	/* one message is taken per step */
+	do {
+		ocpp_step();
+	} while (ocpp_ws_has_message());
+
+	(void)ocpp_reactor_sync_ws((struct ocpp_reactor *)ctx, src);
+}
+
+static int64_t get_timeout_ms(void)
+{
+	time_t deadline;
+	time_t ping;
+	const bool engine = ocpp_get_next_deadline(&deadline) == 0;
+
+	/* the transport keeps the link alive on the same timer */
+	if (ocpp_ws_get_next_deadline(&ping) == 0 &&
+			(!engine || ping < deadline)) {
+		deadline = ping;
+	} else if (!engine) {
+		return -1;
+	}
+
+	const time_t now = ocpp_get_time();
+
+	return deadline > now? (int64_t)(deadline - now) * 1000 : 0;
+}
+
+int ocpp_reactor_sync_ws(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src)
+{
+	const int fd = ocpp_ws_get_fd();
+	unsigned int events = OCPP_REACTOR_READABLE;
+	int err;
+
+	/* what the steps sent, in one go if on io_uring */
+	if ((err = ocpp_ws_uring_submit()) != 0) {
+		return err;
+	}
+
+	if (ocpp_ws_wants_write()) {
+		events |= OCPP_REACTOR_WRITABLE;
+	}
+
+	if (fd != src->fd) {
+		ocpp_reactor_remove(reactor, src);
+		src->fd = fd;
+		err = ocpp_reactor_add(reactor, src, events);
+	} else {
+		err = ocpp_reactor_set_events(reactor, src, events);
+	}
+
+	if (err) {
+		return err;
+	}
+
+	return ocpp_reactor_set_timeout(reactor, src, get_timeout_ms());
+}
+
+int ocpp_reactor_attach_ws(struct ocpp_reactor *reactor,
+		struct ocpp_reactor_source *src)
+{
+	int err;
+
+	src->fd = -1;
+	src->callback = on_ready;
+	src->ctx = reactor;
+
+	if ((err = ocpp_reactor_add(reactor, src, 0)) != 0) {
+		return err;
+	}
+
+	return ocpp_reactor_sync_ws(reactor, src);
+}
@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/sim.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/* ocpp_step() handles one incoming and one outgoing message at a time, so a
+ * few steps may be needed at the same instant. This bounds them in case the
+ * engine keeps reporting work due without making progress. */
+#if !defined(OCPP_SIM_MAX_STEPS_PER_TICK)
+#define OCPP_SIM_MAX_STEPS_PER_TICK			64
+#endif
+
+struct delivery {
+	bool used;
+	time_t at;
+	uint32_t seq; /**< Keeps deliveries due at the same time in order. */
+	struct ocpp_message msg;
+};
+
+static struct {
+	time_t now;
+	bool link_up;
+	uint32_t msgid;
+	uint32_t seq;
+
+	ocpp_sim_csms_t csms;
+	void *csms_ctx;
+
+	struct delivery inbox[OCPP_SIM_INBOX_LEN];
+	struct ocpp_sim_stats stats;
+} sim;
+
+static struct delivery *find_next_delivery(void)
+{
+	struct delivery *next = NULL;
+
+	for (int i = 0; i < OCPP_SIM_INBOX_LEN; i++) {
+		struct delivery *p = &sim.inbox[i];
+
+		if (!p->used) {
+			continue;
+		}
+		if (next == NULL || p->at < next->at ||
+				(p->at == next->at && p->seq < next->seq)) {
+			next = p;
+		}
+	}
+
+	return next;
+}
+
+static int deliver(const struct ocpp_message *msg, uint32_t delay_sec)
+{
+	for (int i = 0; i < OCPP_SIM_INBOX_LEN; i++) {
+		struct delivery *p = &sim.inbox[i];
+
+		if (p->used) {
+			continue;
+		}
+
+		p->used = true;
+		p->at = sim.now + (time_t)delay_sec;
+		p->seq = sim.seq++;
+		memcpy(&p->msg, msg, sizeof(*msg));
+
+		return 0;
+	}
+
+	return -ENOBUFS;
+}
+
+static bool get_next_event(time_t *next)
+{
+	const struct delivery *delivery = find_next_delivery();
+	bool found = ocpp_get_next_deadline(next) == 0;
+
+	/* nothing is received while the link is down */
+	if (delivery && sim.link_up && (!found || delivery->at < *next)) {
+		*next = delivery->at;
+		found = true;
+	}
+
+	return found;
+}
+
+int ocpp_send(const struct ocpp_message *msg)
+{
+	if (!sim.link_up) {
+		sim.stats.send_failures++;
+		return -ENOTCONN;
+	}
+
+	sim.stats.sent++;
+
+	if (sim.csms == NULL) {
+		return 0;
+	}
+
+	struct ocpp_message resp = {
+		.role = OCPP_MSG_ROLE_CALLRESULT,
+		.type = msg->type,
+	};
+	uint32_t delay_sec = 0;
+
+	memcpy(resp.id, msg->id, sizeof(resp.id));
+
+	if ((*sim.csms)(msg, &resp, &delay_sec, sim.csms_ctx)) {
+		/* a full inbox loses the response, just like a congested
+		 * link would */
+		(void)deliver(&resp, delay_sec);
+	}
+
+	return 0;
+}
+
+int ocpp_recv(struct ocpp_message *msg)
+{
+	struct delivery *p = find_next_delivery();
+
+	if (!sim.link_up || p == NULL || p->at > sim.now) {
+		return -ENOMSG;
+	}
+
+	memcpy(msg, &p->msg, sizeof(*msg));
+	p->used = false;
+	sim.stats.received++;
+
+	return 0;
+}
+
+time_t ocpp_get_time(void)
+{
+	return sim.now;
+}
+
+void ocpp_generate_message_id(void *buf, size_t bufsize)
+{
+	snprintf((char *)buf, bufsize, "%lu", (unsigned long)++sim.msgid);
+}
+
+int ocpp_sim_inject(const struct ocpp_message *msg, uint32_t delay_sec)
+{
+	return deliver(msg, delay_sec);
+}
+
+void ocpp_sim_set_link(bool up)
+{
+	sim.link_up = up;
+}
+
+void ocpp_sim_run_until(time_t until)
+{
+	int steps_at_now = 0;
+
+	while (sim.now <= until) {
+		time_t next;
+
+		ocpp_step();
+		sim.stats.steps++;
+
+		if (!get_next_event(&next)) {
+			sim.now = until;
+			break;
+		}
+
+		if (next <= sim.now) {
+			if (++steps_at_now < OCPP_SIM_MAX_STEPS_PER_TICK) {
+				continue;
+			}
+			next = sim.now + 1;
+		}
+
+		steps_at_now = 0;
+
+		if (next > until) {
+			sim.now = until;
+			break;
+		}
+
+		sim.now = next;
+	}
+}
+
+void ocpp_sim_run(uint32_t sec)
+{
+	ocpp_sim_run_until(sim.now + (time_t)sec);
+}
+
+time_t ocpp_sim_now(void)
+{
+	return sim.now;
+}
+
+const struct ocpp_sim_stats *ocpp_sim_get_stats(void)
+{
+	return &sim.stats;
+}
+
+void ocpp_sim_init(time_t start, ocpp_sim_csms_t csms, void *ctx)
+{
+	memset(&sim, 0, sizeof(sim));
+
+	sim.now = start;
+	sim.link_up = true;
+	sim.csms = csms;
+	sim.csms_ctx = ctx;
+}
@@ -311,3 +311,47 @@ const char *ocpp_stringify_measurand(ocpp_measurand_t measurand)
 
 	return tbl[__builtin_ctz(measurand)];
 }
+
+static const char *get_call_error_str(ocpp_call_error_t code)
+{
+	const char *tbl[] = {
+		[OCPP_CALL_ERROR_NOT_IMPLEMENTED] = "NotImplemented",
+		[OCPP_CALL_ERROR_NOT_SUPPORTED] = "NotSupported",
+		[OCPP_CALL_ERROR_INTERNAL] = "InternalError",
+		[OCPP_CALL_ERROR_PROTOCOL] = "ProtocolError",
+		[OCPP_CALL_ERROR_SECURITY] = "SecurityError",
+		[OCPP_CALL_ERROR_FORMATION_VIOLATION] = "FormationViolation",
+		[OCPP_CALL_ERROR_PROPERTY_CONSTRAINT_VIOLATION] =
+			"PropertyConstraintViolation",
+		[OCPP_CALL_ERROR_OCCURRENCE_CONSTRAINT_VIOLATION] =
+			"OccurenceConstraintViolation",
+		[OCPP_CALL_ERROR_TYPE_CONSTRAINT_VIOLATION] =
+			"TypeConstraintViolation",
+		[OCPP_CALL_ERROR_GENERIC] = "GenericError",
+	};
+
+	if ((size_t)code >= ARRAY_COUNT(tbl)) {
+		return NULL;
+	}
+
+	return tbl[code];
+}
+
+const char *ocpp_stringify_call_error(ocpp_call_error_t code)
+{
+	const char *str = get_call_error_str(code);
+	return str? str : "GenericError";
+}
+
+ocpp_call_error_t ocpp_get_call_error_from_string(const char *str,
+		const size_t len)
+{
+	for (int i = 0; i <= OCPP_CALL_ERROR_GENERIC; i++) {
+		const char *p = get_call_error_str((ocpp_call_error_t)i);
+		if (strncmp(str, p, len) == 0 && p[len] == '\0') {
+			return (ocpp_call_error_t)i;
+		}
+	}
+
+	return OCPP_CALL_ERROR_GENERIC;
+}
@@ -0,0 +1,1452 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE				200112L
+#endif
+
+#include "ocpp/ws.h"
+#include "ocpp/ws_simd.h"
+#include "ocpp/ws_deflate.h"
+#include "ocpp/ws_uring.h"
+#include "ocpp/ws_tls.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL				0
+#endif
+
+#define WS_GUID				"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_LEN				24 /* base64 of 16 bytes */
+#define WS_ACCEPT_LEN				28 /* base64 of 20 bytes */
+/* 2 bytes, 8 of extended payload length and 4 of masking key */
+#define WS_MAX_HEADER_LEN			14
+#define WS_EXTENSION_MAXLEN			160
+/* subprotocols known to ocpp_get_codec() that an offer is checked against */
+#define WS_OFFER_MAX				4
+
+/* set on the last frame of a message, RFC 6455 5.2 */
+#define FRAME_FIN				0x80
+/* set on the first frame of a compressed message, RFC 7692 6 */
+#define FRAME_RSV1				0x40
+
+#define CLOSE_PROTOCOL_ERROR			1002
+#define CLOSE_NO_STATUS				1005
+#define CLOSE_ABNORMAL				1006
+#define CLOSE_INVALID_DATA			1007
+#define CLOSE_TOO_BIG				1009
+
+enum opcode {
+	OP_CONTINUATION				= 0x0,
+	OP_TEXT					= 0x1,
+	OP_BINARY				= 0x2,
+	OP_CLOSE				= 0x8,
+	OP_PING					= 0x9,
+	OP_PONG					= 0xA,
+};
+
+static struct {
+	int fd;
+	ocpp_ws_state_t state;
+	int err; /**< What brought the connection down. */
+	uint16_t close_code;
+	const struct ocpp_codec *codec;
+	/* The codecs of the subprotocols offered, the only ones the server
+	 * may answer with, RFC 6455 4.1. */
+	const struct ocpp_codec *offered[WS_OFFER_MAX];
+	unsigned int nr_offered;
+	char accept[WS_ACCEPT_LEN + 1];
+
+	time_t rx_at; /**< When the last frame came in. */
+	time_t ping_at;
+	bool ping_pending; /**< Nothing has come since the ping. */
+
+	struct {
+		uint8_t buf[OCPP_WS_RX_BUFSIZE];
+		size_t len;
+		/* The payload of the message being received is put together
+		 * at the front, followed by the frames not parsed yet. */
+		size_t msg_len;
+		uint8_t opcode; /**< Of the message being received, or 0. */
+		bool compressed;
+		bool ready; /**< The message is complete. */
+	} rx;
+
+	struct {
+		uint8_t buf[OCPP_WS_TX_BUFSIZE];
+		size_t len; /**< Taken, the gaps between frames included. */
+		/* The frames queued lie where they were encoded, each header
+		 * right before its payload, to go out in a single sendmsg(). */
+		struct {
+			size_t off;
+			size_t len;
+		} seg[OCPP_WS_TX_SEGMENTS];
+		unsigned int nseg;
+		unsigned int first; /**< Not sent in full yet. */
+		size_t sent; /**< Of the first one. */
+	} tx;
+
+	uint64_t payload[OCPP_WS_PAYLOAD_BUFSIZE / sizeof(uint64_t)];
+#if OCPP_WS_DEFLATE
+	/* A message on either way before compression or after decompression,
+	 * as sending and receiving never overlap. */
+	uint8_t plain[OCPP_WS_DEFLATE_BUFSIZE];
+#endif
+} ws = {
+	.fd = -1,
+	.err = -ENOTCONN,
+	.close_code = CLOSE_ABNORMAL,
+};
+
+static uint32_t rol32(uint32_t x, unsigned int n)
+{
+	return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(uint32_t h[5], const uint8_t *p)
+{
+	uint32_t w[80];
+	uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+	for (int i = 0; i < 16; i++) {
+		w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 |
+			(uint32_t)p[i * 4 + 2] << 8 | (uint32_t)p[i * 4 + 3];
+	}
+	for (int i = 16; i < 80; i++) {
+		w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	for (int i = 0; i < 80; i++) {
+		uint32_t f, k;
+
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+
+		const uint32_t t = rol32(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = rol32(b, 30);
+		b = a;
+		a = t;
+	}
+
+	h[0] += a;
+	h[1] += b;
+	h[2] += c;
+	h[3] += d;
+	h[4] += e;
+}
+
+static void sha1(const void *data, size_t len, uint8_t digest[20])
+{
+	uint32_t h[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+	};
+	const uint8_t *p = (const uint8_t *)data;
+	uint8_t block[64];
+	size_t i = 0;
+
+	for (; len - i >= sizeof(block); i += sizeof(block)) {
+		sha1_block(h, &p[i]);
+	}
+
+	const size_t rest = len - i;
+	memset(block, 0, sizeof(block));
+	memcpy(block, &p[i], rest);
+	block[rest] = 0x80;
+
+	if (rest >= sizeof(block) - 8) {
+		sha1_block(h, block);
+		memset(block, 0, sizeof(block));
+	}
+
+	const uint64_t bits = (uint64_t)len * 8;
+	for (int j = 0; j < 8; j++) {
+		block[63 - j] = (uint8_t)(bits >> (j * 8));
+	}
+	sha1_block(h, block);
+
+	for (int j = 0; j < 20; j++) {
+		digest[j] = (uint8_t)(h[j / 4] >> (24 - (j % 4) * 8));
+	}
+}
+
+static void base64(char *out, const uint8_t *data, size_t len)
+{
+	static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+		"abcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	for (size_t i = 0; i < len; i += 3) {
+		const uint32_t v = (uint32_t)data[i] << 16 |
+			(i + 1 < len? (uint32_t)data[i + 1] << 8 : 0) |
+			(i + 2 < len? (uint32_t)data[i + 2] : 0);
+
+		*out++ = table[v >> 18 & 0x3f];
+		*out++ = table[v >> 12 & 0x3f];
+		*out++ = i + 1 < len? table[v >> 6 & 0x3f] : '=';
+		*out++ = i + 2 < len? table[v & 0x3f] : '=';
+	}
+
+	*out = '\0';
+}
+
+static char to_lower(char c)
+{
+	return c >= 'A' && c <= 'Z'? (char)(c - 'A' + 'a') : c;
+}
+
+/* Compares s of len bytes with the null-terminated lowercase str. */
+static bool equals_nocase(const char *s, size_t len, const char *str)
+{
+	for (size_t i = 0; i < len; i++) {
+		if (str[i] == '\0' || to_lower(s[i]) != str[i]) {
+			return false;
+		}
+	}
+
+	return str[len] == '\0';
+}
+
+static bool contains_token(const char *s, size_t len, const char *token)
+{
+	const size_t n = strlen(token);
+
+	for (size_t i = 0; i + n <= len; i++) {
+		if (equals_nocase(&s[i], n, token)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool is_ows(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static void note_offer(const char *subprotocols)
+{
+	const char *p = subprotocols;
+
+	ws.nr_offered = 0;
+
+	while (*p) {
+		size_t n = strcspn(p, ",");
+		const char *next = p[n] == ','? &p[n + 1] : &p[n];
+
+		while (n && is_ows(*p)) {
+			p++;
+			n--;
+		}
+		while (n && is_ows(p[n - 1])) {
+			n--;
+		}
+
+		const struct ocpp_codec *codec = ocpp_get_codec(p, n);
+
+		if (codec && ws.nr_offered < WS_OFFER_MAX) {
+			ws.offered[ws.nr_offered++] = codec;
+		}
+
+		p = next;
+	}
+}
+
+static bool is_offered(const struct ocpp_codec *codec)
+{
+	for (unsigned int i = 0; i < ws.nr_offered; i++) {
+		if (ws.offered[i] == codec) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static size_t get_header_len(size_t len)
+{
+	return 2 + (len > 0xffff? 8 : len > 125? 2 : 0) + 4;
+}
+
+/* Client frames are always masked, RFC 6455 5.3. */
+static size_t put_header(uint8_t *p, uint8_t opcode, bool fin, size_t len)
+{
+	size_t i = 2;
+
+	/* with FRAME_RSV1 if compressed */
+	p[0] = (uint8_t)((fin? FRAME_FIN : 0) | opcode);
+
+	if (len <= 125) {
+		p[1] = (uint8_t)(0x80 | len);
+	} else if (len <= 0xffff) {
+		p[1] = 0x80 | 126;
+		p[i++] = (uint8_t)(len >> 8);
+		p[i++] = (uint8_t)len;
+	} else {
+		p[1] = 0x80 | 127;
+		for (int j = 7; j >= 0; j--) {
+			p[i++] = (uint8_t)((uint64_t)len >> (j * 8));
+		}
+	}
+
+	ocpp_ws_random(&p[i], 4);
+
+	return i + 4;
+}
+
+static bool has_pending_tx(void)
+{
+	return ws.tx.first < ws.tx.nseg;
+}
+
+static void reset_tx(void)
+{
+	ws.tx.len = ws.tx.sent = 0;
+	ws.tx.nseg = ws.tx.first = 0;
+}
+
+/* Moves what is left to send to the front, to make room behind it. */
+static void compact_tx(void)
+{
+	/* the ring writes from where the frames lie, so they stay until all
+	 * are out */
+	if ((ws.tx.first == 0 && ws.tx.sent == 0) || ocpp_ws_uring_active()) {
+		return;
+	}
+
+	const size_t start = ws.tx.seg[ws.tx.first].off + ws.tx.sent;
+
+	memmove(ws.tx.buf, &ws.tx.buf[start], ws.tx.len - start);
+	ws.tx.len -= start;
+
+	for (unsigned int i = ws.tx.first; i < ws.tx.nseg; i++) {
+		ws.tx.seg[i - ws.tx.first].off = ws.tx.seg[i].off - start;
+		ws.tx.seg[i - ws.tx.first].len = ws.tx.seg[i].len;
+	}
+
+	ws.tx.seg[0].off = 0;
+	ws.tx.seg[0].len -= ws.tx.sent;
+	ws.tx.nseg -= ws.tx.first;
+	ws.tx.first = 0;
+	ws.tx.sent = 0;
+}
+
+/* Appends to the last segment when right behind it. */
+static int queue_segment(size_t off, size_t len)
+{
+	if (ws.tx.nseg > 0 && ws.tx.seg[ws.tx.nseg - 1].off +
+			ws.tx.seg[ws.tx.nseg - 1].len == off) {
+		ws.tx.seg[ws.tx.nseg - 1].len += len;
+		return 0;
+	}
+
+	if (ws.tx.nseg >= OCPP_WS_TX_SEGMENTS) {
+		return -ENOBUFS;
+	}
+
+	ws.tx.seg[ws.tx.nseg].off = off;
+	ws.tx.seg[ws.tx.nseg].len = len;
+	ws.tx.nseg++;
+
+	return 0;
+}
+
+static int queue_frame(uint8_t opcode, const void *data, size_t len)
+{
+	compact_tx();
+
+	if (get_header_len(len) + len > sizeof(ws.tx.buf) - ws.tx.len) {
+		return -ENOBUFS;
+	}
+
+	uint8_t *p = &ws.tx.buf[ws.tx.len];
+	const size_t hlen = put_header(p, opcode, true, len);
+
+	if (len) {
+		memcpy(&p[hlen], data, len);
+	}
+	ocpp_ws_mask(&p[hlen], len, &p[hlen - 4]);
+
+	if (queue_segment(ws.tx.len, hlen + len) != 0) {
+		return -ENOBUFS;
+	}
+
+	ws.tx.len += hlen + len;
+
+	return 0;
+}
+
+static int queue_close(uint16_t code)
+{
+	const uint8_t status[2] = { (uint8_t)(code >> 8), (uint8_t)code };
+	return queue_frame(OP_CLOSE, status, sizeof(status));
+}
+
+static ssize_t send_some(const void *data, size_t len)
+{
+	if (ocpp_ws_tls_active()) {
+		const ssize_t n = ocpp_ws_tls_send(data, len);
+		if (n < 0) {
+			errno = (int)-n;
+			return -1;
+		}
+		return n;
+	}
+
+	return send(ws.fd, data, len, MSG_NOSIGNAL);
+}
+
+static ssize_t recv_some(void *buf, size_t bufsize)
+{
+	if (ocpp_ws_tls_active()) {
+		const ssize_t n = ocpp_ws_tls_recv(buf, bufsize);
+		if (n < 0) {
+			errno = (int)-n;
+			return -1;
+		}
+		return n;
+	}
+
+	if (ocpp_ws_uring_active()) {
+		const ssize_t n = ocpp_ws_uring_recv(buf, bufsize);
+		if (n < 0) {
+			errno = (int)-n;
+			return -1;
+		}
+		return n;
+	}
+
+	return recv(ws.fd, buf, bufsize, 0);
+}
+
+/* The frames queued in one go on the socket, or on the ring writing them
+ * from where they lie. TLS encrypts anyway, a segment at a time. */
+static ssize_t send_pending(void)
+{
+	struct iovec iov[OCPP_WS_TX_SEGMENTS];
+	struct msghdr msg = { .msg_iov = iov, };
+
+	if (ocpp_ws_tls_active()) {
+		return send_some(&ws.tx.buf[ws.tx.seg[ws.tx.first].off +
+				ws.tx.sent],
+				ws.tx.seg[ws.tx.first].len - ws.tx.sent);
+	}
+
+	for (unsigned int i = ws.tx.first; i < ws.tx.nseg; i++) {
+		iov[msg.msg_iovlen].iov_base = &ws.tx.buf[ws.tx.seg[i].off];
+		iov[msg.msg_iovlen].iov_len = ws.tx.seg[i].len;
+		msg.msg_iovlen++;
+	}
+
+	iov[0].iov_base = (uint8_t *)iov[0].iov_base + ws.tx.sent;
+	iov[0].iov_len -= ws.tx.sent;
+
+	if (ocpp_ws_uring_active()) {
+		const ssize_t n = ocpp_ws_uring_send(iov,
+				(unsigned int)msg.msg_iovlen);
+		if (n < 0) {
+			errno = (int)-n;
+			return -1;
+		}
+		return n;
+	}
+
+	return sendmsg(ws.fd, &msg, MSG_NOSIGNAL);
+}
+
+static void advance_tx(size_t n)
+{
+	while (n > 0) {
+		const size_t left = ws.tx.seg[ws.tx.first].len - ws.tx.sent;
+
+		if (n < left) {
+			ws.tx.sent += n;
+			break;
+		}
+
+		n -= left;
+		ws.tx.first++;
+		ws.tx.sent = 0;
+	}
+}
+
+static int flush(void)
+{
+	while (has_pending_tx()) {
+		const ssize_t n = send_pending();
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			return -errno;
+		}
+
+		advance_tx((size_t)n);
+	}
+
+	if (!has_pending_tx()) {
+		reset_tx();
+	}
+
+	return 0;
+}
+
+/* Reads what has arrived, returning -ECONNRESET at the end of the stream. */
+static int fill_rx(void)
+{
+	while (ws.rx.len < sizeof(ws.rx.buf)) {
+		const ssize_t n = recv_some(&ws.rx.buf[ws.rx.len],
+				sizeof(ws.rx.buf) - ws.rx.len);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			return -errno;
+		} else if (n == 0) {
+			return -ECONNRESET;
+		}
+
+		ws.rx.len += (size_t)n;
+	}
+
+	return 0;
+}
+
+static void drop(int err)
+{
+	ocpp_ws_uring_stop();
+	ocpp_ws_tls_stop();
+
+	if (ws.fd >= 0) {
+		close(ws.fd);
+	}
+
+	ws.fd = -1;
+	ws.state = OCPP_WS_CLOSED;
+	ws.err = err;
+	ws.codec = NULL;
+	ws.rx.len = ws.rx.msg_len = 0;
+	ws.rx.opcode = 0;
+	ws.rx.compressed = false;
+	ws.rx.ready = false;
+	reset_tx();
+
+	ocpp_ws_deflate_end();
+}
+
+/* Fails the connection, RFC 6455 7.1.7. */
+static int fail(uint16_t code, int err)
+{
+	if (queue_close(code) == 0) {
+		(void)flush();
+	}
+
+	drop(err);
+
+	return err;
+}
+
+/* Takes n bytes at pos out of the receive buffer. */
+static void consume(size_t pos, size_t n)
+{
+	memmove(&ws.rx.buf[pos], &ws.rx.buf[pos + n], ws.rx.len - pos - n);
+	ws.rx.len -= n;
+}
+
+static int handle_control(uint8_t opcode, const uint8_t *data, size_t len)
+{
+	switch (opcode) {
+	case OP_PING:
+		/* left unanswered when there is no room, as if it was lost */
+		(void)queue_frame(OP_PONG, data, len);
+		return 0;
+	case OP_PONG:
+		return 0;
+	case OP_CLOSE:
+		if (len == 1) {
+			return fail(CLOSE_PROTOCOL_ERROR, -EPROTO);
+		} else if (!ocpp_ws_utf8_valid(&data[2], len? len - 2 : 0)) {
+			return fail(CLOSE_INVALID_DATA, -EILSEQ);
+		}
+
+		ws.close_code = len? (uint16_t)(data[0] << 8 | data[1]) :
+			CLOSE_NO_STATUS;
+
+		if (ws.state == OCPP_WS_OPEN &&
+				queue_frame(OP_CLOSE, data, len? 2 : 0) == 0) {
+			(void)flush();
+		}
+
+		drop(-ENOTCONN);
+		return 0;
+	default:
+		return fail(CLOSE_PROTOCOL_ERROR, -EPROTO);
+	}
+}
+
+static int process_frames(void)
+{
+	bool received = false;
+
+	while (!ws.rx.ready && ws.state != OCPP_WS_CLOSED) {
+		const size_t pos = ws.rx.msg_len;
+		const size_t avail = ws.rx.len - pos;
+		const uint8_t *p = &ws.rx.buf[pos];
+		size_t hlen = 2;
+		uint64_t len;
+
+		if (avail < hlen) {
+			break;
+		}
+
+		const bool fin = (p[0] & FRAME_FIN) != 0;
+		const uint8_t rsv = p[0] & 0x70;
+		const uint8_t opcode = p[0] & 0x0f;
+
+		/* RSV1 only on the first frame of a compressed message, and
+		 * servers do not mask */
+		if ((rsv && (rsv != FRAME_RSV1 || !ocpp_ws_deflate_enabled() ||
+				(opcode & 0x8) || opcode == OP_CONTINUATION)) ||
+				(p[1] & 0x80)) {
+			return fail(CLOSE_PROTOCOL_ERROR, -EPROTO);
+		}
+
+		len = p[1] & 0x7f;
+		if (len == 126) {
+			if (avail < (hlen = 4)) {
+				break;
+			}
+			len = (uint64_t)p[2] << 8 | p[3];
+		} else if (len == 127) {
+			if (avail < (hlen = 10)) {
+				break;
+			}
+			len = 0;
+			for (int i = 2; i < 10; i++) {
+				len = len << 8 | p[i];
+			}
+		}
+
+		if (opcode & 0x8) {
+			if (!fin || len > 125) {
+				return fail(CLOSE_PROTOCOL_ERROR, -EPROTO);
+			}
+		} else if (opcode > OP_BINARY || (opcode == OP_CONTINUATION)
+				!= (ws.rx.opcode != 0)) {
+			return fail(CLOSE_PROTOCOL_ERROR, -EPROTO);
+		}
+
+		if (len > sizeof(ws.rx.buf) - pos - hlen) {
+			return fail(CLOSE_TOO_BIG, -EMSGSIZE);
+		}
+		if (avail < hlen + len) {
+			break;
+		}
+
+		received = true;
+
+		if (opcode & 0x8) {
+			int err = handle_control(opcode, &p[hlen], (size_t)len);
+			if (err || ws.state == OCPP_WS_CLOSED) {
+				return err;
+			}
+			consume(pos, hlen + (size_t)len);
+			continue;
+		}
+
+		consume(pos, hlen);
+		ws.rx.msg_len += (size_t)len;
+
+		if (opcode != OP_CONTINUATION) {
+			ws.rx.opcode = opcode;
+			ws.rx.compressed = rsv != 0;
+		}
+		if (fin) {
+			/* checked once decompressed otherwise */
+			if (ws.rx.opcode == OP_TEXT && !ws.rx.compressed &&
+					!ocpp_ws_utf8_valid(ws.rx.buf,
+						ws.rx.msg_len)) {
+				return fail(CLOSE_INVALID_DATA, -EILSEQ);
+			}
+			ws.rx.ready = true;
+		}
+	}
+
+	/* a pong or any other frame tells the server is there */
+	if (received) {
+		ws.rx_at = ocpp_get_time();
+		ws.ping_pending = false;
+	}
+
+	return 0;
+}
+
+/* Finds the end of the line at s, returning its length without CRLF. */
+static size_t get_line_len(const char *s, size_t len)
+{
+	for (size_t i = 0; i + 1 < len; i++) {
+		if (s[i] == '\r' && s[i + 1] == '\n') {
+			return i;
+		}
+	}
+
+	return len;
+}
+
+static int process_handshake(void)
+{
+	const char *s = (const char *)ws.rx.buf;
+	size_t end = 0;
+	bool upgrade = false, connection = false, accepted = false;
+
+	for (size_t i = 0; i + 3 < ws.rx.len; i++) {
+		if (memcmp(&s[i], "\r\n\r\n", 4) == 0) {
+			end = i + 4;
+			break;
+		}
+	}
+
+	if (end == 0) {
+		return ws.rx.len == sizeof(ws.rx.buf)? -EPROTO : 0;
+	}
+
+	if (end < 12 || memcmp(s, "HTTP/1.1 ", 9) != 0) {
+		return -EPROTO;
+	}
+	if (memcmp(&s[9], "101", 3) != 0) {
+		return -ECONNREFUSED;
+	}
+
+	for (size_t i = get_line_len(s, end) + 2; i < end - 2; ) {
+		const size_t n = get_line_len(&s[i], end - i);
+		const char *line = &s[i];
+		const char *colon = memchr(line, ':', n);
+
+		i += n + 2;
+
+		if (colon == NULL) {
+			return -EPROTO;
+		}
+
+		const size_t name_len = (size_t)(colon - line);
+		const char *value = colon + 1;
+		size_t value_len = n - name_len - 1;
+
+		while (value_len && (*value == ' ' || *value == '\t')) {
+			value++;
+			value_len--;
+		}
+		while (value_len && (value[value_len - 1] == ' ' ||
+					value[value_len - 1] == '\t')) {
+			value_len--;
+		}
+
+		if (equals_nocase(line, name_len, "upgrade")) {
+			upgrade = equals_nocase(value, value_len, "websocket");
+		} else if (equals_nocase(line, name_len, "connection")) {
+			connection = contains_token(value, value_len,
+					"upgrade");
+		} else if (equals_nocase(line, name_len,
+					"sec-websocket-accept")) {
+			accepted = value_len == WS_ACCEPT_LEN &&
+				memcmp(value, ws.accept, WS_ACCEPT_LEN) == 0;
+		} else if (equals_nocase(line, name_len,
+					"sec-websocket-protocol")) {
+			ws.codec = ocpp_get_codec(value, value_len);
+		} else if (equals_nocase(line, name_len,
+					"sec-websocket-extensions")) {
+			int err = ocpp_ws_deflate_accept(value, value_len);
+			if (err) {
+				return err;
+			}
+		}
+	}
+
+	if (!upgrade || !connection || !accepted || ws.codec == NULL ||
+			!is_offered(ws.codec)) {
+		return -EPROTO;
+	}
+
+	consume(0, end);
+	ws.state = OCPP_WS_OPEN;
+	ws.rx_at = ocpp_get_time();
+	ws.ping_pending = false;
+
+	return 0;
+}
+
+static uint32_t get_ping_interval(void)
+{
+	uint32_t interval = 0;
+
+	ocpp_get_configuration("WebSocketPingInterval",
+			&interval, sizeof(interval), NULL);
+
+	return interval;
+}
+
+/* Pings the server once nothing has come for WebSocketPingInterval, giving
+ * up on it when nothing comes for another. */
+static int keep_alive(void)
+{
+	const uint32_t interval = get_ping_interval();
+
+	if (interval == 0 || ws.state != OCPP_WS_OPEN) {
+		return 0;
+	}
+
+	const time_t now = ocpp_get_time();
+
+	if (ws.ping_pending) {
+		return now - ws.ping_at >= (time_t)interval? -ETIMEDOUT : 0;
+	}
+
+	if (now - ws.rx_at >= (time_t)interval &&
+			queue_frame(OP_PING, NULL, 0) == 0) {
+		ws.ping_at = now;
+		ws.ping_pending = true;
+	}
+
+	return 0;
+}
+
+/* Hands the socket over to io_uring once connected, if it can be set up.
+ * TLS stays on the socket. */
+static void start_io(void)
+{
+	if (!ocpp_ws_tls_active()) {
+		(void)ocpp_ws_uring_start(ws.fd, ws.tx.buf,
+				sizeof(ws.tx.buf));
+	}
+}
+
+static int check_connected(void)
+{
+	struct pollfd pfd = { .fd = ws.fd, .events = POLLOUT, };
+	int err = 0;
+	socklen_t len = sizeof(err);
+
+	if (poll(&pfd, 1, 0) <= 0) {
+		return 0;
+	}
+
+	if (getsockopt(ws.fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) {
+		return -errno;
+	}
+	if (err) {
+		return -err;
+	}
+
+	ws.state = OCPP_WS_HANDSHAKING;
+	start_io();
+
+	return 0;
+}
+
+static int connect_to(const char *host, uint16_t port)
+{
+	struct addrinfo hints = {
+		.ai_family = AF_UNSPEC,
+		.ai_socktype = SOCK_STREAM,
+	};
+	struct addrinfo *res;
+	char service[6];
+	int err = -EHOSTUNREACH;
+
+	snprintf(service, sizeof(service), "%u", (unsigned int)port);
+
+	if (getaddrinfo(host, service, &hints, &res) != 0) {
+		return -EHOSTUNREACH;
+	}
+
+	for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+		const int fd = socket(ai->ai_family, ai->ai_socktype,
+				ai->ai_protocol);
+
+		if (fd < 0) {
+			err = -errno;
+			continue;
+		}
+
+		const int flags = fcntl(fd, F_GETFL, 0);
+		if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+			err = -errno;
+			close(fd);
+			continue;
+		}
+
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+			ws.state = OCPP_WS_HANDSHAKING;
+		} else if (errno == EINPROGRESS) {
+			ws.state = OCPP_WS_CONNECTING;
+		} else {
+			err = -errno;
+			close(fd);
+			continue;
+		}
+
+		ws.fd = fd;
+		err = 0;
+		break;
+	}
+
+	freeaddrinfo(res);
+
+	return err;
+}
+
+static int put_request(const struct ocpp_ws_param *param)
+{
+	uint8_t nonce[16];
+	uint8_t digest[20];
+	char key[WS_KEY_LEN + sizeof(WS_GUID)];
+	char ext[WS_EXTENSION_MAXLEN] = "";
+	int err;
+
+	ocpp_ws_random(nonce, sizeof(nonce));
+	base64(key, nonce, sizeof(nonce));
+
+	memcpy(&key[WS_KEY_LEN], WS_GUID, sizeof(WS_GUID));
+	sha1(key, WS_KEY_LEN + sizeof(WS_GUID) - 1, digest);
+	base64(ws.accept, digest, sizeof(digest));
+	key[WS_KEY_LEN] = '\0';
+
+	/* not offered when built without it */
+	if (param->deflate && (err = ocpp_ws_deflate_offer(ext, sizeof(ext),
+			param->deflate)) != 0 && err != -ENOTSUP) {
+		return err;
+	}
+
+	const char *subprotocols = param->subprotocols?
+		param->subprotocols : OCPP_CODEC_JSON_SUBPROTOCOL;
+
+	note_offer(subprotocols);
+
+	const int len = snprintf((char *)ws.tx.buf, sizeof(ws.tx.buf),
+			"GET %s HTTP/1.1\r\n"
+			"Host: %s:%u\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Key: %s\r\n"
+			"Sec-WebSocket-Version: 13\r\n"
+			"Sec-WebSocket-Protocol: %s\r\n"
+			"%s%s%s"
+			"\r\n",
+			param->path? param->path : "/",
+			param->host, (unsigned int)param->port, key,
+			subprotocols,
+			ext[0]? "Sec-WebSocket-Extensions: " : "", ext,
+			ext[0]? "\r\n" : "");
+
+	if (len < 0 || (size_t)len >= sizeof(ws.tx.buf)) {
+		return -ENOBUFS;
+	}
+
+	ws.tx.len = (size_t)len;
+
+	return queue_segment(0, ws.tx.len);
+}
+
+int ocpp_ws_open(const struct ocpp_ws_param *param)
+{
+	int err;
+
+	if (param == NULL || param->host == NULL || param->port == 0) {
+		return -EINVAL;
+	}
+
+	drop(-ENOTCONN);
+	ws.close_code = CLOSE_ABNORMAL;
+
+	if ((err = put_request(param)) != 0 ||
+			(err = connect_to(param->host, param->port)) != 0 ||
+			(param->tls && (err = ocpp_ws_tls_start(ws.fd,
+				param->host, param->port, param->tls)) != 0)) {
+		drop(err);
+		return err;
+	}
+
+	if (ws.state == OCPP_WS_HANDSHAKING) {
+		start_io();
+	}
+
+	return 0;
+}
+
+int ocpp_ws_poll(void)
+{
+	int err = 0;
+	int rx = 0;
+
+	if (ws.state == OCPP_WS_CLOSED) {
+		return ws.err;
+	}
+
+	if (ws.state == OCPP_WS_CONNECTING &&
+			((err = check_connected()) != 0 ||
+			ws.state == OCPP_WS_CONNECTING)) {
+		goto out;
+	}
+
+	if ((err = flush()) != 0) {
+		goto out;
+	}
+
+	/* the data before the end of the stream is processed first, as the
+	 * close frame of the peer comes right before it */
+	rx = fill_rx();
+
+	if (ws.state == OCPP_WS_HANDSHAKING &&
+			(err = process_handshake()) != 0) {
+		goto out;
+	}
+
+	if (ws.state == OCPP_WS_OPEN || ws.state == OCPP_WS_CLOSING) {
+		if ((err = process_frames()) != 0) {
+			return err;
+		}
+	}
+
+	if (ws.state != OCPP_WS_CLOSED) {
+		err = rx < 0? rx : keep_alive();
+		if (!err) {
+			err = flush();
+		}
+	}
+	if (!err) {
+		err = ocpp_ws_uring_submit();
+	}
+out:
+	if (err) {
+		drop(err);
+	}
+
+	return ws.state == OCPP_WS_CLOSED? ws.err : 0;
+}
+
+void ocpp_ws_close(uint16_t code)
+{
+	if (ws.state == OCPP_WS_OPEN && queue_close(code) == 0) {
+		ws.state = OCPP_WS_CLOSING;
+		(void)flush();
+		(void)ocpp_ws_uring_submit();
+	} else if (ws.state != OCPP_WS_CLOSED) {
+		drop(-ENOTCONN);
+	}
+}
+
+ocpp_ws_state_t ocpp_ws_get_state(void)
+{
+	return ws.state;
+}
+
+int ocpp_ws_get_fd(void)
+{
+	return ocpp_ws_uring_active()? ocpp_ws_uring_get_fd() : ws.fd;
+}
+
+bool ocpp_ws_wants_write(void)
+{
+	/* the ring waits for the socket on its own */
+	return ws.state == OCPP_WS_CONNECTING || ocpp_ws_tls_wants_write() ||
+		(has_pending_tx() && !ocpp_ws_uring_active());
+}
+
+int ocpp_ws_get_next_deadline(time_t *deadline)
+{
+	const uint32_t interval = get_ping_interval();
+
+	if (interval == 0 || ws.state != OCPP_WS_OPEN) {
+		return -ENOENT;
+	}
+
+	if (deadline) {
+		*deadline = (ws.ping_pending? ws.ping_at : ws.rx_at) +
+			(time_t)interval;
+	}
+
+	return 0;
+}
+
+bool ocpp_ws_has_message(void)
+{
+	return ws.rx.ready;
+}
+
+uint16_t ocpp_ws_get_close_code(void)
+{
+	return ws.close_code;
+}
+
+const struct ocpp_codec *ocpp_ws_get_codec(void)
+{
+	return ws.state == OCPP_WS_OPEN || ws.state == OCPP_WS_CLOSING?
+		ws.codec : NULL;
+}
+
+/* Encodes msg with the codec agreed, compressed if agreed too. */
+static int encode(const struct ocpp_message *msg, void *buf, size_t bufsize,
+		size_t *len, uint8_t *opcode)
+{
+	*opcode = ws.codec->binary? OP_BINARY : OP_TEXT;
+
+#if OCPP_WS_DEFLATE
+	if (ocpp_ws_deflate_enabled()) {
+		size_t plain_len;
+		int err = (*ws.codec->encode)(msg, ws.plain, sizeof(ws.plain),
+				&plain_len);
+
+		if (err) {
+			return err;
+		}
+
+		*opcode |= FRAME_RSV1;
+
+		return ocpp_ws_deflate_compress(buf, bufsize,
+				ws.plain, plain_len, len);
+	}
+#endif
+
+	return (*ws.codec->encode)(msg, buf, bufsize, len);
+}
+
+#if OCPP_WS_DEFLATE
+/* Decompresses the message received into ws.plain. */
+static int decompress(const uint8_t **data, size_t *len)
+{
+	int err = ocpp_ws_deflate_decompress(ws.plain, sizeof(ws.plain),
+			ws.rx.buf, ws.rx.msg_len, len);
+
+	if (err == -EMSGSIZE) {
+		return fail(CLOSE_TOO_BIG, err);
+	} else if (err) {
+		return fail(CLOSE_INVALID_DATA, err);
+	}
+
+	*data = ws.plain;
+
+	return 0;
+}
+#endif
+
+/* Waits for the socket to take more, or the ring to have written out. */
+static int wait_writable(void)
+{
+	struct pollfd pfd = { .fd = ws.fd, .events = POLLOUT, };
+	int err;
+
+	if (ocpp_ws_uring_active()) {
+		if ((err = ocpp_ws_uring_submit()) != 0) {
+			return err;
+		}
+
+		pfd.fd = ocpp_ws_uring_get_fd();
+		pfd.events = POLLIN;
+	}
+
+	const int n = poll(&pfd, 1, OCPP_WS_TX_TIMEOUT_MS);
+
+	if (n < 0) {
+		return errno == EINTR? 0 : -errno;
+	}
+
+	return n == 0? -ETIMEDOUT : 0;
+}
+
+/* Sends a message larger than the buffer in fragments, RFC 6455 5.4, each
+ * encoded into the whole buffer once the one before is out. The payload is
+ * the caller's and not kept past the call, so the fragments all go out
+ * within it, waiting on the socket in between if need be. */
+static int send_fragments(const struct ocpp_message *msg, uint8_t opcode)
+{
+	struct ocpp_encoder enc;
+	uint8_t *p = ws.tx.buf;
+	size_t len;
+	int err;
+	int rc;
+
+	ocpp_encoder_init(&enc, ws.codec, msg);
+
+	do {
+		while (has_pending_tx()) {
+			if ((err = wait_writable()) != 0 ||
+					(err = flush()) != 0) {
+				goto out_drop;
+			}
+		}
+
+		err = ocpp_encoder_next(&enc, &p[WS_MAX_HEADER_LEN],
+				sizeof(ws.tx.buf) - WS_MAX_HEADER_LEN, &len);
+
+		if (err != 0 && err != -EAGAIN) {
+			if (opcode == OP_CONTINUATION) {
+				goto out_drop; /* no way to end it */
+			}
+			return err;
+		}
+
+		const size_t hlen = get_header_len(len);
+		const size_t off = WS_MAX_HEADER_LEN - hlen;
+
+		put_header(&p[off], opcode, err == 0, len);
+		ocpp_ws_mask(&p[WS_MAX_HEADER_LEN], len,
+				&p[WS_MAX_HEADER_LEN - 4]);
+
+		(void)queue_segment(off, hlen + len);
+		ws.tx.len = WS_MAX_HEADER_LEN + len;
+		opcode = OP_CONTINUATION;
+
+		if ((rc = flush()) != 0) {
+			err = rc;
+			goto out_drop;
+		}
+	} while (err == -EAGAIN);
+
+	return 0;
+
+out_drop:
+	drop(err);
+	return err;
+}
+
+/* Makes room for a frame to take a segment of its own at the end of the
+ * queue. The payload goes past the longest header, the actual one put right
+ * before it in place by queue_message(), leaving a gap in front not sent. */
+static int get_room(uint8_t **payload, size_t *room)
+{
+	int err;
+
+	if (ws.state != OCPP_WS_OPEN) {
+		return -ENOTCONN;
+	}
+
+	if ((err = flush()) != 0) {
+		drop(err);
+		return err;
+	}
+
+	compact_tx();
+
+	const size_t avail = sizeof(ws.tx.buf) - ws.tx.len;
+
+	if (avail <= WS_MAX_HEADER_LEN ||
+			ws.tx.nseg >= OCPP_WS_TX_SEGMENTS) {
+		return -ENOBUFS;
+	}
+
+	*payload = &ws.tx.buf[ws.tx.len + WS_MAX_HEADER_LEN];
+	*room = avail - WS_MAX_HEADER_LEN;
+
+	return 0;
+}
+
+static int queue_message(uint8_t opcode, size_t len)
+{
+	uint8_t *p = &ws.tx.buf[ws.tx.len];
+	const size_t hlen = get_header_len(len);
+	const size_t off = WS_MAX_HEADER_LEN - hlen;
+	int err;
+
+	put_header(&p[off], opcode, true, len);
+	ocpp_ws_mask(&p[WS_MAX_HEADER_LEN], len, &p[WS_MAX_HEADER_LEN - 4]);
+
+	(void)queue_segment(ws.tx.len + off, hlen + len);
+	ws.tx.len += WS_MAX_HEADER_LEN + len;
+
+	if ((err = flush()) != 0) {
+		drop(err);
+		return err;
+	}
+
+	return 0;
+}
+
+int ocpp_send(const struct ocpp_message *msg)
+{
+	uint8_t *payload;
+	uint8_t opcode;
+	size_t room;
+	size_t len;
+	int err;
+
+	if ((err = get_room(&payload, &room)) != 0) {
+		return err;
+	}
+
+	err = encode(msg, payload, room, &len, &opcode);
+
+	/* too large even for the buffer empty, but for a compressed one
+	 * limited to the buffer still */
+	if (err == -ENOBUFS && !ocpp_ws_deflate_enabled() &&
+			len > sizeof(ws.tx.buf) - WS_MAX_HEADER_LEN) {
+		return send_fragments(msg, opcode);
+	} else if (err) {
+		return err;
+	}
+
+	return queue_message(opcode, len);
+}
+
+/* The payload is kept unmasked in the message slot, behind the codec it is
+ * encoded with, as a reconnection may agree on another. A compressed one is
+ * not kept, as it depends on the messages compressed before. */
+int ocpp_encode_frame(const struct ocpp_message *msg,
+		void *buf, size_t bufsize, size_t *len)
+{
+	const size_t hlen = sizeof(ws.codec);
+	int err;
+
+	if (ws.state != OCPP_WS_OPEN) {
+		return -ENOTCONN;
+	} else if (ocpp_ws_deflate_enabled()) {
+		return -ENOTSUP;
+	} else if (bufsize <= hlen) {
+		return -ENOBUFS;
+	}
+
+	if ((err = (*ws.codec->encode)(msg, (uint8_t *)buf + hlen,
+			bufsize - hlen, len)) != 0) {
+		return err;
+	}
+
+	memcpy(buf, &ws.codec, hlen);
+	*len += hlen;
+
+	return 0;
+}
+
+/* Every attempt copies the payload into the queue to be masked there with
+ * a key of its own. */
+int ocpp_send_frame(const struct ocpp_message *msg,
+		const void *frame, size_t len)
+{
+	const size_t hlen = sizeof(ws.codec);
+	const struct ocpp_codec *codec;
+	uint8_t *payload;
+	size_t room;
+	int err;
+
+	if ((err = get_room(&payload, &room)) != 0) {
+		return err;
+	}
+
+	memcpy(&codec, frame, hlen);
+
+	if (codec != ws.codec || ocpp_ws_deflate_enabled() ||
+			len - hlen > sizeof(ws.tx.buf) - WS_MAX_HEADER_LEN) {
+		return ocpp_send(msg);
+	} else if (len - hlen > room) {
+		return -ENOBUFS;
+	}
+
+	memcpy(payload, (const uint8_t *)frame + hlen, len - hlen);
+
+	return queue_message(codec->binary? OP_BINARY : OP_TEXT, len - hlen);
+}
+
+int ocpp_recv(struct ocpp_message *msg)
+{
+	const uint8_t *data = ws.rx.buf;
+	size_t len;
+	int err;
+
+	if (ocpp_ws_poll() != 0) {
+		return -ENOTCONN;
+	}
+	if (!ws.rx.ready) {
+		return -ENOMSG;
+	}
+
+	len = ws.rx.msg_len;
+
+#if OCPP_WS_DEFLATE
+	if (ws.rx.compressed) {
+		if ((err = decompress(&data, &len)) != 0) {
+			return err;
+		}
+		if (ws.rx.opcode == OP_TEXT &&
+				!ocpp_ws_utf8_valid(data, len)) {
+			return fail(CLOSE_INVALID_DATA, -EILSEQ);
+		}
+	}
+#endif
+
+	err = (*ws.codec->decode)(msg, ws.payload, sizeof(ws.payload),
+			data, len);
+
+	consume(0, ws.rx.msg_len);
+	ws.rx.msg_len = 0;
+	ws.rx.opcode = 0;
+	ws.rx.compressed = false;
+	ws.rx.ready = false;
+
+	/* the next message may have come in along, to be told of by
+	 * ocpp_ws_has_message() without waiting for the socket */
+	if (ws.state == OCPP_WS_OPEN || ws.state == OCPP_WS_CLOSING) {
+		/* taking from the ring costs no syscall, and neither the
+		 * ring nor TLS wakes up again for what was left there */
+		if (ocpp_ws_uring_active() || ocpp_ws_tls_has_pending()) {
+			(void)fill_rx();
+		}
+		(void)process_frames();
+	}
+
+	return err;
+}
+
+/* keep_alive() pings the server on WebSocketPingInterval */
+bool ocpp_transport_keeps_alive(void)
+{
+	return true;
+}
+
+void __attribute__((weak)) ocpp_ws_random(void *buf, size_t len)
+{
+	static uint32_t x;
+	uint8_t *p = (uint8_t *)buf;
+
+	if (x == 0) {
+		x = ((uint32_t)time(NULL) ^ (uint32_t)(uintptr_t)&x) | 1;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		p[i] = (uint8_t)(x >> 24);
+	}
+}
@@ -0,0 +1,529 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/ws_deflate.h"
+
+#include <errno.h>
+
+#if OCPP_WS_DEFLATE
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ZLIB_CONST
+#include <zlib.h>
+
+#define EXTENSION_NAME				"permessage-deflate"
+#define MAX_WINDOW_BITS				15
+/* zlib takes no 256-byte window to compress with */
+#define MIN_CLIENT_WINDOW_BITS			9
+#define MIN_SERVER_WINDOW_BITS			8
+
+enum param {
+	SERVER_NO_CONTEXT_TAKEOVER,
+	CLIENT_NO_CONTEXT_TAKEOVER,
+	SERVER_MAX_WINDOW_BITS,
+	CLIENT_MAX_WINDOW_BITS,
+	PARAM_MAX,
+};
+
+static const char *param_names[PARAM_MAX] = {
+	[SERVER_NO_CONTEXT_TAKEOVER] = "server_no_context_takeover",
+	[CLIENT_NO_CONTEXT_TAKEOVER] = "client_no_context_takeover",
+	[SERVER_MAX_WINDOW_BITS] = "server_max_window_bits",
+	[CLIENT_MAX_WINDOW_BITS] = "client_max_window_bits",
+};
+
+static struct {
+	struct ocpp_ws_deflate_param offer;
+	bool offered;
+	bool enabled;
+
+	uint8_t client_bits;
+	uint8_t server_bits;
+	bool client_no_context_takeover;
+	bool server_no_context_takeover;
+
+	z_stream tx;
+	z_stream rx;
+
+#if OCPP_WS_DEFLATE_HEAPSIZE > 0
+	size_t heap_used;
+	uint64_t heap[(OCPP_WS_DEFLATE_HEAPSIZE + 7) / 8];
+#endif
+} ext;
+
+#if OCPP_WS_DEFLATE_HEAPSIZE > 0
+/* deflate_state and inflate_state, rounded up */
+#define STREAM_OVERHEAD				8192
+
+/* Freed all at once in ocpp_ws_deflate_end(), as zlib allocates only when
+ * a stream is set up. */
+static voidpf alloc_heap(voidpf opaque, uInt items, uInt size)
+{
+	const size_t n = ((size_t)items * size + 7) & ~(size_t)7;
+	(void)opaque;
+
+	if (n > sizeof(ext.heap) - ext.heap_used) {
+		return Z_NULL;
+	}
+
+	voidpf p = (uint8_t *)ext.heap + ext.heap_used;
+	ext.heap_used += n;
+
+	return p;
+}
+
+static void free_heap(voidpf opaque, voidpf address)
+{
+	(void)opaque;
+	(void)address;
+}
+
+static size_t get_heap_needed(unsigned int client_bits,
+		unsigned int server_bits)
+{
+	return STREAM_OVERHEAD * 2 + ((size_t)1 << (client_bits + 2)) +
+		((size_t)1 << (OCPP_WS_DEFLATE_MEM_LEVEL + 9)) +
+		((size_t)1 << server_bits);
+}
+#endif
+
+static uint8_t get_bits(uint8_t bits, uint8_t min)
+{
+	if (bits == 0 || bits > MAX_WINDOW_BITS) {
+		return MAX_WINDOW_BITS;
+	}
+	return bits < min? min : bits;
+}
+
+/* Narrows the windows until they fit in the heap, the one of compression
+ * first as it takes four times the memory. */
+static int fit_windows(uint8_t *client_bits, uint8_t *server_bits)
+{
+#if OCPP_WS_DEFLATE_HEAPSIZE > 0
+	while (get_heap_needed(*client_bits, *server_bits) >
+			sizeof(ext.heap)) {
+		if (*client_bits > MIN_CLIENT_WINDOW_BITS) {
+			(*client_bits)--;
+		} else if (*server_bits > MIN_SERVER_WINDOW_BITS) {
+			(*server_bits)--;
+		} else {
+			return -ENOMEM;
+		}
+	}
+#else
+	(void)client_bits;
+	(void)server_bits;
+#endif
+	return 0;
+}
+
+static bool is_ows(char c)
+{
+	return c == ' ' || c == '\t';
+}
+
+static bool is_delimiter(char c)
+{
+	return c == ';' || c == ',' || c == '=' || c == '"' || is_ows(c);
+}
+
+static const char *skip_ows(const char *p, const char *end)
+{
+	while (p < end && is_ows(*p)) {
+		p++;
+	}
+	return p;
+}
+
+static size_t get_token_len(const char *p, const char *end)
+{
+	size_t n = 0;
+
+	while (&p[n] < end && !is_delimiter(p[n])) {
+		n++;
+	}
+
+	return n;
+}
+
+static bool equals_nocase(const char *s, size_t len, const char *lower)
+{
+	for (size_t i = 0; i < len; i++) {
+		const char c = (s[i] >= 'A' && s[i] <= 'Z')?
+			(char)(s[i] - 'A' + 'a') : s[i];
+		if (lower[i] == '\0' || lower[i] != c) {
+			return false;
+		}
+	}
+
+	return lower[len] == '\0';
+}
+
+static int get_param(const char *name, size_t len)
+{
+	for (int i = 0; i < PARAM_MAX; i++) {
+		if (equals_nocase(name, len, param_names[i])) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/* 8 to 15, with no leading zero, RFC 7692 7.1.2.1. */
+static int parse_bits(const char *s, size_t len)
+{
+	if (s == NULL || len == 0 || len > 2 || s[0] < '1' || s[0] > '9') {
+		return -1;
+	}
+
+	int bits = s[0] - '0';
+
+	if (len == 2) {
+		if (s[1] < '0' || s[1] > '9') {
+			return -1;
+		}
+		bits = bits * 10 + s[1] - '0';
+	}
+
+	return bits < MIN_SERVER_WINDOW_BITS || bits > MAX_WINDOW_BITS?
+		-1 : bits;
+}
+
+/* Returns the length so far, or -1 once out of room. */
+static int __attribute__((format(printf, 4, 5)))
+append(char *buf, size_t bufsize, int len, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (len < 0 || (size_t)len >= bufsize) {
+		return -1;
+	}
+
+	va_start(ap, fmt);
+	const int n = vsnprintf(&buf[len], bufsize - (size_t)len, fmt, ap);
+	va_end(ap);
+
+	return n < 0? -1 : len + n;
+}
+
+static int init_streams(void)
+{
+	memset(&ext.tx, 0, sizeof(ext.tx));
+	memset(&ext.rx, 0, sizeof(ext.rx));
+#if OCPP_WS_DEFLATE_HEAPSIZE > 0
+	ext.tx.zalloc = ext.rx.zalloc = alloc_heap;
+	ext.tx.zfree = ext.rx.zfree = free_heap;
+#endif
+
+	/* negative bits for raw deflate, with no zlib header */
+	if (deflateInit2(&ext.tx, OCPP_WS_DEFLATE_LEVEL, Z_DEFLATED,
+			-(int)ext.client_bits, OCPP_WS_DEFLATE_MEM_LEVEL,
+			Z_DEFAULT_STRATEGY) != Z_OK) {
+		return -ENOMEM;
+	}
+	if (inflateInit2(&ext.rx, -(int)ext.server_bits) != Z_OK) {
+		deflateEnd(&ext.tx);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+int ocpp_ws_deflate_offer(char *buf, size_t bufsize,
+		const struct ocpp_ws_deflate_param *param)
+{
+	uint8_t client_bits = get_bits(param->client_max_window_bits,
+			MIN_CLIENT_WINDOW_BITS);
+	uint8_t server_bits = get_bits(param->server_max_window_bits,
+			MIN_SERVER_WINDOW_BITS);
+	int err;
+
+	ocpp_ws_deflate_end();
+
+	if ((err = fit_windows(&client_bits, &server_bits)) != 0) {
+		return err;
+	}
+
+	int len = snprintf(buf, bufsize, "%s; %s=%u", EXTENSION_NAME,
+			param_names[CLIENT_MAX_WINDOW_BITS], client_bits);
+
+	/* the window of the server is left to it unless narrowed */
+	if (server_bits < MAX_WINDOW_BITS) {
+		len = append(buf, bufsize, len, "; %s=%u",
+				param_names[SERVER_MAX_WINDOW_BITS],
+				server_bits);
+	}
+	if (param->client_no_context_takeover) {
+		len = append(buf, bufsize, len, "; %s",
+				param_names[CLIENT_NO_CONTEXT_TAKEOVER]);
+	}
+	if (param->server_no_context_takeover) {
+		len = append(buf, bufsize, len, "; %s",
+				param_names[SERVER_NO_CONTEXT_TAKEOVER]);
+	}
+
+	if (len < 0 || (size_t)len >= bufsize) {
+		return -ENOBUFS;
+	}
+
+	ext.offer = *param;
+	ext.offer.client_max_window_bits = client_bits;
+	ext.offer.server_max_window_bits = server_bits;
+	ext.offered = true;
+
+	return 0;
+}
+
+int ocpp_ws_deflate_accept(const char *value, size_t len)
+{
+	const char *end = &value[len];
+	const char *p = skip_ows(value, end);
+	size_t n = get_token_len(p, end);
+	uint8_t client_bits = ext.offer.client_max_window_bits;
+	uint8_t server_bits = MAX_WINDOW_BITS;
+	unsigned int seen = 0;
+
+	if (!ext.offered || ext.enabled ||
+			!equals_nocase(p, n, EXTENSION_NAME)) {
+		return -EPROTO;
+	}
+
+	p = skip_ows(&p[n], end);
+
+	while (p < end) {
+		const char *arg = NULL;
+		size_t arg_len = 0;
+
+		/* a comma would be a second extension, never offered */
+		if (*p != ';') {
+			return -EPROTO;
+		}
+
+		p = skip_ows(p + 1, end);
+		const char *name = p;
+		const size_t name_len = get_token_len(p, end);
+		p = skip_ows(&p[name_len], end);
+
+		if (p < end && *p == '=') {
+			p = skip_ows(p + 1, end);
+
+			if (p < end && *p == '"') {
+				arg = ++p;
+				arg_len = get_token_len(p, end);
+				p += arg_len;
+				if (p == end || *p++ != '"') {
+					return -EPROTO;
+				}
+			} else {
+				arg = p;
+				arg_len = get_token_len(p, end);
+				p += arg_len;
+			}
+
+			p = skip_ows(p, end);
+		}
+
+		const int param = get_param(name, name_len);
+
+		if (param < 0 || (seen & (1u << param))) {
+			return -EPROTO;
+		}
+
+		seen |= 1u << param;
+
+		if (param == SERVER_MAX_WINDOW_BITS ||
+				param == CLIENT_MAX_WINDOW_BITS) {
+			const int bits = parse_bits(arg, arg_len);
+
+			if (bits < 0) {
+				return -EPROTO;
+			} else if (param == SERVER_MAX_WINDOW_BITS) {
+				server_bits = (uint8_t)bits;
+			} else if (bits < client_bits) {
+				client_bits = (uint8_t)bits;
+			}
+		} else if (arg != NULL) {
+			return -EPROTO;
+		}
+	}
+
+	/* what was asked of the server must be agreed to, and the window of
+	 * the client can not go below what zlib compresses with */
+	if (server_bits > ext.offer.server_max_window_bits ||
+			(ext.offer.server_no_context_takeover &&
+			!(seen & (1u << SERVER_NO_CONTEXT_TAKEOVER))) ||
+			client_bits < MIN_CLIENT_WINDOW_BITS) {
+		return -EPROTO;
+	}
+
+	ext.client_bits = client_bits;
+	ext.server_bits = server_bits;
+	ext.client_no_context_takeover =
+		ext.offer.client_no_context_takeover ||
+		(seen & (1u << CLIENT_NO_CONTEXT_TAKEOVER));
+	ext.server_no_context_takeover =
+		(seen & (1u << SERVER_NO_CONTEXT_TAKEOVER)) != 0;
+
+	int err = init_streams();
+
+	if (err == 0) {
+		ext.enabled = true;
+	}
+
+	return err;
+}
+
+void ocpp_ws_deflate_end(void)
+{
+	if (ext.enabled) {
+		deflateEnd(&ext.tx);
+		inflateEnd(&ext.rx);
+	}
+
+	ext.enabled = false;
+	ext.offered = false;
+#if OCPP_WS_DEFLATE_HEAPSIZE > 0
+	ext.heap_used = 0;
+#endif
+}
+
+bool ocpp_ws_deflate_enabled(void)
+{
+	return ext.enabled;
+}
+
+int ocpp_ws_deflate_compress(void *buf, size_t bufsize,
+		const void *data, size_t len, size_t *out_len)
+{
+	z_stream *z = &ext.tx;
+
+	if (!ext.enabled) {
+		return -ENOTCONN;
+	}
+
+	z->next_in = (const Bytef *)data;
+	z->avail_in = (uInt)len;
+	z->next_out = (Bytef *)buf;
+	z->avail_out = (uInt)bufsize;
+
+	/* flushed to a byte boundary, ending with an empty stored block of
+	 * 0x00 0x00 0xff 0xff, RFC 7692 7.2.1. No room left may mean more to
+	 * come out. */
+	if (deflate(z, Z_SYNC_FLUSH) != Z_OK || z->avail_in != 0 ||
+			z->avail_out == 0) {
+		deflateReset(z);
+		return -ENOBUFS;
+	}
+
+	*out_len = bufsize - z->avail_out - 4;
+
+	if (ext.client_no_context_takeover) {
+		deflateReset(z);
+	}
+
+	return 0;
+}
+
+int ocpp_ws_deflate_decompress(void *buf, size_t bufsize,
+		const void *data, size_t len, size_t *out_len)
+{
+	static const Bytef tail[] = { 0x00, 0x00, 0xff, 0xff };
+	z_stream *z = &ext.rx;
+	int rc;
+
+	if (!ext.enabled) {
+		return -ENOTCONN;
+	}
+
+	z->next_in = (const Bytef *)data;
+	z->avail_in = (uInt)len;
+	z->next_out = (Bytef *)buf;
+	z->avail_out = (uInt)bufsize;
+
+	rc = inflate(z, Z_SYNC_FLUSH);
+
+	if ((rc == Z_OK || rc == Z_BUF_ERROR) && z->avail_in == 0) {
+		z->next_in = tail;
+		z->avail_in = sizeof(tail);
+		rc = inflate(z, Z_SYNC_FLUSH);
+	}
+
+	switch (rc) {
+	case Z_STREAM_END: /* the peer may end with a final block */
+		inflateReset(z);
+		break;
+	case Z_OK:
+		if (z->avail_in == 0 && z->avail_out != 0) {
+			break;
+		}
+		return z->avail_out == 0? -EMSGSIZE : -EBADMSG;
+	case Z_BUF_ERROR:
+		return z->avail_out == 0? -EMSGSIZE : -EBADMSG;
+	case Z_MEM_ERROR:
+		return -ENOMEM;
+	default:
+		return -EBADMSG;
+	}
+
+	*out_len = bufsize - z->avail_out;
+
+	if (ext.server_no_context_takeover) {
+		inflateReset(z);
+	}
+
+	return 0;
+}
+#else /* !OCPP_WS_DEFLATE */
+int ocpp_ws_deflate_offer(char *buf, size_t bufsize,
+		const struct ocpp_ws_deflate_param *param)
+{
+	(void)buf;
+	(void)bufsize;
+	(void)param;
+	return -ENOTSUP;
+}
+
+int ocpp_ws_deflate_accept(const char *value, size_t len)
+{
+	(void)value;
+	(void)len;
+	return -EPROTO;
+}
+
+void ocpp_ws_deflate_end(void)
+{
+}
+
+bool ocpp_ws_deflate_enabled(void)
+{
+	return false;
+}
+
+int ocpp_ws_deflate_compress(void *buf, size_t bufsize,
+		const void *data, size_t len, size_t *out_len)
+{
+	(void)buf;
+	(void)bufsize;
+	(void)data;
+	(void)len;
+	(void)out_len;
+	return -ENOTCONN;
+}
+
+int ocpp_ws_deflate_decompress(void *buf, size_t bufsize,
+		const void *data, size_t len, size_t *out_len)
+{
+	(void)buf;
+	(void)bufsize;
+	(void)data;
+	(void)len;
+	(void)out_len;
+	return -ENOTCONN;
+}
+#endif /* OCPP_WS_DEFLATE */
@@ -0,0 +1,196 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/ws_link.h"
+
+#include <errno.h>
+#include <string.h>
+
+static struct {
+	struct ocpp_ws_link_param param;
+	bool started;
+	bool up;
+	bool waiting; /**< For retry_at to connect again. */
+	uint32_t failures; /**< Attempts failed in a row. */
+	time_t retry_at;
+	time_t attempt_at;
+	struct ocpp_ws_link_stats stats;
+} m;
+
+/* Doubles the minimum for every failure, with up to half again at random. */
+static uint32_t get_backoff(void)
+{
+	uint32_t wait = m.param.backoff_min_sec;
+	uint32_t r;
+
+	for (uint32_t i = 0; i < m.failures &&
+			wait < m.param.backoff_max_sec; i++) {
+		wait *= 2;
+	}
+
+	if (wait > m.param.backoff_max_sec) {
+		wait = m.param.backoff_max_sec;
+	}
+
+	ocpp_ws_random(&r, sizeof(r));
+
+	return wait + r % (wait / 2 + 1);
+}
+
+static void schedule(time_t now)
+{
+	m.retry_at = now + (time_t)get_backoff();
+	m.failures++;
+	m.waiting = true;
+}
+
+static void attempt(time_t now)
+{
+	m.waiting = false;
+	m.attempt_at = now;
+	m.stats.attempts++;
+
+	if (ocpp_ws_open(&m.param.ws) != 0) {
+		schedule(now);
+	}
+}
+
+static void go_down(void)
+{
+	m.up = false;
+	m.failures = 0;
+	m.stats.drops++;
+
+	ocpp_set_connected(false);
+}
+
+int ocpp_ws_link_poll(void)
+{
+	const time_t now = ocpp_get_time();
+	ocpp_ws_state_t state = ocpp_ws_get_state();
+
+	if (!m.started) {
+		return -EINVAL;
+	}
+
+	if (state != OCPP_WS_CLOSED) {
+		(void)ocpp_ws_poll();
+		state = ocpp_ws_get_state();
+	}
+
+	if (state == OCPP_WS_OPEN) {
+		if (!m.up) {
+			m.up = true;
+			m.failures = 0;
+			m.stats.connects++;
+
+			ocpp_set_connected(true);
+		}
+		return 0;
+	}
+
+	if (state == OCPP_WS_CONNECTING || state == OCPP_WS_HANDSHAKING) {
+		if (now - m.attempt_at >=
+				OCPP_WS_LINK_CONNECT_TIMEOUT_SEC) {
+			ocpp_ws_close(1000);
+			schedule(now);
+		}
+		return 0;
+	}
+
+	if (m.up) {
+		go_down();
+	}
+
+	if (state == OCPP_WS_CLOSED) {
+		if (!m.waiting) {
+			schedule(now);
+		} else if (now >= m.retry_at) {
+			attempt(now);
+		}
+	}
+
+	return 0;
+}
+
+bool ocpp_ws_link_is_up(void)
+{
+	return m.up;
+}
+
+int ocpp_ws_link_get_next_deadline(time_t *deadline)
+{
+	time_t t;
+
+	if (!m.started) {
+		return -ENOENT;
+	} else if (m.waiting) {
+		t = m.retry_at;
+	} else if (m.up) {
+		return ocpp_ws_get_next_deadline(deadline);
+	} else if (ocpp_ws_get_state() == OCPP_WS_CONNECTING ||
+			ocpp_ws_get_state() == OCPP_WS_HANDSHAKING) {
+		t = m.attempt_at + OCPP_WS_LINK_CONNECT_TIMEOUT_SEC;
+	} else {
+		return -ENOENT;
+	}
+
+	if (deadline) {
+		*deadline = t;
+	}
+
+	return 0;
+}
+
+void ocpp_ws_link_get_stats(struct ocpp_ws_link_stats *stats)
+{
+	*stats = m.stats;
+}
+
+void ocpp_ws_link_stop(void)
+{
+	if (!m.started) {
+		return;
+	}
+
+	ocpp_ws_close(1000);
+	ocpp_set_connected(false);
+
+	m.started = false;
+	m.up = false;
+	m.waiting = false;
+}
+
+int ocpp_ws_link_start(const struct ocpp_ws_link_param *param)
+{
+	if (param == NULL || param->ws.host == NULL || param->ws.port == 0) {
+		return -EINVAL;
+	}
+
+	if (m.started) {
+		return -EALREADY;
+	}
+
+	memset(&m, 0, sizeof(m));
+	m.param = *param;
+
+	if (m.param.backoff_min_sec == 0) {
+		m.param.backoff_min_sec = OCPP_WS_LINK_BACKOFF_MIN_SEC;
+	}
+	if (m.param.backoff_max_sec == 0) {
+		m.param.backoff_max_sec = OCPP_WS_LINK_BACKOFF_MAX_SEC;
+	}
+	if (m.param.backoff_max_sec < m.param.backoff_min_sec) {
+		m.param.backoff_max_sec = m.param.backoff_min_sec;
+	}
+
+	m.started = true;
+
+	ocpp_set_connected(false);
+	attempt(ocpp_get_time());
+
+	return 0;
+}
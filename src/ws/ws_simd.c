@@ -0,0 +1,539 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "ocpp/ws_simd.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if OCPP_WS_SIMD && (defined(__x86_64__) || \
+		(defined(__i386__) && defined(__SSE2__))) && defined(__GNUC__)
+#define HAVE_X86
+#include <immintrin.h>
+#endif
+
+#if OCPP_WS_SIMD && defined(__aarch64__) && defined(__ARM_NEON)
+#define HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+typedef void (*mask_func_t)(uint8_t *data, size_t len, const uint8_t key[4]);
+typedef bool (*utf8_func_t)(const uint8_t *data, size_t len);
+
+struct kernel {
+	mask_func_t mask;
+	utf8_func_t utf8;
+};
+
+/* Returns the length of the well-formed sequence at p, or 0 if there is
+ * none, following Table 3-7 of the Unicode Standard. */
+static size_t get_utf8_len(const uint8_t *p, size_t len)
+{
+	const uint8_t c = p[0];
+	uint8_t lo = 0x80, hi = 0xbf;
+	size_t n;
+
+	if (c < 0x80) {
+		return 1;
+	} else if (c < 0xc2) {
+		return 0;
+	} else if (c < 0xe0) {
+		n = 2;
+	} else if (c < 0xf0) {
+		n = 3;
+		lo = c == 0xe0? 0xa0 : 0x80;
+		hi = c == 0xed? 0x9f : 0xbf;
+	} else if (c < 0xf5) {
+		n = 4;
+		lo = c == 0xf0? 0x90 : 0x80;
+		hi = c == 0xf4? 0x8f : 0xbf;
+	} else {
+		return 0;
+	}
+
+	if (len < n || p[1] < lo || p[1] > hi) {
+		return 0;
+	}
+	for (size_t i = 2; i < n; i++) {
+		if (p[i] < 0x80 || p[i] > 0xbf) {
+			return 0;
+		}
+	}
+
+	return n;
+}
+
+/* Checks the sequences from *pos on up to stop at least, ending on a
+ * sequence boundary, for the ASCII-skipping kernels. */
+static bool check_utf8_run(const uint8_t *p, size_t len, size_t *pos,
+		size_t stop)
+{
+	size_t i = *pos;
+
+	while (i < stop && i < len) {
+		const size_t n = get_utf8_len(&p[i], len - i);
+
+		if (n == 0) {
+			return false;
+		}
+
+		i += n;
+	}
+
+	*pos = i;
+
+	return true;
+}
+
+static void mask_scalar(uint8_t *data, size_t len, const uint8_t key[4])
+{
+	uint32_t k32;
+	size_t i = 0;
+
+	memcpy(&k32, key, sizeof(k32));
+	/* the same in both halves whatever the byte order */
+	const uint64_t k = (uint64_t)k32 << 32 | k32;
+
+	for (; i + sizeof(k) <= len; i += sizeof(k)) {
+		uint64_t v;
+		memcpy(&v, &data[i], sizeof(v));
+		v ^= k;
+		memcpy(&data[i], &v, sizeof(v));
+	}
+	for (; i < len; i++) {
+		data[i] ^= key[i & 3];
+	}
+}
+
+static bool utf8_scalar(const uint8_t *data, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len) {
+		uint64_t v;
+
+		if (len - i >= sizeof(v)) {
+			memcpy(&v, &data[i], sizeof(v));
+			if ((v & 0x8080808080808080ull) == 0) {
+				i += sizeof(v);
+				continue;
+			}
+		}
+
+		if (!check_utf8_run(data, len, &i, i + sizeof(v))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* The lookup tables of the validation by Keiser and Lemire, "Validating
+ * UTF-8 In Less Than One Instruction Per Byte", 2021. Each names the errors
+ * a nibble of the previous byte or the current one may take part in, and an
+ * error is where all three of them agree. */
+#if defined(HAVE_X86) || defined(HAVE_NEON)
+#define TOO_SHORT				(1 << 0)
+#define TOO_LONG				(1 << 1)
+#define OVERLONG_3				(1 << 2)
+#define TOO_LARGE				(1 << 3)
+#define SURROGATE				(1 << 4)
+#define OVERLONG_2				(1 << 5)
+#define TOO_LARGE_1000				(1 << 6)
+#define OVERLONG_4				(1 << 6)
+#define TWO_CONTS				(1 << 7)
+#define CARRY					\
+	(TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+static const uint8_t byte_1_high[16] = {
+	/* 0_______ ASCII */
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	/* 10______ continuation */
+	TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+	/* 1100____ */
+	TOO_SHORT | OVERLONG_2,
+	/* 1101____ */
+	TOO_SHORT,
+	/* 1110____ */
+	TOO_SHORT | OVERLONG_3 | SURROGATE,
+	/* 1111____ */
+	TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+};
+
+static const uint8_t byte_1_low[16] = {
+	CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,	/* ____0000 */
+	CARRY | OVERLONG_2,				/* ____0001 */
+	CARRY,
+	CARRY,
+	CARRY | TOO_LARGE,				/* ____0100 */
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,	/* ____1101 */
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+};
+
+static const uint8_t byte_2_high[16] = {
+	/* 0_______ ASCII */
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	/* 1000____ */
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 |
+		OVERLONG_4,
+	/* 1001____ */
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+	/* 101_____ */
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	/* 11______ lead */
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+};
+
+/* What the last bytes of a chunk may be without a sequence cut off: a lead
+ * byte of n bytes may not be in the last n - 1. */
+static const uint8_t max_tail[32] = {
+	255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 255, 255, 255,
+	255, 255, 255, 255, 255, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1,
+};
+#endif
+
+#if defined(HAVE_X86)
+static void mask_sse2(uint8_t *data, size_t len, const uint8_t key[4])
+{
+	int32_t k32;
+	size_t i = 0;
+
+	memcpy(&k32, key, sizeof(k32));
+
+	const __m128i k = _mm_set1_epi32(k32);
+
+	for (; i + 16 <= len; i += 16) {
+		__m128i *p = (__m128i *)(void *)&data[i];
+		_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k));
+	}
+
+	mask_scalar(&data[i], len - i, key);
+}
+
+static bool utf8_sse2(const uint8_t *data, size_t len)
+{
+	size_t i = 0;
+
+	while (i < len) {
+		size_t stop = i + 16;
+
+		if (len - i >= 16) {
+			const int high = _mm_movemask_epi8(_mm_loadu_si128(
+				(const __m128i *)(const void *)&data[i]));
+
+			if (high == 0) {
+				i += 16;
+				continue;
+			}
+
+			/* the ASCII up to the first lead byte is fine */
+			i += (size_t)__builtin_ctz((unsigned int)high);
+			stop = i + 1;
+		}
+
+		if (!check_utf8_run(data, len, &i, stop)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+__attribute__((target("avx2")))
+static void mask_avx2(uint8_t *data, size_t len, const uint8_t key[4])
+{
+	int32_t k32;
+	size_t i = 0;
+
+	memcpy(&k32, key, sizeof(k32));
+
+	const __m256i k = _mm256_set1_epi32(k32);
+
+	for (; i + 32 <= len; i += 32) {
+		__m256i *p = (__m256i *)(void *)&data[i];
+		_mm256_storeu_si256(p,
+				_mm256_xor_si256(_mm256_loadu_si256(p), k));
+	}
+
+	mask_scalar(&data[i], len - i, key);
+}
+
+/* The bytes of in shifted in by n from the end of prev. */
+#define AVX2_PREV(in, prev, n)						\
+	_mm256_alignr_epi8(in, _mm256_permute2x128_si256(prev, in, 0x21), \
+			16 - (n))
+
+__attribute__((target("avx2")))
+static __m256i avx2_lookup(const uint8_t table[16], __m256i idx)
+{
+	const __m256i t = _mm256_broadcastsi128_si256(
+			_mm_loadu_si128((const __m128i *)(const void *)table));
+	return _mm256_shuffle_epi8(t, idx);
+}
+
+__attribute__((target("avx2")))
+static __m256i avx2_check(__m256i in, __m256i prev)
+{
+	const __m256i lo4 = _mm256_set1_epi8(0x0f);
+	const __m256i prev1 = AVX2_PREV(in, prev, 1);
+	const __m256i prev2 = AVX2_PREV(in, prev, 2);
+	const __m256i prev3 = AVX2_PREV(in, prev, 3);
+
+	const __m256i special = _mm256_and_si256(_mm256_and_si256(
+			avx2_lookup(byte_1_high, _mm256_and_si256(
+					_mm256_srli_epi16(prev1, 4), lo4)),
+			avx2_lookup(byte_1_low, _mm256_and_si256(prev1, lo4))),
+			avx2_lookup(byte_2_high, _mm256_and_si256(
+					_mm256_srli_epi16(in, 4), lo4)));
+
+	/* only 111_____ and 1111____ get to 0x80 or above */
+	const __m256i must23 = _mm256_or_si256(
+			_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xe0 - 0x80)),
+			_mm256_subs_epu8(prev3, _mm256_set1_epi8(0xf0 - 0x80)));
+	const __m256i must23_80 = _mm256_and_si256(must23,
+			_mm256_set1_epi8((char)0x80));
+
+	return _mm256_xor_si256(must23_80, special);
+}
+
+__attribute__((target("avx2")))
+static bool utf8_avx2(const uint8_t *data, size_t len)
+{
+	const __m256i max = _mm256_loadu_si256(
+			(const __m256i *)(const void *)max_tail);
+	__m256i prev = _mm256_setzero_si256();
+	__m256i err = _mm256_setzero_si256();
+	__m256i incomplete = _mm256_setzero_si256();
+
+	for (size_t i = 0; i < len; i += 32) {
+		__m256i in;
+
+		if (len - i >= 32) {
+			in = _mm256_loadu_si256(
+				(const __m256i *)(const void *)&data[i]);
+		} else {
+			/* padded with ASCII, which a sequence cut off at the
+			 * end does not take as a continuation */
+			uint8_t tail[32] = { 0, };
+			memcpy(tail, &data[i], len - i);
+			in = _mm256_loadu_si256(
+				(const __m256i *)(const void *)tail);
+		}
+
+		if (_mm256_movemask_epi8(in) == 0) {
+			err = _mm256_or_si256(err, incomplete);
+			incomplete = _mm256_setzero_si256();
+		} else {
+			err = _mm256_or_si256(err, avx2_check(in, prev));
+			incomplete = _mm256_subs_epu8(in, max);
+		}
+
+		prev = in;
+	}
+
+	err = _mm256_or_si256(err, incomplete);
+
+	return _mm256_testz_si256(err, err) != 0;
+}
+#endif /* HAVE_X86 */
+
+#if defined(HAVE_NEON)
+static void mask_neon(uint8_t *data, size_t len, const uint8_t key[4])
+{
+	uint32_t k32;
+	size_t i = 0;
+
+	memcpy(&k32, key, sizeof(k32));
+
+	const uint8x16_t k = vreinterpretq_u8_u32(vdupq_n_u32(k32));
+
+	for (; i + 16 <= len; i += 16) {
+		vst1q_u8(&data[i], veorq_u8(vld1q_u8(&data[i]), k));
+	}
+
+	mask_scalar(&data[i], len - i, key);
+}
+
+static uint8x16_t neon_check(uint8x16_t in, uint8x16_t prev)
+{
+	const uint8x16_t lo4 = vdupq_n_u8(0x0f);
+	const uint8x16_t prev1 = vextq_u8(prev, in, 15);
+	const uint8x16_t prev2 = vextq_u8(prev, in, 14);
+	const uint8x16_t prev3 = vextq_u8(prev, in, 13);
+
+	const uint8x16_t special = vandq_u8(vandq_u8(
+			vqtbl1q_u8(vld1q_u8(byte_1_high), vshrq_n_u8(prev1, 4)),
+			vqtbl1q_u8(vld1q_u8(byte_1_low), vandq_u8(prev1, lo4))),
+			vqtbl1q_u8(vld1q_u8(byte_2_high), vshrq_n_u8(in, 4)));
+
+	const uint8x16_t must23 = vorrq_u8(
+			vqsubq_u8(prev2, vdupq_n_u8(0xe0 - 0x80)),
+			vqsubq_u8(prev3, vdupq_n_u8(0xf0 - 0x80)));
+	const uint8x16_t must23_80 = vandq_u8(must23, vdupq_n_u8(0x80));
+
+	return veorq_u8(must23_80, special);
+}
+
+static bool utf8_neon(const uint8_t *data, size_t len)
+{
+	const uint8x16_t max = vld1q_u8(&max_tail[16]);
+	uint8x16_t prev = vdupq_n_u8(0);
+	uint8x16_t err = vdupq_n_u8(0);
+	uint8x16_t incomplete = vdupq_n_u8(0);
+
+	for (size_t i = 0; i < len; i += 16) {
+		uint8x16_t in;
+
+		if (len - i >= 16) {
+			in = vld1q_u8(&data[i]);
+		} else {
+			uint8_t tail[16] = { 0, };
+			memcpy(tail, &data[i], len - i);
+			in = vld1q_u8(tail);
+		}
+
+		if (vmaxvq_u8(in) < 0x80) {
+			err = vorrq_u8(err, incomplete);
+			incomplete = vdupq_n_u8(0);
+		} else {
+			err = vorrq_u8(err, neon_check(in, prev));
+			incomplete = vqsubq_u8(in, max);
+		}
+
+		prev = in;
+	}
+
+	err = vorrq_u8(err, incomplete);
+
+	return vmaxvq_u8(err) == 0;
+}
+#endif /* HAVE_NEON */
+
+static const struct kernel *get_kernel(ocpp_ws_simd_t impl)
+{
+	static const struct kernel scalar = { mask_scalar, utf8_scalar };
+#if defined(HAVE_X86)
+	static const struct kernel sse2 = { mask_sse2, utf8_sse2 };
+	static const struct kernel avx2 = { mask_avx2, utf8_avx2 };
+#endif
+#if defined(HAVE_NEON)
+	static const struct kernel neon = { mask_neon, utf8_neon };
+#endif
+
+	switch (impl) {
+	case OCPP_WS_SIMD_SCALAR:
+		return &scalar;
+#if defined(HAVE_X86)
+	case OCPP_WS_SIMD_SSE2:
+		return &sse2;
+	case OCPP_WS_SIMD_AVX2:
+		return __builtin_cpu_supports("avx2")? &avx2 : NULL;
+#endif
+#if defined(HAVE_NEON)
+	case OCPP_WS_SIMD_NEON:
+		return &neon;
+#endif
+	default:
+		return NULL;
+	}
+}
+
+static ocpp_ws_simd_t get_best(void)
+{
+	static const ocpp_ws_simd_t preferred[] = {
+		OCPP_WS_SIMD_AVX2,
+		OCPP_WS_SIMD_NEON,
+		OCPP_WS_SIMD_SSE2,
+	};
+
+	for (size_t i = 0; i < sizeof(preferred) / sizeof(*preferred); i++) {
+		if (get_kernel(preferred[i])) {
+			return preferred[i];
+		}
+	}
+
+	return OCPP_WS_SIMD_SCALAR;
+}
+
+static struct {
+	const struct kernel *kernel;
+	ocpp_ws_simd_t impl;
+} selected;
+
+int ocpp_ws_simd_select(ocpp_ws_simd_t impl)
+{
+	if (impl == OCPP_WS_SIMD_AUTO) {
+		impl = get_best();
+	}
+
+	const struct kernel *kernel = get_kernel(impl);
+
+	if (kernel == NULL) {
+		return -ENOTSUP;
+	}
+
+	selected.impl = impl;
+	selected.kernel = kernel;
+
+	return 0;
+}
+
+ocpp_ws_simd_t ocpp_ws_simd_selected(void)
+{
+	if (selected.kernel == NULL) {
+		(void)ocpp_ws_simd_select(OCPP_WS_SIMD_AUTO);
+	}
+
+	return selected.impl;
+}
+
+const char *ocpp_ws_simd_stringify(ocpp_ws_simd_t impl)
+{
+	switch (impl) {
+	case OCPP_WS_SIMD_SCALAR:
+		return "scalar";
+	case OCPP_WS_SIMD_SSE2:
+		return "sse2";
+	case OCPP_WS_SIMD_AVX2:
+		return "avx2";
+	case OCPP_WS_SIMD_NEON:
+		return "neon";
+	default:
+		return "auto";
+	}
+}
+
+void ocpp_ws_mask(void *data, size_t len, const uint8_t key[4])
+{
+	if (selected.kernel == NULL) {
+		(void)ocpp_ws_simd_select(OCPP_WS_SIMD_AUTO);
+	}
+
+	(*selected.kernel->mask)((uint8_t *)data, len, key);
+}
+
+bool ocpp_ws_utf8_valid(const void *data, size_t len)
+{
+	if (selected.kernel == NULL) {
+		(void)ocpp_ws_simd_select(OCPP_WS_SIMD_AUTO);
+	}
+
+	return (*selected.kernel->utf8)((const uint8_t *)data, len);
+}
@@ -0,0 +1,437 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#if !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE				200112L
+#endif
+
+#include "ocpp/ws_tls.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if OCPP_WS_TLS
+#include <arpa/inet.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL				0
+#endif
+
+static struct {
+	SSL_CTX *ctx;
+	const struct ocpp_ws_tls_param *param; /**< The context is built on. */
+	BIO_METHOD *method;
+
+	SSL *ssl;
+	int fd;
+	bool want_write;
+	bool handshaken;
+	bool failed; /**< On a TLS error, not to keep the session. */
+	char peer[OCPP_WS_TLS_PEER_MAXLEN]; /**< Of the connection. */
+
+	SSL_SESSION *session;
+	char session_peer[OCPP_WS_TLS_PEER_MAXLEN];
+
+	struct ocpp_ws_tls_stats stats;
+} tls;
+
+/* The socket BIO of OpenSSL writes with write(), which raises SIGPIPE on a
+ * connection reset. This one goes through send() as the transport does. */
+static int bio_write(BIO *bio, const char *data, int len)
+{
+	const ssize_t n = send(tls.fd, data, (size_t)len, MSG_NOSIGNAL);
+
+	BIO_clear_retry_flags(bio);
+
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+			errno == EINTR)) {
+		BIO_set_retry_write(bio);
+	}
+
+	return (int)n;
+}
+
+static int bio_read(BIO *bio, char *buf, int len)
+{
+	const ssize_t n = recv(tls.fd, buf, (size_t)len, 0);
+
+	BIO_clear_retry_flags(bio);
+
+	if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+			errno == EINTR)) {
+		BIO_set_retry_read(bio);
+	}
+
+	return (int)n;
+}
+
+static long bio_ctrl(BIO *bio, int cmd, long num, void *ptr)
+{
+	(void)bio;
+	(void)num;
+	(void)ptr;
+
+	return cmd == BIO_CTRL_FLUSH? 1 : 0;
+}
+
+static BIO_METHOD *new_method(void)
+{
+	BIO_METHOD *method = BIO_meth_new(BIO_get_new_index() |
+			BIO_TYPE_SOURCE_SINK, "ocpp_ws");
+
+	if (method == NULL) {
+		return NULL;
+	}
+
+	if (!BIO_meth_set_write(method, bio_write) ||
+			!BIO_meth_set_read(method, bio_read) ||
+			!BIO_meth_set_ctrl(method, bio_ctrl)) {
+		BIO_meth_free(method);
+		return NULL;
+	}
+
+	return method;
+}
+
+static void drop_session(void)
+{
+	if (tls.session) {
+		SSL_SESSION_free(tls.session);
+	}
+
+	tls.session = NULL;
+	tls.session_peer[0] = '\0';
+}
+
+/* Takes a session to resume later, the ticket of TLS 1.3 coming after the
+ * handshake. The last one wins. */
+static int on_new_session(SSL *ssl, SSL_SESSION *session)
+{
+	(void)ssl;
+
+	drop_session();
+
+	tls.session = session;
+	memcpy(tls.session_peer, tls.peer, sizeof(tls.session_peer));
+
+	return 1; /* the reference is kept */
+}
+
+static int build_context(const struct ocpp_ws_tls_param *param)
+{
+	SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+
+	if (ctx == NULL) {
+		return -ENOMEM;
+	}
+
+	/* TLS 1.2 at least, OCPP 1.6 Security Whitepaper */
+	SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+	SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+	SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE |
+			SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#if defined(SSL_OP_IGNORE_UNEXPECTED_EOF)
+	/* a server gone is a connection lost, not a TLS error */
+	SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+
+	if ((param->ca_file?
+			SSL_CTX_load_verify_locations(ctx, param->ca_file,
+				NULL) :
+			SSL_CTX_set_default_verify_paths(ctx)) != 1) {
+		goto out_enoent;
+	}
+
+	if (param->cert_file && (SSL_CTX_use_certificate_chain_file(ctx,
+			param->cert_file) != 1 ||
+			SSL_CTX_use_PrivateKey_file(ctx, param->key_file?
+				param->key_file : param->cert_file,
+				SSL_FILETYPE_PEM) != 1 ||
+			SSL_CTX_check_private_key(ctx) != 1)) {
+		goto out_enoent;
+	}
+
+	SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+			SSL_SESS_CACHE_NO_INTERNAL_STORE);
+	SSL_CTX_sess_set_new_cb(ctx, on_new_session);
+
+	tls.ctx = ctx;
+	tls.param = param;
+
+	return 0;
+out_enoent:
+	ERR_clear_error();
+	SSL_CTX_free(ctx);
+	return -ENOENT;
+}
+
+static bool is_address(const char *host)
+{
+	uint8_t addr[16];
+
+	return inet_pton(AF_INET, host, addr) == 1 ||
+		inet_pton(AF_INET6, host, addr) == 1;
+}
+
+static int set_peer(SSL *ssl, const char *host)
+{
+	X509_VERIFY_PARAM *vp = SSL_get0_param(ssl);
+
+	if (is_address(host)) {
+		return X509_VERIFY_PARAM_set1_ip_asc(vp, host) == 1?
+			0 : -EINVAL;
+	}
+
+	if (X509_VERIFY_PARAM_set1_host(vp, host, 0) != 1 ||
+			SSL_set_tlsext_host_name(ssl, host) != 1) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void check_handshake(void)
+{
+	if (tls.handshaken || !SSL_is_init_finished(tls.ssl)) {
+		return;
+	}
+
+	tls.handshaken = true;
+	tls.stats.handshakes++;
+
+	if (SSL_session_reused(tls.ssl)) {
+		tls.stats.resumed++;
+	}
+}
+
+static ssize_t handle(int ret)
+{
+	check_handshake();
+
+	if (ret > 0) {
+		tls.want_write = false;
+		return ret;
+	}
+
+	switch (SSL_get_error(tls.ssl, ret)) {
+	case SSL_ERROR_WANT_READ:
+		tls.want_write = false;
+		return -EAGAIN;
+	case SSL_ERROR_WANT_WRITE:
+		tls.want_write = true;
+		return -EAGAIN;
+	case SSL_ERROR_ZERO_RETURN:
+		return 0;
+	case SSL_ERROR_SYSCALL:
+		if (ERR_peek_error() == 0) {
+			return errno? -errno : -ECONNRESET;
+		}
+		/* fall through */
+	default:
+		ERR_clear_error();
+		tls.failed = true;
+		return -EPROTO;
+	}
+}
+
+int ocpp_ws_tls_start(int fd, const char *host, uint16_t port,
+		const struct ocpp_ws_tls_param *param)
+{
+	BIO *bio;
+	int err;
+
+	if (host == NULL || param == NULL) {
+		return -EINVAL;
+	}
+
+	ocpp_ws_tls_stop();
+
+	if (tls.ctx && tls.param != param) {
+		ocpp_ws_tls_forget();
+	}
+	if (tls.ctx == NULL && (err = build_context(param)) != 0) {
+		return err;
+	}
+	if (tls.method == NULL && (tls.method = new_method()) == NULL) {
+		return -ENOMEM;
+	}
+
+	if ((tls.ssl = SSL_new(tls.ctx)) == NULL ||
+			(bio = BIO_new(tls.method)) == NULL) {
+		ocpp_ws_tls_stop();
+		return -ENOMEM;
+	}
+
+	tls.fd = fd;
+	BIO_set_init(bio, 1);
+	SSL_set_bio(tls.ssl, bio, bio);
+
+	if ((err = set_peer(tls.ssl, host)) != 0) {
+		ocpp_ws_tls_stop();
+		return err;
+	}
+
+	snprintf(tls.peer, sizeof(tls.peer), "%s:%u", host,
+			(unsigned int)port);
+
+	if (tls.session && strcmp(tls.session_peer, tls.peer) == 0) {
+		SSL_set_session(tls.ssl, tls.session);
+	}
+
+	SSL_set_connect_state(tls.ssl);
+
+	tls.handshaken = false;
+	tls.failed = false;
+	tls.want_write = true; /* ClientHello */
+
+	return 0;
+}
+
+void ocpp_ws_tls_stop(void)
+{
+	if (tls.ssl == NULL) {
+		return;
+	}
+
+	if (tls.failed) {
+		drop_session();
+	} else {
+		if (tls.handshaken) {
+			(void)SSL_shutdown(tls.ssl); /* close_notify */
+		}
+		/* or freeing a connection not shut down cleanly makes its
+		 * session not resumable */
+		SSL_set_shutdown(tls.ssl, SSL_SENT_SHUTDOWN |
+				SSL_RECEIVED_SHUTDOWN);
+	}
+
+	ERR_clear_error();
+	SSL_free(tls.ssl);
+
+	tls.ssl = NULL;
+	tls.want_write = false;
+}
+
+void ocpp_ws_tls_forget(void)
+{
+	ocpp_ws_tls_stop();
+	drop_session();
+
+	if (tls.ctx) {
+		SSL_CTX_free(tls.ctx);
+	}
+	if (tls.method) {
+		BIO_meth_free(tls.method);
+	}
+
+	tls.ctx = NULL;
+	tls.param = NULL;
+	tls.method = NULL;
+}
+
+bool ocpp_ws_tls_active(void)
+{
+	return tls.ssl != NULL;
+}
+
+ssize_t ocpp_ws_tls_send(const void *data, size_t len)
+{
+	if (tls.ssl == NULL) {
+		return -ENOTCONN;
+	}
+
+	ERR_clear_error();
+
+	return handle(SSL_write(tls.ssl, data,
+			len > INT_MAX? INT_MAX : (int)len));
+}
+
+ssize_t ocpp_ws_tls_recv(void *buf, size_t bufsize)
+{
+	if (tls.ssl == NULL) {
+		return -ENOTCONN;
+	}
+
+	ERR_clear_error();
+
+	return handle(SSL_read(tls.ssl, buf,
+			bufsize > INT_MAX? INT_MAX : (int)bufsize));
+}
+
+bool ocpp_ws_tls_wants_write(void)
+{
+	return tls.ssl != NULL && tls.want_write;
+}
+
+bool ocpp_ws_tls_has_pending(void)
+{
+	return tls.ssl != NULL && SSL_pending(tls.ssl) > 0;
+}
+
+void ocpp_ws_tls_get_stats(struct ocpp_ws_tls_stats *stats)
+{
+	*stats = tls.stats;
+}
+#else /* !OCPP_WS_TLS */
+int ocpp_ws_tls_start(int fd, const char *host, uint16_t port,
+		const struct ocpp_ws_tls_param *param)
+{
+	(void)fd;
+	(void)host;
+	(void)port;
+	(void)param;
+	return -ENOTSUP;
+}
+
+void ocpp_ws_tls_stop(void)
+{
+}
+
+void ocpp_ws_tls_forget(void)
+{
+}
+
+bool ocpp_ws_tls_active(void)
+{
+	return false;
+}
+
+ssize_t ocpp_ws_tls_send(const void *data, size_t len)
+{
+	(void)data;
+	(void)len;
+	return -ENOTCONN;
+}
+
+ssize_t ocpp_ws_tls_recv(void *buf, size_t bufsize)
+{
+	(void)buf;
+	(void)bufsize;
+	return -ENOTCONN;
+}
+
+bool ocpp_ws_tls_wants_write(void)
+{
+	return false;
+}
+
+bool ocpp_ws_tls_has_pending(void)
+{
+	return false;
+}
+
+void ocpp_ws_tls_get_stats(struct ocpp_ws_tls_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+#endif /* OCPP_WS_TLS */
@@ -0,0 +1,576 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#if !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "ocpp/ws_uring.h"
+
+#include <errno.h>
+#include <string.h>
+
+#if OCPP_WS_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if OCPP_WS_URING_RX_BUFS & (OCPP_WS_URING_RX_BUFS - 1)
+#error "OCPP_WS_URING_RX_BUFS must be a power of 2"
+#endif
+#if OCPP_WS_URING_RX_BUFSIZE > UINT16_MAX
+#error "OCPP_WS_URING_RX_BUFSIZE must fit in 16 bits"
+#endif
+
+/* a chain of writes and one receive at most in flight */
+#define RING_ENTRIES				(OCPP_WS_URING_TX_SEGMENTS * 2)
+/* a completion for every buffer and every write, with room to spare not to
+ * overflow, as an overflow is flushed only by entering the ring */
+#define CQ_ENTRIES				\
+	(OCPP_WS_URING_RX_BUFS * 2 + OCPP_WS_URING_TX_SEGMENTS + 4)
+#define BUFFER_GROUP				0
+
+#define TAG_WRITE				1
+#define TAG_RECV				2
+
+static struct {
+	int fd;
+	int sock;
+	int sock_flags; /**< To give back to the socket, or -1. */
+
+	void *ring;
+	size_t ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	struct {
+		unsigned int *head;
+		unsigned int *tail;
+		unsigned int *flags;
+		unsigned int mask;
+		unsigned int entries;
+		unsigned int local_tail;
+		unsigned int to_submit;
+	} sq;
+
+	struct {
+		unsigned int *head;
+		unsigned int *tail;
+		unsigned int mask;
+		struct io_uring_cqe *cqes;
+	} cq;
+
+	struct {
+		/* The segments of the registered buffer to write next, in
+		 * a chain once the one before has completed. */
+		struct iovec seg[OCPP_WS_URING_TX_SEGMENTS];
+		unsigned int nseg;
+		unsigned int inflight; /**< Writes not completed. */
+		size_t done; /**< Written, not taken by ocpp_ws_uring_send(). */
+		int err;
+	} tx;
+
+	struct {
+		/* buffers filled, in the order received */
+		struct {
+			uint16_t bid;
+			uint16_t len;
+		} filled[OCPP_WS_URING_RX_BUFS];
+		unsigned int first;
+		unsigned int count;
+		size_t offset; /**< Taken from the first one. */
+		uint16_t tail; /**< Of the buffers given back. */
+		bool armed;
+		bool eof;
+		int err;
+	} rx;
+
+	struct ocpp_ws_uring_stats stats;
+} uring = {
+	.fd = -1,
+	.sock = -1,
+	.sock_flags = -1,
+};
+
+static uint8_t rxbufs[OCPP_WS_URING_RX_BUFS][OCPP_WS_URING_RX_BUFSIZE];
+/* the tail the kernel reads lies in the resv of the first entry */
+static struct io_uring_buf bufring[OCPP_WS_URING_RX_BUFS]
+		__attribute__((aligned(4096)));
+
+static int enter(unsigned int to_submit, unsigned int flags)
+{
+	uring.stats.enters++;
+	return (int)syscall(__NR_io_uring_enter, uring.fd, to_submit, 0,
+			flags, NULL, 0);
+}
+
+static struct io_uring_sqe *get_sqe(uint64_t tag)
+{
+	const unsigned int head = __atomic_load_n(uring.sq.head,
+			__ATOMIC_ACQUIRE);
+
+	if (uring.sq.local_tail - head >= uring.sq.entries) {
+		return NULL;
+	}
+
+	struct io_uring_sqe *sqe =
+		&uring.sqes[uring.sq.local_tail & uring.sq.mask];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = tag;
+
+	uring.sq.local_tail++;
+	uring.sq.to_submit++;
+	__atomic_store_n(uring.sq.tail, uring.sq.local_tail, __ATOMIC_RELEASE);
+
+	return sqe;
+}
+
+static void give_back(uint16_t bid)
+{
+	struct io_uring_buf *buf =
+		&bufring[uring.rx.tail & (OCPP_WS_URING_RX_BUFS - 1)];
+
+	buf->addr = (uint64_t)(uintptr_t)rxbufs[bid];
+	buf->len = OCPP_WS_URING_RX_BUFSIZE;
+	buf->bid = bid;
+
+	__atomic_store_n(&bufring[0].resv, ++uring.rx.tail, __ATOMIC_RELEASE);
+}
+
+static void arm_recv(void)
+{
+	struct io_uring_sqe *sqe = get_sqe(TAG_RECV);
+
+	if (sqe == NULL) {
+		return;
+	}
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = uring.sock;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = BUFFER_GROUP;
+
+	uring.rx.armed = true;
+	uring.stats.arms++;
+}
+
+/* Writes out the segments given, linked to keep them in order, with the
+ * next chain waiting for this one to complete. A write falling short
+ * cancels the rest, to be given again from where it stopped. */
+static void prepare_write(void)
+{
+	struct io_uring_sqe *prev = NULL;
+
+	if (uring.tx.inflight > 0) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < uring.tx.nseg; i++) {
+		struct io_uring_sqe *sqe = get_sqe(TAG_WRITE);
+
+		if (sqe == NULL) {
+			break;
+		}
+		if (prev) {
+			prev->flags |= IOSQE_IO_LINK;
+		}
+
+		sqe->opcode = IORING_OP_WRITE_FIXED;
+		sqe->fd = uring.sock;
+		sqe->off = (uint64_t)-1;
+		sqe->addr = (uint64_t)(uintptr_t)uring.tx.seg[i].iov_base;
+		sqe->len = (uint32_t)uring.tx.seg[i].iov_len;
+		sqe->buf_index = 0;
+
+		prev = sqe;
+		uring.tx.inflight++;
+		uring.stats.writes++;
+	}
+
+	uring.tx.nseg = 0;
+}
+
+static void complete_write(int res)
+{
+	uring.tx.inflight--;
+
+	if (res == -EAGAIN || res == -EINTR || res == -ECANCELED) {
+		return; /* given again once the chain is done */
+	} else if (res < 0) {
+		uring.tx.err = res;
+		return;
+	}
+
+	uring.tx.done += (size_t)res;
+}
+
+static void complete_recv(int res, uint32_t flags)
+{
+	if (!(flags & IORING_CQE_F_MORE)) {
+		uring.rx.armed = false;
+	}
+
+	if (res > 0 && (flags & IORING_CQE_F_BUFFER)) {
+		const unsigned int i = (uring.rx.first + uring.rx.count) &
+			(OCPP_WS_URING_RX_BUFS - 1);
+		uring.rx.filled[i].bid =
+			(uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+		uring.rx.filled[i].len = (uint16_t)res;
+		uring.rx.count++;
+		uring.stats.reads++;
+	} else if (res == 0) {
+		uring.rx.eof = true;
+	} else if (res != -ENOBUFS) { /* armed again once taken */
+		uring.rx.err = res;
+	}
+}
+
+/* Takes the completions, which needs no syscall. */
+static void reap(void)
+{
+	/* sized not to happen, but brought back by the kernel if it does */
+	if (__atomic_load_n(uring.sq.flags, __ATOMIC_RELAXED) &
+			IORING_SQ_CQ_OVERFLOW) {
+		(void)enter(0, IORING_ENTER_GETEVENTS);
+	}
+
+	unsigned int head = *uring.cq.head;
+	const unsigned int tail = __atomic_load_n(uring.cq.tail,
+			__ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++) {
+		const struct io_uring_cqe *cqe =
+			&uring.cq.cqes[head & uring.cq.mask];
+
+		if (cqe->user_data == TAG_WRITE) {
+			complete_write(cqe->res);
+		} else if (cqe->user_data == TAG_RECV) {
+			complete_recv(cqe->res, cqe->flags);
+		}
+	}
+
+	__atomic_store_n(uring.cq.head, head, __ATOMIC_RELEASE);
+}
+
+static int map_ring(const struct io_uring_params *p)
+{
+	const size_t sq_size = p->sq_off.array +
+		p->sq_entries * sizeof(unsigned int);
+	const size_t cq_size = p->cq_off.cqes +
+		p->cq_entries * sizeof(struct io_uring_cqe);
+
+	if (!(p->features & IORING_FEAT_SINGLE_MMAP)) {
+		return -ENOTSUP;
+	}
+
+	uring.ring_size = sq_size > cq_size? sq_size : cq_size;
+	uring.ring = mmap(NULL, uring.ring_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, uring.fd, IORING_OFF_SQ_RING);
+	if (uring.ring == MAP_FAILED) {
+		uring.ring = NULL;
+		return -errno;
+	}
+
+	uring.sqes_size = p->sq_entries * sizeof(struct io_uring_sqe);
+	uring.sqes = (struct io_uring_sqe *)mmap(NULL, uring.sqes_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED, uring.fd,
+			IORING_OFF_SQES);
+	if (uring.sqes == MAP_FAILED) {
+		uring.sqes = NULL;
+		return -errno;
+	}
+
+	uint8_t *ring = (uint8_t *)uring.ring;
+	unsigned int *array = (unsigned int *)&ring[p->sq_off.array];
+
+	uring.sq.head = (unsigned int *)&ring[p->sq_off.head];
+	uring.sq.tail = (unsigned int *)&ring[p->sq_off.tail];
+	uring.sq.flags = (unsigned int *)&ring[p->sq_off.flags];
+	uring.sq.mask = *(unsigned int *)&ring[p->sq_off.ring_mask];
+	uring.sq.entries = p->sq_entries;
+	uring.sq.local_tail = *uring.sq.tail;
+
+	/* the entries are taken in the order of the array, so once for all */
+	for (unsigned int i = 0; i < p->sq_entries; i++) {
+		array[i] = i;
+	}
+
+	uring.cq.head = (unsigned int *)&ring[p->cq_off.head];
+	uring.cq.tail = (unsigned int *)&ring[p->cq_off.tail];
+	uring.cq.mask = *(unsigned int *)&ring[p->cq_off.ring_mask];
+	uring.cq.cqes = (struct io_uring_cqe *)&ring[p->cq_off.cqes];
+
+	return 0;
+}
+
+static int register_buffers(void *txbuf, size_t txbufsize)
+{
+	const struct iovec iov = {
+		.iov_base = txbuf,
+		.iov_len = txbufsize,
+	};
+	struct io_uring_buf_reg reg = {
+		.ring_addr = (uint64_t)(uintptr_t)bufring,
+		.ring_entries = OCPP_WS_URING_RX_BUFS,
+		.bgid = BUFFER_GROUP,
+	};
+
+	if (syscall(__NR_io_uring_register, uring.fd,
+			IORING_REGISTER_BUFFERS, &iov, 1) != 0 ||
+			syscall(__NR_io_uring_register, uring.fd,
+			IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+		return -errno;
+	}
+
+	uring.rx.tail = 0;
+	__atomic_store_n(&bufring[0].resv, 0, __ATOMIC_RELEASE);
+
+	for (uint16_t i = 0; i < OCPP_WS_URING_RX_BUFS; i++) {
+		give_back(i);
+	}
+
+	return 0;
+}
+
+int ocpp_ws_uring_start(int fd, void *txbuf, size_t txbufsize)
+{
+	struct io_uring_params params = {
+		.flags = IORING_SETUP_CQSIZE,
+		.cq_entries = CQ_ENTRIES,
+	};
+	int flags;
+	int err;
+
+	ocpp_ws_uring_stop();
+	memset(&uring.stats, 0, sizeof(uring.stats));
+
+	uring.fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+	if (uring.fd < 0) {
+		uring.fd = -1;
+		return -errno;
+	}
+
+	uring.sock = fd;
+
+	if ((err = map_ring(&params)) != 0 ||
+			(err = register_buffers(txbuf, txbufsize)) != 0) {
+		goto out_stop;
+	}
+
+	/* the ring polls the socket itself rather than getting EAGAIN */
+	if ((flags = fcntl(fd, F_GETFL, 0)) < 0) {
+		err = -errno;
+		goto out_stop;
+	}
+
+	uring.sock_flags = flags;
+
+	if (fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0) {
+		err = -errno;
+		goto out_stop;
+	}
+
+	arm_recv();
+
+	if ((err = ocpp_ws_uring_submit()) != 0) {
+		goto out_stop;
+	}
+
+	return 0;
+
+out_stop:
+	ocpp_ws_uring_stop();
+	return err;
+}
+
+void ocpp_ws_uring_stop(void)
+{
+	if (uring.fd < 0) {
+		return;
+	}
+
+	/* the last frames, e.g. a close frame, go out on the way */
+	(void)ocpp_ws_uring_submit();
+
+	if (uring.sqes) {
+		munmap(uring.sqes, uring.sqes_size);
+	}
+	if (uring.ring) {
+		munmap(uring.ring, uring.ring_size);
+	}
+	close(uring.fd);
+
+	/* back to the transport on the socket, or to whoever closes it */
+	if (uring.sock_flags >= 0) {
+		(void)fcntl(uring.sock, F_SETFL, uring.sock_flags);
+	}
+
+	const struct ocpp_ws_uring_stats stats = uring.stats;
+
+	memset(&uring, 0, sizeof(uring));
+	uring.fd = uring.sock = uring.sock_flags = -1;
+	uring.stats = stats;
+}
+
+bool ocpp_ws_uring_active(void)
+{
+	return uring.fd >= 0;
+}
+
+int ocpp_ws_uring_get_fd(void)
+{
+	return uring.fd;
+}
+
+ssize_t ocpp_ws_uring_send(const struct iovec *iov, unsigned int iovcnt)
+{
+	reap();
+
+	if (uring.tx.err) {
+		return uring.tx.err;
+	}
+
+	if (uring.tx.done > 0) {
+		const size_t n = uring.tx.done;
+		uring.tx.done = 0;
+		return (ssize_t)n;
+	}
+
+	/* the segments given before are all that is left of the chain, and
+	 * the ones given now start right where it is written up to */
+	if (uring.tx.inflight == 0) {
+		uring.tx.nseg = iovcnt < OCPP_WS_URING_TX_SEGMENTS?
+			iovcnt : OCPP_WS_URING_TX_SEGMENTS;
+		memcpy(uring.tx.seg, iov, uring.tx.nseg * sizeof(*iov));
+	}
+
+	return -EAGAIN;
+}
+
+ssize_t ocpp_ws_uring_recv(void *buf, size_t bufsize)
+{
+	uint8_t *p = (uint8_t *)buf;
+	size_t n = 0;
+
+	reap();
+
+	while (n < bufsize && uring.rx.count > 0) {
+		const unsigned int i = uring.rx.first;
+		const size_t left = uring.rx.filled[i].len - uring.rx.offset;
+		const size_t chunk = left < bufsize - n? left : bufsize - n;
+		const uint16_t bid = uring.rx.filled[i].bid;
+
+		memcpy(&p[n], &rxbufs[bid][uring.rx.offset], chunk);
+		n += chunk;
+		uring.rx.offset += chunk;
+
+		if (uring.rx.offset == uring.rx.filled[i].len) {
+			give_back(bid);
+			uring.rx.first = (i + 1) & (OCPP_WS_URING_RX_BUFS - 1);
+			uring.rx.count--;
+			uring.rx.offset = 0;
+		}
+	}
+
+	/* ran out of buffers before, with some given back now */
+	if (!uring.rx.armed && !uring.rx.eof && !uring.rx.err &&
+			uring.rx.count < OCPP_WS_URING_RX_BUFS) {
+		arm_recv();
+	}
+
+	if (n > 0) {
+		return (ssize_t)n;
+	} else if (uring.rx.err) {
+		return uring.rx.err;
+	} else if (uring.rx.eof) {
+		return 0;
+	}
+
+	return -EAGAIN;
+}
+
+int ocpp_ws_uring_submit(void)
+{
+	if (uring.fd < 0) {
+		return 0;
+	}
+
+	reap();
+	prepare_write();
+
+	while (uring.sq.to_submit > 0) {
+		const int n = enter(uring.sq.to_submit, 0);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			/* short of resources for now, tried again later */
+			return errno == EAGAIN || errno == EBUSY? 0 : -errno;
+		}
+
+		uring.sq.to_submit -= (unsigned int)n;
+	}
+
+	return 0;
+}
+
+void ocpp_ws_uring_get_stats(struct ocpp_ws_uring_stats *stats)
+{
+	*stats = uring.stats;
+}
+#else /* !OCPP_WS_URING */
+int ocpp_ws_uring_start(int fd, void *txbuf, size_t txbufsize)
+{
+	(void)fd;
+	(void)txbuf;
+	(void)txbufsize;
+	return -ENOTSUP;
+}
+
+void ocpp_ws_uring_stop(void)
+{
+}
+
+bool ocpp_ws_uring_active(void)
+{
+	return false;
+}
+
+int ocpp_ws_uring_get_fd(void)
+{
+	return -1;
+}
+
+ssize_t ocpp_ws_uring_send(const struct iovec *iov, unsigned int iovcnt)
+{
+	(void)iov;
+	(void)iovcnt;
+	return -ENOTCONN;
+}
+
+ssize_t ocpp_ws_uring_recv(void *buf, size_t bufsize)
+{
+	(void)buf;
+	(void)bufsize;
+	return -ENOTCONN;
+}
+
+int ocpp_ws_uring_submit(void)
+{
+	return 0;
+}
+
+void ocpp_ws_uring_get_stats(struct ocpp_ws_uring_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+}
+#endif /* OCPP_WS_URING */
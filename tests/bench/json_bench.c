@@ -0,0 +1,230 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Decode throughput of the OCPP-J decoder for each scan implementation.
+ *
+ *   json_bench [corpus...]
+ *
+ * A corpus file holds one frame per line. Responses are decoded as replies
+ * to a pending GetConfiguration request with the id "bench". Without a
+ * corpus, MeterValues and GetConfiguration frames are generated.
+ */
+
+#include "ocpp/ocpp.h"
+#include "ocpp/codec/json.h"
+#include "ocpp/codec/json_scan.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_FRAMES				4096
+#define MAX_FRAME_LEN				16384
+#define MIN_DURATION_SEC			0.5
+
+struct frame {
+	char *data;
+	size_t len;
+};
+
+static struct frame frames[MAX_FRAMES];
+static size_t nr_frames;
+
+int ocpp_send(const struct ocpp_message *msg)
+{
+	(void)msg;
+	return 0;
+}
+
+int ocpp_recv(struct ocpp_message *msg)
+{
+	(void)msg;
+	return -ENOMSG;
+}
+
+int ocpp_lock(void)
+{
+	return 0;
+}
+
+int ocpp_unlock(void)
+{
+	return 0;
+}
+
+int ocpp_configuration_lock(void)
+{
+	return 0;
+}
+
+int ocpp_configuration_unlock(void)
+{
+	return 0;
+}
+
+void ocpp_generate_message_id(void *buf, size_t bufsize)
+{
+	snprintf((char *)buf, bufsize, "bench");
+}
+
+time_t ocpp_get_time(void)
+{
+	return 0;
+}
+
+static void add_frame(const char *data, size_t len)
+{
+	if (nr_frames >= MAX_FRAMES || len == 0) {
+		return;
+	}
+
+	frames[nr_frames].data = (char *)malloc(len);
+	memcpy(frames[nr_frames].data, data, len);
+	frames[nr_frames].len = len;
+	nr_frames++;
+}
+
+static int load_corpus(const char *path)
+{
+	static char line[MAX_FRAME_LEN];
+	FILE *f = fopen(path, "r");
+
+	if (f == NULL) {
+		perror(path);
+		return -ENOENT;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		size_t len = strlen(line);
+		while (len && strchr("\r\n", line[len - 1])) {
+			len--;
+		}
+		add_frame(line, len);
+	}
+
+	fclose(f);
+
+	return 0;
+}
+
+static void generate_corpus(void)
+{
+	static char buf[MAX_FRAME_LEN];
+	int n;
+
+	n = snprintf(buf, sizeof(buf), "[2,\"1\",\"MeterValues\","
+			"{\"connectorId\":1,\"transactionId\":42,"
+			"\"meterValue\":[");
+	for (int i = 0; i < 4; i++) {
+		n += snprintf(&buf[n], sizeof(buf) - (size_t)n,
+				"%s{\"timestamp\":\"2024-05-01T12:00:%02dZ\","
+				"\"sampledValue\":["
+				"{\"value\":\"%d.%d\",\"context\":"
+				"\"Sample.Periodic\",\"measurand\":"
+				"\"Energy.Active.Import.Register\","
+				"\"unit\":\"Wh\"},"
+				"{\"value\":\"230.1\","
+				"\"measurand\":\"Voltage\","
+				"\"phase\":\"L1-N\",\"unit\":\"V\"},"
+				"{\"value\":\"15.9\",\"measurand\":"
+				"\"Current.Import\",\"phase\":\"L1\","
+				"\"unit\":\"A\"}]}",
+				i? "," : "", i * 10, 12345 + i, i);
+	}
+	n += snprintf(&buf[n], sizeof(buf) - (size_t)n, "]}]");
+	add_frame(buf, (size_t)n);
+
+	n = snprintf(buf, sizeof(buf), "[3,\"bench\",{\"configurationKey\":[");
+	for (int i = 0; i < 24; i++) {
+		n += snprintf(&buf[n], sizeof(buf) - (size_t)n,
+				"%s{\"key\":\"ConfigurationKeyNumber%02d\","
+				"\"readonly\":%s,\"value\":\"%s\"}",
+				i? "," : "", i, i & 1? "true" : "false",
+				"Energy.Active.Import.Register,Voltage,"
+				"Current.Import,Power.Active.Import");
+	}
+	n += snprintf(&buf[n], sizeof(buf) - (size_t)n,
+			"],\"unknownKey\":[\"Foo\",\"Bar\"]}]");
+	add_frame(buf, (size_t)n);
+}
+
+static double get_elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)(now.tv_sec - start->tv_sec) +
+		(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void run(ocpp_json_scan_t impl)
+{
+	static uint8_t payload[65536] __attribute__((aligned(16)));
+	struct ocpp_message msg;
+	struct timespec start;
+	size_t bytes = 0;
+	size_t failures = 0;
+	double elapsed;
+
+	if (ocpp_json_scan_select(impl) != 0) {
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	do {
+		for (size_t i = 0; i < nr_frames; i++) {
+			if (ocpp_decode_json(&msg, payload, sizeof(payload),
+					frames[i].data, frames[i].len)) {
+				failures++;
+			}
+			bytes += frames[i].len;
+		}
+	} while ((elapsed = get_elapsed(&start)) < MIN_DURATION_SEC);
+
+	printf("%-8s %8.3f GB/s", ocpp_json_scan_stringify(impl),
+			(double)bytes / elapsed / 1e9);
+	if (failures) {
+		printf("  (%zu frames not decoded)", failures);
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct ocpp_GetConfiguration req = { 0, };
+	size_t total = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (load_corpus(argv[i]) != 0) {
+			return 1;
+		}
+	}
+	if (argc < 2) {
+		generate_corpus();
+	}
+
+	/* a pending request for the responses in the corpus to match */
+	ocpp_init(NULL, NULL);
+	ocpp_push_request(OCPP_MSG_GET_CONFIGURATION, &req, sizeof(req), NULL);
+	ocpp_step();
+
+	for (size_t i = 0; i < nr_frames; i++) {
+		total += frames[i].len;
+	}
+	printf("%zu frames, %zu bytes\n", nr_frames, total);
+
+	run(OCPP_JSON_SCAN_SCALAR);
+	run(OCPP_JSON_SCAN_SSE2);
+	run(OCPP_JSON_SCAN_AVX2);
+	run(OCPP_JSON_SCAN_NEON);
+
+	return 0;
+}
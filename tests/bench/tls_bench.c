@@ -0,0 +1,216 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * CPU time of a TLS handshake of the WebSocket transport, full and resumed,
+ * both ends counted, as a fleet reconnecting after the central system
+ * restarted costs it.
+ *
+ *   tls_bench
+ *
+ * The server runs in-process over a socketpair with an RSA-2048 key, the
+ * usual certificate of a central system. A full handshake is forced by a
+ * server keeping no session. The resumed one offers the session of the
+ * connection before, once over a ticket of TLS 1.3 and once over a session
+ * ID of TLS 1.2.
+ */
+
+#include "ocpp/ws_tls.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#define MIN_DURATION_SEC			0.5
+
+static EVP_PKEY *key;
+static X509 *cert;
+static char ca_file[] = "/tmp/tls_bench_XXXXXX";
+
+static void add_ext(int nid, const char *value)
+{
+	X509V3_CTX ctx;
+	X509_EXTENSION *ext;
+
+	X509V3_set_ctx_nodb(&ctx);
+	X509V3_set_ctx(&ctx, cert, cert, NULL, NULL, 0);
+	ext = X509V3_EXT_conf_nid(NULL, &ctx, nid, value);
+	X509_add_ext(cert, ext, -1);
+	X509_EXTENSION_free(ext);
+}
+
+static int make_identity(void)
+{
+	X509_NAME *name;
+	FILE *fp;
+	int fd;
+
+	if ((key = EVP_RSA_gen(2048)) == NULL || (cert = X509_new()) == NULL) {
+		return -1;
+	}
+
+	X509_set_version(cert, 2);
+	ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+	X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+	X509_set_pubkey(cert, key);
+	name = X509_get_subject_name(cert);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+			(const unsigned char *)"csms", -1, -1, 0);
+	X509_set_issuer_name(cert, name);
+	add_ext(NID_basic_constraints, "critical,CA:TRUE");
+	add_ext(NID_subject_alt_name, "IP:127.0.0.1");
+	X509_sign(cert, key, EVP_sha256());
+
+	if ((fd = mkstemp(ca_file)) < 0 || (fp = fdopen(fd, "w")) == NULL) {
+		return -1;
+	}
+	PEM_write_X509(fp, cert);
+	fclose(fp);
+
+	return 0;
+}
+
+static SSL_CTX *new_server(int version, bool resumable)
+{
+	static const unsigned char sid_ctx[] = "csms";
+	SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+
+	SSL_CTX_use_certificate(ctx, cert);
+	SSL_CTX_use_PrivateKey(ctx, key);
+	SSL_CTX_set_min_proto_version(ctx, version);
+	SSL_CTX_set_max_proto_version(ctx, version);
+	SSL_CTX_set_session_id_context(ctx, sid_ctx, sizeof(sid_ctx));
+
+	if (!resumable) {
+		SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+		SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+	} else if (version == TLS1_2_VERSION) {
+		SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+	}
+
+	return ctx;
+}
+
+/* One connection: the handshake, a byte each way for the tickets to come
+ * in, then close_notify. */
+static int connect_once(SSL_CTX *server, const struct ocpp_ws_tls_param *p)
+{
+	int sv[2];
+	char c = 'x';
+	bool client_done = false;
+	bool server_done = false;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+		return -1;
+	}
+	fcntl(sv[0], F_SETFL, O_NONBLOCK);
+	fcntl(sv[1], F_SETFL, O_NONBLOCK);
+
+	SSL *ssl = SSL_new(server);
+	SSL_set_fd(ssl, sv[1]);
+	SSL_set_accept_state(ssl);
+
+	if (ocpp_ws_tls_start(sv[0], "127.0.0.1", 443, p) != 0) {
+		return -1;
+	}
+
+	for (int i = 0; i < 10000 && !(client_done && server_done); i++) {
+		if (!client_done && ocpp_ws_tls_send(&c, 1) == 1) {
+			client_done = true;
+		}
+		if (!server_done && SSL_read(ssl, &c, 1) == 1) {
+			server_done = SSL_write(ssl, &c, 1) == 1;
+		}
+	}
+	while (client_done && ocpp_ws_tls_recv(&c, 1) == -EAGAIN) {
+	}
+
+	ocpp_ws_tls_stop();
+	/* or the server gives up the session freed without shutting down */
+	SSL_set_shutdown(ssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+	SSL_free(ssl);
+	close(sv[0]);
+	close(sv[1]);
+
+	return client_done && server_done? 0 : -1;
+}
+
+static double get_cpu_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static double run(int version, bool resumable)
+{
+	const struct ocpp_ws_tls_param param = { .ca_file = ca_file, };
+	SSL_CTX *server = new_server(version, resumable);
+	struct ocpp_ws_tls_stats before;
+	struct ocpp_ws_tls_stats after;
+	unsigned int n = 0;
+	double start;
+	double elapsed;
+
+	/* the first one is always full, and loads the CA */
+	ocpp_ws_tls_forget();
+	connect_once(server, &param);
+	ocpp_ws_tls_get_stats(&before);
+
+	start = get_cpu_time();
+	do {
+		if (connect_once(server, &param) != 0) {
+			fprintf(stderr, "handshake failed\n");
+			exit(1);
+		}
+		n++;
+	} while ((elapsed = get_cpu_time() - start) < MIN_DURATION_SEC);
+
+	ocpp_ws_tls_get_stats(&after);
+	SSL_CTX_free(server);
+
+	printf("%-8s %-8s %10.1f us %8u/%u resumed\n",
+			version == TLS1_3_VERSION? "TLS 1.3" : "TLS 1.2",
+			resumable? "resumed" : "full", elapsed / n * 1e6,
+			after.resumed - before.resumed, n);
+
+	return elapsed / n;
+}
+
+int main(void)
+{
+	if (make_identity() != 0) {
+		fprintf(stderr, "no identity\n");
+		return 1;
+	}
+
+	printf("%-8s %-8s %13s\n", "", "", "cpu/handshake");
+
+	for (int i = 0; i < 2; i++) {
+		const int version = i? TLS1_2_VERSION : TLS1_3_VERSION;
+		const double full = run(version, false);
+		const double resumed = run(version, true);
+
+		printf("%-8s %-8s %10.1fx\n", "", "speedup", full / resumed);
+	}
+
+	ocpp_ws_tls_forget();
+	unlink(ca_file);
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Throughput of the WebSocket masking and UTF-8 validation for each
+ * implementation, over payloads from 64 B to 64 KB.
+ *
+ *   ws_bench
+ *
+ * The UTF-8 check runs on ASCII, the usual OCPP-J frame, and on text mixing
+ * 2-, 3- and 4-byte sequences, which takes the slow path of every kernel.
+ */
+
+#include "ocpp/ws_simd.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_PAYLOAD				65536
+#define MIN_DURATION_SEC			0.1
+
+static uint8_t ascii[MAX_PAYLOAD];
+static uint8_t mixed[MAX_PAYLOAD];
+static uint8_t buf[MAX_PAYLOAD + 1];
+
+static const ocpp_ws_simd_t impls[] = {
+	OCPP_WS_SIMD_SCALAR,
+	OCPP_WS_SIMD_SSE2,
+	OCPP_WS_SIMD_AVX2,
+	OCPP_WS_SIMD_NEON,
+};
+
+static void fill(void)
+{
+	static const char *pieces[] = { "Energy.Active", "\xc3\xa9",
+		"\xea\xb6\x8c", "\xf0\x9f\x94\x8c" };
+
+	for (size_t i = 0; i < sizeof(ascii); i++) {
+		ascii[i] = (uint8_t)"{\"value\":\"12.3\"}, "[i % 18];
+	}
+
+	/* padded with ASCII so that no sequence is cut off at the sizes run */
+	memset(mixed, 'a', sizeof(mixed));
+	for (size_t i = 0, k = 0; i < sizeof(mixed) - 16; k++) {
+		const char *s = pieces[k % 4];
+		const size_t len = strlen(s);
+
+		if ((i + len - 1) / 64 != i / 64) {
+			i = (i / 64 + 1) * 64;
+			continue;
+		}
+
+		memcpy(&mixed[i], s, len);
+		i += len;
+	}
+}
+
+static double get_elapsed(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)(now.tv_sec - start->tv_sec) +
+		(double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static double run_mask(size_t len)
+{
+	const uint8_t key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+	struct timespec start;
+	size_t bytes = 0;
+	double elapsed;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	do {
+		for (int i = 0; i < 64; i++) {
+			/* off by one as the payload after a 2-byte header */
+			ocpp_ws_mask(&buf[1], len, key);
+			bytes += len;
+		}
+	} while ((elapsed = get_elapsed(&start)) < MIN_DURATION_SEC);
+
+	return (double)bytes / elapsed / 1e9;
+}
+
+static double run_utf8(const uint8_t *data, size_t len, size_t *failures)
+{
+	struct timespec start;
+	size_t bytes = 0;
+	double elapsed;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	do {
+		for (int i = 0; i < 64; i++) {
+			if (!ocpp_ws_utf8_valid(data, len)) {
+				(*failures)++;
+			}
+			bytes += len;
+		}
+	} while ((elapsed = get_elapsed(&start)) < MIN_DURATION_SEC);
+
+	return (double)bytes / elapsed / 1e9;
+}
+
+int main(void)
+{
+	fill();
+
+	printf("%-8s %8s %12s %12s %12s\n", "", "size",
+			"mask", "utf8 ascii", "utf8 mixed");
+
+	for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+		if (ocpp_ws_simd_select(impls[i]) != 0) {
+			continue;
+		}
+
+		for (size_t len = 64; len <= MAX_PAYLOAD; len *= 4) {
+			size_t failures = 0;
+
+			printf("%-8s %8zu", ocpp_ws_simd_stringify(impls[i]),
+					len);
+			printf(" %7.3f GB/s", run_mask(len));
+			printf(" %7.3f GB/s", run_utf8(ascii, len, &failures));
+			printf(" %7.3f GB/s", run_utf8(mixed, len, &failures));
+			if (failures) {
+				printf("  (%zu rejected)", failures);
+			}
+			printf("\n");
+		}
+	}
+
+	return 0;
+}
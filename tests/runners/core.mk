@@ -5,6 +5,8 @@ COMPONENT_NAME = Core
 SRC_FILES = \
 	../src/ocpp.c \
 	../src/core/configuration.c \
+	../src/overrides.c \
+	../src/codec/schema.c \
 	../examples/messages.c \
 
 TEST_SRC_FILES = \
@@ -17,6 +19,7 @@ INCLUDE_DIRS = \
 
 MOCKS_SRC_DIRS =
 CPPUTEST_CPPFLAGS = -DOCPP_DEFAULT_TX_TIMEOUT_SEC=5 -DOCPP_DEFAULT_TX_RETRIES=2 \
+		    -DOCPP_FRAME_CACHE_SIZE=16 \
 		    -DOCPP_DEBUG=printf -DOCPP_ERROR=printf -DOCPP_INFO=printf \
 		    -include stdio.h
 
@@ -0,0 +1,25 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = coro
+
+SRC_FILES = \
+	../src/ocpp.c \
+	../src/core/configuration.c \
+	../src/overrides.c \
+	../src/codec/schema.c \
+
+TEST_SRC_FILES = \
+	src/coro_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DOCPP_VALIDATE_ON_PUSH=1
+# <coroutine> is included ahead of the memory leak detection macros. GCC
+# warns about the switch it generates for every coroutine body.
+CPPUTEST_CXXFLAGS = -std=c++20 -include coroutine -Wno-switch-default
+
+include runners/MakefileRunner
@@ -0,0 +1,20 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = decimal
+
+SRC_FILES = \
+	../src/codec/decimal.c \
+
+TEST_SRC_FILES = \
+	src/decimal_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+CPPUTEST_CXXFLAGS = -std=c++17
+
+include runners/MakefileRunner
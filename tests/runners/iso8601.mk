@@ -0,0 +1,20 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = iso8601
+
+SRC_FILES = \
+	../src/codec/iso8601.c \
+
+TEST_SRC_FILES = \
+	src/iso8601_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+CPPUTEST_CXXFLAGS = -std=c++17
+
+include runners/MakefileRunner
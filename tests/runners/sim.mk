@@ -0,0 +1,22 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = sim
+
+SRC_FILES = \
+	../src/ocpp.c \
+	../src/overrides.c \
+	../src/core/configuration.c \
+	../src/sim/sim.c \
+
+TEST_SRC_FILES = \
+	src/sim_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS =
+
+include runners/MakefileRunner
@@ -0,0 +1,23 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = typed
+
+SRC_FILES = \
+	../src/ocpp.c \
+	../src/core/configuration.c \
+	../src/overrides.c \
+	../src/codec/schema.c \
+
+TEST_SRC_FILES = \
+	src/typed_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DOCPP_VALIDATE_ON_PUSH=1
+CPPUTEST_CXXFLAGS = -std=c++17
+
+include runners/MakefileRunner
@@ -0,0 +1,38 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = ws
+
+SRC_FILES = \
+	../src/ocpp.c \
+	../src/core/configuration.c \
+	../src/overrides.c \
+	../src/strconv.c \
+	../src/codec/schema.c \
+	../src/codec/decimal.c \
+	../src/codec/iso8601.c \
+	../src/codec/json_encoder.c \
+	../src/codec/json_decoder.c \
+	../src/codec/json_scan.c \
+	../src/codec/cbor_encoder.c \
+	../src/codec/cbor_decoder.c \
+	../src/codec/codec.c \
+	../src/ws/ws.c \
+	../src/ws/ws_simd.c \
+	../src/ws/ws_deflate.c \
+	../src/ws/ws_uring.c \
+	../src/ws/ws_tls.c \
+
+TEST_SRC_FILES = \
+	src/ws_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = -DOCPP_WS_DEFLATE=1
+CPPUTEST_CXXFLAGS = -std=c++17
+LD_LIBRARIES = -lz
+
+include runners/MakefileRunner
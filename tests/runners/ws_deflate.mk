@@ -0,0 +1,24 @@
+# SPDX-License-Identifier: MIT
+
+COMPONENT_NAME = ws_deflate
+
+SRC_FILES = \
+	../src/ws/ws_deflate.c \
+
+TEST_SRC_FILES = \
+	src/ws_deflate_test.cpp \
+	src/test_all.cpp \
+
+INCLUDE_DIRS = \
+	$(CPPUTEST_HOME)/include \
+	../include \
+
+MOCKS_SRC_DIRS =
+CPPUTEST_CPPFLAGS = \
+	-DOCPP_WS_DEFLATE=1 \
+	-DOCPP_WS_DEFLATE_HEAPSIZE=65536 \
+	-DOCPP_WS_DEFLATE_MEM_LEVEL=4
+CPPUTEST_CXXFLAGS = -std=c++17
+LD_LIBRARIES = -lz
+
+include runners/MakefileRunner
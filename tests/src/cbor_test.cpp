@@ -0,0 +1,441 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ocpp.h"
+#include "ocpp/codec/cbor.h"
+#include "ocpp/codec/codec.h"
+#include "ocpp/codec/json.h"
+
+#include <errno.h>
+#include <stdalign.h>
+#include <stdio.h>
+#include <string.h>
+
+static struct ocpp_message sent;
+static struct {
+	struct ocpp_message msg;
+	int err;
+	bool pending;
+} received;
+
+int ocpp_send(const struct ocpp_message *msg) {
+	memcpy(&sent, msg, sizeof(*msg));
+	return 0;
+}
+
+int ocpp_recv(struct ocpp_message *msg) {
+	if (!received.pending) {
+		return -ENOMSG;
+	}
+	received.pending = false;
+	memcpy(msg, &received.msg, sizeof(*msg));
+	return received.err;
+}
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+void ocpp_generate_message_id(void *buf, size_t bufsize) {
+	static unsigned int id;
+	snprintf((char *)buf, bufsize, "%u", ++id);
+}
+
+TEST_GROUP(cbor) {
+	struct ocpp_message msg;
+	alignas(max_align_t) uint8_t payload[2048];
+	alignas(max_align_t) uint8_t payload2[2048];
+	uint8_t frame[512];
+	char json[1024];
+	char json2[1024];
+	size_t len;
+
+	void setup(void) {
+		memset(payload, 0xa5, sizeof(payload));
+		memset(payload2, 0x5a, sizeof(payload2));
+		memset(&sent, 0, sizeof(sent));
+		memset(&received, 0, sizeof(received));
+		ocpp_init(NULL, NULL);
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	int decode(const uint8_t *data, size_t n) {
+		return ocpp_decode_cbor(&msg, payload2, sizeof(payload2),
+				data, n);
+	}
+	void send_request(ocpp_message_t type) {
+		struct ocpp_Heartbeat req = { 0, };
+		LONGS_EQUAL(0, ocpp_push_request(type, &req, sizeof(req), NULL));
+		ocpp_step();
+	}
+	/* Goes from JSON to CBOR and back to JSON again, expecting the same
+	 * frame as the JSON codec alone gives. */
+	void round_trip(const char *text) {
+		size_t json_len;
+
+		LONGS_EQUAL(0, ocpp_decode_json(&msg, payload, sizeof(payload),
+				text, strlen(text)));
+		LONGS_EQUAL(0, ocpp_encode_json(&msg, json, sizeof(json),
+				&json_len));
+		LONGS_EQUAL(0, ocpp_encode_cbor(&msg, frame, sizeof(frame),
+				&len));
+		CHECK(len < json_len);
+
+		LONGS_EQUAL(0, decode(frame, len));
+		LONGS_EQUAL(0, ocpp_encode_json(&msg, json2, sizeof(json2),
+				NULL));
+		STRCMP_EQUAL(json, json2);
+	}
+};
+
+TEST(cbor, encode_ShouldWriteFrameKeyedByFieldIndex) {
+	struct ocpp_Authorize req;
+	memset(&req, 0, sizeof(req));
+	strcpy(req.idTag, "tag");
+	msg = (struct ocpp_message) {
+		.id = "1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_AUTHORIZE,
+	};
+	msg.payload.fmt.request = &req;
+	msg.payload.size = sizeof(req);
+	const uint8_t expected[] = {
+		0x84, 0x02, 0x61, '1', OCPP_MSG_AUTHORIZE,
+		0xa1, 0x00, 0x63, 't', 'a', 'g',
+	};
+
+	LONGS_EQUAL(0, ocpp_encode_cbor(&msg, frame, sizeof(frame), &len));
+	LONGS_EQUAL(sizeof(expected), len);
+	MEMCMP_EQUAL(expected, frame, sizeof(expected));
+}
+
+TEST(cbor, encode_ShouldReturnENOBUFS_WhenBufferTooSmall) {
+	msg = (struct ocpp_message) {
+		.id = "1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_HEARTBEAT,
+	};
+	size_t expected;
+
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_cbor(&msg, NULL, 0, &expected));
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_cbor(&msg, frame, expected - 1,
+			&len));
+	LONGS_EQUAL(expected, len);
+	LONGS_EQUAL(0, ocpp_encode_cbor(&msg, frame, expected, &len));
+	LONGS_EQUAL(expected, len);
+}
+
+TEST(cbor, decode_ShouldRoundTrip_WhenMessagesGiven) {
+	round_trip("[2,\"1\",\"BootNotification\",{\"chargePointModel\":\"M\","
+			"\"chargePointVendor\":\"V\",\"firmwareVersion\":\"1.0\"}]");
+	round_trip("[2,\"2\",\"RemoteStartTransaction\",{\"connectorId\":1,"
+			"\"idTag\":\"tag\",\"chargingProfile\":{"
+			"\"chargingProfileId\":3,\"stackLevel\":0,"
+			"\"chargingProfilePurpose\":\"TxProfile\","
+			"\"chargingProfileKind\":\"Recurring\","
+			"\"recurrencyKind\":\"Weekly\","
+			"\"chargingSchedule\":{\"chargingRateUnit\":\"A\","
+			"\"chargingSchedulePeriod\":[{\"startPeriod\":0,"
+			"\"limit\":32},{\"startPeriod\":60,"
+			"\"limit\":-1.5}]}}}]");
+	round_trip("[2,\"3\",\"DataTransfer\",{\"vendorId\":\"v\","
+			"\"data\":\"{\\\"a\\\":1}\"}]");
+	round_trip("[2,\"4\",\"GetConfiguration\","
+			"{\"key\":[\"HeartbeatInterval\",\"Foo\"]}]");
+	round_trip("[2,\"5\",\"SignedUpdateFirmware\","
+			"{\"requestId\":5,\"firmware\":{"
+			"\"location\":\"https://fw\","
+			"\"retrieveDateTime\":\"1969-12-31T23:59:59Z\","
+			"\"signingCertificate\":\"cert\","
+			"\"signature\":\"sig\"}}]");
+	round_trip("[2,\"6\",\"Heartbeat\",{}]");
+}
+
+TEST(cbor, decode_ShouldRoundTrip_WhenResponseGiven) {
+	send_request(OCPP_MSG_GET_CONFIGURATION);
+	snprintf(json2, sizeof(json2), "[3,\"%s\",{\"configurationKey\":["
+			"{\"key\":\"HeartbeatInterval\",\"readonly\":false,"
+			"\"value\":\"60\"},"
+			"{\"key\":\"AuthorizeRemoteTxRequests\",\"readonly\":true,"
+			"\"value\":\"true\"}],"
+			"\"unknownKey\":[\"Foo\",\"Bar\"]}]", sent.id);
+
+	round_trip(json2);
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, msg.role);
+	LONGS_EQUAL(OCPP_MSG_GET_CONFIGURATION, msg.type);
+}
+
+TEST(cbor, encode_ShouldShrinkMeterValuesByThreeTimesAtLeast) {
+	const char *text = "[2,\"1\",\"MeterValues\",{\"connectorId\":1,"
+		"\"transactionId\":42,\"meterValue\":["
+		"{\"timestamp\":\"2023-11-14T22:13:20Z\",\"sampledValue\":["
+		"{\"value\":\"1234.5\",\"context\":\"Sample.Periodic\","
+		"\"measurand\":\"Energy.Active.Import.Register\","
+		"\"location\":\"Outlet\",\"unit\":\"kWh\"},"
+		"{\"value\":\"16.0\",\"context\":\"Sample.Periodic\","
+		"\"measurand\":\"Current.Import\",\"phase\":\"L1\","
+		"\"location\":\"Outlet\",\"unit\":\"A\"},"
+		"{\"value\":\"230.1\",\"context\":\"Sample.Periodic\","
+		"\"measurand\":\"Voltage\",\"phase\":\"L1-N\","
+		"\"location\":\"Outlet\",\"unit\":\"V\"}]}]}]";
+
+	round_trip(text);
+	CHECK(len * 3 <= strlen(json));
+}
+
+TEST(cbor, decode_ShouldFillCallError_WhenCallErrorGiven) {
+	const uint8_t data[] = {
+		0x85, 0x04, 0x61, '9', OCPP_CALL_ERROR_NOT_IMPLEMENTED,
+		0x64, 'n', 'o', 'p', 'e', 0xa1, 0x61, 'x', 0x82, 0x01, 0xf6,
+	};
+
+	LONGS_EQUAL(0, decode(data, sizeof(data)));
+
+	const struct ocpp_CallError *err =
+		(const struct ocpp_CallError *)msg.payload.fmt.response;
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLERROR, msg.role);
+	STRCMP_EQUAL("9", msg.id);
+	LONGS_EQUAL(OCPP_CALL_ERROR_NOT_IMPLEMENTED, err->code);
+	STRCMP_EQUAL("nope", err->description);
+}
+
+TEST(cbor, decode_ShouldSkipUnknownAndNullMembers) {
+	const uint8_t data[] = {
+		0x84, 0x02, 0x61, '1', OCPP_MSG_AUTHORIZE,
+		0xa3, 0x63, 'f', 'o', 'o', 0x81, 0x00,
+		0x00, 0x63, 't', 'a', 'g',
+		0x18, 0x64, 0xf6,
+	};
+
+	LONGS_EQUAL(0, decode(data, sizeof(data)));
+	STRCMP_EQUAL("tag",
+		((const struct ocpp_Authorize *)msg.payload.fmt.request)->idTag);
+}
+
+TEST(cbor, decode_ShouldReturnError_WhenFrameNotUsable) {
+	const uint8_t truncated[] = { 0x84, 0x02, 0x61, '1', 0x00, 0xa1 };
+	const uint8_t trailing[] = { 0x84, 0x02, 0x61, '1',
+		OCPP_MSG_AUTHORIZE, 0xa0, 0x00 };
+	const uint8_t indefinite[] = { 0x84, 0x02, 0x61, '1',
+		OCPP_MSG_AUTHORIZE, 0xbf, 0xff };
+	const uint8_t unknown[] = { 0x84, 0x02, 0x61, '1', 0x18, 0xff, 0xa0 };
+	const uint8_t no_request[] = { 0x83, 0x03, 0x61, '1', 0xa0 };
+	const uint8_t too_long[] = { 0x84, 0x02, 0x61, '1',
+		OCPP_MSG_AUTHORIZE, 0xa1, 0x00, 0x78, 21,
+		'1', '2', '3', '4', '5', '6', '7', '8', '9', '0',
+		'1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '1' };
+	const uint8_t missing[] = { 0x84, 0x02, 0x61, '1',
+		OCPP_MSG_AUTHORIZE, 0xa0 };
+	uint8_t deep[32] = { 0x84, 0x02, 0x61, '1', OCPP_MSG_AUTHORIZE,
+		0xa1, 0x05 };
+	memset(&deep[7], 0x81, sizeof(deep) - 8);
+	deep[sizeof(deep) - 1] = 0x00;
+
+	LONGS_EQUAL(-EBADMSG, decode(truncated, sizeof(truncated)));
+	LONGS_EQUAL(-EBADMSG, decode(trailing, sizeof(trailing)));
+	LONGS_EQUAL(-EBADMSG, decode(indefinite, sizeof(indefinite)));
+	LONGS_EQUAL(-EBADMSG, decode(deep, sizeof(deep)));
+	LONGS_EQUAL(-ENOTSUP, decode(unknown, sizeof(unknown)));
+	LONGS_EQUAL(-ENOENT, decode(no_request, sizeof(no_request)));
+	LONGS_EQUAL(-ERANGE, decode(too_long, sizeof(too_long)));
+	LONGS_EQUAL(-EINVAL, decode(missing, sizeof(missing)));
+}
+
+TEST(cbor, step_ShouldReplyNotImplemented_WhenActionUnknown) {
+	const uint8_t call[] = { 0x84, 0x02, 0x63, 'a', 'b', 'c', 0x18, 0xff,
+		0xa0 };
+	const uint8_t expected[] = { 0x85, 0x04, 0x63, 'a', 'b', 'c',
+		OCPP_CALL_ERROR_NOT_IMPLEMENTED, 0x60, 0xa0 };
+
+	received.err = decode(call, sizeof(call));
+	LONGS_EQUAL(-ENOTSUP, received.err);
+	memcpy(&received.msg, &msg, sizeof(msg));
+	received.pending = true;
+
+	ocpp_step(); /* takes in the CALL and queues the CALLERROR */
+	ocpp_step();
+
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLERROR, sent.role);
+	LONGS_EQUAL(0, ocpp_encode_cbor(&sent, frame, sizeof(frame), &len));
+	LONGS_EQUAL(sizeof(expected), len);
+	MEMCMP_EQUAL(expected, frame, len);
+}
+
+TEST(cbor, negotiate_ShouldPickFirstKnownSubprotocol) {
+	const struct ocpp_codec *codec;
+
+	codec = ocpp_negotiate_codec("ocpp2.0.1, ocpp1.6+cbor, ocpp1.6");
+	STRCMP_EQUAL(OCPP_CODEC_CBOR_SUBPROTOCOL, codec->subprotocol);
+	CHECK(codec->binary);
+	POINTERS_EQUAL(ocpp_encode_cbor, codec->encode);
+
+	codec = ocpp_negotiate_codec("ocpp1.6");
+	STRCMP_EQUAL(OCPP_CODEC_JSON_SUBPROTOCOL, codec->subprotocol);
+	CHECK(!codec->binary);
+	POINTERS_EQUAL(ocpp_decode_json, codec->decode);
+
+	POINTERS_EQUAL(ocpp_negotiate_codec("ocpp1.6"),
+			ocpp_negotiate_codec(NULL));
+	POINTERS_EQUAL(NULL, ocpp_negotiate_codec("ocpp2.0.1,ocpp1.5"));
+}
+
+TEST(cbor, encoder_ShouldStreamFrameInPieces_WhenFrameLargerThanBuffer) {
+	static struct ocpp_KeyValue keys[33];
+	memset(keys, 0, sizeof(keys));
+	for (int i = 0; i < 32; i++) {
+		snprintf(keys[i].key, sizeof(keys[i].key), "Key%d", i);
+		memset(keys[i].value, 'a' + i % 26, 100);
+	}
+	struct ocpp_GetConfiguration_conf conf = {
+		.configurationKey = keys,
+	};
+	msg = (struct ocpp_message) {
+		.id = "1",
+		.role = OCPP_MSG_ROLE_CALLRESULT,
+		.type = OCPP_MSG_GET_CONFIGURATION,
+	};
+	msg.payload.fmt.response = &conf;
+	msg.payload.size = sizeof(conf);
+
+	for (const char *protocols : { "ocpp1.6", "ocpp1.6+cbor" }) {
+		const struct ocpp_codec *codec =
+			ocpp_negotiate_codec(protocols);
+		static uint8_t whole[8192];
+		static uint8_t streamed[8192];
+		size_t total, n, off = 0;
+		uint8_t piece[64];
+		struct ocpp_encoder enc;
+		int err;
+
+		LONGS_EQUAL(0, codec->encode(&msg, whole, sizeof(whole),
+				&total));
+		CHECK(total > sizeof(piece) * 10);
+
+		ocpp_encoder_init(&enc, codec, &msg);
+		do {
+			err = ocpp_encoder_next(&enc, piece, sizeof(piece), &n);
+			CHECK(err == 0 || err == -EAGAIN);
+			CHECK(n == sizeof(piece) || err == 0);
+			/* half of every other piece is not taken */
+			if (err == -EAGAIN && (off / sizeof(piece)) % 2) {
+				ocpp_encoder_rewind(&enc, n / 2);
+				n -= n / 2;
+			}
+			memcpy(&streamed[off], piece, n);
+			off += n;
+		} while (err == -EAGAIN);
+
+		LONGS_EQUAL(total, off);
+		MEMCMP_EQUAL(whole, streamed, total);
+	}
+}
+
+TEST(cbor, encoder_ShouldResumeFromLastElement_WhenEncodingPieces) {
+	const size_t rec = OCPP_METER_VALUE_SIZE(2);
+	const size_t start = OCPP_RECORD_OFFSET(struct ocpp_MeterValues,
+			meterValue, struct ocpp_MeterValue);
+	struct ocpp_MeterValues *req = (struct ocpp_MeterValues *)payload;
+
+	memset(payload, 0, sizeof(payload));
+	req->connectorId = 1;
+	for (size_t i = 0; i < 4; i++) {
+		struct ocpp_MeterValue *mv =
+			(struct ocpp_MeterValue *)&payload[start + rec * i];
+		struct ocpp_SampledValue *sv =
+			(struct ocpp_SampledValue *)mv->sampledValue;
+		mv->timestamp = 1700000000 + (time_t)i;
+		mv->nr_sampledValue = 2;
+		snprintf(sv[0].value, sizeof(sv[0].value), "%zu.5", i);
+		sv[0].measurand = OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER;
+		sv[0].unit = OCPP_UNIT_WH;
+		snprintf(sv[1].value, sizeof(sv[1].value), "%zu", i);
+	}
+	CHECK(start + rec * 4 <= sizeof(payload));
+	msg = (struct ocpp_message) {
+		.id = "1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_METER_VALUES,
+	};
+	msg.payload.fmt.request = payload;
+	msg.payload.size = start + rec * 4;
+
+	for (const char *protocols : { "ocpp1.6", "ocpp1.6+cbor" }) {
+		const struct ocpp_codec *codec =
+			ocpp_negotiate_codec(protocols);
+		uint8_t whole[1024];
+		uint8_t streamed[1024];
+		size_t total, n, off = 0;
+		uint8_t piece[1];
+		struct ocpp_encoder enc;
+		int err;
+
+		LONGS_EQUAL(0, codec->encode(&msg, whole, sizeof(whole),
+				&total));
+
+		ocpp_encoder_init(&enc, codec, &msg);
+		for (unsigned int i = 0; ; i++) {
+			err = ocpp_encoder_next(&enc, piece, sizeof(piece), &n);
+			CHECK(err == 0 || err == -EAGAIN);
+			/* every third piece is not taken */
+			if (err == -EAGAIN && i % 3 == 2) {
+				ocpp_encoder_rewind(&enc, n);
+				n = 0;
+			}
+			memcpy(&streamed[off], piece, n);
+			off += n;
+			/* resumed from the last element, not the frame start */
+			CHECK(enc.cursor.offset <= enc.offset);
+			CHECK(off < 32 || enc.offset - enc.cursor.offset < 64);
+			if (err != -EAGAIN) {
+				break;
+			}
+		}
+
+		LONGS_EQUAL(total, off);
+		MEMCMP_EQUAL(whole, streamed, total);
+	}
+}
+
+TEST(cbor, encoder_ShouldReturnEINVAL_WhenBufferSizeZero) {
+	struct ocpp_encoder enc;
+	uint8_t piece[32];
+	size_t n;
+
+	msg = (struct ocpp_message) {
+		.id = "1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_HEARTBEAT,
+	};
+
+	ocpp_encoder_init(&enc, ocpp_negotiate_codec(NULL), &msg);
+	LONGS_EQUAL(-EINVAL, ocpp_encoder_next(&enc, piece, 0, &n));
+	LONGS_EQUAL(0, ocpp_encoder_next(&enc, piece, sizeof(piece), &n));
+	LONGS_EQUAL(strlen("[2,\"1\",\"Heartbeat\",{}]"), n);
+}
+
+TEST(cbor, encoder_ShouldReturnEINVAL_WhenMessageNotRepresentable) {
+	struct ocpp_encoder enc;
+	uint8_t piece[16];
+	size_t n;
+
+	msg = (struct ocpp_message) {
+		.id = "1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_AUTHORIZE,
+	};
+
+	ocpp_encoder_init(&enc, ocpp_negotiate_codec(NULL), &msg);
+	LONGS_EQUAL(-EINVAL, ocpp_encoder_next(&enc, piece, sizeof(piece), &n));
+}
@@ -26,6 +26,42 @@ int ocpp_send(const struct ocpp_message *msg) {
         return mock().actualCall(__func__).returnIntValueOrDefault(0);
 }
 
+static struct {
+        bool enabled;
+        int err;
+        uint8_t sent[OCPP_FRAME_CACHE_SIZE];
+        size_t sent_len;
+} frame_cache;
+
+int ocpp_encode_frame(const struct ocpp_message *msg,
+                void *buf, size_t bufsize, size_t *len) {
+        if (!frame_cache.enabled) {
+                return -ENOTSUP;
+        }
+
+        mock().actualCall(__func__).withParameter("bufsize", bufsize);
+
+        if (frame_cache.err) {
+                return frame_cache.err;
+        }
+
+        memcpy(buf, msg->id, bufsize);
+        *len = bufsize;
+        return 0;
+}
+
+int ocpp_send_frame(const struct ocpp_message *msg,
+                const void *frame, size_t len) {
+        memcpy(sent.message_id, msg->id, sizeof(sent.message_id));
+        sent.role = msg->role;
+        sent.type = msg->type;
+
+        memcpy(frame_cache.sent, frame, len);
+        frame_cache.sent_len = len;
+
+        return mock().actualCall(__func__).returnIntValueOrDefault(0);
+}
+
 int ocpp_recv(struct ocpp_message *msg)
 {
         int rc = mock().actualCall(__func__)
@@ -35,6 +71,12 @@ int ocpp_recv(struct ocpp_message *msg)
         return rc;
 }
 
+static bool transport_keeps_alive;
+
+bool ocpp_transport_keeps_alive(void) {
+        return transport_keeps_alive;
+}
+
 int ocpp_lock(void) {
         return 0;
 }
@@ -71,6 +113,14 @@ static void on_ocpp_event(ocpp_event_t event_type,
                 .withParameter("msg_pair", msg_pair);
 }
 
+static void on_complete(ocpp_completion_t outcome,
+                const struct ocpp_message *resp, void *ctx) {
+        mock().actualCall(__func__)
+                .withParameter("outcome", outcome)
+                .withParameter("resp", resp != NULL)
+                .withParameter("ctx", ctx);
+}
+
 TEST_GROUP(Core) {
         void setup(void) {
                 srand((unsigned int)clock());
@@ -80,6 +130,8 @@ TEST_GROUP(Core) {
         void teardown(void) {
                 mock().checkExpectations();
                 mock().clear();
+                memset(&frame_cache, 0, sizeof(frame_cache));
+                transport_keeps_alive = false;
         }
 
         void step(int sec) {
@@ -160,6 +212,51 @@ TEST(Core, step_ShouldDropMessage_WhenFailedSendingMoreThanRetries) {
         step(OCPP_DEFAULT_TX_TIMEOUT_SEC*2);
 }
 
+TEST(Core, step_ShouldSendCachedFrame_WhenRetrying) {
+        const struct ocpp_DataTransfer data = {
+                .vendorId = "VendorID",
+        };
+        frame_cache.enabled = true;
+        ocpp_send_datatransfer(&data);
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_encode_frame")
+                .withParameter("bufsize", (size_t)OCPP_FRAME_CACHE_SIZE);
+        mock().expectOneCall("ocpp_send_frame").andReturnValue(-1);
+        step(0);
+        MEMCMP_EQUAL(sent.message_id, frame_cache.sent, OCPP_FRAME_CACHE_SIZE);
+        memset(&frame_cache.sent, 0, sizeof(frame_cache.sent));
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_send_frame").andReturnValue(-1);
+        mock().expectOneCall("on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_FREE)
+                .ignoreOtherParameters();
+        step(OCPP_DEFAULT_TX_TIMEOUT_SEC);
+        LONGS_EQUAL(OCPP_FRAME_CACHE_SIZE, frame_cache.sent_len);
+        MEMCMP_EQUAL(sent.message_id, frame_cache.sent, OCPP_FRAME_CACHE_SIZE);
+}
+
+TEST(Core, step_ShouldSendMessage_WhenFrameNotCached) {
+        const struct ocpp_DataTransfer data = {
+                .vendorId = "VendorID",
+        };
+        frame_cache.enabled = true;
+        frame_cache.err = -ENOBUFS;
+        ocpp_send_datatransfer(&data);
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_encode_frame").ignoreOtherParameters();
+        mock().expectOneCall("ocpp_send").andReturnValue(-1);
+        step(0);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_encode_frame").ignoreOtherParameters();
+        mock().expectOneCall("ocpp_send").andReturnValue(-1);
+        mock().expectOneCall("on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_FREE)
+                .ignoreOtherParameters();
+        step(OCPP_DEFAULT_TX_TIMEOUT_SEC);
+}
+
 TEST(Core, ShouldNeverSendHeartBeat_WhenBootNotificationNotAccepted) {
         int interval;
         ocpp_get_configuration("HeartbeatInterval", &interval, sizeof(interval), NULL);
@@ -231,6 +328,183 @@ TEST(Core, step_ShouldNotSendHeartBeat_WhenAnyMessageSentDuringHeartBeatInterval
         step(interval*3-1);
 }
 
+TEST(Core, step_ShouldSendHeartBeatOnlyForClockSync_WhenWebSocketPingEnabled) {
+        const uint32_t ping = 60;
+        LONGS_EQUAL(0, ocpp_set_configuration("WebSocketPingInterval",
+                                &ping, sizeof(ping)));
+        transport_keeps_alive = true;
+        go_bootnoti_accepted();
+
+        int interval;
+        time_t deadline;
+        ocpp_get_configuration("HeartbeatInterval", &interval, sizeof(interval), NULL);
+        LONGS_EQUAL(0, ocpp_get_next_deadline(&deadline));
+        LONGS_EQUAL(OCPP_CLOCK_SYNC_INTERVAL_SEC, deadline);
+
+        /* the link is kept alive by the transport */
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(interval);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(OCPP_CLOCK_SYNC_INTERVAL_SEC - 1);
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        step(OCPP_CLOCK_SYNC_INTERVAL_SEC);
+        check_tx(OCPP_MSG_ROLE_CALL, OCPP_MSG_HEARTBEAT);
+}
+
+TEST(Core, step_ShouldSendHeartBeat_WhenWebSocketPingEnabledButTransportNotPinging) {
+        const uint32_t ping = 60;
+        LONGS_EQUAL(0, ocpp_set_configuration("WebSocketPingInterval",
+                                &ping, sizeof(ping)));
+        go_bootnoti_accepted();
+
+        int interval;
+        time_t deadline;
+        ocpp_get_configuration("HeartbeatInterval", &interval, sizeof(interval), NULL);
+        LONGS_EQUAL(0, ocpp_get_next_deadline(&deadline));
+        LONGS_EQUAL(interval, deadline);
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        step(interval);
+        check_tx(OCPP_MSG_ROLE_CALL, OCPP_MSG_HEARTBEAT);
+}
+
+TEST(Core, step_ShouldHoldQueue_WhileLinkDown) {
+        const struct ocpp_DataTransfer data = {
+                .vendorId = "VendorID",
+        };
+        time_t deadline;
+
+        ocpp_send_datatransfer(&data);
+        ocpp_set_connected(false);
+        CHECK(!ocpp_is_connected());
+        LONGS_EQUAL(-ENOENT, ocpp_get_next_deadline(&deadline));
+
+        /* no attempt is made, let alone counted */
+        for (int i = 0; i < 10; i++) {
+                mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+                step(OCPP_DEFAULT_TX_TIMEOUT_SEC * i);
+        }
+        LONGS_EQUAL(1, ocpp_count_pending_requests());
+
+        ocpp_set_connected(true);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        step(OCPP_DEFAULT_TX_TIMEOUT_SEC * 10);
+        check_tx(OCPP_MSG_ROLE_CALL, OCPP_MSG_DATA_TRANSFER);
+}
+
+TEST(Core, step_ShouldResendRequestInFlight_WhenLinkBackWithAttemptNotCounted) {
+        const struct ocpp_DataTransfer data = {
+                .vendorId = "VendorID",
+        };
+        ocpp_send_datatransfer(&data);
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        step(0);
+
+        /* the reply is lost with the link */
+        ocpp_set_connected(false);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(100);
+        ocpp_set_connected(true);
+
+        const int t0 = 101;
+        for (int i = 0; i < OCPP_DEFAULT_TX_RETRIES; i++) {
+                mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+                mock().expectOneCall("ocpp_send").andReturnValue(0);
+                step(t0 + OCPP_DEFAULT_TX_TIMEOUT_SEC * i);
+                check_tx(OCPP_MSG_ROLE_CALL, OCPP_MSG_DATA_TRANSFER);
+        }
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_FREE)
+                .ignoreOtherParameters();
+        step(t0 + OCPP_DEFAULT_TX_TIMEOUT_SEC * OCPP_DEFAULT_TX_RETRIES);
+        LONGS_EQUAL(0, ocpp_count_pending_requests());
+}
+
+TEST(Core, step_ShouldKeepRetryInterval_WhenLinkBackWithTransactionMessageDeferred) {
+        int32_t interval;
+        ocpp_get_configuration("TransactionMessageRetryInterval",
+                        &interval, sizeof(interval), 0);
+        struct ocpp_StartTransaction start;
+        struct ocpp_message msg = {
+                .role = OCPP_MSG_ROLE_CALLERROR,
+                .type = OCPP_MSG_START_TRANSACTION,
+        };
+
+        ocpp_push_request_force(OCPP_MSG_START_TRANSACTION, &start, sizeof(start), NULL);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(0);
+
+        /* held back until the retry interval passes */
+        memcpy(msg.id, sent.message_id, sizeof(msg.id));
+        mock().expectOneCall("ocpp_recv").withOutputParameterReturning("msg", &msg, sizeof(msg));
+        mock().expectOneCall("on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_INCOMING)
+                .ignoreOtherParameters();
+        step(1);
+
+        ocpp_set_connected(false);
+        ocpp_set_connected(true);
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(2);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(interval);
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        step(1 + interval);
+        check_tx(OCPP_MSG_ROLE_CALL, OCPP_MSG_START_TRANSACTION);
+}
+
+TEST(Core, step_ShouldSendBootNotificationFirst_WhenLinkBackBeforeAccepted) {
+        const struct ocpp_DataTransfer data = {
+                .vendorId = "VendorID",
+        };
+        const struct ocpp_BootNotification boot = {
+                .chargePointModel = "Model",
+                .chargePointVendor = "Vendor",
+        };
+
+        ocpp_set_connected(false);
+        ocpp_send_datatransfer(&data);
+        ocpp_send_bootnotification(&boot);
+        ocpp_set_connected(true);
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        step(0);
+        check_tx(OCPP_MSG_ROLE_CALL, OCPP_MSG_BOOTNOTIFICATION);
+}
+
+TEST(Core, step_ShouldNotSendHeartBeat_WhileLinkDown) {
+        go_bootnoti_accepted();
+        ocpp_set_connected(false);
+
+        int interval;
+        time_t deadline;
+        ocpp_get_configuration("HeartbeatInterval", &interval, sizeof(interval), NULL);
+        LONGS_EQUAL(-ENOENT, ocpp_get_next_deadline(&deadline));
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(interval * 3);
+        LONGS_EQUAL(0, ocpp_count_pending_requests());
+
+        ocpp_set_connected(true);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        step(interval * 3);
+        check_tx(OCPP_MSG_ROLE_CALL, OCPP_MSG_HEARTBEAT);
+}
+
 TEST(Core, ShouldSendStartTransaction_WhenQueueIsFull) {
         int interval;
         ocpp_get_configuration("HeartbeatInterval", &interval, sizeof(interval), NULL);
@@ -399,6 +673,26 @@ TEST(Core, ShouldReturnMSG_MAX_WhenInvalidTypeStringGiven) {
         LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string("UnknownType"));
 }
 
+TEST(Core, ShouldReturnType_WhenTypeStringOfAnyTypeGiven) {
+        for (int i = 0; i < OCPP_MSG_MAX; i++) {
+                const char *str = ocpp_stringify_type((ocpp_message_t)i);
+                LONGS_EQUAL(i, ocpp_get_type_from_string(str));
+                LONGS_EQUAL(i, ocpp_get_type_from_strn(str, strlen(str)));
+        }
+}
+
+TEST(Core, ShouldReturnType_WhenLengthDelimitedTypeStringGiven) {
+        const char *frame = "[2,\"1\",\"Heartbeat\",{}]";
+        LONGS_EQUAL(OCPP_MSG_HEARTBEAT, ocpp_get_type_from_strn(&frame[8], 9));
+}
+
+TEST(Core, ShouldReturnMSG_MAX_WhenTypeStringPrefixOrSuffixGiven) {
+        LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_strn("Heartbeat", 8));
+        LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string("HeartbeatX"));
+        LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_string(""));
+        LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_strn(NULL, 0));
+}
+
 TEST(Core, ShouldReturnMSG_MAX_WhenInvalidTypeIdGiven) {
         LONGS_EQUAL(OCPP_MSG_MAX, ocpp_get_type_from_idstr("UnknownId"));
 }
@@ -482,3 +776,109 @@ TEST(Core, ShouldRetryMessage_WhenMaxAttemptsNotReached) {
         msg = ocpp_get_message_by_id((const char *)id);
         CHECK(msg != NULL);
 }
+
+TEST(Core, ShouldCallCompletionCallback_WhenResponseReceived) {
+        struct ocpp_DataTransfer data = {
+                .vendorId = "VendorID",
+        };
+        LONGS_EQUAL(0, ocpp_push_request_cb(OCPP_MSG_DATA_TRANSFER,
+                        &data, sizeof(data), on_complete, &data));
+
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(0);
+
+        struct ocpp_message resp = {
+                .role = OCPP_MSG_ROLE_CALLRESULT,
+                .type = OCPP_MSG_DATA_TRANSFER,
+        };
+        mock().expectOneCall("ocpp_recv").withOutputParameterReturning("msg", &resp, sizeof(resp));
+        mock().expectOneCall("on_complete")
+                .withParameter("outcome", OCPP_COMPLETION_RESULT)
+                .withParameter("resp", true)
+                .withParameter("ctx", &data);
+        mock().expectOneCall("on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_INCOMING)
+                .ignoreOtherParameters();
+        mock().expectOneCall("on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_FREE)
+                .ignoreOtherParameters();
+        step(1);
+}
+
+TEST(Core, ShouldCallCompletionCallbackWithTimeout_WhenNoResponseReceived) {
+        const struct ocpp_DataTransfer data = {
+                .vendorId = "VendorID",
+        };
+        ocpp_push_request_cb(OCPP_MSG_DATA_TRANSFER, &data, sizeof(data),
+                        on_complete, NULL);
+
+        int i = 0;
+        for (; i < OCPP_DEFAULT_TX_RETRIES; i++) {
+                mock().expectOneCall("ocpp_send").andReturnValue(0);
+                mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+                step(i*OCPP_DEFAULT_TX_TIMEOUT_SEC);
+        }
+
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        mock().expectOneCall("on_complete")
+                .withParameter("outcome", OCPP_COMPLETION_TIMEOUT)
+                .withParameter("resp", false)
+                .withParameter("ctx", (void *)NULL);
+        mock().expectOneCall("on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_FREE)
+                .ignoreOtherParameters();
+        step(i*OCPP_DEFAULT_TX_TIMEOUT_SEC);
+}
+
+TEST(Core, ShouldCallCompletionCallbackWithDropped_WhenRemovedByForcePush) {
+        struct ocpp_DataTransfer data[8];
+        struct ocpp_StartTransaction start;
+        for (int i = 0; i < 8; i++) {
+                LONGS_EQUAL(0, ocpp_push_request_cb(OCPP_MSG_DATA_TRANSFER,
+                                &data[i], sizeof(data[i]), on_complete, &data[i]));
+        }
+
+        mock().expectOneCall("on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_FREE)
+                .ignoreOtherParameters();
+        LONGS_EQUAL(0, ocpp_push_request_force(OCPP_MSG_START_TRANSACTION, &start, sizeof(start), NULL));
+        mock().checkExpectations();
+
+        /* not from within the push, but on the next step */
+        mock().expectOneCall("on_complete")
+                .withParameter("outcome", OCPP_COMPLETION_DROPPED)
+                .withParameter("resp", false)
+                .withParameter("ctx", (void *)&data[0]);
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(0);
+}
+
+TEST(Core, ShouldCallEveryCompletionCallbackWithDropped_WhenWholeQueueRemovedByForcePushes) {
+        struct ocpp_DataTransfer data[8];
+        struct ocpp_StartTransaction start;
+        for (int i = 0; i < 8; i++) {
+                LONGS_EQUAL(0, ocpp_push_request_cb(OCPP_MSG_DATA_TRANSFER,
+                                &data[i], sizeof(data[i]), on_complete, &data[i]));
+        }
+
+        mock().expectNCalls(8, "on_ocpp_event")
+                .withParameter("event_type", OCPP_EVENT_MESSAGE_FREE)
+                .ignoreOtherParameters();
+        for (int i = 0; i < 8; i++) {
+                LONGS_EQUAL(0, ocpp_push_request_force(OCPP_MSG_START_TRANSACTION, &start, sizeof(start), NULL));
+        }
+        LONGS_EQUAL(-ENOMEM, ocpp_push_request_force(OCPP_MSG_START_TRANSACTION, &start, sizeof(start), NULL));
+        mock().checkExpectations();
+
+        for (int i = 0; i < 8; i++) {
+                mock().expectOneCall("on_complete")
+                        .withParameter("outcome", OCPP_COMPLETION_DROPPED)
+                        .withParameter("resp", false)
+                        .withParameter("ctx", (void *)&data[i]);
+        }
+        mock().expectOneCall("ocpp_send").andReturnValue(0);
+        mock().expectOneCall("ocpp_recv").ignoreOtherParameters().andReturnValue(-ENOMSG);
+        step(0);
+}
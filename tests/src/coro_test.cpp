@@ -0,0 +1,241 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/coro.hpp"
+#include "ocpp/overrides.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+static struct {
+	struct ocpp_message sent;
+	struct ocpp_message resp;
+	bool has_resp;
+	time_t now;
+} t;
+
+time_t time(time_t *second) {
+	return t.now;
+}
+
+int ocpp_send(const struct ocpp_message *msg) {
+	memcpy(&t.sent, msg, sizeof(*msg));
+	return mock().actualCall(__func__)
+		.withParameter("type", msg->type)
+		.returnIntValueOrDefault(0);
+}
+
+int ocpp_recv(struct ocpp_message *msg) {
+	if (!t.has_resp) {
+		return -ENOMSG;
+	}
+	t.has_resp = false;
+	memcpy(msg, &t.resp, sizeof(*msg));
+	return 0;
+}
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+void ocpp_generate_message_id(void *buf, size_t bufsize) {
+	static unsigned int id;
+	snprintf((char *)buf, bufsize, "%u", ++id);
+}
+
+static void respond(ocpp_message_role_t role, const void *conf) {
+	t.resp = t.sent;
+	t.resp.role = role;
+	t.resp.payload.fmt.response = conf;
+	t.has_resp = true;
+}
+
+static ocpp::task authorize_then_start(const ocpp::Authorize &auth,
+		const ocpp::StartTransaction &start, int *transaction_id) {
+	auto a = co_await ocpp::call<ocpp::Authorize>(auth);
+	mock().actualCall("authorized").withParameter("ok", (bool)a)
+		.withParameter("status", a.conf->idTagInfo.status);
+
+	auto s = co_await ocpp::call(start);
+	*transaction_id = s? s.conf->transactionId : -1;
+}
+
+template <typename T>
+static ocpp::task await_once(const T &req,
+		ocpp_completion_t *outcome, int *error) {
+	auto res = co_await ocpp::call(req);
+	*outcome = res.outcome;
+	*error = res.error;
+}
+
+static ocpp::task await_error(const ocpp::Authorize &req,
+		ocpp_call_error_t *code) {
+	auto res = co_await ocpp::call(req);
+	mock().actualCall("resumed")
+		.withParameter("outcome", res.outcome)
+		.withParameter("conf", (const void *)res.conf);
+	*code = res.call_error? res.call_error->code : OCPP_CALL_ERROR_GENERIC;
+}
+
+static ocpp::task send_vendor(ocpp_completion_t *outcome) {
+	const ocpp::builder<ocpp::DataTransfer, 512> req(
+			{ .vendorId = "vendor" });
+	auto res = co_await ocpp::call(req);
+	*outcome = res.outcome;
+}
+
+static void on_event(ocpp_event_t event_type,
+		const struct ocpp_message *msg, void *ctx) {
+	(void)ctx;
+	if (event_type == OCPP_EVENT_MESSAGE_FREE) {
+		const struct ocpp_DataTransfer *req =
+			(const struct ocpp_DataTransfer *)
+			msg->payload.fmt.request;
+		mock().actualCall("freed").withParameter("intact",
+				strcmp(req->vendorId, "vendor") == 0);
+	}
+}
+
+TEST_GROUP(coro) {
+	void setup(void) {
+		memset(&t, 0, sizeof(t));
+		ocpp_init(NULL, NULL);
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(coro, call_ShouldResumeWithConf_WhenResultReceived) {
+	const ocpp::Authorize auth = { .idTag = "tag" };
+	const ocpp::StartTransaction start = {
+		.connectorId = 1, .idTag = "tag", .timestamp = 1,
+	};
+	const ocpp::Authorize_conf auth_conf = {
+		.idTagInfo = { .status = OCPP_AUTH_STATUS_ACCEPTED },
+	};
+	const ocpp::StartTransaction_conf start_conf = { .transactionId = 7 };
+	int transaction_id = 0;
+
+	authorize_then_start(auth, start, &transaction_id);
+	LONGS_EQUAL(1, ocpp_count_pending_requests());
+
+	mock().expectOneCall("ocpp_send")
+		.withParameter("type", OCPP_MSG_AUTHORIZE);
+	ocpp_step();
+
+	respond(OCPP_MSG_ROLE_CALLRESULT, &auth_conf);
+	mock().expectOneCall("authorized").withParameter("ok", true)
+		.withParameter("status", OCPP_AUTH_STATUS_ACCEPTED);
+	ocpp_step();
+
+	mock().expectOneCall("ocpp_send")
+		.withParameter("type", OCPP_MSG_START_TRANSACTION);
+	ocpp_step();
+	respond(OCPP_MSG_ROLE_CALLRESULT, &start_conf);
+	ocpp_step();
+
+	LONGS_EQUAL(7, transaction_id);
+	LONGS_EQUAL(0, ocpp_count_pending_requests());
+}
+
+TEST(coro, call_ShouldResumeWithCallErrorOnly_WhenErrorReceived) {
+	const ocpp::Authorize req = { .idTag = "tag" };
+	const struct ocpp_CallError err = {
+		.code = OCPP_CALL_ERROR_NOT_IMPLEMENTED,
+	};
+	ocpp_call_error_t code = OCPP_CALL_ERROR_GENERIC;
+
+	await_error(req, &code);
+
+	mock().expectOneCall("ocpp_send")
+		.withParameter("type", OCPP_MSG_AUTHORIZE);
+	ocpp_step();
+
+	respond(OCPP_MSG_ROLE_CALLERROR, &err);
+	mock().expectOneCall("resumed")
+		.withParameter("outcome", OCPP_COMPLETION_ERROR)
+		.withParameter("conf", (const void *)NULL);
+	ocpp_step();
+
+	LONGS_EQUAL(OCPP_CALL_ERROR_NOT_IMPLEMENTED, code);
+}
+
+TEST(coro, call_ShouldResumeWithTimeout_WhenNoResponseReceived) {
+	const ocpp::builder<ocpp::DataTransfer, 512> req(
+			{ .vendorId = "vendor" });
+	ocpp_completion_t outcome = OCPP_COMPLETION_RESULT;
+	int error = -1;
+
+	await_once(req, &outcome, &error);
+
+	mock().expectNCalls(3, "ocpp_send")
+		.withParameter("type", OCPP_MSG_DATA_TRANSFER);
+	for (int i = 0; i <= 3; i++) {
+		t.now = i * OCPP_DEFAULT_TX_TIMEOUT_SEC;
+		ocpp_step();
+	}
+
+	LONGS_EQUAL(OCPP_COMPLETION_TIMEOUT, outcome);
+	LONGS_EQUAL(0, error);
+}
+
+TEST(coro, call_ShouldResumeImmediately_WhenQueueIsFull) {
+	const ocpp::builder<ocpp::DataTransfer, 512> req(
+			{ .vendorId = "vendor" });
+	ocpp_completion_t outcome = OCPP_COMPLETION_RESULT;
+	int error = 0;
+
+	while (ocpp_push_request(OCPP_MSG_DATA_TRANSFER,
+			req.data(), req.size(), NULL) == 0) {
+	}
+
+	await_once(req, &outcome, &error);
+
+	LONGS_EQUAL(OCPP_COMPLETION_DROPPED, outcome);
+	LONGS_EQUAL(-ENOMEM, error);
+}
+
+TEST(coro, call_ShouldResumeWithEINVAL_WhenRequestInvalid) {
+	const ocpp::Authorize req = {};
+	ocpp_completion_t outcome = OCPP_COMPLETION_RESULT;
+	int error = 0;
+
+	await_once(req, &outcome, &error);
+
+	LONGS_EQUAL(OCPP_COMPLETION_DROPPED, outcome);
+	LONGS_EQUAL(-EINVAL, error);
+	LONGS_EQUAL(0, ocpp_count_pending_requests());
+}
+
+TEST(coro, call_ShouldKeepRequestForFreeEvent_WhenCoroutineEnded) {
+	const ocpp::DataTransfer_conf conf = {
+		.status = OCPP_DATA_STATUS_ACCEPTED,
+	};
+	ocpp_completion_t outcome = OCPP_COMPLETION_DROPPED;
+
+	ocpp_init(on_event, NULL);
+	send_vendor(&outcome);
+
+	mock().expectOneCall("ocpp_send")
+		.withParameter("type", OCPP_MSG_DATA_TRANSFER);
+	ocpp_step();
+
+	/* the frame of the coroutine is gone by the time it is freed */
+	respond(OCPP_MSG_ROLE_CALLRESULT, &conf);
+	mock().expectOneCall("freed").withParameter("intact", true);
+	ocpp_step();
+
+	LONGS_EQUAL(OCPP_COMPLETION_RESULT, outcome);
+}
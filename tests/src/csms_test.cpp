@@ -0,0 +1,352 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/csms.h"
+#include "ocpp/ws.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+/* unique within a second too, for the calls to follow one another */
+void ocpp_generate_message_id(void *buf, size_t bufsize) {
+	static unsigned int seq;
+	snprintf((char *)buf, bufsize, "cp-%u", ++seq);
+}
+
+struct received {
+	ocpp_message_role_t role;
+	ocpp_message_t type;
+	std::string text;
+};
+
+/* what the engine got from the central system */
+static std::vector<struct ocpp_message> incoming;
+static struct ocpp_BootNotification_conf boot_conf;
+static std::vector<int> transaction_ids;
+/* what the central system got from the engine */
+static std::vector<struct received> received;
+
+static void on_engine_event(ocpp_event_t event_type,
+		const struct ocpp_message *msg, void *ctx) {
+	(void)ctx;
+	if (event_type != OCPP_EVENT_MESSAGE_INCOMING) {
+		return;
+	}
+	incoming.push_back(*msg);
+
+	if (msg->role == OCPP_MSG_ROLE_CALL && msg->type == OCPP_MSG_RESET) {
+		/* kept by the engine until sent */
+		static struct ocpp_Reset_conf conf;
+		conf.status = OCPP_REMOTE_STATUS_ACCEPTED;
+		LONGS_EQUAL(0, ocpp_push_response(msg, &conf, sizeof(conf),
+					false, NULL));
+	} else if (msg->role == OCPP_MSG_ROLE_CALLRESULT &&
+			msg->type == OCPP_MSG_BOOTNOTIFICATION) {
+		memcpy(&boot_conf, msg->payload.fmt.response,
+				sizeof(boot_conf));
+	} else if (msg->role == OCPP_MSG_ROLE_CALLRESULT &&
+			msg->type == OCPP_MSG_START_TRANSACTION) {
+		transaction_ids.push_back(((const struct
+				ocpp_StartTransaction_conf *)
+				msg->payload.fmt.response)->transactionId);
+	}
+}
+
+static void on_csms_message(const struct ocpp_message *msg,
+		const char *text, size_t len, void *ctx) {
+	(void)ctx;
+	received.push_back({ msg->role, msg->type, std::string(text, len) });
+}
+
+static uint64_t now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+TEST_GROUP(csms) {
+	struct ocpp_csms_param param;
+
+	void setup(void) {
+		incoming.clear();
+		received.clear();
+		transaction_ids.clear();
+		memset(&boot_conf, 0, sizeof(boot_conf));
+		memset(&param, 0, sizeof(param));
+		param.heartbeat_interval = 300;
+		param.seed = 1;
+
+		ocpp_init(on_engine_event, NULL);
+	}
+	void teardown(void) {
+		ocpp_ws_close(1000);
+		ocpp_ws_close(1000);
+		ocpp_csms_stop();
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void step(void) {
+		ocpp_step();
+		(void)ocpp_ws_poll();
+		LONGS_EQUAL(0, ocpp_csms_poll(1));
+	}
+	void go_open(void) {
+		LONGS_EQUAL(0, ocpp_csms_start(&param,
+					on_csms_message, NULL));
+		go_connect();
+	}
+	void go_connect(void) {
+		const struct ocpp_ws_param ws = {
+			.host = "127.0.0.1",
+			.port = ocpp_csms_get_port(),
+			.path = "/ocpp/CP001",
+			.subprotocols = NULL,
+			.deflate = NULL,
+		};
+		LONGS_EQUAL(0, ocpp_ws_open(&ws));
+		for (int i = 0; i < 500 && (!ocpp_csms_connected() ||
+				ocpp_ws_get_state() != OCPP_WS_OPEN); i++) {
+			step();
+		}
+		CHECK(ocpp_csms_connected());
+		LONGS_EQUAL(OCPP_WS_OPEN, ocpp_ws_get_state());
+	}
+	/* Steps both sides until the engine got n messages in all. */
+	bool run_until_incoming(size_t n, int max_ms = 1000) {
+		const uint64_t until = now_ms() + (uint64_t)max_ms;
+		while (incoming.size() < n && now_ms() < until) {
+			step();
+		}
+		return incoming.size() >= n;
+	}
+	void push_heartbeat(void) {
+		LONGS_EQUAL(0, ocpp_push_request(OCPP_MSG_HEARTBEAT,
+					NULL, 0, NULL));
+	}
+};
+
+TEST(csms, start_ShouldListenOnPortPickedByKernel_WhenPortIsZero) {
+	LONGS_EQUAL(0, ocpp_csms_start(&param, NULL, NULL));
+	CHECK(ocpp_csms_get_port() != 0);
+	CHECK(!ocpp_csms_connected());
+	LONGS_EQUAL(-EALREADY, ocpp_csms_start(&param, NULL, NULL));
+	LONGS_EQUAL(-ENOTCONN, ocpp_csms_call(OCPP_MSG_RESET, NULL, 0, NULL));
+}
+
+TEST(csms, poll_ShouldReturnEINVAL_WhenNotStarted) {
+	LONGS_EQUAL(-EINVAL, ocpp_csms_poll(0));
+	LONGS_EQUAL(0, ocpp_csms_get_port());
+}
+
+TEST(csms, boot_ShouldBeAnsweredWithStatusConfigured_WhenConnected) {
+	struct ocpp_BootNotification boot = { };
+	struct ocpp_csms_stats stats;
+	strcpy(boot.chargePointModel, "model");
+	strcpy(boot.chargePointVendor, "vendor");
+	param.boot_status = OCPP_BOOT_STATUS_PENDING;
+	param.heartbeat_interval = 60;
+
+	go_open();
+	LONGS_EQUAL(0, ocpp_push_request(OCPP_MSG_BOOTNOTIFICATION,
+				&boot, sizeof(boot), NULL));
+	CHECK(run_until_incoming(1));
+
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, incoming[0].role);
+	LONGS_EQUAL(OCPP_MSG_BOOTNOTIFICATION, incoming[0].type);
+	LONGS_EQUAL(OCPP_BOOT_STATUS_PENDING, boot_conf.status);
+	LONGS_EQUAL(60, boot_conf.interval);
+	CHECK(boot_conf.currentTime != 0);
+
+	LONGS_EQUAL(1, received.size());
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALL, received[0].role);
+	LONGS_EQUAL(OCPP_MSG_BOOTNOTIFICATION, received[0].type);
+
+	ocpp_csms_get_stats(&stats);
+	LONGS_EQUAL(1, stats.connections);
+	LONGS_EQUAL(1, stats.received);
+	LONGS_EQUAL(1, stats.answered);
+	LONGS_EQUAL(0, stats.errors);
+}
+
+TEST(csms, answer_ShouldBeHeldBack_WhenLatencyConfigured) {
+	param.latency_ms = 100;
+	go_open();
+
+	const uint64_t start = now_ms();
+	push_heartbeat();
+	CHECK(run_until_incoming(1));
+
+	CHECK(now_ms() - start >= 100);
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, incoming[0].role);
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT, incoming[0].type);
+}
+
+TEST(csms, transaction_ShouldGetIncreasingIds_WhenStarted) {
+	struct ocpp_StartTransaction start = { };
+	strcpy(start.idTag, "tag");
+	start.connectorId = 1;
+	start.timestamp = time(NULL);
+
+	go_open();
+	for (size_t i = 0; i < 2; i++) {
+		LONGS_EQUAL(0, ocpp_push_request(OCPP_MSG_START_TRANSACTION,
+					&start, sizeof(start), NULL));
+		CHECK(run_until_incoming(i + 1));
+	}
+
+	LONGS_EQUAL(2, transaction_ids.size());
+	LONGS_EQUAL(1, transaction_ids[0]);
+	LONGS_EQUAL(2, transaction_ids[1]);
+	CHECK(received[1].text.find("StartTransaction") != std::string::npos);
+}
+
+TEST(csms, answer_ShouldBeCallError_WhenInjected) {
+	struct ocpp_csms_stats stats;
+	param.callerror_pct = 100;
+	go_open();
+
+	push_heartbeat();
+	CHECK(run_until_incoming(1));
+
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLERROR, incoming[0].role);
+	ocpp_csms_get_stats(&stats);
+	LONGS_EQUAL(1, stats.errors);
+	LONGS_EQUAL(0, stats.answered);
+}
+
+TEST(csms, answer_ShouldBeLeftOut_WhenDropInjected) {
+	struct ocpp_csms_stats stats;
+	param.drop_pct = 100;
+	go_open();
+
+	push_heartbeat();
+	CHECK(!run_until_incoming(1, 100));
+
+	ocpp_csms_get_stats(&stats);
+	LONGS_EQUAL(1, stats.received);
+	LONGS_EQUAL(1, stats.dropped);
+	LONGS_EQUAL(OCPP_WS_OPEN, ocpp_ws_get_state());
+}
+
+TEST(csms, connection_ShouldBeDropped_WhenDisconnectInjected) {
+	struct ocpp_csms_stats stats;
+	param.disconnect_pct = 100;
+	go_open();
+
+	push_heartbeat();
+	for (int i = 0; i < 500 &&
+			ocpp_ws_get_state() != OCPP_WS_CLOSED; i++) {
+		step();
+	}
+
+	LONGS_EQUAL(OCPP_WS_CLOSED, ocpp_ws_get_state());
+	CHECK(!ocpp_csms_connected());
+	ocpp_csms_get_stats(&stats);
+	LONGS_EQUAL(1, stats.disconnects);
+}
+
+TEST(csms, answer_ShouldBeNotImplemented_WhenTypeNotAnswered) {
+	struct ocpp_DataTransfer data = { };
+	strcpy(data.vendorId, "vendor");
+	go_open();
+
+	LONGS_EQUAL(0, ocpp_push_request(OCPP_MSG_DATA_TRANSFER,
+				&data, sizeof(data), NULL));
+	CHECK(run_until_incoming(1));
+
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLERROR, incoming[0].role);
+	LONGS_EQUAL(OCPP_MSG_DATA_TRANSFER, incoming[0].type);
+}
+
+TEST(csms, draws_ShouldRepeat_WhenSeedIsSame) {
+	struct ocpp_csms_stats first;
+	struct ocpp_csms_stats second;
+	std::vector<ocpp_message_role_t> roles[2];
+	param.callerror_pct = 50;
+	param.seed = 7;
+
+	for (int run = 0; run < 2; run++) {
+		incoming.clear();
+		go_open();
+		for (size_t i = 0; i < 10; i++) {
+			push_heartbeat();
+			CHECK(run_until_incoming(i + 1));
+			roles[run].push_back(incoming[i].role);
+		}
+		ocpp_csms_get_stats(run? &second : &first);
+		ocpp_ws_close(1000);
+		ocpp_ws_close(1000);
+		ocpp_csms_stop();
+	}
+
+	CHECK(roles[0] == roles[1]);
+	LONGS_EQUAL(first.errors, second.errors);
+	CHECK(first.errors > 0 && first.answered > 0);
+}
+
+TEST(csms, call_ShouldTellOfReply_WhenChargePointAnswers) {
+	struct ocpp_Reset reset = { };
+	struct ocpp_csms_stats stats;
+	char id[OCPP_MESSAGE_ID_MAXLEN];
+	reset.type = OCPP_RESET_SOFT;
+	go_open();
+
+	LONGS_EQUAL(0, ocpp_csms_call(OCPP_MSG_RESET,
+				&reset, sizeof(reset), id));
+	CHECK(run_until_incoming(1));
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALL, incoming[0].role);
+	LONGS_EQUAL(OCPP_MSG_RESET, incoming[0].type);
+	STRCMP_EQUAL(id, incoming[0].id);
+
+	for (int i = 0; i < 500 && received.empty(); i++) {
+		step();
+	}
+	LONGS_EQUAL(1, received.size());
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, received[0].role);
+	LONGS_EQUAL(OCPP_MSG_RESET, received[0].type);
+	CHECK(received[0].text.find("Accepted") != std::string::npos);
+
+	ocpp_csms_get_stats(&stats);
+	LONGS_EQUAL(1, stats.calls);
+	LONGS_EQUAL(1, stats.replies);
+}
+
+TEST(csms, connection_ShouldBeServedAgain_WhenChargePointReconnects) {
+	struct ocpp_csms_stats stats;
+	go_open();
+
+	ocpp_csms_disconnect();
+	for (int i = 0; i < 500 &&
+			ocpp_ws_get_state() != OCPP_WS_CLOSED; i++) {
+		step();
+	}
+	LONGS_EQUAL(OCPP_WS_CLOSED, ocpp_ws_get_state());
+
+	go_connect();
+	push_heartbeat();
+	CHECK(run_until_incoming(1));
+
+	ocpp_csms_get_stats(&stats);
+	LONGS_EQUAL(2, stats.connections);
+	LONGS_EQUAL(1, stats.disconnects);
+	LONGS_EQUAL(1, stats.answered);
+}
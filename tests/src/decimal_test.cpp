@@ -0,0 +1,91 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/codec/decimal.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+static const char *format(int64_t v, unsigned int scale) {
+	static char buf[OCPP_DECIMAL_MAXLEN + 1];
+	const int len = ocpp_format_decimal(buf, v, scale);
+	LONGS_EQUAL(strlen(buf), len);
+	return buf;
+}
+
+static int64_t parse(const char *s, unsigned int scale, int expected) {
+	int64_t v = 0;
+	LONGS_EQUAL(expected, ocpp_parse_decimal(s, strlen(s), scale, &v));
+	return v;
+}
+
+TEST_GROUP(decimal) {
+	void setup(void) {
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(decimal, format_ShouldWriteShortestString) {
+	STRCMP_EQUAL("32.5", format(325, 1));
+	STRCMP_EQUAL("32", format(320, 1));
+	STRCMP_EQUAL("0.5", format(5, 1));
+	STRCMP_EQUAL("-1.5", format(-15, 1));
+	STRCMP_EQUAL("-0.05", format(-5, 2));
+	STRCMP_EQUAL("0", format(0, 3));
+	STRCMP_EQUAL("12.34", format(12340, 3));
+	STRCMP_EQUAL("1000", format(1000, 0));
+}
+
+TEST(decimal, format_ShouldHandleLimits) {
+	STRCMP_EQUAL("-9223372036854775808", format(INT64_MIN, 0));
+	STRCMP_EQUAL("9.223372036854775807", format(INT64_MAX, 18));
+	STRCMP_EQUAL("-0.000000000000000001", format(-1, 18));
+}
+
+TEST(decimal, format_ShouldReturnEINVAL_WhenScaleTooLarge) {
+	char buf[OCPP_DECIMAL_MAXLEN + 1];
+	LONGS_EQUAL(-EINVAL,
+		ocpp_format_decimal(buf, 1, OCPP_DECIMAL_MAX_SCALE + 1));
+}
+
+TEST(decimal, parse_ShouldReturnScaledValue) {
+	LONGS_EQUAL(325, parse("32.5", 1, 0));
+	LONGS_EQUAL(320, parse("32", 1, 0));
+	LONGS_EQUAL(-15, parse("-1.5", 1, 0));
+	LONGS_EQUAL(65, parse("6.55", 1, 0));
+	LONGS_EQUAL(1500, parse("1.5e3", 0, 0));
+	LONGS_EQUAL(15, parse("150E-1", 0, 0));
+	LONGS_EQUAL(0, parse("0", 3, 0));
+}
+
+TEST(decimal, parse_ShouldReturnEBADMSG_WhenNotNumber) {
+	parse("", 1, -EBADMSG);
+	parse("-", 1, -EBADMSG);
+	parse("01", 1, -EBADMSG);
+	parse("1.", 1, -EBADMSG);
+	parse(".5", 1, -EBADMSG);
+	parse("1e", 1, -EBADMSG);
+	parse("1,5", 1, -EBADMSG);
+}
+
+TEST(decimal, parse_ShouldReturnERANGE_WhenOverflow) {
+	parse("9223372036854775808", 0, -ERANGE);
+	parse("922337203685477580.8", 1, -ERANGE);
+	LONGS_EQUAL(INT64_MIN, parse("-9223372036854775808", 0, 0));
+}
+
+TEST(decimal, ShouldRoundTrip) {
+	const int64_t values[] = { 0, 1, -1, 7, 10, -100, 123456, INT64_MAX };
+	const size_t n = sizeof(values) / sizeof(values[0]);
+
+	for (unsigned int scale = 0; scale <= 3; scale++) {
+		for (size_t i = 0; i < n; i++) {
+			LONGS_EQUAL(values[i],
+				parse(format(values[i], scale), scale, 0));
+		}
+	}
+}
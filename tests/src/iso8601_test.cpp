@@ -0,0 +1,96 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/codec/iso8601.h"
+
+#include <errno.h>
+#include <string.h>
+
+static const char *format(time_t t, struct ocpp_iso8601_cache *cache) {
+	static char buf[OCPP_ISO8601_LEN + 1];
+	const size_t len = ocpp_format_iso8601(buf, t, cache);
+	buf[len] = '\0';
+	return buf;
+}
+
+static time_t parse(const char *s, int expected) {
+	time_t t = 0;
+	LONGS_EQUAL(expected, ocpp_parse_iso8601(s, strlen(s), &t));
+	return t;
+}
+
+TEST_GROUP(iso8601) {
+	void setup(void) {
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(iso8601, format_ShouldWriteUtcTime) {
+	STRCMP_EQUAL("1970-01-01T00:00:00Z", format(0, NULL));
+	STRCMP_EQUAL("2023-11-14T22:13:20Z", format(1700000000, NULL));
+	STRCMP_EQUAL("2024-02-29T23:59:59Z", format(1709251199, NULL));
+	STRCMP_EQUAL("1969-12-31T23:59:59Z", format(-1, NULL));
+}
+
+TEST(iso8601, format_ShouldReturnFixedLength) {
+	char buf[OCPP_ISO8601_LEN];
+	LONGS_EQUAL(OCPP_ISO8601_LEN, ocpp_format_iso8601(buf, 0, NULL));
+}
+
+TEST(iso8601, format_ShouldFollowDayChange_WhenCacheGiven) {
+	struct ocpp_iso8601_cache cache = { 0, };
+
+	STRCMP_EQUAL("2023-11-14T23:59:59Z", format(1700006399, &cache));
+	STRCMP_EQUAL("2023-11-14T00:00:00Z", format(1699920000, &cache));
+	STRCMP_EQUAL("2023-11-15T00:00:00Z", format(1700006400, &cache));
+	STRCMP_EQUAL("1970-01-01T00:00:00Z", format(0, &cache));
+	STRCMP_EQUAL("1969-12-31T23:59:59Z", format(-1, &cache));
+}
+
+TEST(iso8601, parse_ShouldReturnTime_WhenUtcGiven) {
+	LONGS_EQUAL(0, parse("1970-01-01T00:00:00Z", 0));
+	LONGS_EQUAL(1700000000, parse("2023-11-14T22:13:20Z", 0));
+	LONGS_EQUAL(1700000000, parse("2023-11-14t22:13:20z", 0));
+	LONGS_EQUAL(1700000000, parse("2023-11-14T22:13:20", 0));
+}
+
+TEST(iso8601, parse_ShouldDropFraction) {
+	LONGS_EQUAL(1700000000, parse("2023-11-14T22:13:20.999Z", 0));
+	LONGS_EQUAL(1700000000, parse("2023-11-14T22:13:20.5", 0));
+}
+
+TEST(iso8601, parse_ShouldApplyOffset) {
+	LONGS_EQUAL(1700000000, parse("2023-11-15T07:13:20+09:00", 0));
+	LONGS_EQUAL(1700000000, parse("2023-11-15T07:13:20+0900", 0));
+	LONGS_EQUAL(1700000000, parse("2023-11-15T07:13:20+09", 0));
+	LONGS_EQUAL(1700000000, parse("2023-11-14T17:43:20.123-04:30", 0));
+}
+
+TEST(iso8601, parse_ShouldReturnEBADMSG_WhenMalformed) {
+	parse("", -EBADMSG);
+	parse("2023-11-14", -EBADMSG);
+	parse("2023-11-14 22:13:20Z", -EBADMSG);
+	parse("2023-11-14T22:13:20.Z", -EBADMSG);
+	parse("2023-11-14T22:13:20+9", -EBADMSG);
+	parse("2023-11-14T22:13:20+09:0", -EBADMSG);
+	parse("2023-11-14T22:13:20+24:00", -EBADMSG);
+	parse("2023-11-14T22:13:20ZZ", -EBADMSG);
+	parse("2023-13-14T22:13:20Z", -EBADMSG);
+	parse("2023-02-29T22:13:20Z", -EBADMSG);
+	parse("2023-11-14T24:00:00Z", -EBADMSG);
+}
+
+TEST(iso8601, parse_ShouldAcceptLeapDay) {
+	LONGS_EQUAL(1709251199, parse("2024-02-29T23:59:59Z", 0));
+}
+
+TEST(iso8601, ShouldRoundTrip) {
+	struct ocpp_iso8601_cache cache = { 0, };
+
+	for (time_t t = -86400 * 3; t < 4102444800; t += 7777777) {
+		LONGS_EQUAL(t, parse(format(t, &cache), 0));
+	}
+}
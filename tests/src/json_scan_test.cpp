@@ -0,0 +1,141 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/codec/json.h"
+#include "ocpp/codec/json_scan.h"
+
+#include <errno.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+ocpp_message_t ocpp_get_type_from_idstr(const char *idstr) {
+	return OCPP_MSG_MAX;
+}
+
+ocpp_message_t ocpp_get_type_from_strn(const char *typestr, size_t len) {
+	return len == 12 && memcmp(typestr, "DataTransfer", len) == 0?
+		OCPP_MSG_DATA_TRANSFER : OCPP_MSG_MAX;
+}
+
+static const ocpp_json_scan_t impls[] = {
+	OCPP_JSON_SCAN_SCALAR,
+	OCPP_JSON_SCAN_SSE2,
+	OCPP_JSON_SCAN_AVX2,
+	OCPP_JSON_SCAN_NEON,
+};
+
+TEST_GROUP(json_scan) {
+	void setup(void) {
+		ocpp_json_scan_select(OCPP_JSON_SCAN_AUTO);
+	}
+	void teardown(void) {
+		ocpp_json_scan_select(OCPP_JSON_SCAN_AUTO);
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(json_scan, select_ShouldPickAvailableImplementation_WhenAutoGiven) {
+	LONGS_EQUAL(0, ocpp_json_scan_select(OCPP_JSON_SCAN_AUTO));
+	CHECK(ocpp_json_scan_selected() != OCPP_JSON_SCAN_AUTO);
+	LONGS_EQUAL(0, ocpp_json_scan_select(OCPP_JSON_SCAN_SCALAR));
+	LONGS_EQUAL(OCPP_JSON_SCAN_SCALAR, ocpp_json_scan_selected());
+	STRCMP_EQUAL("scalar",
+			ocpp_json_scan_stringify(ocpp_json_scan_selected()));
+}
+
+TEST(json_scan, select_ShouldKeepCurrent_WhenUnavailableGiven) {
+	LONGS_EQUAL(0, ocpp_json_scan_select(OCPP_JSON_SCAN_SCALAR));
+	for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+		if (ocpp_json_scan_select(impls[i]) == 0) {
+			LONGS_EQUAL(impls[i], ocpp_json_scan_selected());
+		}
+	}
+	LONGS_EQUAL(-ENOTSUP, ocpp_json_scan_select(
+			(ocpp_json_scan_t)(OCPP_JSON_SCAN_AUTO + 1)));
+}
+
+TEST(json_scan, scan_ShouldMatchScalar_WhenAnyImplementationSelected) {
+	alignas(64) uint8_t block[OCPP_JSON_SCAN_BLOCK_SIZE + 1];
+	const uint8_t special[] = { '"', '\\', ' ', '\t', '\n', '\r', 0x00,
+		0x1f, 0x20, 0x7f, 0x80, 0xff, 'a', '{', ':' };
+
+	srand(1);
+
+	for (int n = 0; n < 1000; n++) {
+		struct ocpp_json_scan_mask expected;
+
+		for (size_t i = 0; i < sizeof(block); i++) {
+			block[i] = (n & 1)? (uint8_t)rand() :
+				special[(size_t)rand() % sizeof(special)];
+		}
+
+		/* unaligned on purpose */
+		ocpp_json_scan_select(OCPP_JSON_SCAN_SCALAR);
+		ocpp_json_scan(&block[n & 1], &expected);
+
+		for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+			struct ocpp_json_scan_mask actual;
+
+			if (ocpp_json_scan_select(impls[i]) != 0) {
+				continue;
+			}
+
+			ocpp_json_scan(&block[n & 1], &actual);
+			MEMCMP_EQUAL(&expected, &actual, sizeof(actual));
+		}
+	}
+}
+
+TEST(json_scan, decode_ShouldGiveSameResult_WhenAnyImplementationSelected) {
+	char frame[1024];
+	alignas(max_align_t) uint8_t expected[1024];
+	alignas(max_align_t) uint8_t payload[1024];
+	struct ocpp_message msg;
+	size_t expected_size;
+
+	snprintf(frame, sizeof(frame), "[2,\"1\",   \"DataTransfer\",\n  {"
+			"\"vendorId\":\"%s\\\"\\\\%s\",\"data\":\"%s\\u00e9%s\""
+			"      }    ]   ",
+			"0123456789012345678901234567890123456789012345678",
+			"abcdefghijklmnopqrstuvwxyz0123456789012345678901",
+			"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz"
+			"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz",
+			"0123456789");
+
+	ocpp_json_scan_select(OCPP_JSON_SCAN_SCALAR);
+	LONGS_EQUAL(0, ocpp_decode_json(&msg, expected, sizeof(expected),
+				frame, strlen(frame)));
+	expected_size = msg.payload.size;
+
+	for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+		if (ocpp_json_scan_select(impls[i]) != 0) {
+			continue;
+		}
+
+		const size_t end = (size_t)(strrchr(frame, ']') - frame);
+
+		for (size_t split = 0; split < end; split += 7) {
+			struct ocpp_json_decoder dec;
+
+			memset(payload, 0, sizeof(payload));
+			ocpp_json_decoder_init(&dec, &msg, payload,
+					sizeof(payload));
+
+			LONGS_EQUAL(-EAGAIN, ocpp_json_decoder_feed(&dec,
+						frame, split));
+			LONGS_EQUAL(0, ocpp_json_decoder_feed(&dec,
+						&frame[split],
+						strlen(frame) - split));
+			LONGS_EQUAL(expected_size, msg.payload.size);
+			MEMCMP_EQUAL(expected, payload, expected_size);
+		}
+	}
+
+	const struct ocpp_DataTransfer *p =
+		(const struct ocpp_DataTransfer *)expected;
+	STRCMP_EQUAL("0123456789012345678901234567890123456789012345678\"\\"
+			"abcdefghijklmnopqrstuvwxyz0123456789012345678901",
+			p->vendorId);
+}
@@ -0,0 +1,695 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ocpp.h"
+#include "ocpp/codec/json.h"
+#include "ocpp/codec/schema.h"
+
+#include <errno.h>
+#include <stdalign.h>
+#include <stdio.h>
+#include <string.h>
+
+static struct ocpp_message sent;
+static struct {
+	struct ocpp_message msg;
+	int err;
+	bool pending;
+} received;
+
+int ocpp_send(const struct ocpp_message *msg) {
+	memcpy(&sent, msg, sizeof(*msg));
+	return 0;
+}
+
+int ocpp_recv(struct ocpp_message *msg) {
+	if (!received.pending) {
+		return -ENOMSG;
+	}
+	received.pending = false;
+	memcpy(msg, &received.msg, sizeof(*msg));
+	return received.err;
+}
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+void ocpp_generate_message_id(void *buf, size_t bufsize) {
+	static unsigned int id;
+	snprintf((char *)buf, bufsize, "%u", ++id);
+}
+
+static struct ocpp_message make_message(ocpp_message_role_t role,
+		ocpp_message_t type, const char *id,
+		const void *payload, size_t size) {
+	struct ocpp_message msg;
+
+	memset(&msg, 0, sizeof(msg));
+	strcpy(msg.id, id);
+	msg.role = role;
+	msg.type = type;
+	msg.payload.fmt.request = payload;
+	msg.payload.size = size;
+
+	return msg;
+}
+
+TEST_GROUP(json) {
+	char buf[1024];
+	size_t len;
+
+	void setup(void) {
+		memset(buf, 0xa5, sizeof(buf));
+		memset(&sent, 0, sizeof(sent));
+		len = 0;
+		ocpp_init(NULL, NULL);
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(json, encode_ShouldWriteCallFrame_WhenRequestGiven) {
+	struct ocpp_BootNotification req;
+	memset(&req, 0, sizeof(req));
+	strcpy(req.chargePointModel, "Model");
+	strcpy(req.chargePointVendor, "Vendor");
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_BOOTNOTIFICATION, "1", &req, sizeof(req));
+	const char *expected = "[2,\"1\",\"BootNotification\","
+		"{\"chargePointModel\":\"Model\",\"chargePointVendor\":\"Vendor\"}]";
+
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL(expected, buf);
+	LONGS_EQUAL(strlen(expected), len);
+}
+
+TEST(json, encode_ShouldReportLength_WhenNoBufferGiven) {
+	struct ocpp_BootNotification req;
+	memset(&req, 0, sizeof(req));
+	strcpy(req.chargePointModel, "Model");
+	strcpy(req.chargePointVendor, "Vendor");
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_BOOTNOTIFICATION, "1", &req, sizeof(req));
+
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_json(&msg, NULL, 0, &len));
+	LONGS_EQUAL(84, len);
+}
+
+TEST(json, encode_ShouldReturnENOBUFS_WhenBufferTooSmall) {
+	struct ocpp_BootNotification req;
+	memset(&req, 0, sizeof(req));
+	strcpy(req.chargePointModel, "Model");
+	strcpy(req.chargePointVendor, "Vendor");
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_BOOTNOTIFICATION, "1", &req, sizeof(req));
+
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_json(&msg, buf, 10, &len));
+	LONGS_EQUAL(84, len);
+	MEMCMP_EQUAL("[2,\"1\",\"Bo", buf, 10);
+	LONGS_EQUAL(0xa5, (uint8_t)buf[10]);
+	/* exact fit leaves no room for the null terminator */
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, 84, &len));
+	LONGS_EQUAL(0xa5, (uint8_t)buf[84]);
+}
+
+TEST(json, encode_at_ShouldWriteFrameFromOffset) {
+	struct ocpp_BootNotification req;
+	memset(&req, 0, sizeof(req));
+	strcpy(req.chargePointModel, "Model");
+	strcpy(req.chargePointVendor, "Vendor");
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_BOOTNOTIFICATION, "1", &req, sizeof(req));
+
+	LONGS_EQUAL(-ENOBUFS, ocpp_encode_json_at(&msg, 10, buf, 8, &len));
+	LONGS_EQUAL(84, len);
+	MEMCMP_EQUAL("otNotifi", buf, 8);
+	LONGS_EQUAL(0xa5, (uint8_t)buf[8]);
+	LONGS_EQUAL(0, ocpp_encode_json_at(&msg, 80, buf, 8, &len));
+	STRCMP_EQUAL("r\"}]", buf);
+	LONGS_EQUAL(0, ocpp_encode_json_at(&msg, 84, buf, 8, &len));
+	STRCMP_EQUAL("", buf);
+}
+
+TEST(json, encode_ShouldReturnEINVAL_WhenRequiredEnumUnknown) {
+	struct ocpp_Authorize_conf conf;
+	memset(&conf, 0, sizeof(conf));
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALLRESULT,
+			OCPP_MSG_AUTHORIZE, "1", &conf, sizeof(conf));
+
+	LONGS_EQUAL(-EINVAL, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+}
+
+TEST(json, encode_ShouldReturnEINVAL_WhenPayloadMissing) {
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_AUTHORIZE, "1", NULL, 0);
+	LONGS_EQUAL(-EINVAL, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+}
+
+TEST(json, encode_ShouldWriteEmptyObject_WhenMessageHasNoFields) {
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_HEARTBEAT, "7", NULL, 0);
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[2,\"7\",\"Heartbeat\",{}]", buf);
+}
+
+TEST(json, encode_ShouldEscapeStrings) {
+	struct ocpp_DataTransfer req;
+	memset(&req, 0, sizeof(req));
+	strcpy(req.vendorId, "a\"b\\c\n\x01");
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_DATA_TRANSFER, "1", &req, sizeof(req));
+
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[2,\"1\",\"DataTransfer\","
+			"{\"vendorId\":\"a\\\"b\\\\c\\n\\u0001\"}]", buf);
+}
+
+TEST(json, encode_ShouldWriteTextUpToPayloadSize) {
+	alignas(struct ocpp_DataTransfer) uint8_t payload[
+		sizeof(struct ocpp_DataTransfer) + 8] = { 0, };
+	struct ocpp_DataTransfer *req = (struct ocpp_DataTransfer *)payload;
+	strcpy(req->vendorId, "v");
+	memcpy(req->data, "{\"a\":1}", 7);
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_DATA_TRANSFER, "1", payload,
+			offsetof(struct ocpp_DataTransfer, data) + 7);
+
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[2,\"1\",\"DataTransfer\","
+			"{\"vendorId\":\"v\",\"data\":\"{\\\"a\\\":1}\"}]", buf);
+}
+
+TEST(json, encode_ShouldWriteMeterValueRecords) {
+	const size_t rec = OCPP_METER_VALUE_SIZE(1);
+	const size_t off = OCPP_RECORD_OFFSET(struct ocpp_MeterValues,
+			meterValue, struct ocpp_MeterValue);
+	alignas(struct ocpp_MeterValue) uint8_t payload[256] = { 0, };
+	struct ocpp_MeterValues *req = (struct ocpp_MeterValues *)payload;
+	struct ocpp_MeterValue *mv1 = (struct ocpp_MeterValue *)&payload[off];
+	struct ocpp_MeterValue *mv2 =
+		(struct ocpp_MeterValue *)&payload[off + rec];
+	struct ocpp_SampledValue *sv1 =
+		(struct ocpp_SampledValue *)mv1->sampledValue;
+	struct ocpp_SampledValue *sv2 =
+		(struct ocpp_SampledValue *)mv2->sampledValue;
+
+	req->connectorId = 1;
+	mv1->timestamp = 1700000000;
+	mv1->nr_sampledValue = 1;
+	strcpy(sv1->value, "12.5");
+	sv1->measurand = OCPP_MEASURAND_ENERGY_ACTIVE_IMPORT_REGISTER;
+	sv1->unit = OCPP_UNIT_WH;
+	mv2->timestamp = 1700000001;
+	mv2->nr_sampledValue = 1;
+	strcpy(sv2->value, "13");
+
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_METER_VALUES, "1", payload, off + rec * 2);
+
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[2,\"1\",\"MeterValues\",{\"connectorId\":1,"
+			"\"meterValue\":[{\"timestamp\":\"2023-11-14T22:13:20Z\","
+			"\"sampledValue\":[{\"value\":\"12.5\","
+			"\"measurand\":\"Energy.Active.Import.Register\","
+			"\"unit\":\"Wh\"}]},"
+			"{\"timestamp\":\"2023-11-14T22:13:21Z\","
+			"\"sampledValue\":[{\"value\":\"13\"}]}]}]", buf);
+}
+
+TEST(json, encode_ShouldReturnEINVAL_WhenRecordExceedsPayload) {
+	const size_t off = OCPP_RECORD_OFFSET(struct ocpp_MeterValues,
+			meterValue, struct ocpp_MeterValue);
+	alignas(struct ocpp_MeterValue) uint8_t payload[256] = { 0, };
+	struct ocpp_MeterValue *mv = (struct ocpp_MeterValue *)&payload[off];
+	mv->nr_sampledValue = 2;
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_METER_VALUES, "1", payload,
+			off + OCPP_METER_VALUE_SIZE(1));
+
+	LONGS_EQUAL(-EINVAL, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+}
+
+TEST(json, encode_ShouldWriteNestedChargingProfile) {
+	const size_t profile_off = OCPP_RECORD_OFFSET(
+			struct ocpp_RemoteStartTransaction, chargingProfile,
+			struct ocpp_ChargingProfile);
+	const size_t schedule_off = OCPP_RECORD_OFFSET(
+			struct ocpp_ChargingProfile, chargingSchedule,
+			struct ocpp_ChargingSchedule);
+	alignas(struct ocpp_ChargingProfile) uint8_t payload[256] = { 0, };
+	struct ocpp_RemoteStartTransaction *req =
+		(struct ocpp_RemoteStartTransaction *)payload;
+	struct ocpp_ChargingProfile *profile =
+		(struct ocpp_ChargingProfile *)&payload[profile_off];
+	struct ocpp_ChargingSchedule *schedule =
+		(struct ocpp_ChargingSchedule *)
+		&payload[profile_off + schedule_off];
+	struct ocpp_ChargingSchedulePeriod *period =
+		(struct ocpp_ChargingSchedulePeriod *)
+		schedule->chargingSchedulePeriod;
+
+	req->connectorId = 1;
+	strcpy(req->idTag, "tag");
+	profile->chargingProfileId = 3;
+	profile->chargingProfilePurpose = OCPP_CHARGING_PROFILE_TX;
+	profile->chargingProfileKind = OCPP_CHARGING_PROFILE_KIND_RECURRING;
+	profile->recurrencyKind = OCPP_CHARGING_PROFILE_RECURRENCY_WEEKLY;
+	schedule->chargingRateUnit = OCPP_CHARGING_UNIT_AMPERE;
+	schedule->nr_chargingSchedulePeriod = 1;
+	period->limit_tenth = 320;
+
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALL,
+			OCPP_MSG_REMOTE_START_TRANSACTION, "1", payload,
+			profile_off + schedule_off +
+			OCPP_CHARGING_SCHEDULE_SIZE(1));
+
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[2,\"1\",\"RemoteStartTransaction\",{\"connectorId\":1,"
+			"\"idTag\":\"tag\",\"chargingProfile\":{"
+			"\"chargingProfileId\":3,\"stackLevel\":0,"
+			"\"chargingProfilePurpose\":\"TxProfile\","
+			"\"chargingProfileKind\":\"Recurring\","
+			"\"recurrencyKind\":\"Weekly\","
+			"\"chargingSchedule\":{\"chargingRateUnit\":\"A\","
+			"\"chargingSchedulePeriod\":[{\"startPeriod\":0,"
+			"\"limit\":32}]}}}]", buf);
+}
+
+TEST(json, encode_ShouldWriteCallResultFrame_WhenResponseGiven) {
+	struct ocpp_StartTransaction_conf conf;
+	memset(&conf, 0, sizeof(conf));
+	conf.idTagInfo.expiryDate = 1700000000;
+	conf.idTagInfo.status = OCPP_AUTH_STATUS_ACCEPTED;
+	conf.transactionId = 7;
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALLRESULT,
+			OCPP_MSG_START_TRANSACTION, "5", &conf, sizeof(conf));
+
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[3,\"5\",{\"idTagInfo\":{"
+			"\"expiryDate\":\"2023-11-14T22:13:20Z\","
+			"\"status\":\"Accepted\"},\"transactionId\":7}]", buf);
+}
+
+TEST(json, encode_ShouldWriteLists_WhenGetConfigurationResponseGiven) {
+	struct ocpp_KeyValue keys[3];
+	memset(keys, 0, sizeof(keys));
+	strcpy(keys[0].key, "HeartbeatInterval");
+	strcpy(keys[0].value, "60");
+	strcpy(keys[1].key, "AuthorizeRemoteTxRequests");
+	keys[1].readonly = true;
+	strcpy(keys[1].value, "true");
+	char unknown[] = "Foo\0Bar\0";
+	struct ocpp_GetConfiguration_conf conf = {
+		.configurationKey = keys,
+		.unknownKey = unknown,
+	};
+	const struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALLRESULT,
+			OCPP_MSG_GET_CONFIGURATION, "2", &conf, sizeof(conf));
+
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[3,\"2\",{\"configurationKey\":["
+			"{\"key\":\"HeartbeatInterval\",\"readonly\":false,"
+			"\"value\":\"60\"},"
+			"{\"key\":\"AuthorizeRemoteTxRequests\",\"readonly\":true,"
+			"\"value\":\"true\"}],"
+			"\"unknownKey\":[\"Foo\",\"Bar\"]}]", buf);
+}
+
+TEST(json, encode_ShouldWriteCallErrorFrame) {
+	struct ocpp_CallError err = {
+		.code = OCPP_CALL_ERROR_FORMATION_VIOLATION,
+	};
+	strcpy(err.description, "bad");
+	struct ocpp_message msg = make_message(OCPP_MSG_ROLE_CALLERROR,
+			OCPP_MSG_AUTHORIZE, "3", &err, sizeof(err));
+
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[4,\"3\",\"FormationViolation\",\"bad\",{}]", buf);
+
+	msg.payload.fmt.response = NULL;
+	msg.payload.size = 0;
+	LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[4,\"3\",\"NotSupported\",\"\",{}]", buf);
+}
+
+TEST(json, schema_ShouldDescribeEveryMessage_WhenGeneratedFromDefines) {
+	for (int type = 0; type < OCPP_MSG_MAX; type++) {
+		for (int response = 0; response < 2; response++) {
+			const struct ocpp_schema *schema = ocpp_get_schema(
+					(ocpp_message_t)type, response);
+
+			CHECK(schema != NULL);
+			CHECK(schema->size <= OCPP_MESSAGE_MAX_FIXED_SIZE);
+
+			for (uint16_t i = 0; i < schema->nr_fields; i++) {
+				const struct ocpp_field *field =
+					&schema->fields[i];
+				CHECK(field->name != NULL);
+				CHECK(field->offset + field->size
+						<= schema->size);
+			}
+		}
+	}
+
+	const struct ocpp_schema *schema =
+		ocpp_get_schema(OCPP_MSG_GET_DIAGNOSTICS, false);
+	STRCMP_EQUAL("location", schema->fields[0].name);
+	LONGS_EQUAL(offsetof(struct ocpp_GetDiagnostics, url),
+			schema->fields[0].offset);
+	LONGS_EQUAL(sizeof(((struct ocpp_GetDiagnostics *)0)->url),
+			schema->fields[0].size);
+	LONGS_EQUAL(OCPP_FIELD_REQUIRED, schema->fields[0].flags);
+}
+
+TEST(json, validate_ShouldReturnZero_WhenPayloadValid) {
+	struct ocpp_BootNotification req;
+	memset(&req, 0, sizeof(req));
+	strcpy(req.chargePointModel, "Model");
+	strcpy(req.chargePointVendor, "Vendor");
+
+	LONGS_EQUAL(0, ocpp_validate(OCPP_MSG_BOOTNOTIFICATION, false,
+			&req, sizeof(req)));
+	LONGS_EQUAL(0, ocpp_validate(OCPP_MSG_HEARTBEAT, false, NULL, 0));
+}
+
+TEST(json, validate_ShouldReturnEINVAL_WhenRequiredFieldMissing) {
+	struct ocpp_BootNotification req;
+	memset(&req, 0, sizeof(req));
+	strcpy(req.chargePointModel, "Model");
+
+	LONGS_EQUAL(-EINVAL, ocpp_validate(OCPP_MSG_BOOTNOTIFICATION, false,
+			&req, sizeof(req)));
+	LONGS_EQUAL(-EINVAL, ocpp_validate(OCPP_MSG_BOOTNOTIFICATION, false,
+			NULL, 0));
+	LONGS_EQUAL(-EINVAL, ocpp_validate(OCPP_MSG_BOOTNOTIFICATION, false,
+			&req, sizeof(req) - 1));
+}
+
+TEST(json, validate_ShouldReturnERANGE_WhenStringNotTerminated) {
+	struct ocpp_Authorize req;
+	memset(&req, 'a', sizeof(req));
+
+	LONGS_EQUAL(-ERANGE, ocpp_validate(OCPP_MSG_AUTHORIZE, false,
+			&req, sizeof(req)));
+}
+
+TEST(json, validate_ShouldReturnERANGE_WhenEnumOutOfRange) {
+	struct ocpp_ChangeAvailability req;
+	memset(&req, 0, sizeof(req));
+	req.connectorId = 1;
+	const int type = 100;
+	memcpy(&req.type, &type, sizeof(req.type));
+
+	LONGS_EQUAL(-ERANGE, ocpp_validate(OCPP_MSG_CHANGE_AVAILABILITY, false,
+			&req, sizeof(req)));
+}
+
+TEST(json, validate_ShouldReturnERANGE_WhenArrayExceedsPayload) {
+	const size_t off = OCPP_RECORD_OFFSET(struct ocpp_MeterValues,
+			meterValue, struct ocpp_MeterValue);
+	alignas(struct ocpp_MeterValue) uint8_t payload[256] = { 0, };
+	struct ocpp_MeterValue *mv = (struct ocpp_MeterValue *)&payload[off];
+	struct ocpp_SampledValue *sv =
+		(struct ocpp_SampledValue *)mv->sampledValue;
+	mv->timestamp = 1700000000;
+	mv->nr_sampledValue = 1;
+	strcpy(sv->value, "1");
+
+	LONGS_EQUAL(0, ocpp_validate(OCPP_MSG_METER_VALUES, false,
+			payload, off + OCPP_METER_VALUE_SIZE(1)));
+	mv->nr_sampledValue = 2;
+	LONGS_EQUAL(-ERANGE, ocpp_validate(OCPP_MSG_METER_VALUES, false,
+			payload, off + OCPP_METER_VALUE_SIZE(1)));
+}
+
+TEST_GROUP(json_decoder) {
+	struct ocpp_message msg;
+	alignas(max_align_t) uint8_t payload[512];
+	char buf[1024];
+	size_t len;
+
+	void setup(void) {
+		memset(payload, 0xa5, sizeof(payload));
+		memset(&sent, 0, sizeof(sent));
+		memset(&received, 0, sizeof(received));
+		ocpp_init(NULL, NULL);
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	int decode(const char *frame) {
+		return ocpp_decode_json(&msg, payload, sizeof(payload),
+				frame, strlen(frame));
+	}
+	const char *encode(void) {
+		LONGS_EQUAL(0, ocpp_encode_json(&msg, buf, sizeof(buf), &len));
+		return buf;
+	}
+	void send_request(ocpp_message_t type) {
+		struct ocpp_Heartbeat req = { 0, };
+		LONGS_EQUAL(0, ocpp_push_request(type, &req, sizeof(req), NULL));
+		ocpp_step();
+	}
+};
+
+TEST(json_decoder, decode_ShouldFillRequestStruct_WhenCallGiven) {
+	LONGS_EQUAL(0, decode(" [ 2 , \"19223201\" , \"ChangeAvailability\" ,"
+			" { \"type\" : \"Inoperative\", \"connectorId\": 1 } ]\r\n"));
+
+	const struct ocpp_ChangeAvailability *p =
+		(const struct ocpp_ChangeAvailability *)msg.payload.fmt.request;
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALL, msg.role);
+	LONGS_EQUAL(OCPP_MSG_CHANGE_AVAILABILITY, msg.type);
+	STRCMP_EQUAL("19223201", msg.id);
+	POINTERS_EQUAL(payload, p);
+	LONGS_EQUAL(sizeof(*p), msg.payload.size);
+	LONGS_EQUAL(1, p->connectorId);
+	LONGS_EQUAL(OCPP_INOPERATIVE, p->type);
+}
+
+TEST(json_decoder, decode_ShouldRoundTrip_WhenRecordsGiven) {
+	const char *frame = "[2,\"1\",\"RemoteStartTransaction\","
+		"{\"connectorId\":1,\"idTag\":\"tag\",\"chargingProfile\":{"
+		"\"chargingProfileId\":3,\"stackLevel\":0,"
+		"\"chargingProfilePurpose\":\"TxProfile\","
+		"\"chargingProfileKind\":\"Recurring\","
+		"\"recurrencyKind\":\"Weekly\","
+		"\"validFrom\":\"2023-11-14T22:13:20Z\","
+		"\"chargingSchedule\":{\"chargingRateUnit\":\"A\","
+		"\"chargingSchedulePeriod\":[{\"startPeriod\":0,\"limit\":32},"
+		"{\"startPeriod\":60,\"limit\":6.5,\"numberPhases\":3}]}}}]";
+
+	LONGS_EQUAL(0, decode(frame));
+
+	const struct ocpp_ChargingProfile *profile =
+		(const struct ocpp_ChargingProfile *)&payload[
+		OCPP_RECORD_OFFSET(struct ocpp_RemoteStartTransaction,
+				chargingProfile, struct ocpp_ChargingProfile)];
+	const struct ocpp_ChargingSchedule *schedule =
+		(const struct ocpp_ChargingSchedule *)((const uint8_t *)profile +
+		OCPP_RECORD_OFFSET(struct ocpp_ChargingProfile,
+				chargingSchedule, struct ocpp_ChargingSchedule));
+	const struct ocpp_ChargingSchedulePeriod *period =
+		(const struct ocpp_ChargingSchedulePeriod *)
+		schedule->chargingSchedulePeriod;
+
+	LONGS_EQUAL(1700000000, profile->validFrom);
+	LONGS_EQUAL(2, schedule->nr_chargingSchedulePeriod);
+	LONGS_EQUAL(320, period[0].limit_tenth);
+	LONGS_EQUAL(65, period[1].limit_tenth);
+	LONGS_EQUAL(3, period[1].numberPhases);
+	STRCMP_EQUAL(frame, encode());
+}
+
+TEST(json_decoder, decode_ShouldRoundTrip_WhenMeterValueRecordsGiven) {
+	const char *frame = "[2,\"1\",\"MeterValues\",{\"connectorId\":1,"
+		"\"transactionId\":7,"
+		"\"meterValue\":[{\"timestamp\":\"2023-11-14T22:13:20Z\","
+		"\"sampledValue\":[{\"value\":\"12.5\","
+		"\"measurand\":\"Energy.Active.Import.Register\","
+		"\"unit\":\"Wh\"},{\"value\":\"230\",\"phase\":\"L1\"}]},"
+		"{\"timestamp\":\"2023-11-14T22:13:21Z\","
+		"\"sampledValue\":[{\"value\":\"13\"}]}]}]";
+
+	LONGS_EQUAL(0, decode(frame));
+	LONGS_EQUAL(OCPP_RECORD_OFFSET(struct ocpp_MeterValues, meterValue,
+				struct ocpp_MeterValue) +
+			OCPP_METER_VALUE_SIZE(2) + OCPP_METER_VALUE_SIZE(1),
+			msg.payload.size);
+	STRCMP_EQUAL(frame, encode());
+}
+
+TEST(json_decoder, feed_ShouldDecodeFragments_WhenFrameSplitAnywhere) {
+	const char *frame = "[2,\"42\",\"DataTransfer\",{\"vendorId\":\"v\\u00e9"
+		"\\ud83d\\ude00\",\"messageId\":\"m\",\"data\":\"-1.5e3 \\\"x\\\"\","
+		"\"unknown\":{\"a\":[1,{\"b\":null}],\"c\":true}}]";
+	struct ocpp_message whole;
+	alignas(max_align_t) uint8_t expected[sizeof(payload)];
+
+	LONGS_EQUAL(0, ocpp_decode_json(&whole, expected, sizeof(expected),
+				frame, strlen(frame)));
+
+	for (size_t i = 0; i < strlen(frame); i++) {
+		struct ocpp_json_decoder dec;
+		memset(payload, 0, sizeof(payload));
+		ocpp_json_decoder_init(&dec, &msg, payload, sizeof(payload));
+
+		LONGS_EQUAL(-EAGAIN, ocpp_json_decoder_feed(&dec, frame, i));
+		LONGS_EQUAL(0, ocpp_json_decoder_feed(&dec, &frame[i],
+					strlen(frame) - i));
+		LONGS_EQUAL(whole.payload.size, msg.payload.size);
+		MEMCMP_EQUAL(expected, payload, msg.payload.size);
+	}
+
+	const struct ocpp_DataTransfer *p =
+		(const struct ocpp_DataTransfer *)payload;
+	STRCMP_EQUAL("v\xc3\xa9\xf0\x9f\x98\x80", p->vendorId);
+	STRCMP_EQUAL("-1.5e3 \"x\"", p->data);
+	LONGS_EQUAL(offsetof(struct ocpp_DataTransfer, data) + 11,
+			msg.payload.size);
+}
+
+TEST(json_decoder, decode_ShouldTypeResponse_WhenPendingRequestMatches) {
+	send_request(OCPP_MSG_BOOTNOTIFICATION);
+	snprintf(buf, sizeof(buf), "[3,\"%s\",{\"status\":\"Accepted\","
+			"\"currentTime\":\"2023-11-15T07:13:20.123+09:00\","
+			"\"interval\":300}]", sent.id);
+
+	LONGS_EQUAL(0, decode(buf));
+
+	const struct ocpp_BootNotification_conf *p =
+		(const struct ocpp_BootNotification_conf *)
+		msg.payload.fmt.response;
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, msg.role);
+	LONGS_EQUAL(OCPP_MSG_BOOTNOTIFICATION, msg.type);
+	LONGS_EQUAL(1700000000, p->currentTime);
+	LONGS_EQUAL(300, p->interval);
+	LONGS_EQUAL(OCPP_BOOT_STATUS_ACCEPTED, p->status);
+}
+
+TEST(json_decoder, decode_ShouldReturnENOENT_WhenNoPendingRequestMatches) {
+	LONGS_EQUAL(-ENOENT, decode("[3,\"unknown\",{}]"));
+	STRCMP_EQUAL("unknown", msg.id);
+}
+
+TEST(json_decoder, decode_ShouldReturnENOTSUP_WhenActionUnknown) {
+	LONGS_EQUAL(-ENOTSUP, decode("[2,\"7\",\"FooBar\",{}]"));
+	STRCMP_EQUAL("7", msg.id);
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALL, msg.role);
+}
+
+TEST(json_decoder, step_ShouldReplyNotImplemented_WhenActionUnknown) {
+	received.err = decode("[2,\"abc\",\"FooBar\",{}]");
+	LONGS_EQUAL(-ENOTSUP, received.err);
+	memcpy(&received.msg, &msg, sizeof(msg));
+	received.pending = true;
+
+	ocpp_step(); /* takes in the CALL and queues the CALLERROR */
+	ocpp_step();
+
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLERROR, sent.role);
+	LONGS_EQUAL(0, ocpp_encode_json(&sent, buf, sizeof(buf), &len));
+	STRCMP_EQUAL("[4,\"abc\",\"NotImplemented\",\"\",{}]", buf);
+}
+
+TEST(json_decoder, decode_ShouldFillCallError_WhenCallErrorGiven) {
+	send_request(OCPP_MSG_HEARTBEAT);
+	snprintf(buf, sizeof(buf), "[4,\"%s\",\"NotImplemented\",\"nope\","
+			"{\"x\":[1,2,{\"y\":\"z\"}]}]", sent.id);
+
+	LONGS_EQUAL(0, decode(buf));
+
+	const struct ocpp_CallError *p =
+		(const struct ocpp_CallError *)msg.payload.fmt.response;
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLERROR, msg.role);
+	LONGS_EQUAL(OCPP_MSG_HEARTBEAT, msg.type);
+	LONGS_EQUAL(OCPP_CALL_ERROR_NOT_IMPLEMENTED, p->code);
+	STRCMP_EQUAL("nope", p->description);
+}
+
+TEST(json_decoder, decode_ShouldFillLists_WhenStringListsGiven) {
+	LONGS_EQUAL(0, decode("[2,\"1\",\"GetConfiguration\","
+			"{\"key\":[\"HeartbeatInterval\",\"Foo\"]}]"));
+
+	const struct ocpp_GetConfiguration *p =
+		(const struct ocpp_GetConfiguration *)payload;
+	MEMCMP_EQUAL("HeartbeatInterval\0Foo\0", p->keys, 23);
+	STRCMP_EQUAL("[2,\"1\",\"GetConfiguration\","
+			"{\"key\":[\"HeartbeatInterval\",\"Foo\"]}]", encode());
+}
+
+TEST(json_decoder, decode_ShouldPointIntoPayload_WhenPointerMembersGiven) {
+	LONGS_EQUAL(0, decode("[2,\"1\",\"SignedUpdateFirmware\","
+			"{\"requestId\":5,\"firmware\":{"
+			"\"location\":\"https://fw\","
+			"\"retrieveDateTime\":\"2023-11-14T22:13:20Z\","
+			"\"signingCertificate\":\"cert\","
+			"\"signature\":\"sig\"}}]"));
+
+	const struct ocpp_SignedUpdateFirmware *p =
+		(const struct ocpp_SignedUpdateFirmware *)payload;
+	LONGS_EQUAL(5, p->requestId);
+	STRCMP_EQUAL("https://fw", p->firmware.location);
+	STRCMP_EQUAL("cert", p->firmware.signingCertificate);
+	STRCMP_EQUAL("sig", p->firmware.signature);
+	CHECK((const uint8_t *)p->firmware.signature >= payload);
+	CHECK((const uint8_t *)p->firmware.signature <
+			&payload[msg.payload.size]);
+}
+
+TEST(json_decoder, decode_ShouldReturnEBADMSG_WhenMalformed) {
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Heartbeat\",{}"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Heartbeat\",{}]x"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Heartbeat\",{},1]"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Heartbeat\"]"));
+	LONGS_EQUAL(-EBADMSG, decode("[5,\"1\",{}]"));
+	LONGS_EQUAL(-EBADMSG, decode("{\"a\":1}"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Reset\",{\"type\":\"Warm\"}]"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Reset\",{\"type\":1}]"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Reset\",{\"type\" \"Hard\"}]"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Reset\",{\"type\":\"Hard\"]]"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"Reset\",{\"a\":tru}]"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"UnlockConnector\","
+				"{\"connectorId\":01}]"));
+	LONGS_EQUAL(-EBADMSG, decode("[2,\"1\",\"ReserveNow\","
+				"{\"expiryDate\":\"2023-13-01T00:00:00Z\"}]"));
+}
+
+TEST(json_decoder, decode_ShouldReturnERANGE_WhenValueDoesNotFit) {
+	LONGS_EQUAL(-ERANGE, decode("[2,\"1\",\"Authorize\","
+			"{\"idTag\":\"123456789012345678901\"}]"));
+	LONGS_EQUAL(-ERANGE, decode("[2,\"1\",\"UnlockConnector\","
+			"{\"connectorId\":4294967296}]"));
+}
+
+TEST(json_decoder, decode_ShouldReturnEINVAL_WhenRequiredFieldMissing) {
+	LONGS_EQUAL(-EINVAL, decode("[2,\"1\",\"Authorize\",{}]"));
+	LONGS_EQUAL(-EINVAL, decode("[2,\"1\",\"RemoteStartTransaction\","
+			"{\"connectorId\":1}]"));
+}
+
+TEST(json_decoder, decode_ShouldReturnENOBUFS_WhenPayloadBufferTooSmall) {
+	const char *frame = "[2,\"1\",\"DataTransfer\","
+		"{\"vendorId\":\"v\",\"data\":\"0123456789\"}]";
+
+	LONGS_EQUAL(-ENOBUFS, ocpp_decode_json(&msg, payload,
+			offsetof(struct ocpp_DataTransfer, data) + 10,
+			frame, strlen(frame)));
+	LONGS_EQUAL(0, ocpp_decode_json(&msg, payload,
+			offsetof(struct ocpp_DataTransfer, data) + 11,
+			frame, strlen(frame)));
+}
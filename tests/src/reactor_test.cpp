@@ -0,0 +1,380 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/reactor.h"
+#include "ocpp/ws.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+/* The key of RFC 6455 1.3, accepted as "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=". */
+void ocpp_ws_random(void *buf, size_t len) {
+	static const char nonce[] = "the sample nonce";
+	for (size_t i = 0; i < len; i++) {
+		((char *)buf)[i] = nonce[i % (sizeof(nonce) - 1)];
+	}
+}
+
+struct fired {
+	struct ocpp_reactor_source *src;
+	unsigned int events;
+};
+
+static std::vector<struct fired> fired;
+static struct ocpp_reactor *current;
+
+static void record(struct ocpp_reactor_source *src, unsigned int events,
+		void *ctx) {
+	char buf[16];
+	(void)ctx;
+	fired.push_back({ src, events });
+	/* level-triggered, so taken not to be told of again */
+	if (events & OCPP_REACTOR_READABLE) {
+		CHECK(read(src->fd, buf, sizeof(buf)) >= 0);
+	}
+}
+
+/* Removes the source given as the context, from the callback of another. */
+static void remove_other(struct ocpp_reactor_source *src, unsigned int events,
+		void *ctx) {
+	record(src, events, ctx);
+	ocpp_reactor_remove(current, (struct ocpp_reactor_source *)ctx);
+}
+
+TEST_GROUP(reactor) {
+	struct ocpp_reactor reactor;
+	struct ocpp_reactor_source *timers[8];
+	struct ocpp_reactor_source src[4];
+	int sv[4][2];
+
+	void setup(void) {
+		fired.clear();
+		current = &reactor;
+		memset(src, 0, sizeof(src));
+		for (int i = 0; i < 4; i++) {
+			LONGS_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0,
+						sv[i]));
+			src[i].fd = sv[i][0];
+			src[i].callback = record;
+		}
+		LONGS_EQUAL(0, ocpp_reactor_init(&reactor, timers, 8));
+	}
+	void teardown(void) {
+		ocpp_reactor_deinit(&reactor);
+		for (int i = 0; i < 4; i++) {
+			close(sv[i][0]);
+			close(sv[i][1]);
+		}
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void make_readable(int i) {
+		LONGS_EQUAL(1, write(sv[i][1], "x", 1));
+	}
+};
+
+TEST(reactor, run_ShouldReturnZero_WhenNothingReady) {
+	LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[0],
+				OCPP_REACTOR_READABLE));
+	LONGS_EQUAL(0, ocpp_reactor_run(&reactor, 0));
+	LONGS_EQUAL(0, fired.size());
+	CHECK(ocpp_reactor_get_fd(&reactor) >= 0);
+}
+
+TEST(reactor, run_ShouldCallBackOnlyReadySources) {
+	for (int i = 0; i < 4; i++) {
+		LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[i],
+					OCPP_REACTOR_READABLE));
+	}
+
+	make_readable(2);
+
+	LONGS_EQUAL(1, ocpp_reactor_run(&reactor, 100));
+	LONGS_EQUAL(1, fired.size());
+	POINTERS_EQUAL(&src[2], fired[0].src);
+	LONGS_EQUAL(OCPP_REACTOR_READABLE, fired[0].events);
+}
+
+TEST(reactor, set_events_ShouldWaitForWritable_WhenAsked) {
+	LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[0],
+				OCPP_REACTOR_READABLE));
+	LONGS_EQUAL(0, ocpp_reactor_run(&reactor, 0));
+
+	LONGS_EQUAL(0, ocpp_reactor_set_events(&reactor, &src[0],
+				OCPP_REACTOR_READABLE | OCPP_REACTOR_WRITABLE));
+	LONGS_EQUAL(1, ocpp_reactor_run(&reactor, 100));
+	LONGS_EQUAL(OCPP_REACTOR_WRITABLE, fired[0].events);
+}
+
+TEST(reactor, set_events_ShouldPollAgain_WhenFdNumberReused) {
+	LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[0],
+				OCPP_REACTOR_READABLE));
+
+	/* closing drops it from the epoll set behind the reactor's back */
+	close(sv[0][0]);
+	close(sv[0][1]);
+	LONGS_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv[0]));
+	LONGS_EQUAL(src[0].fd, sv[0][0]);
+
+	LONGS_EQUAL(0, ocpp_reactor_set_events(&reactor, &src[0],
+				OCPP_REACTOR_READABLE));
+	make_readable(0);
+	LONGS_EQUAL(1, ocpp_reactor_run(&reactor, 100));
+}
+
+TEST(reactor, run_ShouldReportHangup_WhenPeerClosed) {
+	LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[0],
+				OCPP_REACTOR_READABLE));
+	close(sv[0][1]);
+	sv[0][1] = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	LONGS_EQUAL(1, ocpp_reactor_run(&reactor, 100));
+	CHECK(fired[0].events & OCPP_REACTOR_HANGUP);
+}
+
+TEST(reactor, set_timeout_ShouldFireInOrderOfExpiry) {
+	const int timeouts[] = { 30, 10, 20 };
+
+	for (int i = 0; i < 3; i++) {
+		src[i].fd = -1;
+		LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[i], 0));
+		LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &src[i],
+					timeouts[i]));
+	}
+
+	for (int i = 0; i < 10 && fired.size() < 3; i++) {
+		ocpp_reactor_run(&reactor, 1000);
+	}
+
+	LONGS_EQUAL(3, fired.size());
+	POINTERS_EQUAL(&src[1], fired[0].src);
+	POINTERS_EQUAL(&src[2], fired[1].src);
+	POINTERS_EQUAL(&src[0], fired[2].src);
+	LONGS_EQUAL(OCPP_REACTOR_TIMEOUT, fired[0].events);
+	LONGS_EQUAL(0, src[0].expiry);
+}
+
+TEST(reactor, set_timeout_ShouldNotFire_WhenCancelledOrReplaced) {
+	LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[0], 0));
+	LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[1], 0));
+	LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &src[0], 0));
+	LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &src[1], 0));
+	LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &src[0], -1));
+	LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &src[1], 60000));
+
+	LONGS_EQUAL(0, ocpp_reactor_run(&reactor, 20));
+	LONGS_EQUAL(0, fired.size());
+}
+
+TEST(reactor, set_timeout_ShouldReturnENOBUFS_WhenHeapFull) {
+	struct ocpp_reactor_source more[9] = { };
+
+	for (int i = 0; i < 8; i++) {
+		LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &more[i],
+					1000));
+	}
+
+	LONGS_EQUAL(-ENOBUFS, ocpp_reactor_set_timeout(&reactor, &more[8],
+				1000));
+	/* updating one already in is fine */
+	LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &more[3], 10));
+}
+
+TEST(reactor, remove_ShouldDropPendingEvents_WhenRemovedFromCallback) {
+	/* src[0] removes src[1] if called first, and the other way around */
+	src[0].callback = remove_other;
+	src[0].ctx = &src[1];
+	src[1].callback = remove_other;
+	src[1].ctx = &src[0];
+
+	LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[0],
+				OCPP_REACTOR_READABLE));
+	LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &src[1],
+				OCPP_REACTOR_READABLE));
+	LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &src[1], 0));
+	make_readable(0);
+	make_readable(1);
+
+	LONGS_EQUAL(1, ocpp_reactor_run(&reactor, 100));
+	LONGS_EQUAL(1, fired.size());
+	LONGS_EQUAL(0, ocpp_reactor_run(&reactor, 10));
+}
+
+TEST(reactor, run_ShouldCallBackOnlyOnce_WhenOneOfThousandsReady) {
+	enum { NR_IDLE = 4000, NR_SOCKETS = 200 };
+	std::vector<struct ocpp_reactor_source> idle(NR_IDLE);
+	std::vector<struct ocpp_reactor_source> socks(NR_SOCKETS);
+	std::vector<struct ocpp_reactor_source *> heap(NR_IDLE);
+	std::vector<int> peers(NR_SOCKETS);
+
+	ocpp_reactor_deinit(&reactor);
+	LONGS_EQUAL(0, ocpp_reactor_init(&reactor, heap.data(), NR_IDLE));
+
+	for (int i = 0; i < NR_IDLE; i++) {
+		idle[i] = { -1, record, NULL, 0, false, 0, 0 };
+		LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &idle[i], 0));
+		/* one due now, the rest in an hour and some */
+		LONGS_EQUAL(0, ocpp_reactor_set_timeout(&reactor, &idle[i],
+					i == 1234? 0 : 3600000 + i % 97));
+	}
+	for (int i = 0; i < NR_SOCKETS; i++) {
+		int fds[2];
+		LONGS_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+		socks[i] = { fds[0], record, NULL, 0, false, 0, 0 };
+		peers[i] = fds[1];
+		LONGS_EQUAL(0, ocpp_reactor_add(&reactor, &socks[i],
+					OCPP_REACTOR_READABLE));
+	}
+
+	LONGS_EQUAL(1, ocpp_reactor_run(&reactor, 100));
+	POINTERS_EQUAL(&idle[1234], fired[0].src);
+
+	LONGS_EQUAL(1, write(peers[77], "x", 1));
+	LONGS_EQUAL(1, ocpp_reactor_run(&reactor, 100));
+	POINTERS_EQUAL(&socks[77], fired[1].src);
+	LONGS_EQUAL(0, ocpp_reactor_run(&reactor, 0));
+
+	for (int i = 0; i < NR_SOCKETS; i++) {
+		ocpp_reactor_remove(&reactor, &socks[i]);
+		close(socks[i].fd);
+		close(peers[i]);
+	}
+	for (int i = 0; i < NR_IDLE; i += 2) {
+		ocpp_reactor_remove(&reactor, &idle[i]);
+	}
+	/* the one fired was even */
+	LONGS_EQUAL(NR_IDLE / 2, reactor.nr_timers);
+	for (size_t i = 0; i < reactor.nr_timers; i++) {
+		LONGS_EQUAL(i, heap[i]->timer_index);
+		CHECK(i == 0 || heap[(i - 1) / 2]->expiry <= heap[i]->expiry);
+	}
+}
+
+TEST_GROUP(reactor_ws) {
+	struct ocpp_reactor reactor;
+	struct ocpp_reactor_source *timers[1];
+	struct ocpp_reactor_source src;
+	int listener;
+	int peer;
+	uint16_t port;
+
+	void setup(void) {
+		struct sockaddr_in addr = { };
+		socklen_t len = sizeof(addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		LONGS_EQUAL(0, bind(listener, (struct sockaddr *)&addr, len));
+		LONGS_EQUAL(0, listen(listener, 1));
+		getsockname(listener, (struct sockaddr *)&addr, &len);
+		port = ntohs(addr.sin_port);
+		peer = -1;
+
+		ocpp_init(NULL, NULL);
+		LONGS_EQUAL(0, ocpp_reactor_init(&reactor, timers, 1));
+	}
+	void teardown(void) {
+		ocpp_ws_close(1000);
+		ocpp_ws_close(1000);
+		ocpp_reactor_deinit(&reactor);
+		if (peer >= 0) {
+			close(peer);
+		}
+		close(listener);
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void run_until(ocpp_ws_state_t state) {
+		for (int i = 0; i < 100 && ocpp_ws_get_state() != state; i++) {
+			ocpp_reactor_run(&reactor, 10);
+		}
+		LONGS_EQUAL(state, ocpp_ws_get_state());
+	}
+	std::string read_some(void) {
+		struct pollfd pfd = { .fd = peer, .events = POLLIN, };
+		char buf[1024];
+		for (int i = 0; i < 100 && poll(&pfd, 1, 0) == 0; i++) {
+			ocpp_reactor_run(&reactor, 10);
+		}
+		ssize_t n = recv(peer, buf, sizeof(buf), MSG_DONTWAIT);
+		CHECK(n > 0);
+		return std::string(buf, (size_t)n);
+	}
+};
+
+TEST(reactor_ws, attach_ShouldDriveHandshakeAndEngine_WhenSocketReady) {
+	const struct ocpp_ws_param param = {
+		.host = "127.0.0.1",
+		.port = port,
+		.path = "/ocpp/CP001",
+		.subprotocols = NULL,
+		.deflate = NULL,
+	};
+	struct ocpp_BootNotification boot = { };
+	strcpy(boot.chargePointModel, "model");
+	strcpy(boot.chargePointVendor, "vendor");
+
+	LONGS_EQUAL(0, ocpp_reactor_attach_ws(&reactor, &src));
+	LONGS_EQUAL(-1, src.fd);
+
+	LONGS_EQUAL(0, ocpp_ws_open(&param));
+	LONGS_EQUAL(0, ocpp_reactor_sync_ws(&reactor, &src));
+	LONGS_EQUAL(ocpp_ws_get_fd(), src.fd);
+	/* to tell when the connection is made */
+	CHECK(src.events & OCPP_REACTOR_WRITABLE);
+
+	peer = accept(listener, NULL, NULL);
+	CHECK(peer >= 0);
+	CHECK(read_some().rfind("GET /ocpp/CP001 HTTP/1.1\r\n", 0) == 0);
+	std::string response =
+		"HTTP/1.1 101 Switching Protocols\r\n"
+		"Upgrade: websocket\r\n"
+		"Connection: Upgrade\r\n"
+		"Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+		"Sec-WebSocket-Protocol: ocpp1.6\r\n"
+		"\r\n";
+	LONGS_EQUAL((long)response.size(), send(peer, response.data(),
+				response.size(), 0));
+	run_until(OCPP_WS_OPEN);
+	LONGS_EQUAL(OCPP_REACTOR_READABLE, src.events);
+
+	/* pushed from outside the reactor, due right away */
+	LONGS_EQUAL(0, ocpp_push_request(OCPP_MSG_BOOTNOTIFICATION,
+				&boot, sizeof(boot), NULL));
+	LONGS_EQUAL(0, ocpp_reactor_sync_ws(&reactor, &src));
+	CHECK(src.expiry != 0);
+
+	std::string frame = read_some();
+	CHECK(frame.size() > 6);
+	CHECK((uint8_t)frame[0] == 0x81);
+
+	/* closed by the server, the fd is given up */
+	close(peer);
+	peer = -1;
+	run_until(OCPP_WS_CLOSED);
+	LONGS_EQUAL(-1, src.fd);
+}
@@ -0,0 +1,164 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/sim.h"
+
+#include <errno.h>
+#include <string.h>
+
+#define DAY_SEC			(24 * 60 * 60)
+
+static struct {
+	uint32_t sent[OCPP_MSG_MAX];
+	bool answer;
+	uint32_t delay_sec;
+	time_t completed_at;
+	ocpp_completion_t outcome;
+	time_t received_at;
+	ocpp_message_t received;
+} csms;
+
+static const struct ocpp_BootNotification_conf boot_accepted = {
+	.interval = 1800,
+	.status = OCPP_BOOT_STATUS_ACCEPTED,
+};
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+static bool script(const struct ocpp_message *msg,
+		struct ocpp_message *resp, uint32_t *delay_sec, void *ctx) {
+	(void)ctx;
+	csms.sent[msg->type]++;
+	if (msg->type == OCPP_MSG_BOOTNOTIFICATION) {
+		resp->payload.fmt.response = &boot_accepted;
+	}
+	*delay_sec = csms.delay_sec;
+	return csms.answer;
+}
+
+static void on_event(ocpp_event_t event_type,
+		const struct ocpp_message *msg, void *ctx) {
+	(void)ctx;
+	if (event_type == OCPP_EVENT_MESSAGE_INCOMING && msg->role == OCPP_MSG_ROLE_CALL) {
+		csms.received = msg->type;
+		csms.received_at = ocpp_sim_now();
+	}
+}
+
+static void on_complete(ocpp_completion_t outcome,
+		const struct ocpp_message *response, void *ctx) {
+	(void)response;
+	(void)ctx;
+	csms.outcome = outcome;
+	csms.completed_at = ocpp_sim_now();
+}
+
+TEST_GROUP(sim) {
+	void setup(void) {
+		memset(&csms, 0, sizeof(csms));
+		csms.answer = true;
+		csms.received = OCPP_MSG_MAX;
+
+		ocpp_sim_init(1000, script, NULL);
+		ocpp_init(on_event, NULL);
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void boot(void) {
+		ocpp_push_request(OCPP_MSG_BOOTNOTIFICATION, NULL, 0, NULL);
+		ocpp_sim_run(0);
+	}
+};
+
+TEST(sim, run_ShouldSendHeartbeatEveryInterval_WhenBootAccepted) {
+	boot();
+	ocpp_sim_run(DAY_SEC);
+
+	LONGS_EQUAL(1, csms.sent[OCPP_MSG_BOOTNOTIFICATION]);
+	LONGS_EQUAL(DAY_SEC / 1800, csms.sent[OCPP_MSG_HEARTBEAT]);
+	LONGS_EQUAL(1000 + DAY_SEC, ocpp_sim_now());
+}
+
+TEST(sim, run_ShouldFastForwardToDeadlines) {
+	boot();
+	ocpp_sim_run(7 * DAY_SEC);
+
+	/* a few steps per heartbeat rather than one per second */
+	CHECK(ocpp_sim_get_stats()->steps < 4 * csms.sent[OCPP_MSG_HEARTBEAT]);
+}
+
+TEST(sim, run_ShouldDrainTransactionMessages_WhenLinkRestoredAfterOutage) {
+	ocpp_sim_set_link(false);
+	for (int i = 0; i < 5; i++) {
+		LONGS_EQUAL(0, ocpp_push_request(OCPP_MSG_METER_VALUES,
+				NULL, 0, NULL));
+	}
+
+	ocpp_sim_run(7 * DAY_SEC);
+	LONGS_EQUAL(5, ocpp_count_pending_requests());
+	LONGS_EQUAL(0, csms.sent[OCPP_MSG_METER_VALUES]);
+	CHECK(ocpp_sim_get_stats()->send_failures > 0);
+
+	ocpp_sim_set_link(true);
+	ocpp_sim_run(60);
+	LONGS_EQUAL(0, ocpp_count_pending_requests());
+	LONGS_EQUAL(5, csms.sent[OCPP_MSG_METER_VALUES]);
+}
+
+TEST(sim, run_ShouldTimeOutAtDeterministicTime_WhenUnanswered) {
+	csms.answer = false;
+	ocpp_push_request_cb(OCPP_MSG_AUTHORIZE, NULL, 0, on_complete, NULL);
+
+	ocpp_sim_run(DAY_SEC);
+
+	LONGS_EQUAL(OCPP_COMPLETION_TIMEOUT, csms.outcome);
+	LONGS_EQUAL(1000 + 3 * OCPP_DEFAULT_TX_TIMEOUT_SEC, csms.completed_at);
+	LONGS_EQUAL(3, csms.sent[OCPP_MSG_AUTHORIZE]);
+}
+
+TEST(sim, run_ShouldCompleteAfterDelay_WhenResponseDelayed) {
+	csms.delay_sec = 3;
+	ocpp_push_request_cb(OCPP_MSG_AUTHORIZE, NULL, 0, on_complete, NULL);
+
+	ocpp_sim_run(60);
+
+	LONGS_EQUAL(OCPP_COMPLETION_RESULT, csms.outcome);
+	LONGS_EQUAL(1003, csms.completed_at);
+}
+
+TEST(sim, inject_ShouldDeliverCentralRequest_WhenDue) {
+	const struct ocpp_message req = {
+		.id = "cs-1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_RESET,
+	};
+
+	LONGS_EQUAL(0, ocpp_sim_inject(&req, 3600));
+	ocpp_sim_run(DAY_SEC);
+
+	LONGS_EQUAL(OCPP_MSG_RESET, csms.received);
+	LONGS_EQUAL(1000 + 3600, csms.received_at);
+}
+
+TEST(sim, inject_ShouldReturnENOBUFS_WhenInboxFull) {
+	const struct ocpp_message req = { .role = OCPP_MSG_ROLE_CALL };
+
+	for (int i = 0; i < OCPP_SIM_INBOX_LEN; i++) {
+		LONGS_EQUAL(0, ocpp_sim_inject(&req, 10));
+	}
+	LONGS_EQUAL(-ENOBUFS, ocpp_sim_inject(&req, 10));
+}
@@ -141,3 +141,19 @@ TEST(strconv, ShouldReturnUnitString_WhenUnitCelsiusGiven) {
 	const char *y = ocpp_stringify_unit(OCPP_UNIT_CELSIUS);
 	STRCMP_EQUAL("Celsius", y);
 }
+
+TEST(strconv, ShouldReturnCallErrorString_WhenCallErrorGiven) {
+	STRCMP_EQUAL("OccurenceConstraintViolation", ocpp_stringify_call_error(
+			OCPP_CALL_ERROR_OCCURRENCE_CONSTRAINT_VIOLATION));
+	STRCMP_EQUAL("GenericError",
+			ocpp_stringify_call_error(
+				(ocpp_call_error_t)(OCPP_CALL_ERROR_GENERIC + 1)));
+}
+
+TEST(strconv, ShouldReturnCallError_WhenCallErrorStringGiven) {
+	LONGS_EQUAL(OCPP_CALL_ERROR_FORMATION_VIOLATION,
+			ocpp_get_call_error_from_string("FormationViolation",
+				strlen("FormationViolation")));
+	LONGS_EQUAL(OCPP_CALL_ERROR_GENERIC,
+			ocpp_get_call_error_from_string("Formation", 9));
+}
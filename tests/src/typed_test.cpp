@@ -0,0 +1,152 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ocpp.hpp"
+#include "ocpp/overrides.h"
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+static struct ocpp_message sent;
+
+time_t time(time_t *second) {
+	return 0;
+}
+
+int ocpp_send(const struct ocpp_message *msg) {
+	memcpy(&sent, msg, sizeof(*msg));
+	return 0;
+}
+
+int ocpp_recv(struct ocpp_message *msg) {
+	return -ENOMSG;
+}
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+void ocpp_generate_message_id(void *buf, size_t bufsize) {
+	static unsigned int id;
+	snprintf((char *)buf, bufsize, "%u", ++id);
+}
+
+TEST_GROUP(typed) {
+	void setup(void) {
+		memset(&sent, 0, sizeof(sent));
+		ocpp_init(NULL, NULL);
+	}
+	void teardown(void) {
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(typed, push_request_ShouldMapStructToMessageType) {
+	const ocpp::StatusNotification req = { .connectorId = 1 };
+
+	LONGS_EQUAL(0, ocpp::push_request(req));
+	ocpp_step();
+
+	LONGS_EQUAL(OCPP_MSG_STATUS_NOTIFICATION, sent.type);
+	POINTERS_EQUAL(&req, sent.payload.fmt.request);
+	LONGS_EQUAL(sizeof(req), sent.payload.size);
+}
+
+TEST(typed, push_request_ShouldReturnEINVAL_WhenRequiredFieldMissing) {
+	const ocpp::Authorize req = {};
+
+	LONGS_EQUAL(-EINVAL, ocpp::push_request(req));
+	LONGS_EQUAL(0, ocpp_count_pending_requests());
+}
+
+TEST(typed, push_response_ShouldUseRequestIdAndType) {
+	const struct ocpp_message req = {
+		.id = "req-1",
+		.role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_RESET,
+	};
+	const ocpp::Reset_conf conf = { .status = OCPP_REMOTE_STATUS_ACCEPTED };
+
+	LONGS_EQUAL(0, ocpp::push_response(req, conf));
+	ocpp_step();
+
+	STRCMP_EQUAL("req-1", sent.id);
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALLRESULT, sent.role);
+	LONGS_EQUAL(OCPP_MSG_RESET, sent.type);
+	LONGS_EQUAL(sizeof(conf), sent.payload.size);
+}
+
+TEST(typed, payload_size_ShouldMatchRecordSize) {
+	LONGS_EQUAL(OCPP_METER_VALUE_SIZE(3),
+			ocpp::payload_size<ocpp_MeterValue>(3));
+	LONGS_EQUAL(OCPP_CHARGING_SCHEDULE_SIZE(5),
+			ocpp::payload_size<ocpp_ChargingSchedule>(5));
+	LONGS_EQUAL(offsetof(ocpp_DataTransfer, data) + 4,
+			ocpp::payload_size<ocpp::DataTransfer>(4));
+}
+
+TEST(typed, builder_ShouldLayOutRecordsAndCounts) {
+	const ocpp_SampledValue one[] = { { .value = "1" } };
+	const ocpp_SampledValue two[] = { { .value = "2" }, { .value = "3" } };
+	ocpp::builder<ocpp::MeterValues, 512> b({ .connectorId = 2 });
+
+	CHECK(b.append(ocpp_MeterValue{ .timestamp = 10 }, one));
+	CHECK(b.append(ocpp_MeterValue{ .timestamp = 20 }, two));
+
+	const size_t first = OCPP_RECORD_OFFSET(ocpp_MeterValues, meterValue,
+			ocpp_MeterValue);
+	LONGS_EQUAL(first + OCPP_METER_VALUE_SIZE(1) + OCPP_METER_VALUE_SIZE(2),
+			b.size());
+	LONGS_EQUAL(2, b.head().connectorId);
+
+	const uint8_t *p = (const uint8_t *)b.data();
+	const ocpp_MeterValue *mv1 = (const ocpp_MeterValue *)&p[first];
+	const ocpp_MeterValue *mv2 = (const ocpp_MeterValue *)
+		&p[first + OCPP_METER_VALUE_SIZE(1)];
+	LONGS_EQUAL(1, mv1->nr_sampledValue);
+	LONGS_EQUAL(2, mv2->nr_sampledValue);
+	LONGS_EQUAL(20, mv2->timestamp);
+	STRCMP_EQUAL("3", ((const ocpp_SampledValue *)
+			mv2->sampledValue)[1].value);
+}
+
+TEST(typed, builder_ShouldReturnFalse_WhenCapacityExceeded) {
+	const ocpp_SampledValue samples[4] = {};
+	ocpp::builder<ocpp::MeterValues, 128> b({ .connectorId = 1 });
+
+	CHECK_FALSE(b.append(ocpp_MeterValue{}, samples));
+	LONGS_EQUAL(offsetof(ocpp_MeterValues, meterValue), b.size());
+}
+
+TEST(typed, push_request_ShouldPushBuilderPayloadSize) {
+	ocpp::builder<ocpp::DataTransfer, 512> b({ .vendorId = "vendor" });
+	CHECK(b.append("payload", 7));
+
+	LONGS_EQUAL(0, ocpp::push_request(b));
+	ocpp_step();
+
+	LONGS_EQUAL(OCPP_MSG_DATA_TRANSFER, sent.type);
+	LONGS_EQUAL(offsetof(ocpp_DataTransfer, data) + 7, sent.payload.size);
+}
+
+TEST(typed, push_request_cb_ShouldPushBuilderPayloadSize) {
+	ocpp::builder<ocpp::DataTransfer, 512> b({ .vendorId = "vendor" });
+	CHECK(b.append("payload", 7));
+
+	LONGS_EQUAL(0, ocpp::push_request_cb(b, NULL));
+	ocpp_step();
+
+	LONGS_EQUAL(OCPP_MSG_DATA_TRANSFER, sent.type);
+	LONGS_EQUAL(offsetof(ocpp_DataTransfer, data) + 7, sent.payload.size);
+}
@@ -0,0 +1,222 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ws_deflate.h"
+
+#include <errno.h>
+#include <string.h>
+#define ZLIB_CONST
+#include <zlib.h>
+
+#include <string>
+
+/* Built with a heap of 64 KiB and a memory level of 4, which leaves room
+ * for a window of 2^11 bytes to compress with and 2^15 to decompress. */
+static const char *meter_values =
+	"[2,\"19223201\",\"MeterValues\",{\"connectorId\":1,"
+	"\"transactionId\":42,\"meterValue\":[{\"timestamp\":"
+	"\"2024-05-01T12:00:00Z\",\"sampledValue\":[{\"value\":\"12345.6\","
+	"\"context\":\"Sample.Periodic\",\"measurand\":"
+	"\"Energy.Active.Import.Register\",\"unit\":\"Wh\"}]}]}]";
+
+/* What the server would do with its zlib. */
+static std::string deflate_raw(const std::string &s, int bits) {
+	z_stream z = { };
+	unsigned char out[1024];
+
+	LONGS_EQUAL(Z_OK, deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+				-bits, 8, Z_DEFAULT_STRATEGY));
+	z.next_in = (const Bytef *)s.data();
+	z.avail_in = (uInt)s.size();
+	z.next_out = out;
+	z.avail_out = sizeof(out);
+	LONGS_EQUAL(Z_OK, deflate(&z, Z_SYNC_FLUSH));
+	deflateEnd(&z);
+
+	/* without the empty block at the end */
+	return std::string((const char *)out, sizeof(out) - z.avail_out - 4);
+}
+
+static std::string inflate_raw(z_stream *z, const std::string &s) {
+	const std::string in = s + std::string("\x00\x00\xff\xff", 4);
+	unsigned char out[1024];
+
+	z->next_in = (const Bytef *)in.data();
+	z->avail_in = (uInt)in.size();
+	z->next_out = out;
+	z->avail_out = sizeof(out);
+	LONGS_EQUAL(Z_OK, inflate(z, Z_SYNC_FLUSH));
+	LONGS_EQUAL(0, z->avail_in);
+
+	return std::string((const char *)out, sizeof(out) - z->avail_out);
+}
+
+TEST_GROUP(ws_deflate) {
+	char offer[160];
+	struct ocpp_ws_deflate_param param;
+
+	void setup(void) {
+		memset(&param, 0, sizeof(param));
+	}
+	void teardown(void) {
+		ocpp_ws_deflate_end();
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	int agree(const char *response) {
+		LONGS_EQUAL(0, ocpp_ws_deflate_offer(offer, sizeof(offer),
+					&param));
+		return ocpp_ws_deflate_accept(response, strlen(response));
+	}
+	std::string compress(const std::string &s) {
+		char buf[1024];
+		size_t len;
+		LONGS_EQUAL(0, ocpp_ws_deflate_compress(buf, sizeof(buf),
+					s.data(), s.size(), &len));
+		return std::string(buf, len);
+	}
+	std::string decompress(const std::string &s) {
+		char buf[1024];
+		size_t len;
+		LONGS_EQUAL(0, ocpp_ws_deflate_decompress(buf, sizeof(buf),
+					s.data(), s.size(), &len));
+		return std::string(buf, len);
+	}
+};
+
+TEST(ws_deflate, offer_ShouldNarrowWindows_WhenHeapCapped) {
+	LONGS_EQUAL(0, ocpp_ws_deflate_offer(offer, sizeof(offer), &param));
+	STRCMP_EQUAL("permessage-deflate; client_max_window_bits=11", offer);
+}
+
+TEST(ws_deflate, offer_ShouldWriteAllParams_WhenGiven) {
+	param.client_max_window_bits = 10;
+	param.server_max_window_bits = 9;
+	param.client_no_context_takeover = true;
+	param.server_no_context_takeover = true;
+
+	LONGS_EQUAL(0, ocpp_ws_deflate_offer(offer, sizeof(offer), &param));
+	STRCMP_EQUAL("permessage-deflate; client_max_window_bits=10; "
+			"server_max_window_bits=9; client_no_context_takeover; "
+			"server_no_context_takeover", offer);
+}
+
+TEST(ws_deflate, offer_ShouldReturnENOBUFS_WhenBufferTooSmall) {
+	LONGS_EQUAL(-ENOBUFS, ocpp_ws_deflate_offer(offer, 20, &param));
+}
+
+TEST(ws_deflate, accept_ShouldEnable_WhenResponseMatchesOffer) {
+	LONGS_EQUAL(0, agree("permessage-deflate; server_max_window_bits=\"12\""
+				" ; client_max_window_bits=11"));
+	CHECK(ocpp_ws_deflate_enabled());
+}
+
+TEST(ws_deflate, accept_ShouldReturnEPROTO_WhenResponseInvalid) {
+	const char *responses[] = {
+		"x-webkit-deflate-frame",
+		"permessage-deflate; server_max_window_bits=13, foo",
+		"permessage-deflate; server_max_window_bits=13; foo",
+		"permessage-deflate; server_max_window_bits=14",
+		"permessage-deflate; server_max_window_bits=013",
+		"permessage-deflate; server_max_window_bits",
+		"permessage-deflate; server_max_window_bits=13; "
+			"server_max_window_bits=13",
+		"permessage-deflate; server_max_window_bits=13; "
+			"client_max_window_bits=8",
+		"permessage-deflate; server_max_window_bits=13; "
+			"client_no_context_takeover=1",
+		/* what was asked of the server not agreed */
+		"permessage-deflate",
+	};
+
+	param.server_max_window_bits = 13;
+
+	for (size_t i = 0; i < sizeof(responses) / sizeof(*responses); i++) {
+		LONGS_EQUAL(-EPROTO, agree(responses[i]));
+		CHECK(!ocpp_ws_deflate_enabled());
+	}
+}
+
+TEST(ws_deflate, accept_ShouldReturnEPROTO_WhenNotOffered) {
+	const char *response = "permessage-deflate";
+	LONGS_EQUAL(-EPROTO, ocpp_ws_deflate_accept(response,
+				strlen(response)));
+	LONGS_EQUAL(-ENOTCONN, ocpp_ws_deflate_compress(offer, sizeof(offer),
+				"x", 1, NULL));
+}
+
+TEST(ws_deflate, compress_ShouldKeepContext_WhenTakeoverAllowed) {
+	z_stream peer = { };
+	LONGS_EQUAL(Z_OK, inflateInit2(&peer, -13));
+	LONGS_EQUAL(0, agree("permessage-deflate; server_max_window_bits=13"));
+
+	std::string first = compress(meter_values);
+	std::string second = compress(meter_values);
+
+	CHECK(inflate_raw(&peer, first) == meter_values);
+	CHECK(inflate_raw(&peer, second) == meter_values);
+	CHECK(second.size() < first.size() / 4);
+	inflateEnd(&peer);
+}
+
+TEST(ws_deflate, compress_ShouldStartOver_WhenNoContextTakeover) {
+	param.client_no_context_takeover = true;
+	LONGS_EQUAL(0, agree("permessage-deflate; server_max_window_bits=13"));
+
+	std::string first = compress(meter_values);
+	std::string second = compress(meter_values);
+
+	CHECK(first == second);
+	CHECK(first.size() < strlen(meter_values));
+}
+
+TEST(ws_deflate, compress_ShouldReturnENOBUFS_WhenBufferTooSmall) {
+	char buf[16];
+	size_t len;
+
+	LONGS_EQUAL(0, agree("permessage-deflate; server_max_window_bits=13"));
+	LONGS_EQUAL(-ENOBUFS, ocpp_ws_deflate_compress(buf, sizeof(buf),
+				meter_values, strlen(meter_values), &len));
+
+	/* started over, which the peer can follow */
+	z_stream peer = { };
+	LONGS_EQUAL(Z_OK, inflateInit2(&peer, -13));
+	CHECK(inflate_raw(&peer, compress(meter_values)) == meter_values);
+	inflateEnd(&peer);
+}
+
+TEST(ws_deflate, decompress_ShouldGiveMessage_WhenServerCompressed) {
+	LONGS_EQUAL(0, agree("permessage-deflate; server_max_window_bits=10"));
+
+	CHECK(decompress(deflate_raw(meter_values, 10)) == meter_values);
+	CHECK(decompress(deflate_raw("", 10)) == "");
+	CHECK(decompress(deflate_raw("[3,\"1\",{}]", 10)) == "[3,\"1\",{}]");
+}
+
+TEST(ws_deflate, decompress_ShouldFitInHeap_WhenWidestWindowsAgreed) {
+	LONGS_EQUAL(0, agree("permessage-deflate"));
+
+	CHECK(decompress(deflate_raw(meter_values, 15)) == meter_values);
+	CHECK(compress(meter_values).size() < strlen(meter_values));
+}
+
+TEST(ws_deflate, decompress_ShouldReturnEMSGSIZE_WhenMessageTooLarge) {
+	std::string in = deflate_raw(meter_values, 13);
+	char buf[32];
+	size_t len;
+
+	LONGS_EQUAL(0, agree("permessage-deflate; server_max_window_bits=13"));
+	LONGS_EQUAL(-EMSGSIZE, ocpp_ws_deflate_decompress(buf, sizeof(buf),
+				in.data(), in.size(), &len));
+}
+
+TEST(ws_deflate, decompress_ShouldReturnEBADMSG_WhenCorrupt) {
+	char buf[64];
+	size_t len;
+
+	LONGS_EQUAL(0, agree("permessage-deflate; server_max_window_bits=13"));
+	/* a block of the reserved type 3 */
+	LONGS_EQUAL(-EBADMSG, ocpp_ws_deflate_decompress(buf, sizeof(buf),
+				"\xff\xff\xff", 3, &len));
+}
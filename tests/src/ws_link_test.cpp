@@ -0,0 +1,267 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ws_link.h"
+#include "ocpp/csms.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+/* moved by hand for the waits */
+static time_t clock_now;
+time_t ocpp_get_time(void) {
+	return clock_now;
+}
+
+/* the jitter drawn, and the masks along */
+static uint32_t random_value;
+void ocpp_ws_random(void *buf, size_t len) {
+	uint8_t *p = (uint8_t *)buf;
+	for (size_t i = 0; i < len; i++) {
+		p[i] = (uint8_t)(random_value >> (8 * (i % 4)));
+	}
+}
+
+static std::vector<ocpp_message_t> received;
+
+static void on_csms_message(const struct ocpp_message *msg,
+		const char *text, size_t len, void *ctx) {
+	(void)text;
+	(void)len;
+	(void)ctx;
+	if (msg->role == OCPP_MSG_ROLE_CALL) {
+		received.push_back(msg->type);
+	}
+}
+
+TEST_GROUP(ws_link) {
+	struct ocpp_csms_param csms;
+	struct ocpp_ws_link_param param;
+
+	void setup(void) {
+		clock_now = 100;
+		random_value = 0;
+		received.clear();
+
+		memset(&csms, 0, sizeof(csms));
+		csms.heartbeat_interval = 300;
+		csms.seed = 1;
+
+		memset(&param, 0, sizeof(param));
+		param.ws.host = "127.0.0.1";
+		param.ws.path = "/ocpp/CP001";
+
+		ocpp_init(NULL, NULL);
+	}
+	void teardown(void) {
+		ocpp_ws_link_stop();
+		ocpp_csms_stop();
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void step(void) {
+		LONGS_EQUAL(0, ocpp_ws_link_poll());
+		ocpp_step();
+		if (ocpp_csms_get_port()) {
+			LONGS_EQUAL(0, ocpp_csms_poll(1));
+		} else {
+			usleep(1000);
+		}
+	}
+	void go_up(void) {
+		LONGS_EQUAL(0, ocpp_csms_start(&csms, on_csms_message, NULL));
+		param.ws.port = ocpp_csms_get_port();
+		LONGS_EQUAL(0, ocpp_ws_link_start(&param));
+		CHECK(!ocpp_is_connected());
+		step_until_up();
+	}
+	void step_until_up(void) {
+		for (int i = 0; i < 500 && !ocpp_ws_link_is_up(); i++) {
+			step();
+		}
+		CHECK(ocpp_ws_link_is_up());
+		CHECK(ocpp_is_connected());
+	}
+	/* Steps until the attempt failed, returning when the next is due. */
+	time_t step_until_waiting(void) {
+		time_t deadline = 0;
+		for (int i = 0; i < 500; i++) {
+			step();
+			if (ocpp_ws_get_state() == OCPP_WS_CLOSED &&
+					ocpp_ws_link_get_next_deadline(
+						&deadline) == 0) {
+				break;
+			}
+		}
+		LONGS_EQUAL(OCPP_WS_CLOSED, ocpp_ws_get_state());
+		return deadline;
+	}
+	bool step_until_received(ocpp_message_t type) {
+		for (int i = 0; i < 500; i++) {
+			for (ocpp_message_t t : received) {
+				if (t == type) {
+					return true;
+				}
+			}
+			step();
+		}
+		return false;
+	}
+	/* A port nothing listens on. */
+	uint16_t get_closed_port(void) {
+		LONGS_EQUAL(0, ocpp_csms_start(&csms, NULL, NULL));
+		const uint16_t port = ocpp_csms_get_port();
+		ocpp_csms_stop();
+		return port;
+	}
+};
+
+TEST(ws_link, start_ShouldReportLinkUp_WhenHandshakeDone) {
+	struct ocpp_ws_link_stats stats;
+
+	go_up();
+
+	ocpp_ws_link_get_stats(&stats);
+	LONGS_EQUAL(1, stats.attempts);
+	LONGS_EQUAL(1, stats.connects);
+	LONGS_EQUAL(0, stats.drops);
+	LONGS_EQUAL(-EALREADY, ocpp_ws_link_start(&param));
+}
+
+TEST(ws_link, start_ShouldReturnEINVAL_WhenNoHostOrPort) {
+	LONGS_EQUAL(-EINVAL, ocpp_ws_link_start(NULL));
+	LONGS_EQUAL(-EINVAL, ocpp_ws_link_start(&param));
+	LONGS_EQUAL(-EINVAL, ocpp_ws_link_poll());
+}
+
+TEST(ws_link, poll_ShouldBackOffDoubling_WhenConnectionRefused) {
+	param.ws.port = get_closed_port();
+	param.backoff_min_sec = 1;
+	param.backoff_max_sec = 4;
+	LONGS_EQUAL(0, ocpp_ws_link_start(&param));
+
+	LONGS_EQUAL(101, step_until_waiting());
+	clock_now = 101;
+	LONGS_EQUAL(103, step_until_waiting());
+	clock_now = 103;
+	LONGS_EQUAL(107, step_until_waiting());
+	clock_now = 107;
+	LONGS_EQUAL(111, step_until_waiting());
+
+	struct ocpp_ws_link_stats stats;
+	ocpp_ws_link_get_stats(&stats);
+	LONGS_EQUAL(4, stats.attempts);
+	LONGS_EQUAL(0, stats.connects);
+	CHECK(!ocpp_is_connected());
+}
+
+TEST(ws_link, poll_ShouldNotAttempt_UntilWaitOver) {
+	struct ocpp_ws_link_stats stats;
+
+	param.ws.port = get_closed_port();
+	param.backoff_min_sec = 10;
+	LONGS_EQUAL(0, ocpp_ws_link_start(&param));
+	LONGS_EQUAL(110, step_until_waiting());
+
+	clock_now = 109;
+	for (int i = 0; i < 10; i++) {
+		step();
+	}
+	ocpp_ws_link_get_stats(&stats);
+	LONGS_EQUAL(1, stats.attempts);
+}
+
+TEST(ws_link, poll_ShouldAddJitterUpToHalfTheWait) {
+	param.ws.port = get_closed_port();
+	param.backoff_min_sec = 4;
+	random_value = 2;
+	LONGS_EQUAL(0, ocpp_ws_link_start(&param));
+
+	LONGS_EQUAL(106, step_until_waiting());
+}
+
+TEST(ws_link, poll_ShouldGiveUp_WhenHandshakeTakesTooLong) {
+	struct sockaddr_in addr = { };
+	socklen_t len = sizeof(addr);
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	/* accepted by the kernel, never answered */
+	const int listener = socket(AF_INET, SOCK_STREAM, 0);
+	LONGS_EQUAL(0, bind(listener, (struct sockaddr *)&addr, len));
+	LONGS_EQUAL(0, listen(listener, 1));
+	getsockname(listener, (struct sockaddr *)&addr, &len);
+	param.ws.port = ntohs(addr.sin_port);
+
+	LONGS_EQUAL(0, ocpp_ws_link_start(&param));
+	for (int i = 0; i < 10; i++) {
+		step();
+	}
+	LONGS_EQUAL(OCPP_WS_HANDSHAKING, ocpp_ws_get_state());
+
+	time_t deadline;
+	LONGS_EQUAL(0, ocpp_ws_link_get_next_deadline(&deadline));
+	LONGS_EQUAL(100 + OCPP_WS_LINK_CONNECT_TIMEOUT_SEC, deadline);
+
+	clock_now = deadline;
+	LONGS_EQUAL(deadline + 1, step_until_waiting());
+	close(listener);
+}
+
+TEST(ws_link, poll_ShouldReconnectAndDrainQueue_WhenLinkLost) {
+	const struct ocpp_BootNotification boot = {
+		.chargePointModel = "Model",
+		.chargePointVendor = "Vendor",
+	};
+	const struct ocpp_Authorize authorize = {
+		.idTag = "TAG1",
+	};
+	struct ocpp_ws_link_stats stats;
+
+	go_up();
+	LONGS_EQUAL(0, ocpp_push_request(OCPP_MSG_BOOTNOTIFICATION,
+				&boot, sizeof(boot), NULL));
+	CHECK(step_until_received(OCPP_MSG_BOOTNOTIFICATION));
+
+	ocpp_csms_disconnect();
+	LONGS_EQUAL(101, step_until_waiting());
+	CHECK(!ocpp_is_connected());
+
+	/* held rather than spent on retries */
+	LONGS_EQUAL(0, ocpp_push_request(OCPP_MSG_AUTHORIZE,
+				&authorize, sizeof(authorize), NULL));
+	for (int i = 0; i < 10; i++) {
+		step();
+	}
+	CHECK(!step_until_received(OCPP_MSG_AUTHORIZE));
+
+	clock_now = 101;
+	step_until_up();
+	CHECK(step_until_received(OCPP_MSG_AUTHORIZE));
+
+	ocpp_ws_link_get_stats(&stats);
+	LONGS_EQUAL(2, stats.attempts);
+	LONGS_EQUAL(2, stats.connects);
+	LONGS_EQUAL(1, stats.drops);
+}
@@ -0,0 +1,177 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ws_simd.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const ocpp_ws_simd_t impls[] = {
+	OCPP_WS_SIMD_SCALAR,
+	OCPP_WS_SIMD_SSE2,
+	OCPP_WS_SIMD_AVX2,
+	OCPP_WS_SIMD_NEON,
+};
+
+static const char *valid[] = {
+	"a",
+	"\xc2\x80",			/* U+0080 */
+	"\xdf\xbf",			/* U+07FF */
+	"\xe0\xa0\x80",			/* U+0800 */
+	"\xe2\x82\xac",			/* U+20AC */
+	"\xed\x9f\xbf",			/* U+D7FF */
+	"\xee\x80\x80",			/* U+E000 */
+	"\xef\xbf\xbf",			/* U+FFFF */
+	"\xf0\x90\x80\x80",		/* U+10000 */
+	"\xf0\x9f\x98\x80",		/* U+1F600 */
+	"\xf4\x8f\xbf\xbf",		/* U+10FFFF */
+	"\xea\xb6\x8c\xea\xb2\xbd\xed\x99\x98",
+};
+
+static const char *invalid[] = {
+	"\x80",				/* lone continuation */
+	"\xbf",
+	"\xc0\x80",			/* overlong */
+	"\xc1\xbf",
+	"\xe0\x9f\xbf",
+	"\xf0\x8f\xbf\xbf",
+	"\xed\xa0\x80",			/* surrogate */
+	"\xed\xbf\xbf",
+	"\xf4\x90\x80\x80",		/* above U+10FFFF */
+	"\xf5\x80\x80\x80",
+	"\xff",
+	"\xc2",				/* cut off */
+	"\xe2\x82",
+	"\xf0\x9f\x98",
+	"\xc2\x41",			/* not a continuation */
+	"\xe2\x41\xac",
+	"\xf0\x9f\x41\x80",
+	"\xc2\x80\x80",			/* one continuation too many */
+};
+
+static void mask_reference(uint8_t *p, size_t len, const uint8_t key[4]) {
+	for (size_t i = 0; i < len; i++) {
+		p[i] ^= key[i & 3];
+	}
+}
+
+/* Places s at every offset of a buffer of ASCII wide enough to span the
+ * 16- and 32-byte chunks of the vector kernels. */
+static void check_at_every_offset(const char *s, bool expected) {
+	const size_t len = strlen(s);
+	uint8_t buf[96];
+
+	for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+		if (ocpp_ws_simd_select(impls[i]) != 0) {
+			continue;
+		}
+
+		for (size_t off = 0; off + len <= 72; off++) {
+			for (size_t end = off + len; end <= off + len + 8;
+					end += 8) {
+				memset(buf, 'x', sizeof(buf));
+				memcpy(&buf[off], s, len);
+
+				if (ocpp_ws_utf8_valid(buf, end) != expected) {
+					FAIL(ocpp_ws_simd_stringify(impls[i]));
+				}
+			}
+		}
+	}
+}
+
+TEST_GROUP(ws_simd) {
+	void setup(void) {
+		ocpp_ws_simd_select(OCPP_WS_SIMD_AUTO);
+	}
+	void teardown(void) {
+		ocpp_ws_simd_select(OCPP_WS_SIMD_AUTO);
+		mock().checkExpectations();
+		mock().clear();
+	}
+};
+
+TEST(ws_simd, select_ShouldPickAvailableImplementation_WhenAutoGiven) {
+	LONGS_EQUAL(0, ocpp_ws_simd_select(OCPP_WS_SIMD_AUTO));
+	CHECK(ocpp_ws_simd_selected() != OCPP_WS_SIMD_AUTO);
+	LONGS_EQUAL(0, ocpp_ws_simd_select(OCPP_WS_SIMD_SCALAR));
+	LONGS_EQUAL(OCPP_WS_SIMD_SCALAR, ocpp_ws_simd_selected());
+	STRCMP_EQUAL("scalar", ocpp_ws_simd_stringify(ocpp_ws_simd_selected()));
+	LONGS_EQUAL(-ENOTSUP, ocpp_ws_simd_select(
+				(ocpp_ws_simd_t)(OCPP_WS_SIMD_AUTO + 1)));
+	LONGS_EQUAL(OCPP_WS_SIMD_SCALAR, ocpp_ws_simd_selected());
+}
+
+TEST(ws_simd, mask_ShouldMatchReference_WhenAnyImplementationSelected) {
+	const uint8_t key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+	uint8_t expected[300];
+	uint8_t actual[sizeof(expected) + 3];
+
+	srand(1);
+
+	for (size_t len = 0; len <= sizeof(expected); len++) {
+		for (size_t i = 0; i < len; i++) {
+			expected[i] = (uint8_t)rand();
+		}
+
+		for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+			if (ocpp_ws_simd_select(impls[i]) != 0) {
+				continue;
+			}
+
+			/* unaligned on purpose */
+			uint8_t *p = &actual[len & 3];
+			memcpy(p, expected, len);
+			ocpp_ws_mask(p, len, key);
+			mask_reference(p, len, key);
+			MEMCMP_EQUAL(expected, p, len);
+		}
+	}
+}
+
+TEST(ws_simd, utf8_ShouldAccept_WhenWellFormed) {
+	LONGS_EQUAL(true, ocpp_ws_utf8_valid("", 0));
+
+	for (size_t i = 0; i < sizeof(valid) / sizeof(*valid); i++) {
+		check_at_every_offset(valid[i], true);
+	}
+}
+
+TEST(ws_simd, utf8_ShouldReject_WhenIllFormed) {
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(*invalid); i++) {
+		check_at_every_offset(invalid[i], false);
+	}
+}
+
+TEST(ws_simd, utf8_ShouldMatchScalar_WhenRandomBytesGiven) {
+	const char *pieces[] = { "a", "\xc3\xa9", "\xe2\x82\xac",
+		"\xf0\x9f\x98\x80", "\x80", "\xed\xa0\x80", "\xf4\x90" };
+	uint8_t buf[256];
+
+	srand(2);
+
+	for (int n = 0; n < 2000; n++) {
+		size_t len = 0;
+
+		/* mostly well-formed, with an error now and then */
+		while (len + 4 <= sizeof(buf)) {
+			const size_t k = (size_t)rand() % 100;
+			const char *s = pieces[k < 95? k % 4 : 4 + k % 3];
+			memcpy(&buf[len], s, strlen(s));
+			len += strlen(s);
+		}
+		len = (size_t)rand() % (len + 1);
+
+		ocpp_ws_simd_select(OCPP_WS_SIMD_SCALAR);
+		const bool expected = ocpp_ws_utf8_valid(buf, len);
+
+		for (size_t i = 0; i < sizeof(impls) / sizeof(*impls); i++) {
+			if (ocpp_ws_simd_select(impls[i]) != 0) {
+				continue;
+			}
+
+			LONGS_EQUAL(expected, ocpp_ws_utf8_valid(buf, len));
+		}
+	}
+}
@@ -0,0 +1,681 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ws.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define ZLIB_CONST
+#include <zlib.h>
+
+#include <string>
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+/* moved by hand for the pings */
+static time_t clock_now;
+time_t ocpp_get_time(void) {
+	return clock_now;
+}
+
+/* The key of RFC 6455 1.3, accepted as "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=". */
+void ocpp_ws_random(void *buf, size_t len) {
+	static const char nonce[] = "the sample nonce";
+	for (size_t i = 0; i < len; i++) {
+		((char *)buf)[i] = nonce[i % (sizeof(nonce) - 1)];
+	}
+}
+
+static const char *accepted =
+	"HTTP/1.1 101 Switching Protocols\r\n"
+	"Upgrade: websocket\r\n"
+	"Connection: Upgrade\r\n"
+	"Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+	"Sec-WebSocket-Protocol: ocpp1.6\r\n"
+	"\r\n";
+
+static std::string frame(bool fin, uint8_t opcode, const std::string &data) {
+	std::string f;
+	f += (char)((fin? 0x80 : 0) | opcode);
+	if (data.size() < 126) {
+		f += (char)data.size();
+	} else {
+		f += (char)126;
+		f += (char)(data.size() >> 8);
+		f += (char)data.size();
+	}
+	return f + data;
+}
+
+TEST_GROUP(ws) {
+	int listener;
+	int peer;
+	uint16_t port;
+
+	void setup(void) {
+		struct sockaddr_in addr = { };
+		socklen_t len = sizeof(addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		LONGS_EQUAL(0, bind(listener, (struct sockaddr *)&addr, len));
+		LONGS_EQUAL(0, listen(listener, 1));
+		getsockname(listener, (struct sockaddr *)&addr, &len);
+		port = ntohs(addr.sin_port);
+		peer = -1;
+
+		clock_now = 100;
+		ocpp_reset_configuration();
+	}
+	void teardown(void) {
+		ocpp_ws_close(1000);
+		ocpp_ws_close(1000);
+		if (peer >= 0) {
+			close(peer);
+		}
+		close(listener);
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void set_ping_interval(uint32_t sec) {
+		LONGS_EQUAL(0, ocpp_set_configuration("WebSocketPingInterval",
+					&sec, sizeof(sec)));
+	}
+	bool has_data(void) {
+		char c;
+		return recv(peer, &c, 1, MSG_DONTWAIT | MSG_PEEK) > 0;
+	}
+	time_t poll_until_deadline(time_t expected) {
+		time_t deadline = 0;
+		for (int i = 0; i < 100; i++) {
+			LONGS_EQUAL(0, ocpp_ws_poll());
+			LONGS_EQUAL(0, ocpp_ws_get_next_deadline(&deadline));
+			if (deadline == expected) {
+				break;
+			}
+			usleep(1000);
+		}
+		return deadline;
+	}
+
+	/* Polls the client until the server has something to read. */
+	void pump(void) {
+		struct pollfd pfd = { .fd = peer, .events = POLLIN, };
+		for (int i = 0; i < 100; i++) {
+			ocpp_ws_poll();
+			if (poll(&pfd, 1, 10) > 0) {
+				return;
+			}
+		}
+		FAIL("nothing from the client");
+	}
+	std::string read_exactly(size_t n) {
+		std::string s(n, '\0');
+		for (size_t i = 0; i < n; ) {
+			ssize_t r = recv(peer, &s[i], n - i, 0);
+			CHECK(r > 0);
+			i += (size_t)r;
+		}
+		return s;
+	}
+	std::string read_request(void) {
+		std::string s;
+		pump();
+		while (s.find("\r\n\r\n") == std::string::npos) {
+			s += read_exactly(1);
+		}
+		return s;
+	}
+	std::string read_frame(uint8_t *opcode) {
+		pump();
+		std::string h = read_exactly(2);
+		size_t len = (uint8_t)h[1] & 0x7f;
+		CHECK((uint8_t)h[1] & 0x80);
+		if (len == 126) {
+			std::string ext = read_exactly(2);
+			len = (size_t)(uint8_t)ext[0] << 8 | (uint8_t)ext[1];
+		}
+		std::string key = read_exactly(4);
+		std::string data = read_exactly(len);
+		for (size_t i = 0; i < len; i++) {
+			data[i] ^= key[i % 4];
+		}
+		*opcode = (uint8_t)h[0];
+		return data;
+	}
+	void write_raw(const std::string &s) {
+		LONGS_EQUAL((long)s.size(), send(peer, s.data(), s.size(), 0));
+	}
+	int poll_until(ocpp_ws_state_t state) {
+		int err = 0;
+		for (int i = 0; i < 100 && ocpp_ws_get_state() != state; i++) {
+			err = ocpp_ws_poll();
+			usleep(1000);
+		}
+		LONGS_EQUAL(state, ocpp_ws_get_state());
+		return err;
+	}
+	std::string connect(const char *response,
+			const struct ocpp_ws_deflate_param *deflate = NULL) {
+		const struct ocpp_ws_param param = {
+			.host = "127.0.0.1",
+			.port = port,
+			.path = "/ocpp/CP001",
+			.subprotocols = NULL,
+			.deflate = deflate,
+		};
+		LONGS_EQUAL(0, ocpp_ws_open(&param));
+		peer = accept(listener, NULL, NULL);
+		CHECK(peer >= 0);
+		std::string req = read_request();
+		write_raw(response);
+		return req;
+	}
+	void go_open(void) {
+		connect(accepted);
+		poll_until(OCPP_WS_OPEN);
+	}
+	int recv_message(struct ocpp_message *msg) {
+		int err = -ENOMSG;
+		for (int i = 0; i < 100 && err == -ENOMSG; i++) {
+			err = ocpp_recv(msg);
+			usleep(1000);
+		}
+		return err;
+	}
+};
+
+TEST(ws, open_ShouldCompleteHandshake_WhenServerAccepts) {
+	std::string req = connect(accepted);
+	poll_until(OCPP_WS_OPEN);
+
+	CHECK(req.rfind("GET /ocpp/CP001 HTTP/1.1\r\n", 0) == 0);
+	CHECK(req.find("Upgrade: websocket\r\n") != std::string::npos);
+	CHECK(req.find("Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n")
+			!= std::string::npos);
+	CHECK(req.find("Sec-WebSocket-Version: 13\r\n") != std::string::npos);
+	CHECK(req.find("Sec-WebSocket-Protocol: ocpp1.6\r\n")
+			!= std::string::npos);
+	STRCMP_EQUAL("ocpp1.6", ocpp_ws_get_codec()->subprotocol);
+	CHECK(ocpp_ws_get_fd() >= 0);
+}
+
+TEST(ws, open_ShouldReturnEPROTO_WhenAcceptKeyWrong) {
+	std::string response = accepted;
+	response.replace(response.find("s3pP"), 4, "AAAA");
+	connect(response.c_str());
+	LONGS_EQUAL(-EPROTO, poll_until(OCPP_WS_CLOSED));
+}
+
+TEST(ws, open_ShouldReturnEPROTO_WhenSubprotocolNotAgreed) {
+	std::string response = accepted;
+	response.erase(response.find("Sec-WebSocket-Protocol"),
+			strlen("Sec-WebSocket-Protocol: ocpp1.6\r\n"));
+	connect(response.c_str());
+	LONGS_EQUAL(-EPROTO, poll_until(OCPP_WS_CLOSED));
+}
+
+TEST(ws, open_ShouldReturnEPROTO_WhenSubprotocolNotOffered) {
+	std::string response = accepted;
+	response.replace(response.find("ocpp1.6\r\n"), strlen("ocpp1.6"),
+			"ocpp1.6+cbor");
+	connect(response.c_str());
+	LONGS_EQUAL(-EPROTO, poll_until(OCPP_WS_CLOSED));
+}
+
+TEST(ws, open_ShouldReturnECONNREFUSED_WhenUpgradeRefused) {
+	connect("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+	LONGS_EQUAL(-ECONNREFUSED, poll_until(OCPP_WS_CLOSED));
+	LONGS_EQUAL(-1, ocpp_ws_get_fd());
+}
+
+TEST(ws, send_ShouldReturnENOTCONN_WhenNotOpen) {
+	const struct ocpp_message msg = { .id = "1",
+		.role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, };
+	LONGS_EQUAL(-ENOTCONN, ocpp_send(&msg));
+	LONGS_EQUAL(-ENOTCONN, ocpp_recv(NULL));
+}
+
+TEST(ws, send_ShouldWriteMaskedTextFrame) {
+	const struct ocpp_message msg = { .id = "1",
+		.role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, };
+	uint8_t opcode;
+
+	go_open();
+	LONGS_EQUAL(0, ocpp_send(&msg));
+
+	std::string f = read_frame(&opcode);
+	STRCMP_EQUAL("[2,\"1\",\"Heartbeat\",{}]", f.c_str());
+	LONGS_EQUAL(0x81, opcode);
+}
+
+TEST(ws, send_ShouldWriteFrameOfExtendedLength) {
+	struct ocpp_message msg = { .id = "2", .role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_BOOTNOTIFICATION, };
+	struct ocpp_BootNotification boot = {
+		.chargePointModel = "Model",
+		.chargePointSerialNumber = "0123456789012345678901234",
+		.chargePointVendor = "Vendor",
+		.firmwareVersion = "01234567890123456789012345678901234567890",
+		.meterSerialNumber = "0123456789012345678901234",
+	};
+	uint8_t opcode;
+
+	msg.payload.fmt.request = &boot;
+	msg.payload.size = sizeof(boot);
+	go_open();
+	LONGS_EQUAL(0, ocpp_send(&msg));
+
+	std::string f = read_frame(&opcode);
+	CHECK(f.size() > 125);
+	CHECK(f.rfind("[2,\"2\",\"BootNotification\",{", 0) == 0);
+	CHECK(f.find("\"meterSerialNumber\":\"0123456789012345678901234\"")
+			!= std::string::npos);
+	LONGS_EQUAL(0x81, opcode);
+}
+
+TEST(ws, send_ShouldSendInFragments_WhenMessageLargerThanBuffer) {
+	static union {
+		struct ocpp_DataTransfer req;
+		char buf[sizeof(struct ocpp_DataTransfer) +
+			3 * OCPP_WS_TX_BUFSIZE];
+	} u;
+	struct ocpp_message msg = { .id = "3", .role = OCPP_MSG_ROLE_CALL,
+		.type = OCPP_MSG_DATA_TRANSFER, };
+	const std::string data(2 * OCPP_WS_TX_BUFSIZE + 100, 'x');
+	std::string received;
+	uint8_t opcode;
+	int n = 0;
+
+	strcpy(u.req.vendorId, "Vendor");
+	strcpy(u.req.data, data.c_str());
+	msg.payload.fmt.request = &u.req;
+	msg.payload.size = sizeof(u);
+	go_open();
+	LONGS_EQUAL(0, ocpp_send(&msg));
+
+	do {
+		std::string f = read_frame(&opcode);
+		CHECK(f.size() <= OCPP_WS_TX_BUFSIZE);
+		LONGS_EQUAL(n == 0? 0x01 : 0x00, opcode & 0x0f);
+		received += f;
+		n++;
+	} while (!(opcode & 0x80));
+
+	CHECK(n >= 3);
+	STRCMP_EQUAL(("[2,\"3\",\"DataTransfer\",{\"vendorId\":\"Vendor\","
+			"\"data\":\"" + data + "\"}]").c_str(),
+			received.c_str());
+
+	msg.type = OCPP_MSG_HEARTBEAT;
+	msg.payload.size = 0;
+	LONGS_EQUAL(0, ocpp_send(&msg));
+	std::string f = read_frame(&opcode);
+	STRCMP_EQUAL("[2,\"3\",\"Heartbeat\",{}]", f.c_str());
+	LONGS_EQUAL(0x81, opcode);
+}
+
+TEST(ws, sendFrame_ShouldMaskCopyOfFrame_WhenSentAgain) {
+	const struct ocpp_message msg = { .id = "4",
+		.role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, };
+	const char *expected = "[2,\"4\",\"Heartbeat\",{}]";
+	uint8_t cache[64];
+	uint8_t opcode;
+	size_t len;
+
+	LONGS_EQUAL(-ENOTCONN, ocpp_encode_frame(&msg,
+				cache, sizeof(cache), &len));
+	go_open();
+	LONGS_EQUAL(0, ocpp_encode_frame(&msg, cache, sizeof(cache), &len));
+	const std::string kept((const char *)cache, len);
+
+	for (int i = 0; i < 2; i++) {
+		LONGS_EQUAL(0, ocpp_send_frame(&msg, cache, len));
+		std::string f = read_frame(&opcode);
+		STRCMP_EQUAL(expected, f.c_str());
+		LONGS_EQUAL(0x81, opcode);
+		CHECK(kept == std::string((const char *)cache, len));
+	}
+}
+
+TEST(ws, send_ShouldQueueFramesInOrder_WhenSocketWouldBlock) {
+	struct ocpp_message msg = {
+		.role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, };
+	const int size = 1;
+	uint8_t opcode;
+	int n = 0;
+	int err;
+
+	go_open();
+	setsockopt(ocpp_ws_get_fd(), SOL_SOCKET, SO_SNDBUF,
+			&size, sizeof(size));
+	setsockopt(peer, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+	/* the socket fills up first, then the frames queued behind */
+	do {
+		snprintf(msg.id, sizeof(msg.id), "%d", n);
+	} while ((err = ocpp_send(&msg)) == 0 && ++n < 100000);
+	LONGS_EQUAL(-ENOBUFS, err);
+
+	for (int i = 0; i < n; i++) {
+		std::string expected = "[2,\"" + std::to_string(i) +
+			"\",\"Heartbeat\",{}]";
+		std::string f = read_frame(&opcode);
+		STRCMP_EQUAL(expected.c_str(), f.c_str());
+		LONGS_EQUAL(0x81, opcode);
+	}
+
+	LONGS_EQUAL(0, ocpp_send(&msg));
+}
+
+TEST(ws, recv_ShouldAssembleFragments_WhenPingInterleaved) {
+	struct ocpp_message msg = { };
+	uint8_t opcode;
+
+	go_open();
+	write_raw(frame(false, 0x1, "[2,\"42\",\"Re"));
+	write_raw(frame(true, 0x9, "hi"));
+	write_raw(frame(false, 0x0, "set\",{\"type\""));
+	write_raw(frame(true, 0x0, ":\"Soft\"}]"));
+
+	LONGS_EQUAL(0, recv_message(&msg));
+	STRCMP_EQUAL("42", msg.id);
+	LONGS_EQUAL(OCPP_MSG_ROLE_CALL, msg.role);
+	LONGS_EQUAL(OCPP_MSG_RESET, msg.type);
+	LONGS_EQUAL(OCPP_RESET_SOFT,
+		((const struct ocpp_Reset *)msg.payload.fmt.request)->type);
+
+	std::string pong = read_frame(&opcode);
+	STRCMP_EQUAL("hi", pong.c_str());
+	LONGS_EQUAL(0x8A, opcode);
+}
+
+TEST(ws, recv_ShouldReceiveFramesOfExtendedLength) {
+	struct ocpp_message msg = { };
+	std::string vendor(200, 'v');
+
+	go_open();
+	write_raw(frame(true, 0x1, "[2,\"9\",\"DataTransfer\",{\"vendorId\":\""
+				+ vendor + "\"}]"));
+
+	LONGS_EQUAL(0, recv_message(&msg));
+	LONGS_EQUAL(OCPP_MSG_DATA_TRANSFER, msg.type);
+}
+
+TEST(ws, recv_ShouldEchoClose_WhenServerCloses) {
+	struct ocpp_message msg = { };
+	const struct ocpp_message hb = { .id = "1",
+		.role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, };
+	uint8_t opcode;
+
+	go_open();
+	write_raw(frame(true, 0x8, std::string("\x03\xe9", 2)));
+
+	LONGS_EQUAL(-ENOTCONN, recv_message(&msg));
+	LONGS_EQUAL(OCPP_WS_CLOSED, ocpp_ws_get_state());
+	LONGS_EQUAL(1001, ocpp_ws_get_close_code());
+	LONGS_EQUAL(-ENOTCONN, ocpp_send(&hb));
+
+	std::string status = read_frame(&opcode);
+	LONGS_EQUAL(0x88, opcode);
+	MEMCMP_EQUAL("\x03\xe9", status.data(), 2);
+}
+
+TEST(ws, close_ShouldWaitForPeerClose) {
+	uint8_t opcode;
+
+	go_open();
+	ocpp_ws_close(1000);
+	LONGS_EQUAL(OCPP_WS_CLOSING, ocpp_ws_get_state());
+
+	std::string status = read_frame(&opcode);
+	LONGS_EQUAL(0x88, opcode);
+	MEMCMP_EQUAL("\x03\xe8", status.data(), 2);
+
+	write_raw(frame(true, 0x8, status));
+	LONGS_EQUAL(-ENOTCONN, poll_until(OCPP_WS_CLOSED));
+	LONGS_EQUAL(1000, ocpp_ws_get_close_code());
+}
+
+TEST(ws, poll_ShouldReturnECONNRESET_WhenConnectionLost) {
+	go_open();
+	close(peer);
+	peer = -1;
+
+	LONGS_EQUAL(-ECONNRESET, poll_until(OCPP_WS_CLOSED));
+	LONGS_EQUAL(1006, ocpp_ws_get_close_code());
+}
+
+TEST(ws, poll_ShouldFailWith1009_WhenMessageTooLarge) {
+	uint8_t opcode;
+
+	go_open();
+	write_raw(std::string("\x81\x7f\x00\x00\x00\x00\x00\x10\x00\x00", 10));
+
+	LONGS_EQUAL(-EMSGSIZE, poll_until(OCPP_WS_CLOSED));
+	std::string status = read_frame(&opcode);
+	LONGS_EQUAL(0x88, opcode);
+	MEMCMP_EQUAL("\x03\xf1", status.data(), 2);
+}
+
+TEST(ws, poll_ShouldFailWith1002_WhenServerMasks) {
+	uint8_t opcode;
+
+	go_open();
+	write_raw(std::string("\x81\x81\x01\x02\x03\x04\x5a", 7));
+
+	LONGS_EQUAL(-EPROTO, poll_until(OCPP_WS_CLOSED));
+	std::string status = read_frame(&opcode);
+	LONGS_EQUAL(0x88, opcode);
+	MEMCMP_EQUAL("\x03\xea", status.data(), 2);
+}
+
+TEST(ws, poll_ShouldFailWith1002_WhenContinuationUnexpected) {
+	uint8_t opcode;
+
+	go_open();
+	write_raw(frame(true, 0x0, "x"));
+
+	LONGS_EQUAL(-EPROTO, poll_until(OCPP_WS_CLOSED));
+	std::string status = read_frame(&opcode);
+	MEMCMP_EQUAL("\x03\xea", status.data(), 2);
+}
+
+TEST(ws, poll_ShouldFailWith1007_WhenTextNotInUtf8) {
+	uint8_t opcode;
+
+	go_open();
+	/* a 3-byte sequence cut short across the fragments */
+	write_raw(frame(false, 0x1, "\xe2\x82"));
+	write_raw(frame(true, 0x0, "("));
+
+	LONGS_EQUAL(-EILSEQ, poll_until(OCPP_WS_CLOSED));
+	std::string status = read_frame(&opcode);
+	LONGS_EQUAL(0x88, opcode);
+	MEMCMP_EQUAL("\x03\xef", status.data(), 2);
+}
+
+TEST(ws, open_ShouldReturnEPROTO_WhenExtensionNotOffered) {
+	std::string response = accepted;
+	response.insert(response.size() - 2,
+			"Sec-WebSocket-Extensions: permessage-deflate\r\n");
+	connect(response.c_str());
+	LONGS_EQUAL(-EPROTO, poll_until(OCPP_WS_CLOSED));
+}
+
+TEST(ws, poll_ShouldFailWith1002_WhenCompressedNotAgreed) {
+	uint8_t opcode;
+
+	go_open();
+	write_raw(frame(true, 0x41, "x"));
+
+	LONGS_EQUAL(-EPROTO, poll_until(OCPP_WS_CLOSED));
+	std::string status = read_frame(&opcode);
+	MEMCMP_EQUAL("\x03\xea", status.data(), 2);
+}
+
+TEST(ws, deflate_ShouldCompressBothWays_WhenAgreed) {
+	const struct ocpp_ws_deflate_param offer = {
+		.client_max_window_bits = 10,
+		.server_max_window_bits = 12,
+	};
+	const struct ocpp_message heartbeat = { .id = "1",
+		.role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, };
+	const std::string reset = "[2,\"42\",\"Reset\",{\"type\":\"Soft\"}]";
+	std::string response = accepted;
+	struct ocpp_message msg = { };
+	z_stream server_tx = { }, server_rx = { };
+	unsigned char buf[256];
+	uint8_t opcode;
+
+	response.insert(response.size() - 2, "Sec-WebSocket-Extensions: "
+			"permessage-deflate; server_max_window_bits=12\r\n");
+	std::string req = connect(response.c_str(), &offer);
+	poll_until(OCPP_WS_OPEN);
+	CHECK(req.find("Sec-WebSocket-Extensions: permessage-deflate; "
+			"client_max_window_bits=10; server_max_window_bits=12"
+			"\r\n") != std::string::npos);
+
+	/* server to client, in two fragments with RSV1 on the first */
+	LONGS_EQUAL(Z_OK, deflateInit2(&server_tx, 6, Z_DEFLATED, -12, 8,
+				Z_DEFAULT_STRATEGY));
+	server_tx.next_in = (const Bytef *)reset.data();
+	server_tx.avail_in = (uInt)reset.size();
+	server_tx.next_out = buf;
+	server_tx.avail_out = sizeof(buf);
+	LONGS_EQUAL(Z_OK, deflate(&server_tx, Z_SYNC_FLUSH));
+	std::string z((const char *)buf, sizeof(buf) - server_tx.avail_out - 4);
+	deflateEnd(&server_tx);
+
+	write_raw(frame(false, 0x41, z.substr(0, 3)));
+	write_raw(frame(true, 0x0, z.substr(3)));
+	LONGS_EQUAL(0, recv_message(&msg));
+	STRCMP_EQUAL("42", msg.id);
+	LONGS_EQUAL(OCPP_MSG_RESET, msg.type);
+
+	/* client to server, twice to go through the window kept */
+	LONGS_EQUAL(Z_OK, inflateInit2(&server_rx, -10));
+	for (int i = 0; i < 2; i++) {
+		LONGS_EQUAL(0, ocpp_send(&heartbeat));
+		std::string f = read_frame(&opcode) +
+			std::string("\x00\x00\xff\xff", 4);
+		LONGS_EQUAL(0xC1, opcode);
+
+		server_rx.next_in = (const Bytef *)f.data();
+		server_rx.avail_in = (uInt)f.size();
+		server_rx.next_out = buf;
+		server_rx.avail_out = sizeof(buf);
+		LONGS_EQUAL(Z_OK, inflate(&server_rx, Z_SYNC_FLUSH));
+		std::string plain((const char *)buf,
+				sizeof(buf) - server_rx.avail_out);
+		STRCMP_EQUAL("[2,\"1\",\"Heartbeat\",{}]", plain.c_str());
+	}
+	inflateEnd(&server_rx);
+}
+
+TEST(ws, deflate_ShouldFailWith1007_WhenCompressedDataCorrupt) {
+	const struct ocpp_ws_deflate_param offer = { };
+	std::string response = accepted;
+	struct ocpp_message msg = { };
+	uint8_t opcode;
+
+	response.insert(response.size() - 2,
+			"Sec-WebSocket-Extensions: permessage-deflate\r\n");
+	connect(response.c_str(), &offer);
+	poll_until(OCPP_WS_OPEN);
+
+	write_raw(frame(true, 0x41, "\xff\xff\xff"));
+	LONGS_EQUAL(-EBADMSG, recv_message(&msg));
+	LONGS_EQUAL(OCPP_WS_CLOSED, ocpp_ws_get_state());
+	std::string status = read_frame(&opcode);
+	MEMCMP_EQUAL("\x03\xef", status.data(), 2);
+}
+
+TEST(ws, deadline_ShouldReturnENOENT_WhenPingDisabled) {
+	time_t deadline;
+
+	LONGS_EQUAL(-ENOENT, ocpp_ws_get_next_deadline(&deadline));
+	go_open();
+	LONGS_EQUAL(-ENOENT, ocpp_ws_get_next_deadline(&deadline));
+
+	clock_now += 3600;
+	LONGS_EQUAL(0, ocpp_ws_poll());
+	CHECK(!has_data());
+}
+
+TEST(ws, poll_ShouldPing_WhenNothingReceivedForPingInterval) {
+	time_t deadline;
+	uint8_t opcode;
+
+	set_ping_interval(10);
+	go_open();
+	LONGS_EQUAL(0, ocpp_ws_get_next_deadline(&deadline));
+	LONGS_EQUAL(110, deadline);
+
+	clock_now = 109;
+	LONGS_EQUAL(0, ocpp_ws_poll());
+	CHECK(!has_data());
+
+	clock_now = 110;
+	std::string ping = read_frame(&opcode);
+	LONGS_EQUAL(0x89, opcode);
+	LONGS_EQUAL(0, ping.size());
+	/* now waiting for anything to come back */
+	LONGS_EQUAL(0, ocpp_ws_get_next_deadline(&deadline));
+	LONGS_EQUAL(120, deadline);
+
+	clock_now = 112;
+	write_raw(frame(true, 0xA, ""));
+	LONGS_EQUAL(122, poll_until_deadline(122));
+}
+
+TEST(ws, poll_ShouldPutOffPing_WhenAnyFrameReceived) {
+	struct ocpp_message msg = { };
+
+	set_ping_interval(10);
+	go_open();
+
+	clock_now = 105;
+	write_raw(frame(true, 0x1, "[2,\"1\",\"Reset\",{\"type\":\"Soft\"}]"));
+	LONGS_EQUAL(0, recv_message(&msg));
+	LONGS_EQUAL(115, poll_until_deadline(115));
+
+	clock_now = 110;
+	LONGS_EQUAL(0, ocpp_ws_poll());
+	CHECK(!has_data());
+}
+
+TEST(ws, poll_ShouldReturnETIMEDOUT_WhenPingUnanswered) {
+	uint8_t opcode;
+
+	set_ping_interval(10);
+	go_open();
+
+	clock_now = 110;
+	read_frame(&opcode);
+	LONGS_EQUAL(0x89, opcode);
+
+	clock_now = 119;
+	LONGS_EQUAL(0, ocpp_ws_poll());
+	clock_now = 120;
+	LONGS_EQUAL(-ETIMEDOUT, ocpp_ws_poll());
+	LONGS_EQUAL(OCPP_WS_CLOSED, ocpp_ws_get_state());
+}
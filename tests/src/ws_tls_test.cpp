@@ -0,0 +1,413 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ws.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include <string>
+
+int ocpp_lock(void) {
+	return 0;
+}
+int ocpp_unlock(void) {
+	return 0;
+}
+int ocpp_configuration_lock(void) {
+	return 0;
+}
+int ocpp_configuration_unlock(void) {
+	return 0;
+}
+
+/* Self-signed, for 127.0.0.1 and localhost, trusted as its own CA. */
+struct identity {
+	EVP_PKEY *key;
+	X509 *cert;
+	char cert_file[32];
+	char key_file[32];
+};
+
+static void add_ext(X509 *x, int nid, const char *value) {
+	X509V3_CTX ctx;
+	X509V3_set_ctx_nodb(&ctx);
+	X509V3_set_ctx(&ctx, x, x, NULL, NULL, 0);
+	X509_EXTENSION *ext = X509V3_EXT_conf_nid(NULL, &ctx, nid, value);
+	CHECK(ext != NULL);
+	X509_add_ext(x, ext, -1);
+	X509_EXTENSION_free(ext);
+}
+
+static void write_pem(char path[32], bool key, struct identity *id) {
+	strcpy(path, "/tmp/ws_tls_XXXXXX");
+	const int fd = mkstemp(path);
+	CHECK(fd >= 0);
+	FILE *fp = fdopen(fd, "w");
+	if (key) {
+		PEM_write_PrivateKey(fp, id->key, NULL, NULL, 0, NULL, NULL);
+	} else {
+		PEM_write_X509(fp, id->cert);
+	}
+	fclose(fp);
+}
+
+static void make_identity(struct identity *id, const char *cn) {
+	static long serial;
+
+	id->key = EVP_EC_gen("P-256");
+	CHECK(id->key != NULL);
+	id->cert = X509_new();
+	X509_set_version(id->cert, 2);
+	ASN1_INTEGER_set(X509_get_serialNumber(id->cert), ++serial);
+	X509_gmtime_adj(X509_getm_notBefore(id->cert), -60);
+	X509_gmtime_adj(X509_getm_notAfter(id->cert), 3600);
+	X509_set_pubkey(id->cert, id->key);
+
+	X509_NAME *name = X509_get_subject_name(id->cert);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+			(const unsigned char *)cn, -1, -1, 0);
+	X509_set_issuer_name(id->cert, name);
+	add_ext(id->cert, NID_basic_constraints, "critical,CA:TRUE");
+	add_ext(id->cert, NID_subject_alt_name, "IP:127.0.0.1,DNS:localhost");
+	CHECK(X509_sign(id->cert, id->key, EVP_sha256()) > 0);
+
+	write_pem(id->cert_file, false, id);
+	write_pem(id->key_file, true, id);
+}
+
+static void free_identity(struct identity *id) {
+	unlink(id->cert_file);
+	unlink(id->key_file);
+	X509_free(id->cert);
+	EVP_PKEY_free(id->key);
+}
+
+static std::string base64(const uint8_t *data, size_t len) {
+	char out[64];
+	EVP_EncodeBlock((unsigned char *)out, data, (int)len);
+	return out;
+}
+
+static std::string text(const std::string &data) {
+	std::string f;
+	f += (char)0x81;
+	f += (char)data.size();
+	return f + data;
+}
+
+TEST_GROUP(ws_tls) {
+	struct identity csms;
+	struct identity cp;
+	struct identity stranger;
+	struct ocpp_ws_tls_param tls;
+
+	SSL_CTX *ctx;
+	int listener;
+	uint16_t port;
+	int peer;
+	SSL *ssl;
+	bool upgraded;
+	std::string in;
+
+	void setup(void) {
+		make_identity(&csms, "csms");
+		make_identity(&cp, "cp");
+		make_identity(&stranger, "stranger");
+
+		tls = { .ca_file = csms.cert_file,
+			.cert_file = NULL, .key_file = NULL, };
+
+		struct sockaddr_in addr = { };
+		socklen_t len = sizeof(addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		LONGS_EQUAL(0, bind(listener, (struct sockaddr *)&addr, len));
+		LONGS_EQUAL(0, listen(listener, 4));
+		fcntl(listener, F_SETFL, O_NONBLOCK);
+		getsockname(listener, (struct sockaddr *)&addr, &len);
+		port = ntohs(addr.sin_port);
+
+		peer = -1;
+		ssl = NULL;
+		ctx = NULL;
+		serve_as(&csms, TLS1_3_VERSION, true);
+
+		ocpp_reset_configuration();
+	}
+	void teardown(void) {
+		ocpp_ws_close(1000);
+		ocpp_ws_close(1000);
+		ocpp_ws_tls_forget();
+		drop_peer(false);
+		SSL_CTX_free(ctx);
+		close(listener);
+		free_identity(&csms);
+		free_identity(&cp);
+		free_identity(&stranger);
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void serve_as(struct identity *id, int max_version, bool tickets) {
+		static const unsigned char sid_ctx[] = "csms";
+
+		SSL_CTX_free(ctx);
+		ctx = SSL_CTX_new(TLS_server_method());
+		SSL_CTX_use_certificate(ctx, id->cert);
+		SSL_CTX_use_PrivateKey(ctx, id->key);
+		SSL_CTX_set_max_proto_version(ctx, max_version);
+		SSL_CTX_set_session_id_context(ctx, sid_ctx, sizeof(sid_ctx));
+		if (!tickets) {
+			SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+		}
+	}
+	void require_client_cert(void) {
+		X509_STORE_add_cert(SSL_CTX_get_cert_store(ctx), cp.cert);
+		SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER |
+				SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+	}
+	void drop_peer(bool notify) {
+		if (ssl) {
+			if (notify) {
+				SSL_shutdown(ssl);
+			}
+			SSL_free(ssl);
+		}
+		if (peer >= 0) {
+			close(peer);
+		}
+		ssl = NULL;
+		peer = -1;
+		upgraded = false;
+		in.clear();
+	}
+
+	/* Accepts, does the handshakes and answers the upgrade. */
+	void serve(void) {
+		if (peer < 0) {
+			if ((peer = accept(listener, NULL, NULL)) < 0) {
+				return;
+			}
+			fcntl(peer, F_SETFL, O_NONBLOCK);
+			ssl = SSL_new(ctx);
+			SSL_set_fd(ssl, peer);
+			SSL_set_accept_state(ssl);
+		}
+		if (!SSL_is_init_finished(ssl) && SSL_do_handshake(ssl) != 1) {
+			return;
+		}
+		if (upgraded) {
+			return;
+		}
+
+		char buf[1024];
+		const int n = SSL_read(ssl, buf, sizeof(buf));
+		if (n > 0) {
+			in.append(buf, (size_t)n);
+		}
+		if (in.find("\r\n\r\n") == std::string::npos) {
+			return;
+		}
+
+		const char *tag = "Sec-WebSocket-Key: ";
+		const size_t pos = in.find(tag) + strlen(tag);
+		std::string key = in.substr(pos, in.find("\r\n", pos) - pos);
+		key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+		uint8_t digest[SHA_DIGEST_LENGTH];
+		SHA1((const unsigned char *)key.data(), key.size(), digest);
+
+		write("HTTP/1.1 101 Switching Protocols\r\n"
+				"Upgrade: websocket\r\n"
+				"Connection: Upgrade\r\n"
+				"Sec-WebSocket-Accept: " +
+				base64(digest, sizeof(digest)) + "\r\n"
+				"Sec-WebSocket-Protocol: ocpp1.6\r\n"
+				"\r\n");
+		upgraded = true;
+		in.clear();
+	}
+	void write(const std::string &s) {
+		LONGS_EQUAL((long)s.size(), SSL_write(ssl, s.data(),
+					(int)s.size()));
+	}
+	std::string read(size_t n) {
+		std::string s;
+		for (int i = 0; i < 500 && s.size() < n; i++) {
+			char buf[512];
+			const int r = SSL_read(ssl, buf, sizeof(buf));
+			if (r > 0) {
+				s.append(buf, (size_t)r);
+			} else {
+				(void)ocpp_ws_poll();
+				usleep(1000);
+			}
+		}
+		return s;
+	}
+
+	int open(void) {
+		const struct ocpp_ws_param param = {
+			.host = "127.0.0.1",
+			.port = port,
+			.path = "/ocpp/CP001",
+			.subprotocols = NULL,
+			.deflate = NULL,
+			.tls = &tls,
+		};
+		int err = ocpp_ws_open(&param);
+		if (err) {
+			return err;
+		}
+		for (int i = 0; i < 1000 &&
+				ocpp_ws_get_state() != OCPP_WS_OPEN; i++) {
+			if ((err = ocpp_ws_poll()) != 0) {
+				break;
+			}
+			serve();
+			usleep(500);
+		}
+		return err;
+	}
+	/* Drops the connection with no close_notify, as a server restarting
+	 * would, and waits for the transport to tell. */
+	void lose(void) {
+		drop_peer(false);
+		for (int i = 0; i < 500 &&
+				ocpp_ws_get_state() != OCPP_WS_CLOSED; i++) {
+			(void)ocpp_ws_poll();
+			usleep(1000);
+		}
+		LONGS_EQUAL(OCPP_WS_CLOSED, ocpp_ws_get_state());
+	}
+	void get_stats(struct ocpp_ws_tls_stats *stats) {
+		ocpp_ws_tls_get_stats(stats);
+	}
+};
+
+TEST(ws_tls, open_ShouldConnectOverTls_WhenServerVerified) {
+	struct ocpp_ws_tls_stats before;
+	struct ocpp_ws_tls_stats after;
+	struct ocpp_message msg = { };
+
+	get_stats(&before);
+	LONGS_EQUAL(0, open());
+	LONGS_EQUAL(OCPP_WS_OPEN, ocpp_ws_get_state());
+	get_stats(&after);
+	LONGS_EQUAL(before.handshakes + 1, after.handshakes);
+	LONGS_EQUAL(before.resumed, after.resumed);
+	/* the ring does not take TLS */
+	CHECK(!ocpp_ws_uring_active());
+
+	write(text("[2,\"1\",\"Reset\",{\"type\":\"Soft\"}]"));
+	int err = -ENOMSG;
+	for (int i = 0; i < 500 && err == -ENOMSG; i++) {
+		if ((err = ocpp_recv(&msg)) == -ENOMSG) {
+			usleep(1000);
+		}
+	}
+	LONGS_EQUAL(0, err);
+	STRCMP_EQUAL("1", msg.id);
+	LONGS_EQUAL(OCPP_MSG_RESET, msg.type);
+
+	const struct ocpp_message hb = { .id = "2",
+		.role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, };
+	LONGS_EQUAL(0, ocpp_send(&hb));
+	const std::string frame = read(2);
+	LONGS_EQUAL(0x81, (uint8_t)frame[0]);
+}
+
+TEST(ws_tls, open_ShouldResumeWithTicket_WhenReconnectingAfterLinkLost) {
+	struct ocpp_ws_tls_stats before;
+	struct ocpp_ws_tls_stats after;
+
+	LONGS_EQUAL(0, open());
+	CHECK(!SSL_session_reused(ssl));
+	lose();
+
+	get_stats(&before);
+	LONGS_EQUAL(0, open());
+	get_stats(&after);
+	CHECK(SSL_session_reused(ssl));
+	LONGS_EQUAL(TLS1_3_VERSION, SSL_version(ssl));
+	LONGS_EQUAL(before.handshakes + 1, after.handshakes);
+	LONGS_EQUAL(before.resumed + 1, after.resumed);
+}
+
+TEST(ws_tls, open_ShouldResumeWithSessionId_WhenServerGivesNoTicket) {
+	serve_as(&csms, TLS1_2_VERSION, false);
+
+	LONGS_EQUAL(0, open());
+	CHECK(!SSL_session_reused(ssl));
+	ocpp_ws_close(1000);
+	ocpp_ws_close(1000);
+	drop_peer(true);
+
+	LONGS_EQUAL(0, open());
+	CHECK(SSL_session_reused(ssl));
+	LONGS_EQUAL(TLS1_2_VERSION, SSL_version(ssl));
+}
+
+TEST(ws_tls, open_ShouldReturnEPROTO_WhenServerNotVerified) {
+	serve_as(&stranger, TLS1_3_VERSION, true);
+
+	LONGS_EQUAL(-EPROTO, open());
+	LONGS_EQUAL(OCPP_WS_CLOSED, ocpp_ws_get_state());
+}
+
+TEST(ws_tls, open_ShouldDoFullHandshake_WhenLastOneFailedOnTlsError) {
+	struct ocpp_ws_tls_stats before;
+	struct ocpp_ws_tls_stats after;
+
+	LONGS_EQUAL(0, open());
+	lose();
+
+	/* the session is given up along with the connection */
+	serve_as(&stranger, TLS1_3_VERSION, true);
+	LONGS_EQUAL(-EPROTO, open());
+	drop_peer(false);
+
+	serve_as(&csms, TLS1_3_VERSION, true);
+	get_stats(&before);
+	LONGS_EQUAL(0, open());
+	get_stats(&after);
+	CHECK(!SSL_session_reused(ssl));
+	LONGS_EQUAL(before.resumed, after.resumed);
+}
+
+TEST(ws_tls, open_ShouldPresentClientCertificate_ForSecurityProfile3) {
+	require_client_cert();
+	tls.cert_file = cp.cert_file;
+	tls.key_file = cp.key_file;
+
+	LONGS_EQUAL(0, open());
+	X509 *presented = SSL_get1_peer_certificate(ssl);
+	CHECK(presented != NULL);
+	LONGS_EQUAL(0, X509_cmp(presented, cp.cert));
+	X509_free(presented);
+}
+
+TEST(ws_tls, open_ShouldReturnENOENT_WhenCertificateNotLoaded) {
+	tls.ca_file = "/nonexistent/ca.pem";
+	LONGS_EQUAL(-ENOENT, open());
+
+	tls.ca_file = csms.cert_file;
+	tls.cert_file = cp.cert_file;
+	tls.key_file = stranger.key_file;
+	LONGS_EQUAL(-ENOENT, open());
+}
@@ -0,0 +1,250 @@
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include "ocpp/ws.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+/* Built along with ws_test.cpp, which runs the transport over the ring as
+ * well and gives the overrides. */
+
+static const char *accepted =
+	"HTTP/1.1 101 Switching Protocols\r\n"
+	"Upgrade: websocket\r\n"
+	"Connection: Upgrade\r\n"
+	"Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+	"Sec-WebSocket-Protocol: ocpp1.6\r\n"
+	"\r\n";
+
+static std::string text(const std::string &data) {
+	std::string f;
+	f += (char)0x81;
+	if (data.size() < 126) {
+		f += (char)data.size();
+	} else {
+		f += (char)126;
+		f += (char)(data.size() >> 8);
+		f += (char)data.size();
+	}
+	return f + data;
+}
+
+TEST_GROUP(ws_uring) {
+	int listener;
+	int peer;
+	uint16_t port;
+
+	void setup(void) {
+		struct sockaddr_in addr = { };
+		socklen_t len = sizeof(addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+		LONGS_EQUAL(0, bind(listener, (struct sockaddr *)&addr, len));
+		LONGS_EQUAL(0, listen(listener, 1));
+		getsockname(listener, (struct sockaddr *)&addr, &len);
+		port = ntohs(addr.sin_port);
+		peer = -1;
+
+		ocpp_reset_configuration();
+	}
+	void teardown(void) {
+		ocpp_ws_close(1000);
+		ocpp_ws_close(1000);
+		if (peer >= 0) {
+			close(peer);
+		}
+		close(listener);
+		mock().checkExpectations();
+		mock().clear();
+	}
+
+	void go_open(void) {
+		const struct ocpp_ws_param param = {
+			.host = "127.0.0.1",
+			.port = port,
+			.path = "/ocpp/CP001",
+			.subprotocols = NULL,
+			.deflate = NULL,
+		};
+		LONGS_EQUAL(0, ocpp_ws_open(&param));
+		peer = accept(listener, NULL, NULL);
+		CHECK(peer >= 0);
+		for (int i = 0; i < 100 &&
+				ocpp_ws_get_state() != OCPP_WS_OPEN; i++) {
+			ocpp_ws_poll();
+			/* the request taken in whole, then answered */
+			char buf[512];
+			if (recv(peer, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+				write_raw(accepted);
+			}
+			usleep(1000);
+		}
+		LONGS_EQUAL(OCPP_WS_OPEN, ocpp_ws_get_state());
+	}
+	void write_raw(const std::string &s) {
+		LONGS_EQUAL((long)s.size(), send(peer, s.data(), s.size(), 0));
+	}
+	/* Reads from the server side until n frames of the client are in. */
+	size_t count_frames(size_t n) {
+		std::string s;
+		size_t frames = 0;
+		size_t pos = 0;
+		struct pollfd pfd = { .fd = peer, .events = POLLIN, };
+
+		while (frames < n && poll(&pfd, 1, 1000) > 0) {
+			char buf[4096];
+			ssize_t r = recv(peer, buf, sizeof(buf), 0);
+			CHECK(r > 0);
+			s.append(buf, (size_t)r);
+
+			/* short frames, masked: 2 + 4 + length */
+			while (pos + 2 <= s.size() &&
+					pos + 6 + ((uint8_t)s[pos + 1] & 0x7f)
+					<= s.size()) {
+				pos += 6 + ((uint8_t)s[pos + 1] & 0x7f);
+				frames++;
+			}
+		}
+		return frames;
+	}
+	int recv_message(struct ocpp_message *msg) {
+		int err = -ENOMSG;
+		for (int i = 0; i < 100 && err == -ENOMSG; i++) {
+			err = ocpp_recv(msg);
+			if (err == -ENOMSG) {
+				usleep(1000);
+			}
+		}
+		return err;
+	}
+};
+
+TEST(ws_uring, open_ShouldHandSocketToRing_WhenConnected) {
+	go_open();
+
+	CHECK(ocpp_ws_uring_active());
+	LONGS_EQUAL(ocpp_ws_uring_get_fd(), ocpp_ws_get_fd());
+	CHECK(!ocpp_ws_wants_write());
+}
+
+TEST(ws_uring, send_ShouldChainFramesInOneSubmission_WhenQueued) {
+	const struct ocpp_message msg = { .id = "1",
+		.role = OCPP_MSG_ROLE_CALL, .type = OCPP_MSG_HEARTBEAT, };
+	struct ocpp_ws_uring_stats before;
+	struct ocpp_ws_uring_stats after;
+
+	go_open();
+	ocpp_ws_uring_get_stats(&before);
+
+	for (int i = 0; i < 10; i++) {
+		LONGS_EQUAL(0, ocpp_send(&msg));
+	}
+	ocpp_ws_uring_get_stats(&after);
+	LONGS_EQUAL(before.enters, after.enters);
+
+	LONGS_EQUAL(0, ocpp_ws_uring_submit());
+	ocpp_ws_uring_get_stats(&after);
+	LONGS_EQUAL(before.enters + 1, after.enters);
+	LONGS_EQUAL(before.writes + 10, after.writes);
+
+	LONGS_EQUAL(10, count_frames(10));
+}
+
+TEST(ws_uring, recv_ShouldTakeMessagesWithNoSyscall_WhenAlreadyReceived) {
+	struct ocpp_message msg = { };
+	struct ocpp_ws_uring_stats before;
+	struct ocpp_ws_uring_stats after;
+	std::string frames;
+
+	go_open();
+	for (int i = 0; i < 20; i++) {
+		frames += text("[2,\"" + std::to_string(i) +
+				"\",\"Reset\",{\"type\":\"Soft\"}]");
+	}
+	write_raw(frames);
+	usleep(10000);
+
+	ocpp_ws_uring_get_stats(&before);
+	for (int i = 0; i < 20; i++) {
+		const std::string id = std::to_string(i);
+		LONGS_EQUAL(0, ocpp_recv(&msg));
+		STRCMP_EQUAL(id.c_str(), msg.id);
+	}
+	ocpp_ws_uring_get_stats(&after);
+
+	/* nothing to submit, so the ring is not entered at all */
+	LONGS_EQUAL(before.enters, after.enters);
+	LONGS_EQUAL(before.arms, after.arms);
+}
+
+TEST(ws_uring, recv_ShouldArmAgain_WhenBuffersRanOut) {
+	struct ocpp_message msg = { };
+	struct ocpp_ws_uring_stats stats;
+	const std::string vendor(100, 'v');
+	const int n = OCPP_WS_URING_RX_BUFS * OCPP_WS_URING_RX_BUFSIZE / 100;
+
+	go_open();
+	/* more than the buffers provided, each write filling one */
+	for (int i = 0; i < n; i++) {
+		write_raw(text("[2,\"" + std::to_string(i) +
+				"\",\"DataTransfer\",{\"vendorId\":\"" +
+				vendor + "\"}]"));
+	}
+
+	for (int i = 0; i < n; i++) {
+		const std::string id = std::to_string(i);
+		LONGS_EQUAL(0, recv_message(&msg));
+		STRCMP_EQUAL(id.c_str(), msg.id);
+	}
+
+	ocpp_ws_uring_get_stats(&stats);
+	CHECK(stats.arms > 1);
+}
+
+TEST(ws_uring, poll_ShouldReturnECONNRESET_WhenServerGone) {
+	go_open();
+	close(peer);
+	peer = -1;
+
+	int err = 0;
+	for (int i = 0; i < 100 &&
+			ocpp_ws_get_state() != OCPP_WS_CLOSED; i++) {
+		err = ocpp_ws_poll();
+		usleep(1000);
+	}
+	LONGS_EQUAL(-ECONNRESET, err);
+	CHECK(!ocpp_ws_uring_active());
+}
+
+TEST(ws_uring, stop_ShouldGiveSocketBackNonBlocking) {
+	uint8_t buf[64];
+	int sv[2];
+
+	LONGS_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv));
+	LONGS_EQUAL(0, ocpp_ws_uring_start(sv[0], buf, sizeof(buf)));
+	CHECK(!(fcntl(sv[0], F_GETFL) & O_NONBLOCK));
+
+	ocpp_ws_uring_stop();
+	CHECK(fcntl(sv[0], F_GETFL) & O_NONBLOCK);
+
+	close(sv[0]);
+	close(sv[1]);
+}
+
+TEST(ws_uring, start_ShouldLeaveTransportOnSocket_WhenRingCanNotTakeIt) {
+	uint8_t buf[64];
+	LONGS_EQUAL(-EBADF, ocpp_ws_uring_start(-1, buf, sizeof(buf)));
+	CHECK(!ocpp_ws_uring_active());
+	LONGS_EQUAL(-1, ocpp_ws_uring_get_fd());
+}
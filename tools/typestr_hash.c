@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2024 권경환 Kyunghwan Kwon <k@libmcu.org>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Searches the seed of the minimal perfect hash over the message type names
+ * in src/ocpp.c and prints it along with its slot table, to paste over
+ * TYPESTR_HASH_SEED and the slots of ocpp_get_type_from_strn().
+ *
+ *   make typestr_hash
+ *
+ * Run it again whenever a message type is added. The hash has to stay the
+ * same as hash_typestr() of src/ocpp.c.
+ */
+
+#include "ocpp/ocpp.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TYPESTR_HASH_BITS		6
+#define NR_SLOTS			(1u << TYPESTR_HASH_BITS)
+
+#define TYPE(x)				{ x, #x }
+
+/* The names of the constants to print, as ocpp_message_t does not tell. */
+static const struct {
+	ocpp_message_t type;
+	const char *name;
+} types[] = {
+	TYPE(OCPP_MSG_AUTHORIZE),
+	TYPE(OCPP_MSG_BOOTNOTIFICATION),
+	TYPE(OCPP_MSG_CHANGE_AVAILABILITY),
+	TYPE(OCPP_MSG_CHANGE_CONFIGURATION),
+	TYPE(OCPP_MSG_CLEAR_CACHE),
+	TYPE(OCPP_MSG_DATA_TRANSFER),
+	TYPE(OCPP_MSG_GET_CONFIGURATION),
+	TYPE(OCPP_MSG_HEARTBEAT),
+	TYPE(OCPP_MSG_METER_VALUES),
+	TYPE(OCPP_MSG_REMOTE_START_TRANSACTION),
+	TYPE(OCPP_MSG_REMOTE_STOP_TRANSACTION),
+	TYPE(OCPP_MSG_RESET),
+	TYPE(OCPP_MSG_START_TRANSACTION),
+	TYPE(OCPP_MSG_STATUS_NOTIFICATION),
+	TYPE(OCPP_MSG_STOP_TRANSACTION),
+	TYPE(OCPP_MSG_UNLOCK_CONNECTOR),
+	TYPE(OCPP_MSG_DIAGNOSTICS_NOTIFICATION),
+	TYPE(OCPP_MSG_FIRMWARE_NOTIFICATION),
+	TYPE(OCPP_MSG_GET_DIAGNOSTICS),
+	TYPE(OCPP_MSG_UPDATE_FIRMWARE),
+	TYPE(OCPP_MSG_GET_LOCAL_LIST_VERSION),
+	TYPE(OCPP_MSG_SEND_LOCAL_LIST),
+	TYPE(OCPP_MSG_CANCEL_RESERVATION),
+	TYPE(OCPP_MSG_RESERVE_NOW),
+	TYPE(OCPP_MSG_CLEAR_CHARGING_PROFILE),
+	TYPE(OCPP_MSG_GET_COMPOSITE_SCHEDULE),
+	TYPE(OCPP_MSG_SET_CHARGING_PROFILE),
+	TYPE(OCPP_MSG_TRIGGER_MESSAGE),
+	TYPE(OCPP_MSG_CERTIFICATE_SIGNED),
+	TYPE(OCPP_MSG_DELETE_CERTIFICATE),
+	TYPE(OCPP_MSG_EXTENDED_TRIGGER_MESSAGE),
+	TYPE(OCPP_MSG_GET_INSTALLED_CERTIFICATE_IDS),
+	TYPE(OCPP_MSG_GET_LOG),
+	TYPE(OCPP_MSG_INSTALL_CERTIFICATE),
+	TYPE(OCPP_MSG_LOG_STATUS_NOTIFICATION),
+	TYPE(OCPP_MSG_SECURITY_EVENT_NOTIFICATION),
+	TYPE(OCPP_MSG_SIGN_CERTIFICATE),
+	TYPE(OCPP_MSG_SIGNED_FIRMWARE_STATUS_NOTIFICATION),
+	TYPE(OCPP_MSG_SIGNED_UPDATE_FIRMWARE),
+};
+
+/* not called, but for src/ocpp.c to link */
+int ocpp_lock(void) { return 0; }
+int ocpp_unlock(void) { return 0; }
+int ocpp_configuration_lock(void) { return 0; }
+int ocpp_configuration_unlock(void) { return 0; }
+int ocpp_send(const struct ocpp_message *msg) { (void)msg; return -ENOTSUP; }
+int ocpp_recv(struct ocpp_message *msg) { (void)msg; return -ENOMSG; }
+
+static uint32_t hash_typestr(uint32_t seed, const char *str, size_t len)
+{
+	uint32_t h = seed;
+
+	for (size_t i = 0; i < len; i++) {
+		h ^= (uint8_t)str[i];
+		h *= 16777619u;
+	}
+
+	return h >> (32 - TYPESTR_HASH_BITS);
+}
+
+static bool place(uint32_t seed, int slots[NR_SLOTS])
+{
+	for (unsigned int i = 0; i < NR_SLOTS; i++) {
+		slots[i] = -1;
+	}
+
+	for (int i = 0; i < (int)(sizeof(types) / sizeof(*types)); i++) {
+		const char *s = ocpp_stringify_type(types[i].type);
+		const uint32_t slot = hash_typestr(seed, s, strlen(s));
+
+		if (slots[slot] >= 0) {
+			return false;
+		}
+
+		slots[slot] = i;
+	}
+
+	return true;
+}
+
+int main(void)
+{
+	int slots[NR_SLOTS];
+	uint32_t seed = 0;
+
+	if (sizeof(types) / sizeof(*types) != OCPP_MSG_MAX) {
+		fprintf(stderr, "types[] of %s is missing a message type\n",
+				__FILE__);
+		return 1;
+	}
+
+	while (!place(seed, slots)) {
+		if (++seed == 0) {
+			fprintf(stderr, "no seed for %u slots\n", NR_SLOTS);
+			return 1;
+		}
+	}
+
+	printf("#define TYPESTR_HASH_SEED\t\t0x%xu\n\n", seed);
+
+	for (unsigned int i = 0; i < NR_SLOTS; i++) {
+		if (slots[i] < 0) {
+			continue;
+		}
+
+		const int t = slots[i];
+		printf("\t\t[%u] = { %s + 1, %zu },\n", i, types[t].name,
+				strlen(ocpp_stringify_type(types[t].type)));
+	}
+
+	return 0;
+}